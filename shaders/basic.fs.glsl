@@ -1,64 +1,88 @@
-#version 330 core
+#version 450 core
 
-#define NUM_MATERIALS	1
+// Features of the permutation, 0 or 1, see MaterialFeatures in Material.hpp
+//   ALBEDO_MAP, METALLIC_ROUGHNESS_MAP, NORMAL_MAP, ALPHA_TEST, COMPACT_GBUFFER
 
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec4 gAlbedoSpec;
-layout (location = 3) out vec4 gMetallicRoughness;
+// See GBuffer.hpp for the layouts
+layout (location = 0) out vec4 gNormal;
+layout (location = 1) out vec4 gAlbedoMetallic;
+layout (location = 2) out vec4 gRoughness;
+layout (location = 3) out vec4 gPosition;
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+#if NORMAL_MAP
 in mat3 TBN;
-in float MaterialID;
+#endif
+flat in uint DrawID;
+
+#include "include/drawdata.glsl"
+#include "include/material.glsl"
 
 struct Material {
-	vec4 baseColor;
 	sampler2D albedo;
 	sampler2D metallicRoughness;
 	sampler2D normal;
-	float metallicFactor;
-	float roughnessFactor;
-
-	bool hasAlbedo;
-	bool hasMetallicRoughness;
 };
 
-uniform Material materials[NUM_MATERIALS];
 uniform Material material;
-uniform samplerCube depthMap;
+
+#if COMPACT_GBUFFER
+// Octahedral mapping of a unit vector to [0, 1]^2
+vec2 OctEncode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+
+	vec2 p = n.xy;
+	if (n.z < 0.0) {
+		p = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+
+	return p * 0.5 + 0.5;
+}
+#endif
 
 void main()
 {
-	vec3 normal = normalize(Normal);
+	MaterialData params = materials[draws[DrawID].materialId];
 
-	normal = texture(material.normal, TexCoords).rgb;
+#if NORMAL_MAP
+	vec3 normal = texture(material.normal, TexCoords).rgb;
 	normal = normal * 2.0 - 1.0;
 	normal = normalize(TBN * normal);
+#else
+	vec3 normal = normalize(Normal);
+#endif
 
+#if ALBEDO_MAP
 	vec4 tex = texture(material.albedo, TexCoords);
-//	vec4 tex = texture(materials[int(MaterialID)].diffuse, TexCoords);
+#else
+	vec4 tex = vec4(1.0);
+#endif
+
+	// Only without the pre-pass: after it the GL_EQUAL test already rejects the holes,
+	// and with depth writes off the test can run before the shader
+#if ALPHA_TEST
 	if (tex.a < 0.0001)
 		discard ;
+#endif
 
-	gPosition = FragPos;
-	gNormal = normal;
-	if (material.hasAlbedo) {
-		gAlbedoSpec.rgb = texture(material.albedo, TexCoords).rgb * material.baseColor.rgb;
-	}
-	else {
-		gAlbedoSpec.rgb = material.baseColor.rgb;
-	}
-	gAlbedoSpec.a = 0.0;
+	float metallic = params.metallicFactor;
+	float roughness = params.roughnessFactor;
 
-	gMetallicRoughness = vec4(0.0);
-	if (material.hasMetallicRoughness) {
-		gMetallicRoughness.b = texture(material.metallicRoughness, TexCoords).b * material.metallicFactor;
-		gMetallicRoughness.g = texture(material.metallicRoughness, TexCoords).g * material.roughnessFactor;
-	}
-	else {
-		gMetallicRoughness.b = material.metallicFactor;
-		gMetallicRoughness.g = material.roughnessFactor;
-	}
+#if METALLIC_ROUGHNESS_MAP
+	vec4 metallicRoughness = texture(material.metallicRoughness, TexCoords);
+	metallic *= metallicRoughness.b;
+	roughness *= metallicRoughness.g;
+#endif
+
+#if COMPACT_GBUFFER
+	gNormal = vec4(OctEncode(normal), 0.0, 0.0);
+#else
+	gNormal = vec4(normal, 0.0);
+#endif
+	gAlbedoMetallic = vec4(tex.rgb * params.baseColor.rgb, metallic);
+	gRoughness = vec4(roughness, 0.0, 0.0, 0.0);
+	gPosition = vec4(FragPos, 1.0);
 }
@@ -1,33 +1,45 @@
-#version 330 core
+#version 450 core
 
 layout (location = 0) in vec3 in_position;
 layout (location = 1) in vec3 in_normal;
 layout (location = 2) in vec2 tex_coords;
 layout (location = 3) in vec4 in_tangent;
-layout (location = 4) in float in_material;
+layout (location = 5) in uint in_drawId;
+
+#include "include/drawdata.glsl"
 
 uniform mat4 projectionMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 viewProjectionMatrix;
-uniform mat4 modelMatrix;
 uniform vec3 viewPos;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
+#if NORMAL_MAP
 out mat3 TBN;
-out float MaterialID;
+#endif
+flat out uint DrawID;
+
+// Must match depth.vs.glsl for the GL_EQUAL test after the depth pre-pass
+invariant gl_Position;
 
 void main()
 {
-	gl_Position = viewProjectionMatrix * modelMatrix * vec4(in_position, 1.0);
-	FragPos = vec3(modelMatrix * vec4(in_position, 1.0));
+	mat4 modelMatrix = draws[in_drawId].model;
+	// Packed positions are normalized over the bounds of the mesh
+	vec3 position = draws[in_drawId].positionOffset.xyz + in_position * draws[in_drawId].positionScale.xyz;
+
+	gl_Position = viewProjectionMatrix * modelMatrix * vec4(position, 1.0);
+	FragPos = vec3(modelMatrix * vec4(position, 1.0));
 	TexCoords = tex_coords;
-	Normal = mat3(transpose(inverse(modelMatrix))) * in_normal;
-	MaterialID = in_material;
+	Normal = mat3(draws[in_drawId].normal) * in_normal;
+	DrawID = in_drawId;
 
-	vec3 T = normalize(vec3(modelMatrix * in_tangent));
+#if NORMAL_MAP
+	vec3 T = normalize(vec3(modelMatrix * vec4(in_tangent.xyz, 0.0)));
 	vec3 N = normalize(vec3(modelMatrix * vec4(in_normal, 0.0)));
 	vec3 B = normalize(cross(N, T)) * in_tangent.w;
 	TBN = mat3(T, B, N);
+#endif
 }
@@ -0,0 +1,25 @@
+#version 450 core
+
+layout (location = 0) in vec3 in_position;
+layout (location = 2) in vec2 tex_coords;
+layout (location = 5) in uint in_drawId;
+
+#include "include/drawdata.glsl"
+
+uniform mat4 viewProjectionMatrix;
+
+out vec2 TexCoords;
+flat out uint DrawID;
+
+// The G-buffer pass tests against this depth with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+	mat4 modelMatrix = draws[in_drawId].model;
+	vec3 position = draws[in_drawId].positionOffset.xyz + in_position * draws[in_drawId].positionScale.xyz;
+
+	gl_Position = viewProjectionMatrix * modelMatrix * vec4(position, 1.0);
+	TexCoords = tex_coords;
+	DrawID = in_drawId;
+}
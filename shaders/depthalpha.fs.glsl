@@ -0,0 +1,13 @@
+#version 450 core
+
+in vec2 TexCoords;
+
+uniform sampler2D albedo;
+
+// Same test as basic.fs.glsl, only the alpha-tested buckets are drawn with it and they
+// all have an albedo map
+void main()
+{
+	if (texture(albedo, TexCoords).a < 0.0001)
+		discard ;
+}
@@ -0,0 +1,143 @@
+#version 450 core
+#define LOCAL_SIZE 64
+
+layout (local_size_x = LOCAL_SIZE) in;
+
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+struct DrawBounds {
+	vec3 boundsMin;
+	uint bucket;
+	vec3 boundsMax;
+	uint bucketFirst;
+};
+
+layout (std430, binding = 5) readonly buffer CommandBuffer {
+	DrawCommand commands[];
+};
+
+layout (std430, binding = 6) readonly buffer BoundsBuffer {
+	DrawBounds bounds[];
+};
+
+layout (std430, binding = 7) writeonly buffer CulledCommandBuffer {
+	DrawCommand culledCommands[];
+};
+
+layout (std430, binding = 8) buffer DrawCountBuffer {
+	uint drawCounts[];
+};
+
+// Range of the commands culled by this dispatch
+uniform uint firstCommand;
+uniform uint commandCount;
+uniform vec4 frustumPlanes[6];
+
+// Commands are appended behind a counter, or kept in place with no instance
+uniform bool compact;
+// One counter and output range per bucket, or a single list. The output offset is
+// the one of the first command, bucket ranges are only used with the whole queue
+uniform bool perBucket;
+uniform uint outputOffset;
+uniform uint counterOffset;
+
+// Depth pyramid of the previous frame
+uniform bool occlusion;
+uniform sampler2D hiZ;
+uniform mat4 hiZViewProjection;
+uniform vec2 depthSize;
+uniform int hiZLevels;
+
+bool InsideFrustum(vec3 boundsMin, vec3 boundsMax)
+{
+	for (int i = 0; i < 6; i++) {
+		vec3 positive = mix(boundsMin, boundsMax, greaterThanEqual(frustumPlanes[i].xyz, vec3(0.0)));
+
+		if (dot(frustumPlanes[i].xyz, positive) + frustumPlanes[i].w < 0.0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Occluded(vec3 boundsMin, vec3 boundsMax)
+{
+	vec2 rectMin = vec2(1.0);
+	vec2 rectMax = vec2(0.0);
+	float nearest = 1.0;
+
+	for (int i = 0; i < 8; i++) {
+		vec3 corner = mix(boundsMin, boundsMax, bvec3(i & 1, i & 2, i & 4));
+		vec4 clip = hiZViewProjection * vec4(corner, 1.0);
+
+		// Reaches behind the previous camera
+		if (clip.w <= 0.0) {
+			return false;
+		}
+
+		vec3 ndc = clip.xyz / clip.w;
+
+		rectMin = min(rectMin, ndc.xy * 0.5 + 0.5);
+		rectMax = max(rectMax, ndc.xy * 0.5 + 0.5);
+		nearest = min(nearest, ndc.z * 0.5 + 0.5);
+	}
+
+	ivec2 pixelMin = ivec2(clamp(rectMin, 0.0, 1.0) * (depthSize - 1.0));
+	ivec2 pixelMax = ivec2(clamp(rectMax, 0.0, 1.0) * (depthSize - 1.0));
+
+	// Level 0 of the pyramid is at half the depth resolution, pick the one where
+	// the rectangle spans at most two texels
+	vec2 extent = vec2(pixelMax - pixelMin + 1);
+	int level = clamp(int(ceil(log2(max(extent.x, extent.y)))) - 1, 0, hiZLevels - 1);
+
+	ivec2 texelMin = pixelMin >> (level + 1);
+	ivec2 texelMax = pixelMax >> (level + 1);
+
+	float farthest = 0.0;
+
+	for (int y = texelMin.y; y <= texelMax.y; y++) {
+		for (int x = texelMin.x; x <= texelMax.x; x++) {
+			farthest = max(farthest, texelFetch(hiZ, ivec2(x, y), level).r);
+		}
+	}
+
+	return nearest > farthest;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+
+	if (index >= commandCount) {
+		return;
+	}
+
+	DrawCommand command = commands[firstCommand + index];
+	DrawBounds box = bounds[firstCommand + index];
+
+	bool visible = InsideFrustum(box.boundsMin, box.boundsMax)
+		&& !(occlusion && Occluded(box.boundsMin, box.boundsMax));
+
+	if (compact) {
+		if (!visible) {
+			return;
+		}
+
+		uint counter = counterOffset + (perBucket ? box.bucket : 0u);
+		uint first = outputOffset + (perBucket ? box.bucketFirst : 0u);
+
+		culledCommands[first + atomicAdd(drawCounts[counter], 1u)] = command;
+	}
+	else {
+		if (!visible) {
+			command.instanceCount = 0u;
+		}
+		culledCommands[outputOffset + index] = command;
+	}
+}
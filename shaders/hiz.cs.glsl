@@ -0,0 +1,29 @@
+#version 450 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// Depth texture for the first level, the pyramid itself for the others
+uniform sampler2D source;
+uniform int sourceLevel;
+
+layout (r32f, binding = 0) uniform writeonly image2D destination;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+	if (any(greaterThanEqual(texel, imageSize(destination)))) {
+		return;
+	}
+
+	ivec2 sourceMax = textureSize(source, sourceLevel) - 1;
+	float depth = 0.0;
+
+	// Farthest depth of the 2x2 footprint, odd sizes are covered by the last texel
+	for (int i = 0; i < 4; i++) {
+		ivec2 p = min(texel * 2 + ivec2(i & 1, i >> 1), sourceMax);
+		depth = max(depth, texelFetch(source, p, sourceLevel).r);
+	}
+
+	imageStore(destination, texel, vec4(depth));
+}
@@ -0,0 +1,14 @@
+// Per-draw data of the draw queues, see DrawQueue.hpp for the layout
+struct DrawData {
+	mat4 model;
+	mat4 normal;
+	// Index in the material table, see material.glsl
+	uint materialId;
+	uint padding[3];
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+	DrawData draws[];
+};
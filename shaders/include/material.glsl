@@ -0,0 +1,11 @@
+// Parameters of the materials, indexed by DrawData.materialId, see MaterialTable.hpp
+struct MaterialData {
+	vec4 baseColor;
+	float metallicFactor;
+	float roughnessFactor;
+	uint padding[2];
+};
+
+layout (std430, binding = 9) readonly buffer MaterialBuffer {
+	MaterialData materials[];
+};
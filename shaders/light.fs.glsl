@@ -1,12 +1,15 @@
 #version 450 core
-#define MAX_NUM_POINT_LIGHTS		16
-#define MAX_NUM_DIRECTIONAL_LIGHTS	1
+
+// Defined by MeshRendererSystem: MAX_NUM_DIRECTIONAL_LIGHTS, NUM_SHADOW_TIERS, and the
+// features of the permutation, 0 or 1: COMPACT_GBUFFER, SSAO
 
 struct PointLight {
 	vec3 position;
+	float radius;
 	vec3 color;
 	float intensity;
-	float radius;
+	int shadowTier;
+	int shadowLayer;
 };
 
 struct DirectionalLight {
@@ -18,47 +21,150 @@ struct DirectionalLight {
 out vec4 frag_color;
 
 uniform vec3 viewPos;
-uniform sampler2D gPosition;
 uniform sampler2D gNormal;
-uniform sampler2D gAlbedoSpec;
+uniform sampler2D gAlbedoMetallic;
+uniform sampler2D gRoughness;
+uniform sampler2D gPosition;
+uniform sampler2D gDepth;
 uniform sampler2D gSSAO;
-uniform sampler2D gMetallicRoughness;
-uniform samplerCube depthMap;
+uniform mat4 inverseViewProjection;
+uniform samplerCubeArrayShadow shadowTiers[NUM_SHADOW_TIERS];
+uniform float shadowFarPlane;
+uniform int shadowTaps;
+uniform float shadowRadius;
+uniform float shadowTapDistance;
 
 uniform float exposure;
-uniform PointLight pointLight[MAX_NUM_POINT_LIGHTS];
-uniform int pointLightCount;
+uniform mat4 viewMatrix;
+
+// Clusters: screen tiles and exponential depth slices
+uniform vec3 clusterCount;
+uniform float clusterScale;
+uniform float clusterBias;
+uniform vec4 screenSize;
+
+layout (std430, binding = 1) readonly buffer PointLightBuffer {
+	PointLight pointLight[];
+};
+
+layout (std430, binding = 2) readonly buffer ClusterBuffer {
+	uvec2 clusters[];
+};
+
+layout (std430, binding = 3) readonly buffer LightIndexBuffer {
+	uint lightIndices[];
+};
 
 uniform DirectionalLight directionalLights[MAX_NUM_DIRECTIONAL_LIGHTS];
 uniform int directionalLightCount;
 
 in vec2 TexCoords;
 
-float CalcShadow(vec3 lightPos, vec3 fragPos)
+const float PI = 3.14159265359;
+
+// The first four points cover the disk on their own
+const vec2 poissonDisk[12] = vec2[](
+	vec2(-0.326, -0.406), vec2( 0.962, -0.195), vec2(-0.096,  0.840), vec2( 0.473, -0.480),
+	vec2(-0.840, -0.074), vec2( 0.519,  0.767), vec2(-0.696,  0.457), vec2( 0.185, -0.893),
+	vec2( 0.507,  0.064), vec2(-0.321, -0.933), vec2(-0.792,  0.560), vec2( 0.896,  0.412)
+);
+
+// Fraction of light that reaches the fragment, the tier is not dynamically uniform once
+// lights are culled per pixel so it is selected with a branch
+float SampleShadow(int tier, vec4 coord, float ref)
 {
-	float far_plane = 10000.0;
-	vec3 fragToLight = fragPos - lightPos;
+	if (tier == 0) { return texture(shadowTiers[0], coord, ref); }
+	if (tier == 1) { return texture(shadowTiers[1], coord, ref); }
+	return texture(shadowTiers[2], coord, ref);
+}
+
+float InterleavedGradientNoise(vec2 pixel)
+{
+	return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+float CalcShadow(PointLight light, vec3 fragPos, float viewDistance)
+{
+	if (light.shadowTier < 0) { return 0.0; }
+
+	vec3 fragToLight = fragPos - light.position;
 	float currentDepth = length(fragToLight);
+
+	if (currentDepth >= shadowFarPlane) { return 0.0; }
+
 	float bias = 1.0;
-	float shadow = 0.0;
-
-	// PCF 
-	float samples = 4.0;
-	float off = 0.2;
-	for (float x = -off; x < off; x += off / (samples * 0.5)) {
-		for (float y = -off; y < off; y += off / (samples * 0.5)) {
-			for (float z = -off; z < off; z += off / (samples * 0.5)) {
-				float closestDepth = (texture(depthMap, fragToLight + vec3(x, y, z))).r * far_plane;
-				shadow += (currentDepth - bias > closestDepth) ? 1.0 : 0.0;
-			}
-		}
+	float ref = (currentDepth - bias) / shadowFarPlane;
+
+	// Distant pixels are small on screen, fewer taps are enough
+	int taps = shadowTaps;
+	if (shadowTapDistance > 0.0) {
+		taps = max(shadowTaps >> min(int(viewDistance / shadowTapDistance), 4), 1);
+	}
+
+	if (taps == 1) {
+		return 1.0 - SampleShadow(light.shadowTier, vec4(fragToLight, light.shadowLayer), ref);
 	}
-	shadow /= (samples * samples * samples);
 
-	return shadow;
+	// Disk perpendicular to the lookup direction, rotated per pixel
+	vec3 dir = fragToLight / currentDepth;
+	vec3 up = abs(dir.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+	vec3 tangent = normalize(cross(up, dir));
+	vec3 bitangent = cross(dir, tangent);
+
+	float angle = InterleavedGradientNoise(gl_FragCoord.xy) * 2.0 * PI;
+	mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+
+	float lit = 0.0;
+	for (int i = 0; i < taps; i++) {
+		vec2 offset = rotation * poissonDisk[i] * shadowRadius;
+		vec3 coord = fragToLight + tangent * offset.x + bitangent * offset.y;
+
+		lit += SampleShadow(light.shadowTier, vec4(coord, light.shadowLayer), ref);
+	}
+
+	return 1.0 - lit / float(taps);
 }
 
-const float PI = 3.14159265359;
+#if COMPACT_GBUFFER
+vec3 OctDecode(vec2 e)
+{
+	e = e * 2.0 - 1.0;
+
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+
+	return normalize(n);
+}
+
+vec3 WorldPosition(vec2 uv, float depth)
+{
+	vec4 p = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+	return p.xyz / p.w;
+}
+#endif
+
+uint ClusterIndex(vec3 fragPos)
+{
+	float viewDepth = -(viewMatrix * vec4(fragPos, 1.0)).z;
+	uint slice = uint(max(log(viewDepth) * clusterScale + clusterBias, 0.0));
+	uvec2 tile = uvec2(gl_FragCoord.xy / screenSize.xy * clusterCount.xy);
+
+	uvec3 count = uvec3(clusterCount);
+	uvec3 cluster = min(uvec3(tile, slice), count - 1);
+
+	return cluster.x + count.x * (cluster.y + count.y * cluster.z);
+}
+
+// Inverse square falloff that reaches zero at the radius of the light
+float Attenuation(float dist, float radius)
+{
+	float ratio = dist / radius;
+	float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+
+	return (window * window) / max(dist * dist, 0.0001);
+}
 
 // Normal Distribution Function
 float DistributionTrowbridgeReitzGGX(vec3 normal, vec3 halfway, float roughness)
@@ -98,28 +204,68 @@ vec3 FresnelSchlick(float cosTheta, vec3 F0)
 	return F0 + (1.0 - F0) * pow(1 - cosTheta, 5.0);
 }
 
-vec3 CalcPbr()
+// Bilateral upsample of the reduced resolution occlusion: the bilinear weights of the
+// four nearest texels are scaled down when their depth differs from the pixel's
+float AmbientOcclusion(float viewDepth)
 {
-	vec3 fragPos = texture(gPosition, TexCoords).rgb;
-	vec3 fragColor = texture(gAlbedoSpec, TexCoords).rgb;
+#if !SSAO
+	return 1.0;
+#else
+	ivec2 size = textureSize(gSSAO, 0);
+	vec2 coord = TexCoords * vec2(size) - 0.5;
+	vec2 f = fract(coord);
+	ivec2 base = ivec2(floor(coord));
+
+	float occlusion = 0.0;
+	float total = 0.0;
+
+	for (int i = 0; i < 4; i++) {
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		vec2 tap = texelFetch(gSSAO, clamp(base + offset, ivec2(0), size - 1), 0).rg;
+
+		float bilinear = (offset.x == 1 ? f.x : 1.0 - f.x) * (offset.y == 1 ? f.y : 1.0 - f.y);
+		float weight = bilinear / (abs(tap.g - viewDepth) + 0.01);
+
+		occlusion += tap.r * weight;
+		total += weight;
+	}
+
+	return occlusion / total;
+#endif
+}
 
-	vec3 N = texture(gNormal, TexCoords).rgb;
+vec3 CalcPbr(float depth)
+{
+#if COMPACT_GBUFFER
+	vec3 fragPos = WorldPosition(TexCoords, depth);
+	vec3 N = OctDecode(texture(gNormal, TexCoords).xy);
+#else
+	vec3 fragPos = texture(gPosition, TexCoords).xyz;
+	vec3 N = texture(gNormal, TexCoords).xyz;
+#endif
 	vec3 V = normalize(viewPos - fragPos).rgb;
+	float viewDistance = length(viewPos - fragPos);
 
-	const float metallicFactor = texture(gMetallicRoughness, TexCoords).b;
-	const float roughnessFactor = texture(gMetallicRoughness, TexCoords).g;
+	vec4 albedoMetallic = texture(gAlbedoMetallic, TexCoords);
+	vec3 fragColor = albedoMetallic.rgb;
+	float metallicFactor = albedoMetallic.a;
+	float roughnessFactor = texture(gRoughness, TexCoords).r;
 
 	vec3 F0 = vec3(0.04);
 	F0 = mix(F0, fragColor, metallicFactor);
 
+	uvec2 cluster = clusters[ClusterIndex(fragPos)];
+
 	vec3 Lo = vec3(0.0);
-	for (int i = 0; i < pointLightCount; i++) {
-		vec3 L = normalize(pointLight[i].position - fragPos);
+	for (uint c = 0; c < cluster.y; c++) {
+		PointLight light = pointLight[lightIndices[cluster.x + c]];
+
+		vec3 L = normalize(light.position - fragPos);
 		vec3 H = normalize(V + L);
 
-		float dist = length(pointLight[i].position - fragPos);
-		float attenuation = 1.0 / (dist * dist);
-		vec3 radiance = pointLight[i].color * pointLight[i].intensity * attenuation;
+		float dist = length(light.position - fragPos);
+		float attenuation = Attenuation(dist, light.radius);
+		vec3 radiance = light.color * light.intensity * attenuation;
 
 		// DFG
 
@@ -136,14 +282,14 @@ vec3 CalcPbr()
 		vec3 specular = DFG / max(denom, 0.001);
 
 		float NdotL = max(dot(N, L), 0.0);
-		Lo += ((kd * fragColor / PI + specular) * radiance * NdotL);
+		float shadow = CalcShadow(light, fragPos, viewDistance);
+		Lo += ((kd * fragColor / PI + specular) * radiance * NdotL) * (1.0 - shadow);
 	}
 
-	float shadow = CalcShadow(pointLight[0].position, fragPos);
-
-	vec3 color = Lo;
+	float ao = AmbientOcclusion((viewMatrix * vec4(fragPos, 1.0)).z);
+	vec3 ambient = vec3(0.03) * fragColor * ao;
 
-	color = color * (1.0 - shadow);
+	vec3 color = ambient + Lo;
 
 	color = color / (color + vec3(1.0));
 	color = pow(color, vec3(1.0 / 2.2));
@@ -153,7 +299,15 @@ vec3 CalcPbr()
 
 void main()
 {
-	vec3 color = CalcPbr();
+	float depth = texture(gDepth, TexCoords).r;
+
+	// Nothing was drawn, the skybox fills it later
+	if (depth >= 1.0) {
+		frag_color = vec4(0.0, 0.0, 0.0, 1.0);
+		return ;
+	}
+
+	vec3 color = CalcPbr(depth);
 
 	color = vec3(1.0) - exp(-color * exposure);
 
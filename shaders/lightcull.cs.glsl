@@ -0,0 +1,131 @@
+#version 450 core
+#define LOCAL_SIZE				128
+#define MAX_LIGHTS_PER_CLUSTER	128
+
+layout (local_size_x = LOCAL_SIZE) in;
+
+struct PointLight {
+	vec3 position;
+	float radius;
+	vec3 color;
+	float intensity;
+	int shadowTier;
+	int shadowLayer;
+};
+
+layout (std430, binding = 1) readonly buffer PointLightBuffer {
+	PointLight pointLight[];
+};
+
+layout (std430, binding = 2) writeonly buffer ClusterBuffer {
+	uvec2 clusters[];
+};
+
+layout (std430, binding = 3) writeonly buffer LightIndexBuffer {
+	uint lightIndices[];
+};
+
+layout (std430, binding = 4) buffer LightIndexCounter {
+	uint lightIndexCount;
+};
+
+uniform uvec3 clusterCount;
+uniform mat4 inverseProjection;
+uniform mat4 viewMatrix;
+uniform float zNear;
+uniform float zFar;
+uniform uint pointLightCount;
+uniform uint lightIndexCapacity;
+
+// View-space position and radius of a batch of lights
+shared vec4 sharedLights[LOCAL_SIZE];
+
+vec3 ScreenToView(vec2 ndc)
+{
+	vec4 p = inverseProjection * vec4(ndc, -1.0, 1.0);
+	return p.xyz / p.w;
+}
+
+// Point where the ray from the eye through `p` crosses the plane at depth `z`
+vec3 IntersectDepth(vec3 p, float z)
+{
+	return p * (z / p.z);
+}
+
+bool SphereIntersectsAabb(vec3 center, float radius, vec3 aabbMin, vec3 aabbMax)
+{
+	vec3 d = center - clamp(center, aabbMin, aabbMax);
+	return dot(d, d) <= radius * radius;
+}
+
+void main()
+{
+	uint clusterIndex = gl_GlobalInvocationID.x;
+	bool active = clusterIndex < clusterCount.x * clusterCount.y * clusterCount.z;
+
+	uvec3 cluster = uvec3(
+		clusterIndex % clusterCount.x,
+		(clusterIndex / clusterCount.x) % clusterCount.y,
+		clusterIndex / (clusterCount.x * clusterCount.y));
+
+	// View-space bounds of the cluster
+	vec2 tileMin = vec2(cluster.xy) / vec2(clusterCount.xy) * 2.0 - 1.0;
+	vec2 tileMax = vec2(cluster.xy + 1) / vec2(clusterCount.xy) * 2.0 - 1.0;
+	float sliceNear = -zNear * pow(zFar / zNear, float(cluster.z) / float(clusterCount.z));
+	float sliceFar  = -zNear * pow(zFar / zNear, float(cluster.z + 1) / float(clusterCount.z));
+
+	vec3 minPoint = ScreenToView(tileMin);
+	vec3 maxPoint = ScreenToView(tileMax);
+
+	vec3 a = IntersectDepth(minPoint, sliceNear);
+	vec3 b = IntersectDepth(minPoint, sliceFar);
+	vec3 c = IntersectDepth(maxPoint, sliceNear);
+	vec3 d = IntersectDepth(maxPoint, sliceFar);
+
+	vec3 aabbMin = min(min(a, b), min(c, d));
+	vec3 aabbMax = max(max(a, b), max(c, d));
+
+	uint visible[MAX_LIGHTS_PER_CLUSTER];
+	uint visibleCount = 0;
+
+	for (uint batch = 0; batch < pointLightCount; batch += LOCAL_SIZE) {
+		uint lightIndex = batch + gl_LocalInvocationIndex;
+
+		if (lightIndex < pointLightCount) {
+			PointLight light = pointLight[lightIndex];
+			sharedLights[gl_LocalInvocationIndex] = vec4((viewMatrix * vec4(light.position, 1.0)).xyz, light.radius);
+		}
+
+		barrier();
+
+		uint batchSize = min(uint(LOCAL_SIZE), pointLightCount - batch);
+
+		for (uint i = 0; active && i < batchSize; i++) {
+			vec4 light = sharedLights[i];
+
+			if (visibleCount < MAX_LIGHTS_PER_CLUSTER && SphereIntersectsAabb(light.xyz, light.w, aabbMin, aabbMax)) {
+				visible[visibleCount++] = batch + i;
+			}
+		}
+
+		barrier();
+	}
+
+	if (!active) { return ; }
+
+	uint offset = atomicAdd(lightIndexCount, visibleCount);
+
+	// The index list is full, drop what does not fit
+	if (offset >= lightIndexCapacity) {
+		visibleCount = 0;
+	}
+	else {
+		visibleCount = min(visibleCount, lightIndexCapacity - offset);
+	}
+
+	for (uint i = 0; i < visibleCount; i++) {
+		lightIndices[offset + i] = visible[i];
+	}
+
+	clusters[clusterIndex] = uvec2(offset, visibleCount);
+}
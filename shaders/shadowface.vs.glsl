@@ -0,0 +1,18 @@
+#version 450 core
+
+layout (location = 0) in vec3 in_position;
+layout (location = 5) in uint in_drawId;
+
+#include "include/drawdata.glsl"
+
+uniform mat4 shadowMatrix;
+
+out vec4 FragPos;
+
+void main()
+{
+	vec3 position = draws[in_drawId].positionOffset.xyz + in_position * draws[in_drawId].positionScale.xyz;
+
+	FragPos = draws[in_drawId].model * vec4(position, 1.0);
+	gl_Position = shadowMatrix * FragPos;
+}
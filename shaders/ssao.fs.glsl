@@ -1,50 +1,97 @@
 #version 450 core
+#define KERNEL_SIZE	16
 
-out float frag_color;
+// Occlusion and view space depth, the depth drives the bilateral blur and upsample
+out vec2 frag_color;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
 uniform sampler2D gNormal;
-uniform sampler2D texNoise;
+uniform sampler2D gDepth;
+uniform bool compactGBuffer;
 
 uniform mat4 projectionMatrix;
-uniform vec3 samples[64];
+uniform mat4 inverseProjection;
+uniform mat4 viewMatrix;
+uniform uint frameIndex;
+uniform float radius;
+uniform float bias;
+// At most KERNEL_SIZE, the first samples of the kernel are the closest to the pixel
+uniform int sampleCount;
 
-const float noiseSize = 4.0;
-const vec2 screenSize = { 1920.0, 1080.0 };
-const vec2 noiseScale = vec2(screenSize.x / noiseSize, screenSize.y / noiseSize);
+layout (std140, binding = 0) uniform SsaoKernel {
+	vec4 samples[KERNEL_SIZE];
+};
 
-const int kernelSize = 64;
-const float radius = 0.5;
-const float bias = 0.025;
+const float PI = 3.14159265359;
+
+vec3 OctDecode(vec2 e)
+{
+	e = e * 2.0 - 1.0;
+
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+
+	return normalize(n);
+}
+
+// Occlusion is computed in view space
+vec3 ViewPosition(vec2 uv)
+{
+	float depth = textureLod(gDepth, uv, 0.0).r;
+	vec4 p = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+
+	return p.xyz / p.w;
+}
+
+vec3 ViewNormal(vec2 uv)
+{
+	vec3 normal = compactGBuffer ? OctDecode(textureLod(gNormal, uv, 0.0).xy) : textureLod(gNormal, uv, 0.0).xyz;
+	return normalize(mat3(viewMatrix) * normal);
+}
+
+// Interleaved gradient noise, shifted every frame so the few samples cover more directions over time
+float Noise(vec2 pixel)
+{
+	pixel += 5.588238 * float(frameIndex % 64u);
+	return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
 
 void main()
 {
-//	vec3 fragPos = texture(gPosition, TexCoords).xyz;
-//	vec3 normal = normalize(texture(gNormal, TexCoords).xyz);
-//	vec3 randVec = normalize(texture(texNoise, TexCoords * noiseScale).xyz);
-//
-//	vec3 tangent = normalize(randVec - normal * dot(randVec, normal));
-//	vec3 bitangent = cross(normal, tangent);
-//	mat3 TBN = mat3(tangent, bitangent, normal);
-//
-//	float occlusion = 0.0;
-//	for (int i = 0; i < kernelSize; i++) {
-//		vec3 _sample = TBN * samples[i];
-//		_sample = fragPos + _sample * radius;
-//
-//		vec4 off = vec4(_sample, 1.0);
-//		off = projectionMatrix * off;
-//		off.xyz /= off.w;
-//		off.xyz = off.xyz * 0.5 + 0.5;
-//
-//		float sampleDepth = texture(gPosition, off.xy).z;
-//		float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
-//		occlusion += (sampleDepth >= _sample.z + bias ? 1.0 : 0.0) * rangeCheck;
-//	}
-//
-//	occlusion = 1.0 - (occlusion / kernelSize);
-//	frag_color = occlusion;
-	frag_color = 1.0f;
+	vec3 fragPos = ViewPosition(TexCoords);
+
+	if (textureLod(gDepth, TexCoords, 0.0).r >= 1.0) {
+		frag_color = vec2(1.0, fragPos.z);
+		return ;
+	}
+
+	vec3 normal = ViewNormal(TexCoords);
+
+	float angle = Noise(gl_FragCoord.xy) * 2.0 * PI;
+	vec3 randVec = vec3(cos(angle), sin(angle), 0.0);
+
+	vec3 tangent = normalize(randVec - normal * dot(randVec, normal));
+	vec3 bitangent = cross(normal, tangent);
+	mat3 TBN = mat3(tangent, bitangent, normal);
+
+	float occlusion = 0.0;
+	for (int i = 0; i < sampleCount; i++) {
+		vec3 _sample = TBN * samples[i].xyz;
+		_sample = fragPos + _sample * radius;
+
+		vec4 off = vec4(_sample, 1.0);
+		off = projectionMatrix * off;
+		off.xyz /= off.w;
+		off.xyz = off.xyz * 0.5 + 0.5;
+
+		float sampleDepth = ViewPosition(off.xy).z;
+		float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
+		occlusion += (sampleDepth >= _sample.z + bias ? 1.0 : 0.0) * rangeCheck;
+	}
+
+	occlusion = 1.0 - (occlusion / float(sampleCount));
+	frag_color = vec2(occlusion, fragPos.z);
 }
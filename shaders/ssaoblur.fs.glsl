@@ -1,20 +1,38 @@
 #version 450 core
 
-out float frag_color;
+out vec2 frag_color;
 
 in vec2 TexCoords;
 
+// Occlusion and view space depth
 uniform sampler2D ssaoInput;
 
+// One texel along the blur axis
+uniform vec2 direction;
+
+const float weights[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
+
+// Relative depth difference at which a tap loses most of its weight
+const float depthSharpness = 20.0;
+
 void main()
 {
-	vec2 texelSize = 1.0 / vec2(textureSize(ssaoInput, 0));
-	float result = 0.0;
-	for (int x = -2; x < 2; x++) {
-		for (int y = -2; y < 2; y++) {
-			vec2 offset = vec2(float(x), float(y)) * texelSize;
-			result += texture(ssaoInput, TexCoords + offset).r;
+	vec2 center = texture(ssaoInput, TexCoords).rg;
+
+	float result = center.r * weights[0];
+	float total = weights[0];
+
+	for (int i = 1; i < 5; i++) {
+		for (int side = -1; side <= 1; side += 2) {
+			vec2 tap = texture(ssaoInput, TexCoords + direction * float(i * side)).rg;
+
+			// Do not bleed occlusion across depth discontinuities
+			float weight = weights[i] * exp(-depthSharpness * abs(tap.g - center.g) / max(abs(center.g), 0.0001));
+
+			result += tap.r * weight;
+			total += weight;
 		}
 	}
-	frag_color = result / (4.0 * 4.0);
+
+	frag_color = vec2(result / total, center.g);
 }
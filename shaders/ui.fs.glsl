@@ -1,19 +1,35 @@
 #version 450 core
 
+#define MODE_IMAGE 0u
+#define MODE_TILED_IMAGE 1u
+#define MODE_GLYPH 2u
+
 out vec4 frag_color;
 
 in vec2 TexCoords;
+flat in vec4 Rect;
+flat in vec4 Color;
+flat in uint Mode;
+
+uniform sampler2D images;
+uniform sampler2D glyphs;
 
-uniform sampler2D tex;
-uniform vec4 color;
+// Rect is in texels, stay half a texel inside so that neighbours in the atlas never bleed
+vec2 atlasCoords(sampler2D atlas, vec2 uv)
+{
+	vec2 texel = Rect.xy + uv * Rect.zw;
+	texel = clamp(texel, Rect.xy + 0.5, Rect.xy + Rect.zw - 0.5);
+	return texel / vec2(textureSize(atlas, 0));
+}
 
 void main()
 {
-	vec4 sampled = vec4(1.0, 1.0, 1.0, texture(tex, TexCoords).r);
-	if (color.a > 0.0) {
-		frag_color = color * sampled;
+	if (Mode == MODE_GLYPH) {
+		float coverage = texture(glyphs, atlasCoords(glyphs, clamp(TexCoords, 0.0, 1.0))).r;
+		frag_color = Color * vec4(1.0, 1.0, 1.0, coverage);
 	}
 	else {
-		frag_color = texture(tex, TexCoords);
+		vec2 uv = Mode == MODE_TILED_IMAGE ? fract(TexCoords) : clamp(TexCoords, 0.0, 1.0);
+		frag_color = Color * texture(images, atlasCoords(images, uv));
 	}
 }
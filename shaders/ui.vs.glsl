@@ -1,15 +1,23 @@
 #version 450 core
 
-layout (location = 0) in vec3 in_position;
-layout (location = 2) in vec2 tex_coords;
+layout (location = 0) in vec2 in_position;
+layout (location = 1) in vec2 in_uv;
+layout (location = 2) in vec4 in_rect;
+layout (location = 3) in vec4 in_color;
+layout (location = 4) in uint in_mode;
 
 uniform mat4 projectionMatrix;
-uniform mat4 modelMatrix;
 
 out vec2 TexCoords;
+flat out vec4 Rect;
+flat out vec4 Color;
+flat out uint Mode;
 
 void main()
 {
-	gl_Position = projectionMatrix * modelMatrix * vec4(in_position.xy, 0.0f, 1.0f);
-	TexCoords = tex_coords;
+	gl_Position = projectionMatrix * vec4(in_position, 0.0f, 1.0f);
+	TexCoords = in_uv;
+	Rect = in_rect;
+	Color = in_color;
+	Mode = in_mode;
 }
@@ -0,0 +1,52 @@
+#version 450 core
+
+// Scene rendered below the display resolution, stretched over the back buffer
+out vec4 frag_color;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+uniform bool bicubic;
+
+// Catmull-Rom filter in 9 bilinear taps instead of 16 fetches: the middle pairs of
+// weights have the same sign, so each pair is one tap between the two texels
+vec4 CatmullRom(vec2 uv)
+{
+	vec2 size = vec2(textureSize(scene, 0));
+	vec2 position = uv * size;
+	vec2 center = floor(position - 0.5) + 0.5;
+	vec2 f = position - center;
+
+	vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+	vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+	vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+	vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+	vec2 w12 = w1 + w2;
+	vec2 offset12 = w2 / w12;
+
+	vec2 tap0 = (center - 1.0) / size;
+	vec2 tap3 = (center + 2.0) / size;
+	vec2 tap12 = (center + offset12) / size;
+
+	vec4 color = vec4(0.0);
+	color += texture(scene, vec2(tap0.x,  tap0.y)) * w0.x  * w0.y;
+	color += texture(scene, vec2(tap12.x, tap0.y)) * w12.x * w0.y;
+	color += texture(scene, vec2(tap3.x,  tap0.y)) * w3.x  * w0.y;
+
+	color += texture(scene, vec2(tap0.x,  tap12.y)) * w0.x  * w12.y;
+	color += texture(scene, vec2(tap12.x, tap12.y)) * w12.x * w12.y;
+	color += texture(scene, vec2(tap3.x,  tap12.y)) * w3.x  * w12.y;
+
+	color += texture(scene, vec2(tap0.x,  tap3.y)) * w0.x  * w3.y;
+	color += texture(scene, vec2(tap12.x, tap3.y)) * w12.x * w3.y;
+	color += texture(scene, vec2(tap3.x,  tap3.y)) * w3.x  * w3.y;
+
+	// The negative lobes can overshoot
+	return max(color, vec4(0.0));
+}
+
+void main()
+{
+	frag_color = bicubic ? CatmullRom(TexCoords) : texture(scene, TexCoords);
+}
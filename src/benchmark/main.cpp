@@ -0,0 +1,275 @@
+#include "Engine.hpp"
+#include "Benchmark.hpp"
+#include "Profiler.hpp"
+#include "RenderStats.hpp"
+#include "GLState.hpp"
+#include "ProgramCache.hpp"
+#include "Logger.hpp"
+#include "levels/MainLevel.hpp"
+#include "systems/MeshRendererSystem.hpp"
+#include "systems/SkyboxRendererSystem.hpp"
+#include "components/PlayerCameraComponent.hpp"
+#include "components/TransformComponent.hpp"
+#include "stb_image_write.h"
+#include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+using namespace engine;
+
+///
+/// Headless benchmark: renders the main level along a camera path and reports the
+/// frame times as JSON
+///
+/// ./benchmark [--frames N] [--warmup N] [--size WxH] [--path FILE] [--output FILE]
+///             [--counters FILE] [--dump DIR] [--dump-every N]
+///
+/// --counters also writes the average render counters as a tab-separated table.
+///
+/// The frames written with --dump are the golden images of the level, compared by the CI.
+///
+
+struct Options
+{
+	size_t Frames = 600;
+	size_t WarmupFrames = 60;
+	int Width = 1280;
+	int Height = 720;
+	std::string Path;
+	std::string Output;
+	std::string CountersOutput;
+	std::string DumpDirectory;
+	size_t DumpEvery = 60;
+};
+
+static void Usage(char const *name)
+{
+	fmt::print(stderr, "usage: {} [--frames N] [--warmup N] [--size WxH] [--path FILE] [--output FILE] "
+		"[--counters FILE] [--dump DIR] [--dump-every N]\n", name);
+}
+
+static std::optional<Options> ParseOptions(int argc, char **argv)
+{
+	Options options;
+
+	for (int i = 1; i < argc; i++) {
+		std::string const arg = argv[i];
+
+		if (i + 1 >= argc) { return std::nullopt; }
+		char const *value = argv[++i];
+
+		if (arg == "--frames") {
+			options.Frames = std::strtoul(value, nullptr, 10);
+		}
+		else if (arg == "--warmup") {
+			options.WarmupFrames = std::strtoul(value, nullptr, 10);
+		}
+		else if (arg == "--size") {
+			if (std::sscanf(value, "%dx%d", &options.Width, &options.Height) != 2) { return std::nullopt; }
+		}
+		else if (arg == "--path") {
+			options.Path = value;
+		}
+		else if (arg == "--output") {
+			options.Output = value;
+		}
+		else if (arg == "--counters") {
+			options.CountersOutput = value;
+		}
+		else if (arg == "--dump") {
+			options.DumpDirectory = value;
+		}
+		else if (arg == "--dump-every") {
+			options.DumpEvery = std::max<size_t>(std::strtoul(value, nullptr, 10), 1);
+		}
+		else {
+			return std::nullopt;
+		}
+	}
+
+	if (options.Frames == 0 || options.Width <= 0 || options.Height <= 0) { return std::nullopt; }
+
+	return options;
+}
+
+static void PlaceCamera(CameraKey const &key, glm::ivec2 const &size)
+{
+	auto players = Engine::Instance().GetEntities<PlayerCameraComponent, TransformComponent>();
+
+	if (players.empty()) { return ; }
+
+	auto camera = players[0]->Get<PlayerCameraComponent>();
+	auto transform = players[0]->Get<TransformComponent>();
+
+	transform.position = key.Position;
+	transform.direction = glm::normalize(key.Target - key.Position);
+
+	camera.useInput = false;
+	camera.projection = glm::perspective(glm::radians(90.0f), static_cast<float>(size.x) / size.y, 0.1f, 1000.0f);
+	camera.view = glm::lookAt(key.Position, key.Target, glm::vec3(0.0f, 1.0f, 0.0f));
+	camera.viewProjection = camera.projection * camera.view;
+
+	players[0]->Set(camera);
+	players[0]->Set(transform);
+}
+
+static void DumpFrame(std::string const &path, glm::ivec2 const &size)
+{
+	std::vector<unsigned char> pixels(size_t(size.x) * size.y * 3);
+
+	GLState::Instance().BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size.x, size.y, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+	// OpenGL rows go up, the ones of PNG go down
+	stbi_flip_vertically_on_write(1);
+	if (!stbi_write_png(path.c_str(), size.x, size.y, 3, pixels.data(), size.x * 3)) {
+		Logger::Warn("Could not write {}\n", path);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	auto const parsed = ParseOptions(argc, argv);
+
+	if (!parsed) {
+		Usage(argv[0]);
+		return 1;
+	}
+
+	Options const &options = parsed.value();
+
+	auto const startup = std::chrono::steady_clock::now();
+
+	Engine::EnableHeadless(options.Width, options.Height);
+
+	try {
+		Engine::Instance();
+	}
+	catch (std::runtime_error const &e) {
+		fmt::print(stderr, "Could not create the offscreen context: {}\n", e.what());
+		return 1;
+	}
+
+	auto &engine = Engine::Instance();
+	engine.CreateComponentSystem<SkyboxRendererSystem>();
+	engine.CreateComponentSystem<MeshRendererSystem>();
+
+	engine.LoadLevel<MainLevel>();
+
+	CameraPath path = CameraPath::Orbit(glm::vec3(0.0f, 10.0f, 0.0f), 60.0f, 15.0f, 9);
+
+	if (!options.Path.empty()) {
+		auto loaded = CameraPath::Load(options.Path);
+
+		if (!loaded) {
+			fmt::print(stderr, "Could not read the camera path {}\n", options.Path);
+			return 1;
+		}
+		path = std::move(loaded.value());
+	}
+
+	glm::ivec2 const size = engine.GetDisplaySize();
+
+	BenchmarkReport report;
+	report.Level = "MainLevel";
+	report.Width = size.x;
+	report.Height = size.y;
+	report.WarmupFrames = options.WarmupFrames;
+	report.StartupMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startup).count();
+
+	auto const &programs = ProgramCache::Instance().GetStats();
+	report.CachedPrograms = programs.Hits;
+	report.BuiltPrograms = programs.Misses;
+	report.CacheSavedMs = programs.SavedMs;
+
+	std::vector<std::pair<std::string, float>> &passes = report.GpuPasses;
+	std::vector<PassCounters> &passCounters = report.CountersByPass;
+
+	// The same time step every frame, the results do not depend on the speed of the machine
+	float const deltaTime = 1.0f / 60.0f;
+
+	for (size_t frame = 0; frame < options.WarmupFrames + options.Frames; frame++) {
+		bool const bMeasured = frame >= options.WarmupFrames;
+		size_t const measuredFrame = bMeasured ? frame - options.WarmupFrames : 0;
+
+		// The warm-up frames stay at the start of the path, filling the caches and the pools
+		float const t = options.Frames > 1 ? static_cast<float>(measuredFrame) / (options.Frames - 1) : 0.0f;
+		PlaceCamera(path.Sample(t), size);
+
+		auto const start = std::chrono::steady_clock::now();
+		engine.RenderFrame(deltaTime);
+		auto const end = std::chrono::steady_clock::now();
+
+		if (!bMeasured) { continue ; }
+
+		report.CpuFrameTimes.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+		report.GpuFrameTimes.push_back(Profiler::Instance().GetGpuFrameTime());
+
+		for (auto const *timing : Profiler::Instance().GetGpuTimings()) {
+			auto pass = std::find_if(passes.begin(), passes.end(), [timing] (auto const &p) {
+				return p.first == timing->GetName();
+			});
+
+			if (pass == passes.end()) {
+				passes.emplace_back(timing->GetName(), 0.0f);
+				pass = passes.end() - 1;
+			}
+			pass->second += timing->GetLast() / options.Frames;
+		}
+
+		// Summed here, divided by the frame count once the run is over
+		auto const &stats = RenderStats::Instance();
+		report.Counters += stats.Counters;
+
+		for (auto const &counters : stats.Passes) {
+			auto pass = std::find_if(passCounters.begin(), passCounters.end(), [&counters] (auto const &p) {
+				return p.Name == counters.Name;
+			});
+
+			if (pass == passCounters.end()) {
+				passCounters.push_back({ counters.Name, {} });
+				pass = passCounters.end() - 1;
+			}
+			pass->Counters += counters.Counters;
+		}
+
+		if (!options.DumpDirectory.empty() && measuredFrame % options.DumpEvery == 0) {
+			DumpFrame(fmt::format("{}/frame_{:05}.png", options.DumpDirectory, measuredFrame), size);
+		}
+	}
+
+	report.Counters = report.Counters / options.Frames;
+	for (auto &pass : passCounters) {
+		pass.Counters = pass.Counters / options.Frames;
+	}
+
+	if (!options.CountersOutput.empty()) {
+		std::ofstream counters(options.CountersOutput);
+
+		if (!counters) {
+			fmt::print(stderr, "Could not write {}\n", options.CountersOutput);
+			return 1;
+		}
+		WriteCounters(counters, passCounters, report.Counters);
+	}
+
+	if (options.Output.empty()) {
+		WriteJson(std::cout, report);
+	}
+	else {
+		std::ofstream output(options.Output);
+
+		if (!output) {
+			fmt::print(stderr, "Could not write {}\n", options.Output);
+			return 1;
+		}
+		WriteJson(output, report);
+	}
+
+	return 0;
+}
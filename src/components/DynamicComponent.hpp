@@ -0,0 +1,10 @@
+#pragma once
+
+#include "ecs/Component.hpp"
+
+///
+/// Marks an entity that is expected to move, its meshes are kept out of the cached shadows
+///
+struct DynamicComponent : ecs::IComponentBase
+{
+};
@@ -3,10 +3,13 @@
 #include "ecs/Component.hpp"
 #include <vector>
 #include <string>
+#include <optional>
 
 struct ModelComponent : ecs::IComponentBase
 {
 	std::string Name;
 	unsigned int Shader;
 	std::vector<unsigned int> Meshes;
+	/// Replaces the material of every mesh, see Engine::AddPbrMaterial()
+	std::optional<unsigned int> Material;
 };
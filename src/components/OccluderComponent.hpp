@@ -0,0 +1,15 @@
+#pragma once
+
+#include "ecs/Component.hpp"
+#include <vector>
+
+///
+/// Meshes of the entity's model rasterized by the software occlusion culler
+///
+/// Only large and simple opaque meshes are worth it, their triangles are rasterized on
+/// the CPU every frame.
+///
+struct OccluderComponent : ecs::IComponentBase
+{
+	std::vector<unsigned int> Meshes;
+};
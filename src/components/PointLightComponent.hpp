@@ -9,4 +9,7 @@ struct PointLightComponent : ecs::IComponentBase
 	glm::vec3 Color;
 
 	float Intensity = 100.0f;
+
+	/// Distance at which the light stops contributing, derived from the intensity when 0
+	float Radius = 0.0f;
 };
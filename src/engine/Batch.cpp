@@ -1,12 +1,20 @@
 #include "Batch.hpp"
 #include "Engine.hpp"
+#include "RenderCounters.hpp"
 
 namespace engine {
 
-Batch::Batch() : _vao(0), _ibo(0)
+Batch::Batch() : _commandBuffer(0), _materialBuffer(0)
 {
 }
 
+Batch::~Batch()
+{
+	GeometryArena::Instance().Free(_geometry);
+	glDeleteBuffers(1, &_commandBuffer);
+	glDeleteBuffers(1, &_materialBuffer);
+}
+
 void Batch::AddMesh(
 	std::vector<GLfloat> const &positions,
 	std::vector<GLfloat> const &normals,
@@ -16,79 +24,81 @@ void Batch::AddMesh(
 	std::vector<GLuint> const &indices
 )
 {
-	_positions.insert(_positions.end(), positions.begin(), positions.end());
-	_normals.insert(_normals.end(), normals.begin(), normals.end());
-	_uvs.insert(_uvs.end(), uvs.begin(), uvs.end());
-	_tangents.insert(_tangents.end(), tangents.begin(), tangents.end());
+	size_t const vertexCount = positions.size() / 3;
+	size_t const firstVertex = _vertices.size();
+
+	if (vertexCount == 0) { return ; }
+
+	// Tangents may come with or without their handedness
+	size_t const tangentSize = tangents.size() / vertexCount;
+
+	for (size_t i = 0; i < vertexCount; i++) {
+		Vertex v{ glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) };
+
+		v.Position = glm::vec3(positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2]);
+		if (normals.size() >= (i + 1) * 3) {
+			v.Normal = glm::vec3(normals[i * 3 + 0], normals[i * 3 + 1], normals[i * 3 + 2]);
+		}
+		if (uvs.size() >= (i + 1) * 2) {
+			v.Uv = glm::vec2(uvs[i * 2 + 0], uvs[i * 2 + 1]);
+		}
+		for (size_t c = 0; c < std::min<size_t>(tangentSize, 4); c++) {
+			v.Tangent[c] = tangents[i * tangentSize + c];
+		}
+
+		_vertices.push_back(v);
+	}
+
+	_ranges.emplace_back(_indices.size(), indices.size());
+	for (auto const i : indices) {
+		_indices.push_back(i + firstVertex);
+	}
 	_materials.push_back(material);
-	_indices.insert(_indices.end(), indices.begin(), indices.end());
 }
 
 void Batch::Build()
 {
-	glGenVertexArrays(1, &_vao);
-	glBindVertexArray(_vao);
-
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glEnableVertexAttribArray(3);
-	glEnableVertexAttribArray(4);
-
-	const size_t bufferSize = (_positions.size()
-						      + _normals.size()
-						      + _uvs.size()
-						      + _tangents.size()
-						      + _materials.size()) * sizeof(GLfloat);
-	glGenBuffers(1, &_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-	glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STATIC_DRAW);
-
-	size_t offset = 0;
-
-	if (_positions.size() > 0) {
-		glBufferSubData(GL_ARRAY_BUFFER, offset, _positions.size() * sizeof(GLfloat), _positions.data());
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-		offset += _positions.size() * sizeof(GLfloat);
-	}
-	if (_normals.size() > 0) {
-		glBufferSubData(GL_ARRAY_BUFFER, offset, _normals.size() * sizeof(GLfloat), _normals.data());
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-		offset += _normals.size() * sizeof(GLfloat);
-	}
-	if (_uvs.size() > 0) {
-		glBufferSubData(GL_ARRAY_BUFFER, offset, _uvs.size() * sizeof(GLfloat), _uvs.data());
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-		offset += _uvs.size() * sizeof(GLfloat);
-	}
-	if (_tangents.size() > 0) {
-		glBufferSubData(GL_ARRAY_BUFFER, offset, _tangents.size() * sizeof(GLfloat), _tangents.data());
-		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-		offset += _tangents.size() * sizeof(GLfloat);
+	GeometryArena::Instance().Free(_geometry);
+	_geometry = GeometryArena::Instance().Allocate(_vertices, _indices);
+
+	if (!_geometry.IsValid()) { return ; }
+
+	std::vector<DrawElementsIndirectCommand> commands;
+	commands.reserve(_ranges.size());
+
+	for (size_t i = 0; i < _ranges.size(); i++) {
+		auto const [ first, count ] = _ranges[i];
+
+		commands.push_back(DrawElementsIndirectCommand{
+			count, 1, _geometry.FirstIndex + first, _geometry.BaseVertex, static_cast<GLuint>(i) });
 	}
-//	if (_materials.size() > 0) {
-//		glBufferSubData(GL_ARRAY_BUFFER, offset, _materials.size() * sizeof(GLfloat), _materials.data());
-//		glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, 1 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-//		offset += _materials.size() * sizeof(GLfloat);
-//	}
-
-	std::vector<GLfloat> _materialIds{};
-	_materialIds.reserve(_materials.size());
-	std::transform(_materials.begin(), _materials.end(), _materialIds.begin(),
-		[] (std::string const &m) -> GLfloat { return engine::Engine::Instance().GetMaterialId(m); });
-
-	glGenBuffers(1, &_ibo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * _indices.size(), _indices.data(), GL_STATIC_DRAW);
-
-	glBindVertexArray(0);
+
+	std::vector<GLuint> materialIds;
+	materialIds.reserve(_materials.size());
+	std::transform(_materials.begin(), _materials.end(), std::back_inserter(materialIds),
+		[] (std::string const &m) -> GLuint { return engine::Engine::Instance().GetMaterialId(m); });
+
+	GeometryArena::Instance().ReserveDrawIds(commands.size());
+
+	glDeleteBuffers(1, &_commandBuffer);
+	glCreateBuffers(1, &_commandBuffer);
+	glNamedBufferStorage(_commandBuffer, commands.size() * sizeof(DrawElementsIndirectCommand),
+		commands.data(), 0);
+
+	glDeleteBuffers(1, &_materialBuffer);
+	glCreateBuffers(1, &_materialBuffer);
+	glNamedBufferStorage(_materialBuffer, materialIds.size() * sizeof(GLuint), materialIds.data(), 0);
 }
 
 void Batch::Draw() const
 {
-	glBindVertexArray(_vao);
-	glDrawElements(GL_TRIANGLES, _indices.size(), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
+	if (!_geometry.IsValid()) { return ; }
+
+	GeometryArena::Instance().Bind(_geometry);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MaterialIdBinding, _materialBuffer);
+	gl::MultiDrawElementsIndirect(GL_TRIANGLES, _geometry.IndexType, nullptr, _ranges.size(), 0,
+		_ranges.size(), _indices.size() / 3);
 }
 
 }
@@ -2,31 +2,40 @@
 #include <vector>
 #include "lazy.hpp"
 #include "IDrawable.hpp"
+#include "DrawQueue.hpp"
 
 namespace engine {
 
 ///
 /// Group together (batch) multiple meshes that can be rendered in a single drawcall
 ///
+/// The meshes are stored in the geometry arena and drawn with one glMultiDrawElementsIndirect.
+/// The material of each mesh is available to shaders in an SSBO indexed by the draw index attribute.
+///
 class Batch : public IDrawable
 {
 private:
-	std::vector<GLfloat> _positions;
-	std::vector<GLfloat> _normals;
-	std::vector<GLfloat> _uvs;
-	std::vector<GLfloat> _tangents;
-	std::vector<std::string> _materials;
+	std::vector<Vertex> _vertices;
 	std::vector<GLuint> _indices;
+	std::vector<std::string> _materials;
 
-	GLuint _vao;
-	GLuint _vbo;
-	GLuint _ibo;
+	/// First index and index count of each mesh in the batch
+	std::vector<std::pair<GLuint, GLuint>> _ranges;
 
-	// On OpenGL 4, the minimun number of texture units must be at least 80
-	static constexpr GLuint MaxNumberOfTextureUnits = 80;
+	GeometryAllocation _geometry;
+
+	GLuint _commandBuffer;
+	GLuint _materialBuffer;
 
 public:
+	/// Shader storage binding point of the material ids
+	static constexpr GLuint MaterialIdBinding = 1;
+
 	Batch();
+	~Batch();
+
+	Batch(Batch const &) = delete;
+	void operator=(Batch const &) = delete;
 
 	/// Add a mesh to the batch
 	void AddMesh(
@@ -0,0 +1,191 @@
+#include "Benchmark.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+namespace engine
+{
+
+std::optional<CameraPath> CameraPath::Load(std::string const &path)
+{
+	std::ifstream file(path);
+	if (!file) { return std::nullopt; }
+
+	std::vector<CameraKey> keys;
+	std::string line;
+
+	while (std::getline(file, line)) {
+		auto const first = line.find_first_not_of(" \t\r");
+		if (first == std::string::npos || line[first] == '#') { continue ; }
+
+		std::istringstream stream(line);
+		CameraKey key;
+
+		stream >> key.Position.x >> key.Position.y >> key.Position.z
+			>> key.Target.x >> key.Target.y >> key.Target.z;
+		if (!stream) { return std::nullopt; }
+
+		keys.push_back(key);
+	}
+
+	if (keys.empty()) { return std::nullopt; }
+
+	return CameraPath(std::move(keys));
+}
+
+CameraPath CameraPath::Orbit(glm::vec3 const &center, float radius, float height, size_t keyCount)
+{
+	std::vector<CameraKey> keys;
+
+	keyCount = std::max<size_t>(keyCount, 2);
+
+	// The last key is the first one again, the loop is closed
+	for (size_t i = 0; i < keyCount; i++) {
+		float const angle = glm::two_pi<float>() * i / (keyCount - 1);
+
+		CameraKey key;
+		key.Position = center + glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+		key.Target = center;
+		keys.push_back(key);
+	}
+
+	return CameraPath(std::move(keys));
+}
+
+static glm::vec3 CatmullRom(glm::vec3 const &p0, glm::vec3 const &p1, glm::vec3 const &p2, glm::vec3 const &p3, float t)
+{
+	float const t2 = t * t;
+	float const t3 = t2 * t;
+
+	return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+		+ (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+CameraKey CameraPath::Sample(float t) const
+{
+	if (_keys.empty()) { return {}; }
+	if (_keys.size() == 1) { return _keys[0]; }
+
+	size_t const last = _keys.size() - 1;
+	float const position = glm::clamp(t, 0.0f, 1.0f) * last;
+	size_t const segment = std::min(static_cast<size_t>(position), last - 1);
+	float const u = position - segment;
+
+	// The ends repeat their key, the tangent there points at the neighbour
+	CameraKey const &k0 = _keys[segment > 0 ? segment - 1 : 0];
+	CameraKey const &k1 = _keys[segment];
+	CameraKey const &k2 = _keys[segment + 1];
+	CameraKey const &k3 = _keys[std::min(segment + 2, last)];
+
+	CameraKey key;
+	key.Position = CatmullRom(k0.Position, k1.Position, k2.Position, k3.Position, u);
+	key.Target = CatmullRom(k0.Target, k1.Target, k2.Target, k3.Target, u);
+	return key;
+}
+
+FrameTimeSummary Summarize(std::vector<float> samples)
+{
+	FrameTimeSummary summary;
+
+	if (samples.empty()) { return summary; }
+
+	std::sort(samples.begin(), samples.end());
+
+	auto const percentile = [&samples] (float p) {
+		size_t const rank = static_cast<size_t>(std::ceil(p / 100.0f * samples.size()));
+		return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+	};
+
+	summary.Mean = std::accumulate(samples.begin(), samples.end(), 0.0f) / samples.size();
+	summary.P50 = percentile(50.0f);
+	summary.P90 = percentile(90.0f);
+	summary.P99 = percentile(99.0f);
+	summary.Max = samples.back();
+	return summary;
+}
+
+static std::string Quote(std::string const &text)
+{
+	std::string quoted = "\"";
+
+	for (char const c : text) {
+		if (c == '"' || c == '\\') {
+			quoted += '\\';
+		}
+		quoted += c;
+	}
+	return quoted + '"';
+}
+
+static void WriteSummary(std::ostream &out, FrameTimeSummary const &summary)
+{
+	out << "{ \"mean\": " << summary.Mean
+		<< ", \"p50\": " << summary.P50
+		<< ", \"p90\": " << summary.P90
+		<< ", \"p99\": " << summary.P99
+		<< ", \"max\": " << summary.Max << " }";
+}
+
+static void WriteCounters(std::ostream &out, RenderCounters const &c)
+{
+	out << "{ \"draws\": " << c.DrawCalls << ", \"instances\": " << c.Instances
+		<< ", \"triangles\": " << c.Triangles << ", \"programs\": " << c.ProgramBinds
+		<< ", \"vaos\": " << c.VertexArrayBinds << ", \"textures\": " << c.TextureBinds
+		<< ", \"uniforms\": " << c.UniformCalls << ", \"buffer_bytes\": " << c.BufferBytes
+		<< ", \"texture_bytes\": " << c.TextureBytes << " }";
+}
+
+void WriteJson(std::ostream &out, BenchmarkReport const &report)
+{
+	auto const flags = out.flags();
+	auto const precision = out.precision();
+
+	out << std::fixed << std::setprecision(3);
+
+	out << "{\n";
+	out << "\t\"level\": " << Quote(report.Level) << ",\n";
+	out << "\t\"width\": " << report.Width << ",\n";
+	out << "\t\"height\": " << report.Height << ",\n";
+	out << "\t\"warmup_frames\": " << report.WarmupFrames << ",\n";
+	out << "\t\"frames\": " << report.CpuFrameTimes.size() << ",\n";
+	out << "\t\"startup_ms\": " << report.StartupMs << ",\n";
+	out << "\t\"program_cache\": { \"hits\": " << report.CachedPrograms
+		<< ", \"misses\": " << report.BuiltPrograms
+		<< ", \"saved_ms\": " << report.CacheSavedMs << " },\n";
+
+	out << "\t\"cpu_ms\": ";
+	WriteSummary(out, Summarize(report.CpuFrameTimes));
+	out << ",\n";
+
+	out << "\t\"gpu_ms\": ";
+	WriteSummary(out, Summarize(report.GpuFrameTimes));
+	out << ",\n";
+
+	out << "\t\"gpu_passes_ms\": {";
+	for (size_t i = 0; i < report.GpuPasses.size(); i++) {
+		out << (i > 0 ? ",\n\t\t" : "\n\t\t") << Quote(report.GpuPasses[i].first) << ": " << report.GpuPasses[i].second;
+	}
+	out << (report.GpuPasses.empty() ? "},\n" : "\n\t},\n");
+
+	out << "\t\"counters\": ";
+	WriteCounters(out, report.Counters);
+	out << ",\n";
+
+	out << "\t\"pass_counters\": {";
+	for (size_t i = 0; i < report.CountersByPass.size(); i++) {
+		out << (i > 0 ? ",\n\t\t" : "\n\t\t") << Quote(report.CountersByPass[i].Name) << ": ";
+		WriteCounters(out, report.CountersByPass[i].Counters);
+	}
+	out << (report.CountersByPass.empty() ? "}\n" : "\n\t}\n");
+	out << "}\n";
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "RenderCounterTypes.hpp"
+#include <glm/vec3.hpp>
+#include <vector>
+#include <string>
+#include <utility>
+#include <optional>
+#include <iosfwd>
+#include <cstddef>
+
+namespace engine
+{
+
+struct CameraKey
+{
+	glm::vec3 Position = glm::vec3(0.0f);
+	glm::vec3 Target = glm::vec3(0.0f, 0.0f, 1.0f);
+};
+
+///
+/// Scripted camera of the benchmark
+///
+/// The keys are evenly spaced in time and joined by Catmull-Rom splines, so the camera
+/// goes through every key without a kink at any of them.
+///
+class CameraPath
+{
+private:
+	std::vector<CameraKey> _keys;
+
+public:
+	CameraPath() = default;
+	explicit CameraPath(std::vector<CameraKey> keys) : _keys(std::move(keys)) {}
+
+	///
+	/// One key per line, the position then the target: `x y z tx ty tz`
+	///
+	/// Empty lines and the ones starting with `#` are skipped. Nothing is returned when
+	/// the file cannot be read or a line is malformed.
+	///
+	static std::optional<CameraPath> Load(std::string const &path);
+
+	/// `keyCount` keys on a circle around `center`, `height` above it, looking at it
+	static CameraPath Orbit(glm::vec3 const &center, float radius, float height, size_t keyCount);
+
+	/// `t` goes from 0 at the first key to 1 at the last one
+	CameraKey Sample(float t) const;
+
+	size_t GetKeyCount() const { return _keys.size(); }
+};
+
+///
+/// Nearest-rank percentiles of a series of frame times, in milliseconds
+///
+struct FrameTimeSummary
+{
+	float Mean = 0.0f;
+	float P50 = 0.0f;
+	float P90 = 0.0f;
+	float P99 = 0.0f;
+	float Max = 0.0f;
+};
+
+FrameTimeSummary Summarize(std::vector<float> samples);
+
+struct BenchmarkReport
+{
+	std::string Level;
+	int Width = 0;
+	int Height = 0;
+	size_t WarmupFrames = 0;
+
+	/// From the creation of the context to the level being loaded
+	float StartupMs = 0.0f;
+	/// Programs loaded from the program cache, and built from source
+	size_t CachedPrograms = 0;
+	size_t BuiltPrograms = 0;
+	float CacheSavedMs = 0.0f;
+
+	std::vector<float> CpuFrameTimes;
+	std::vector<float> GpuFrameTimes;
+	/// Average GPU time of the outermost passes over the measured frames
+	std::vector<std::pair<std::string, float>> GpuPasses;
+
+	/// Average work submitted per measured frame, in total and by outermost pass
+	RenderCounters Counters;
+	std::vector<PassCounters> CountersByPass;
+};
+
+/// The summaries of the report as a JSON object, the samples are left out
+void WriteJson(std::ostream &out, BenchmarkReport const &report);
+
+}
@@ -0,0 +1,200 @@
+#include "ClusteredLighting.hpp"
+#include "Logger.hpp"
+#include "RenderCounters.hpp"
+#include <algorithm>
+
+namespace engine
+{
+
+ClusteredLighting::ClusteredLighting() : _mode(Mode::Compute), _clusterBuffer(0), _indexBuffer(0),
+	_counterBuffer(0), _lightCount(0), _near(0.1f), _far(1000.0f), _clusterProjection(0.0f)
+{
+	_cullProgram.AddComputeShader("shaders/lightcull.cs.glsl").Link();
+
+	if (!_cullProgram.IsValid()) {
+		Logger::Warn("Light culling compute shader unavailable, culling on the CPU\n");
+		_mode = Mode::Cpu;
+	}
+
+	glCreateBuffers(1, &_clusterBuffer);
+	glCreateBuffers(1, &_indexBuffer);
+	glCreateBuffers(1, &_counterBuffer);
+
+	glNamedBufferStorage(_clusterBuffer, TotalClusters * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(_indexBuffer, TotalClusters * AverageLightsPerCluster * sizeof(GLuint), nullptr,
+		GL_DYNAMIC_STORAGE_BIT);
+	glNamedBufferStorage(_counterBuffer, sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+	glDeleteBuffers(1, &_clusterBuffer);
+	glDeleteBuffers(1, &_indexBuffer);
+	glDeleteBuffers(1, &_counterBuffer);
+}
+
+void ClusteredLighting::SetMode(Mode mode)
+{
+	if (mode == Mode::Compute && !_cullProgram.IsValid()) {
+		Logger::Warn("Light culling compute shader unavailable\n");
+		return ;
+	}
+	_mode = mode;
+}
+
+void ClusteredLighting::UploadLights(std::vector<PointLightData> const &lights)
+{
+	auto &stream = StreamBuffer::Instance();
+
+	_lightCount = lights.size();
+
+	// An empty range cannot be bound, keep room for one light
+	_lights = stream.Allocate(std::max<size_t>(lights.size(), 1) * sizeof(PointLightData), stream.GetStorageAlignment());
+	std::copy(lights.begin(), lights.end(), static_cast<PointLightData *>(_lights.Data));
+}
+
+void ClusteredLighting::Update(std::vector<PointLightData> const &lights, glm::mat4 const &view,
+	glm::mat4 const &projection)
+{
+	// Clip planes of a glm::perspective projection
+	_near = projection[3][2] / (projection[2][2] - 1.0f);
+	_far = projection[3][2] / (projection[2][2] + 1.0f);
+
+	UploadLights(lights);
+
+	if (_mode == Mode::Compute) {
+		CullCompute(view, projection);
+	}
+	else {
+		CullCpu(lights, view, projection);
+	}
+}
+
+void ClusteredLighting::CullCompute(glm::mat4 const &view, glm::mat4 const &projection)
+{
+	GLuint const zero = 0;
+	glClearNamedBufferData(_counterBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	_cullProgram.SetUniform3ui("clusterCount", ClusterCount);
+	_cullProgram.SetUniform4x4f("inverseProjection", glm::inverse(projection));
+	_cullProgram.SetUniform4x4f("viewMatrix", view);
+	_cullProgram.SetUniform1f("zNear", _near);
+	_cullProgram.SetUniform1f("zFar", _far);
+	_cullProgram.SetUniform1ui("pointLightCount", static_cast<GLuint>(_lightCount));
+	_cullProgram.SetUniform1ui("lightIndexCapacity", static_cast<GLuint>(TotalClusters * AverageLightsPerCluster));
+
+	Bind();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IndexCounterBinding, _counterBuffer);
+
+	_cullProgram.Bind();
+	_cullProgram.Dispatch((TotalClusters + WorkGroupSize - 1) / WorkGroupSize);
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void ClusteredLighting::BuildClusterBounds(glm::mat4 const &projection)
+{
+	if (projection == _clusterProjection) { return ; }
+
+	_clusterProjection = projection;
+	_clusterBounds.resize(TotalClusters);
+
+	glm::mat4 const inverseProjection = glm::inverse(projection);
+
+	auto screenToView = [&] (glm::vec2 const &ndc) {
+		glm::vec4 const p = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+		return glm::vec3(p) / p.w;
+	};
+
+	for (GLuint z = 0; z < ClusterCount.z; z++) {
+		float const sliceNear = -_near * std::pow(_far / _near, static_cast<float>(z) / ClusterCount.z);
+		float const sliceFar = -_near * std::pow(_far / _near, static_cast<float>(z + 1) / ClusterCount.z);
+
+		for (GLuint y = 0; y < ClusterCount.y; y++) {
+			for (GLuint x = 0; x < ClusterCount.x; x++) {
+				glm::vec2 const tileMin = glm::vec2(x, y) / glm::vec2(ClusterCount) * 2.0f - 1.0f;
+				glm::vec2 const tileMax = glm::vec2(x + 1, y + 1) / glm::vec2(ClusterCount) * 2.0f - 1.0f;
+
+				Aabb bounds;
+
+				// Rays from the eye through the tile corners, cut by the slice planes
+				for (auto const &corner : { screenToView(tileMin), screenToView(tileMax) }) {
+					for (float const depth : { sliceNear, sliceFar }) {
+						glm::vec3 const p = corner * (depth / corner.z);
+						bounds.Merge(Aabb(p, p));
+					}
+				}
+
+				_clusterBounds[x + ClusterCount.x * (y + ClusterCount.y * z)] = bounds;
+			}
+		}
+	}
+}
+
+void ClusteredLighting::CullCpu(std::vector<PointLightData> const &lights, glm::mat4 const &view,
+	glm::mat4 const &projection)
+{
+	BuildClusterBounds(projection);
+
+	std::vector<std::vector<GLuint>> clusterLights(TotalClusters);
+	float const logRatio = std::log(_far / _near);
+
+	for (size_t i = 0; i < lights.size(); i++) {
+		glm::vec3 const center = glm::vec3(view * glm::vec4(lights[i].Position, 1.0f));
+		float const radius = lights[i].Radius;
+
+		// Only visit the slices the sphere spans
+		float const zMin = std::max(-center.z - radius, _near);
+		float const zMax = std::min(-center.z + radius, _far);
+
+		if (zMin > zMax) { continue ; }
+
+		auto slice = [&] (float depth) {
+			float const s = std::log(depth / _near) * ClusterCount.z / logRatio;
+			return std::clamp(static_cast<GLuint>(std::max(s, 0.0f)), 0u, ClusterCount.z - 1);
+		};
+
+		for (GLuint z = slice(zMin); z <= slice(zMax); z++) {
+			for (GLuint tile = 0; tile < ClusterCount.x * ClusterCount.y; tile++) {
+				size_t const cluster = tile + ClusterCount.x * ClusterCount.y * z;
+				auto const &bounds = _clusterBounds[cluster];
+
+				glm::vec3 const closest = glm::clamp(center, bounds.Min, bounds.Max);
+				glm::vec3 const d = center - closest;
+
+				if (glm::dot(d, d) <= radius * radius && clusterLights[cluster].size() < MaxLightsPerCluster) {
+					clusterLights[cluster].push_back(static_cast<GLuint>(i));
+				}
+			}
+		}
+	}
+
+	size_t const capacity = TotalClusters * AverageLightsPerCluster;
+
+	_clusters.resize(TotalClusters);
+	_indices.clear();
+
+	for (size_t cluster = 0; cluster < TotalClusters; cluster++) {
+		auto const &list = clusterLights[cluster];
+		size_t const count = std::min(list.size(), capacity - _indices.size());
+
+		_clusters[cluster] = glm::uvec2(_indices.size(), count);
+		_indices.insert(_indices.end(), list.begin(), list.begin() + count);
+	}
+
+	gl::NamedBufferSubData(_clusterBuffer, 0, _clusters.size() * sizeof(glm::uvec2), _clusters.data());
+	if (!_indices.empty()) {
+		gl::NamedBufferSubData(_indexBuffer, 0, _indices.size() * sizeof(GLuint), _indices.data());
+	}
+}
+
+void ClusteredLighting::Bind() const
+{
+	if (_lights.IsValid()) {
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LightBinding, _lights.Buffer, _lights.Offset, _lights.Size);
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ClusterBinding, _clusterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LightIndexBinding, _indexBuffer);
+}
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <vector>
+#include <cmath>
+#include "ShaderProgram.hpp"
+#include "Frustum.hpp"
+#include "StreamBuffer.hpp"
+
+namespace engine
+{
+
+///
+/// Mirrors `struct PointLight` in the lighting shaders (std430)
+///
+struct PointLightData
+{
+	glm::vec3 Position;
+	float Radius;
+	glm::vec3 Color;
+	float Intensity;
+	GLint ShadowTier;
+	GLint ShadowLayer;
+	GLint Padding[2];
+};
+
+///
+/// Assigns point lights to the clusters of the view frustum
+///
+/// The frustum is split in screen tiles and exponential depth slices. Each cluster gets
+/// the list of the lights whose sphere of influence touches it, so the lighting pass only
+/// evaluates the lights that can reach a pixel. Culling runs in a compute shader, or on
+/// the CPU when the compute program is not available.
+///
+/// Buffers read by the lighting pass:
+///   binding 1: PointLightData[]
+///   binding 2: uvec2 (offset, count) per cluster
+///   binding 3: light indices
+///
+class ClusteredLighting
+{
+public:
+	static constexpr GLuint LightBinding        = 1;
+	static constexpr GLuint ClusterBinding      = 2;
+	static constexpr GLuint LightIndexBinding   = 3;
+	static constexpr GLuint IndexCounterBinding = 4;
+
+	static constexpr glm::uvec3 ClusterCount = { 16, 9, 24 };
+	static constexpr size_t TotalClusters = ClusterCount.x * ClusterCount.y * ClusterCount.z;
+
+	/// Must match MAX_LIGHTS_PER_CLUSTER in lightcull.cs.glsl
+	static constexpr size_t MaxLightsPerCluster = 128;
+
+	/// Size of the index list, in average lights per cluster
+	static constexpr size_t AverageLightsPerCluster = 32;
+
+	/// Must match the local size of lightcull.cs.glsl
+	static constexpr size_t WorkGroupSize = 128;
+
+	enum class Mode
+	{
+		Compute,
+		Cpu,
+	};
+
+private:
+	ShaderProgram _cullProgram;
+	Mode _mode;
+
+	/// Lights of the frame, in the StreamBuffer
+	StreamBuffer::Allocation _lights;
+	GLuint _clusterBuffer;
+	GLuint _indexBuffer;
+	GLuint _counterBuffer;
+	size_t _lightCount;
+
+	float _near;
+	float _far;
+
+	/// CPU path
+	glm::mat4 _clusterProjection;
+	std::vector<Aabb> _clusterBounds;
+	std::vector<glm::uvec2> _clusters;
+	std::vector<GLuint> _indices;
+
+	void UploadLights(std::vector<PointLightData> const &lights);
+	void BuildClusterBounds(glm::mat4 const &projection);
+	void CullCompute(glm::mat4 const &view, glm::mat4 const &projection);
+	void CullCpu(std::vector<PointLightData> const &lights, glm::mat4 const &view, glm::mat4 const &projection);
+
+public:
+	ClusteredLighting();
+	~ClusteredLighting();
+
+	ClusteredLighting(ClusteredLighting const &) = delete;
+	void operator=(ClusteredLighting const &) = delete;
+
+	/// Upload the lights of the frame and assign them to the clusters
+	void Update(std::vector<PointLightData> const &lights, glm::mat4 const &view, glm::mat4 const &projection);
+
+	/// Bind the light and cluster buffers for the lighting pass
+	void Bind() const;
+
+	/// Uniforms the lighting shader needs to find the cluster of a pixel
+	void SetUniforms(ShaderProgram &shader, glm::vec2 const &screenSize) const
+	{
+		float const logRatio = std::log(_far / _near);
+
+		shader.SetUniform3f("clusterCount", glm::vec3(ClusterCount));
+		shader.SetUniform1f("clusterScale", ClusterCount.z / logRatio);
+		shader.SetUniform1f("clusterBias", -(ClusterCount.z * std::log(_near)) / logRatio);
+		shader.SetUniform4f("screenSize", glm::vec4(screenSize, 0.0f, 0.0f));
+	}
+
+	void SetMode(Mode mode);
+	Mode GetMode() const { return _mode; }
+};
+
+}
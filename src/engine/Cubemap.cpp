@@ -2,6 +2,8 @@
 #include "stb_image.h"
 #include <array>
 #include <glm/glm.hpp>
+#include "GLState.hpp"
+#include "RenderCounters.hpp"
 
 Cubemap::Cubemap()
 {
@@ -24,14 +26,15 @@ void Cubemap::setupTexture()
 	glBindTexture(GL_TEXTURE_CUBE_MAP, _texture);
 
 	stbi_set_flip_vertically_on_load(false);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	for (size_t i = 0; i < 6; i++) {
 		int w, h, nchannel;
 		unsigned char *data = stbi_load(paths[i].c_str(), &w, &h, &nchannel, 0);
 		if (!data) {
 			std::cerr << "WARNING::CUBEMAP::INIT::IMAGE_NOT_FOUND " << paths[i] << std::endl;
 		}
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB,
-			w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+		engine::gl::TexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB,
+			w, h, GL_RGB, GL_UNSIGNED_BYTE, data);
 		stbi_image_free(data);
 	}
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -110,11 +113,11 @@ Cubemap::~Cubemap()
 
 void Cubemap::draw()
 {
-	glDepthMask(GL_FALSE);
-	glBindVertexArray(_vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, _texture);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-	glDepthMask(GL_TRUE);
+	auto &state = engine::GLState::Instance();
+
+	state.DepthWrite(false);
+	state.BindVertexArray(_vao);
+	state.BindTexture(0, _texture);
+	engine::gl::DrawArrays(GL_TRIANGLES, 0, 36);
+	state.DepthWrite(true);
 }
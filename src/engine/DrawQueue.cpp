@@ -0,0 +1,512 @@
+#include "DrawQueue.hpp"
+#include "RenderCounters.hpp"
+#include "StreamBuffer.hpp"
+#include <algorithm>
+#include <tuple>
+
+namespace engine
+{
+
+/// Instances and triangles drawn by the commands, before any culling on the GPU
+static std::pair<size_t, size_t> CountWork([[maybe_unused]] DrawElementsIndirectCommand const *commands,
+	[[maybe_unused]] size_t count)
+{
+	size_t instances = 0;
+	size_t triangles = 0;
+
+#if ENGINE_RENDER_COUNTERS
+	for (size_t i = 0; i < count; i++) {
+		instances += commands[i].InstanceCount;
+		triangles += size_t(commands[i].Count / 3) * commands[i].InstanceCount;
+	}
+#endif
+	return { instances, triangles };
+}
+
+DrawQueue::DrawQueue() : _opaqueCount(0), _commandBuffer(0), _shadowCommandBuffer(0), _drawDataBuffer(0), _commandCapacity(0), _drawDataCapacity(0),
+	_culledOpaqueCount(0), _bCulled(false), _culledBuffer(0),
+	_culledCapacity(0), _gpuCulling(nullptr), _boundsBuffer(0), _boundsCapacity(0), _gpuCommandBuffer(0),
+	_gpuCommandCapacity(0), _gpuCommandOffset(0), _drawCountBuffer(0), _drawCountCapacity(0), _drawCountOffset(0),
+	_bGpuCulled(false), _gpuCulledCommands(0), _gpuCulledCounters(0)
+{
+	glCreateBuffers(1, &_commandBuffer);
+	glCreateBuffers(1, &_shadowCommandBuffer);
+	glCreateBuffers(1, &_drawDataBuffer);
+	glCreateBuffers(1, &_culledBuffer);
+	glCreateBuffers(1, &_boundsBuffer);
+	glCreateBuffers(1, &_gpuCommandBuffer);
+	glCreateBuffers(1, &_drawCountBuffer);
+}
+
+DrawQueue::~DrawQueue()
+{
+	glDeleteBuffers(1, &_commandBuffer);
+	glDeleteBuffers(1, &_shadowCommandBuffer);
+	glDeleteBuffers(1, &_drawDataBuffer);
+	glDeleteBuffers(1, &_culledBuffer);
+	glDeleteBuffers(1, &_boundsBuffer);
+	glDeleteBuffers(1, &_gpuCommandBuffer);
+	glDeleteBuffers(1, &_drawCountBuffer);
+}
+
+void DrawQueue::Clear()
+{
+	_entries.clear();
+	_commands.clear();
+	_shadowCommands.clear();
+	_drawData.clear();
+	_bounds.clear();
+	_buckets.clear();
+	_runs.clear();
+	_opaqueCount = 0;
+	_bCulled = false;
+	_bGpuCulled = false;
+}
+
+void DrawQueue::Submit(Mesh const &mesh, DrawData const &data, BucketKey const &key, Aabb const &bounds,
+	size_t lod, size_t shadowLod)
+{
+	auto const &base = mesh.GetGeometry();
+
+	if (!base.IsValid()) { return ; }
+
+	// Every level of detail shares the vertices, and thus the layout, of the mesh
+	BucketKey layoutKey = key;
+		layoutKey.Format = base.Format;
+		layoutKey.IndexType = base.IndexType;
+
+	DrawData packedData = data;
+		packedData.PositionOffset = glm::vec4(base.PositionOffset, 0.0f);
+		packedData.PositionScale = glm::vec4(base.PositionScale, 0.0f);
+
+	auto toCommand = [&mesh] (size_t level) {
+		auto const &geometry = mesh.GetGeometry(level);
+
+		DrawElementsIndirectCommand command{};
+			command.Count = geometry.IndexCount;
+			command.InstanceCount = 1;
+			command.FirstIndex = geometry.FirstIndex;
+			command.BaseVertex = geometry.BaseVertex;
+
+		return command;
+	};
+
+	_entries.push_back(Entry{ layoutKey, toCommand(lod), toCommand(shadowLod), packedData, bounds });
+}
+
+void DrawQueue::Upload()
+{
+	std::stable_sort(_entries.begin(), _entries.end(), [] (Entry const &a, Entry const &b) {
+		return a.Key < b.Key;
+	});
+
+	_commands.clear();
+	_shadowCommands.clear();
+	_drawData.clear();
+	_bounds.clear();
+	_buckets.clear();
+	_runs.clear();
+	_opaqueCount = 0;
+	_bCulled = false;
+	_bGpuCulled = false;
+	_commands.reserve(_entries.size());
+	_shadowCommands.reserve(_entries.size());
+	_drawData.reserve(_entries.size());
+	_bounds.reserve(_entries.size());
+
+	for (auto const &entry : _entries) {
+
+		if (_buckets.empty() || _buckets.back().Key != entry.Key) {
+			_buckets.push_back(Bucket{ entry.Key, static_cast<GLuint>(_commands.size()), 0 });
+		}
+		_buckets.back().CommandCount++;
+
+		if (!entry.Key.AlphaTested) {
+			_opaqueCount++;
+		}
+
+		// The base instance selects the per-draw data through the arena's draw index attribute
+		auto command = entry.Command;
+		auto shadowCommand = entry.ShadowCommand;
+		command.BaseInstance = static_cast<GLuint>(_drawData.size());
+		shadowCommand.BaseInstance = command.BaseInstance;
+
+		_commands.push_back(command);
+		_shadowCommands.push_back(shadowCommand);
+		_drawData.push_back(entry.Data);
+		_bounds.push_back(entry.Bounds);
+	}
+
+	_runs = BuildRuns(_buckets);
+
+	GeometryArena::Instance().ReserveDrawIds(_drawData.size());
+
+	// Orphan the buffers when they need to grow, otherwise update in place
+	if (_commands.size() > _commandCapacity) {
+		_commandCapacity = std::max(_commands.size(), _commandCapacity * 2);
+		glNamedBufferData(_commandBuffer, _commandCapacity * sizeof(DrawElementsIndirectCommand),
+			nullptr, GL_DYNAMIC_DRAW);
+		glNamedBufferData(_shadowCommandBuffer, _commandCapacity * sizeof(DrawElementsIndirectCommand),
+			nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (_drawData.size() > _drawDataCapacity) {
+		_drawDataCapacity = std::max(_drawData.size(), _drawDataCapacity * 2);
+		glNamedBufferData(_drawDataBuffer, _drawDataCapacity * sizeof(DrawData),
+			nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	if (!_commands.empty()) {
+		gl::NamedBufferSubData(_commandBuffer, 0, _commands.size() * sizeof(DrawElementsIndirectCommand),
+			_commands.data());
+		gl::NamedBufferSubData(_shadowCommandBuffer, 0, _shadowCommands.size() * sizeof(DrawElementsIndirectCommand),
+			_shadowCommands.data());
+		gl::NamedBufferSubData(_drawDataBuffer, 0, _drawData.size() * sizeof(DrawData),
+			_drawData.data());
+	}
+
+	if (UsesGpuCulling()) {
+		std::vector<DrawBounds> bounds;
+		bounds.reserve(_bounds.size());
+
+		for (GLuint bucket = 0; bucket < _buckets.size(); bucket++) {
+			GLuint const first = _buckets[bucket].FirstCommand;
+
+			for (GLuint i = first; i < first + _buckets[bucket].CommandCount; i++) {
+				bounds.push_back(DrawBounds{ _bounds[i].Min, bucket, _bounds[i].Max, first });
+			}
+		}
+
+		if (bounds.size() > _boundsCapacity) {
+			_boundsCapacity = std::max(bounds.size(), _boundsCapacity * 2);
+			glNamedBufferData(_boundsBuffer, _boundsCapacity * sizeof(DrawBounds), nullptr, GL_DYNAMIC_DRAW);
+		}
+		if (!bounds.empty()) {
+			gl::NamedBufferSubData(_boundsBuffer, 0, bounds.size() * sizeof(DrawBounds), bounds.data());
+		}
+	}
+}
+
+void DrawQueue::Bind() const
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawDataBinding, _drawDataBuffer);
+}
+
+std::vector<DrawElementsIndirectCommand> const &DrawQueue::ActiveCommands() const
+{
+	return _bCulled ? _culledCommands : _commands;
+}
+
+std::vector<DrawQueue::Bucket> const &DrawQueue::ActiveBuckets() const
+{
+	return _bCulled ? _culledBuckets : _buckets;
+}
+
+std::vector<DrawQueue::Run> const &DrawQueue::ActiveRuns() const
+{
+	return _bCulled ? _culledRuns : _runs;
+}
+
+size_t DrawQueue::ActiveOpaqueCount() const
+{
+	return _bCulled ? _culledOpaqueCount : _opaqueCount;
+}
+
+void DrawQueue::BindActiveCommands() const
+{
+	Bind();
+
+	if (_bCulled) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _culledBuffer);
+	}
+	else if (_bGpuCulled) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _gpuCommandBuffer);
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, _drawCountBuffer);
+	}
+}
+
+void DrawQueue::DrawBucket(size_t index) const
+{
+	auto const &bucket = ActiveBuckets()[index];
+	GLuint const first = (_bGpuCulled ? _gpuCulledCommands : 0) + bucket.FirstCommand;
+	DrawElementsIndirectCommand const *commands = ActiveCommands().data() + bucket.FirstCommand;
+
+	if (_bGpuCulled && _gpuCulling->HasDrawCount()) {
+		auto const [ instances, triangles ] = CountWork(commands, bucket.CommandCount);
+
+		GeometryArena::Instance().Bind(bucket.Key.Format, bucket.Key.IndexType);
+		gl::MultiDrawElementsIndirectCount(GL_TRIANGLES, bucket.Key.IndexType,
+			reinterpret_cast<void*>(first * sizeof(DrawElementsIndirectCommand)),
+			(_gpuCulledCounters + index) * sizeof(GLuint), bucket.CommandCount, 0, instances, triangles);
+	}
+	else {
+		MultiDraw(bucket.Key.Format, bucket.Key.IndexType, first, bucket.CommandCount, commands);
+	}
+}
+
+void DrawQueue::MultiDraw(VertexFormat format, GLenum indexType, GLuint first, size_t count,
+	DrawElementsIndirectCommand const *commands)
+{
+	auto const [ instances, triangles ] = CountWork(commands, count);
+
+	GeometryArena::Instance().Bind(format, indexType);
+	gl::MultiDrawElementsIndirect(GL_TRIANGLES, indexType,
+		reinterpret_cast<void*>(first * sizeof(DrawElementsIndirectCommand)), count, 0, instances, triangles);
+}
+
+std::vector<DrawQueue::Run> DrawQueue::BuildRuns(std::vector<Bucket> const &buckets)
+{
+	std::vector<Run> runs;
+
+	for (auto const &bucket : buckets) {
+		if (runs.empty() || runs.back().Format != bucket.Key.Format || runs.back().IndexType != bucket.Key.IndexType) {
+			runs.push_back(Run{ bucket.Key.Format, bucket.Key.IndexType, bucket.FirstCommand, 0, 0 });
+		}
+
+		runs.back().CommandCount += bucket.CommandCount;
+		if (!bucket.Key.AlphaTested) {
+			runs.back().OpaqueCount += bucket.CommandCount;
+		}
+	}
+
+	return runs;
+}
+
+void DrawQueue::Draw(std::function<void(BucketKey const &)> const &bindBucket) const
+{
+	if (ActiveCommands().empty()) { return ; }
+
+	BindActiveCommands();
+
+	for (size_t i = 0; i < ActiveBuckets().size(); i++) {
+		bindBucket(ActiveBuckets()[i].Key);
+		DrawBucket(i);
+	}
+}
+
+void DrawQueue::DrawAll() const
+{
+	if (_commands.empty()) { return ; }
+
+	Bind();
+
+	for (auto const &run : _runs) {
+		MultiDraw(run.Format, run.IndexType, run.FirstCommand, run.CommandCount, _commands.data() + run.FirstCommand);
+	}
+}
+
+void DrawQueue::DrawOpaque() const
+{
+	if (ActiveOpaqueCount() == 0) { return ; }
+
+	BindActiveCommands();
+
+	// Compacted buckets are not contiguous anymore
+	if (_bGpuCulled && _gpuCulling->HasDrawCount()) {
+		for (size_t i = 0; i < _buckets.size(); i++) {
+			if (_buckets[i].Key.AlphaTested) { continue ; }
+
+			DrawBucket(i);
+		}
+		return ;
+	}
+
+	GLuint const first = _bGpuCulled ? _gpuCulledCommands : 0;
+
+	for (auto const &run : ActiveRuns()) {
+		if (run.OpaqueCount == 0) { continue ; }
+
+		MultiDraw(run.Format, run.IndexType, first + run.FirstCommand, run.OpaqueCount,
+			ActiveCommands().data() + run.FirstCommand);
+	}
+}
+
+void DrawQueue::DrawAlphaTested(std::function<void(BucketKey const &)> const &bindBucket) const
+{
+	if (ActiveOpaqueCount() == ActiveCommands().size()) { return ; }
+
+	BindActiveCommands();
+
+	for (size_t i = 0; i < ActiveBuckets().size(); i++) {
+		if (!ActiveBuckets()[i].Key.AlphaTested) { continue ; }
+
+		bindBucket(ActiveBuckets()[i].Key);
+		DrawBucket(i);
+	}
+}
+
+size_t DrawQueue::Cull(std::function<bool(Aabb const &)> const &isVisible)
+{
+	_culledCommands.clear();
+	_culledBuckets.clear();
+	_culledOpaqueCount = 0;
+	_bCulled = true;
+	_bGpuCulled = false;
+
+	// Buckets keep their order, the base instances still point at the uploaded draw data
+	for (auto const &bucket : _buckets) {
+		Bucket culled{ bucket.Key, static_cast<GLuint>(_culledCommands.size()), 0 };
+
+		for (GLuint i = bucket.FirstCommand; i < bucket.FirstCommand + bucket.CommandCount; i++) {
+			if (isVisible(_bounds[i])) {
+				_culledCommands.push_back(_commands[i]);
+				culled.CommandCount++;
+			}
+		}
+
+		if (culled.CommandCount == 0) { continue ; }
+
+		if (!bucket.Key.AlphaTested) {
+			_culledOpaqueCount += culled.CommandCount;
+		}
+		_culledBuckets.push_back(culled);
+	}
+
+	_culledRuns = BuildRuns(_culledBuckets);
+
+	if (_culledCommands.size() > _culledCapacity) {
+		_culledCapacity = std::max(_culledCommands.size(), _culledCapacity * 2);
+		glNamedBufferData(_culledBuffer, _culledCapacity * sizeof(DrawElementsIndirectCommand),
+			nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (!_culledCommands.empty()) {
+		gl::NamedBufferSubData(_culledBuffer, 0, _culledCommands.size() * sizeof(DrawElementsIndirectCommand),
+			_culledCommands.data());
+	}
+
+	return _commands.size() - _culledCommands.size();
+}
+
+void DrawQueue::DrawVisible(Frustum const &frustum)
+{
+	if (UsesGpuCulling()) {
+		if (_commands.empty()) { return ; }
+
+		auto const [ commands, counter ] = DispatchGpuCull(_shadowCommandBuffer, frustum, false, false);
+
+		Bind();
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _gpuCommandBuffer);
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, _drawCountBuffer);
+
+		// Each run has its own output range and counter
+		for (size_t i = 0; i < _runs.size(); i++) {
+			auto const &run = _runs[i];
+			DrawElementsIndirectCommand const *shadowCommands = _shadowCommands.data() + run.FirstCommand;
+
+			if (!_gpuCulling->HasDrawCount()) {
+				MultiDraw(run.Format, run.IndexType, commands + run.FirstCommand, run.CommandCount, shadowCommands);
+				continue ;
+			}
+
+			auto const [ instances, triangles ] = CountWork(shadowCommands, run.CommandCount);
+
+			GeometryArena::Instance().Bind(run.Format, run.IndexType);
+			gl::MultiDrawElementsIndirectCount(GL_TRIANGLES, run.IndexType,
+				reinterpret_cast<void*>((commands + run.FirstCommand) * sizeof(DrawElementsIndirectCommand)),
+				(counter + i) * sizeof(GLuint), run.CommandCount, 0, instances, triangles);
+		}
+		return ;
+	}
+
+	_visible.clear();
+	_visibleRuns.clear();
+
+	for (auto const &run : _runs) {
+		Run visible{ run.Format, run.IndexType, static_cast<GLuint>(_visible.size()), 0, 0 };
+
+		for (GLuint i = run.FirstCommand; i < run.FirstCommand + run.CommandCount; i++) {
+			if (frustum.Intersects(_bounds[i])) {
+				_visible.push_back(_shadowCommands[i]);
+				visible.CommandCount++;
+			}
+		}
+
+		if (visible.CommandCount > 0) {
+			_visibleRuns.push_back(visible);
+		}
+	}
+
+	if (_visible.empty()) { return ; }
+
+	// Aligned on a whole command, so that MultiDraw can address it by index
+	auto const visible = StreamBuffer::Instance().Upload(_visible.data(), _visible.size());
+	GLuint const first = static_cast<GLuint>(visible.Offset / sizeof(DrawElementsIndirectCommand));
+
+	Bind();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, visible.Buffer);
+
+	for (auto const &run : _visibleRuns) {
+		MultiDraw(run.Format, run.IndexType, first + run.FirstCommand, run.CommandCount,
+			_visible.data() + run.FirstCommand);
+	}
+}
+
+void DrawQueue::SetGpuCulling(GpuCulling *culling)
+{
+	_gpuCulling = culling;
+	_bGpuCulled = false;
+}
+
+bool DrawQueue::UsesGpuCulling() const
+{
+	return _gpuCulling != nullptr && _gpuCulling->IsSupported();
+}
+
+std::pair<GLuint, GLuint> DrawQueue::DispatchGpuCull(GLuint commandBuffer, Frustum const &frustum, bool bOcclusion,
+	bool bPerBucket)
+{
+	size_t const counterCount = bPerBucket ? _buckets.size() : _runs.size();
+
+	// Written by the GPU, so not in the StreamBuffer: a region per dispatch, orphaned when full
+	if (_gpuCommandOffset + _commands.size() > _gpuCommandCapacity) {
+		_gpuCommandCapacity = std::max(_commands.size() * 8, _gpuCommandCapacity);
+		_gpuCommandOffset = 0;
+		glNamedBufferData(_gpuCommandBuffer, _gpuCommandCapacity * sizeof(DrawElementsIndirectCommand),
+			nullptr, GL_STREAM_DRAW);
+	}
+	if (_drawCountOffset + counterCount > _drawCountCapacity) {
+		_drawCountCapacity = std::max(std::max<size_t>(_buckets.size() * 8, 64), _drawCountCapacity);
+		_drawCountOffset = 0;
+		glNamedBufferData(_drawCountBuffer, _drawCountCapacity * sizeof(GLuint), nullptr, GL_STREAM_DRAW);
+	}
+
+	GLuint const commands = static_cast<GLuint>(_gpuCommandOffset);
+	GLuint const counter = static_cast<GLuint>(_drawCountOffset);
+	GLuint const zero = 0;
+
+	glClearNamedBufferSubData(_drawCountBuffer, GL_R32UI, counter * sizeof(GLuint), counterCount * sizeof(GLuint),
+		GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GpuCulling::CommandBinding, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GpuCulling::BoundsBinding, _boundsBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GpuCulling::CulledCommandBinding, _gpuCommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GpuCulling::DrawCountBinding, _drawCountBuffer);
+
+	if (bPerBucket) {
+		_gpuCulling->Dispatch(0, _commands.size(), frustum, bOcclusion, true, commands, counter);
+	}
+	else {
+		for (size_t i = 0; i < _runs.size(); i++) {
+			_gpuCulling->Dispatch(_runs[i].FirstCommand, _runs[i].CommandCount, frustum, bOcclusion, false,
+				commands + _runs[i].FirstCommand, counter + static_cast<GLuint>(i));
+		}
+	}
+
+	_gpuCommandOffset += _commands.size();
+	_drawCountOffset += counterCount;
+
+	return { commands, counter };
+}
+
+void DrawQueue::CullGpu(Frustum const &frustum, bool bOcclusion)
+{
+	_bCulled = false;
+	_bGpuCulled = false;
+
+	if (!UsesGpuCulling() || _commands.empty()) { return ; }
+
+	std::tie(_gpuCulledCommands, _gpuCulledCounters) = DispatchGpuCull(_commandBuffer, frustum, bOcclusion, true);
+	_bGpuCulled = true;
+}
+
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <vector>
+#include <functional>
+#include "Mesh.hpp"
+#include "Frustum.hpp"
+#include "GpuCulling.hpp"
+
+namespace engine
+{
+
+///
+/// Layout of the commands consumed by glMultiDrawElementsIndirect
+///
+struct DrawElementsIndirectCommand
+{
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint  BaseVertex;
+	GLuint BaseInstance;
+};
+
+///
+/// Per-draw data, mirrors `struct DrawData` in the shaders (std430)
+///
+struct DrawData
+{
+	glm::mat4 Model;
+	glm::mat4 Normal;
+	/// Index in the MaterialTable
+	GLuint MaterialId;
+	GLuint Padding[3];
+	/// Decoding of packed positions, filled by DrawQueue::Submit()
+	glm::vec4 PositionOffset;
+	glm::vec4 PositionScale;
+};
+
+///
+/// World bounds of a draw, mirrors `struct DrawBounds` in drawcull.cs.glsl (std430)
+///
+struct DrawBounds
+{
+	glm::vec3 Min;
+	GLuint Bucket;
+	glm::vec3 Max;
+	/// First command of the bucket
+	GLuint BucketFirst;
+};
+
+///
+/// Collects the meshes to draw in a frame and submits them with glMultiDrawElementsIndirect
+///
+/// Draws are grouped by bucket (shader and material) so that a pass only needs to bind the
+/// bucket's textures and issue one multi-draw per bucket, or one multi-draw per run of
+/// draws sharing a vertex format and index type when textures do not matter (depth/shadow
+/// passes).
+///
+class DrawQueue
+{
+public:
+	///
+	/// Draws sharing a key can be issued in the same multi-draw
+	///
+	struct BucketKey
+	{
+		unsigned int Shader;
+		/// Material id, see Engine::AddPbrMaterial()
+		unsigned int Material;
+		/// The material discards fragments, sorted after the opaque buckets of the same run
+		bool AlphaTested = false;
+		/// Layout of the geometry, set by Submit()
+		VertexFormat Format = VertexFormat::Full;
+		GLenum IndexType = GL_UNSIGNED_INT;
+
+		bool operator==(BucketKey const &rhs) const
+		{
+			return Shader == rhs.Shader && Material == rhs.Material && AlphaTested == rhs.AlphaTested
+				&& Format == rhs.Format && IndexType == rhs.IndexType;
+		}
+
+		bool operator!=(BucketKey const &rhs) const { return !(*this == rhs); }
+
+		bool operator<(BucketKey const &rhs) const
+		{
+			if (Format != rhs.Format) { return Format < rhs.Format; }
+			if (IndexType != rhs.IndexType) { return IndexType == GL_UNSIGNED_SHORT; }
+			if (AlphaTested != rhs.AlphaTested) { return rhs.AlphaTested; }
+			if (Shader != rhs.Shader) { return Shader < rhs.Shader; }
+			return Material < rhs.Material;
+		}
+	};
+
+	struct Bucket
+	{
+		BucketKey Key;
+		GLuint FirstCommand;
+		GLuint CommandCount;
+	};
+
+	///
+	/// Consecutive buckets sharing a VAO, drawn with one multi-draw when textures do not matter
+	///
+	struct Run
+	{
+		VertexFormat Format;
+		GLenum IndexType;
+		GLuint FirstCommand;
+		GLuint CommandCount;
+		/// The opaque commands come first in the run
+		GLuint OpaqueCount;
+	};
+
+	/// Shader storage binding point of the DrawData array
+	static constexpr GLuint DrawDataBinding = 0;
+
+private:
+	struct Entry
+	{
+		BucketKey Key;
+		DrawElementsIndirectCommand Command;
+		DrawElementsIndirectCommand ShadowCommand;
+		DrawData Data;
+		Aabb Bounds;
+	};
+
+	std::vector<Entry> _entries;
+
+	std::vector<DrawElementsIndirectCommand> _commands;
+	/// Same draws at the level of detail of the shadow passes
+	std::vector<DrawElementsIndirectCommand> _shadowCommands;
+	std::vector<DrawData> _drawData;
+	std::vector<Aabb> _bounds;
+	std::vector<Bucket> _buckets;
+	std::vector<Run> _runs;
+
+	size_t _opaqueCount;
+
+	/// Commands that passed the last DrawVisible() test
+	std::vector<DrawElementsIndirectCommand> _visible;
+	std::vector<Run> _visibleRuns;
+
+	GLuint _commandBuffer;
+	GLuint _shadowCommandBuffer;
+	GLuint _drawDataBuffer;
+	size_t _commandCapacity;
+	size_t _drawDataCapacity;
+
+	/// Commands that passed the last Cull() test, drawn instead of the whole queue until the next Upload()
+	std::vector<DrawElementsIndirectCommand> _culledCommands;
+	std::vector<Bucket> _culledBuckets;
+	std::vector<Run> _culledRuns;
+	size_t _culledOpaqueCount;
+	bool _bCulled;
+	GLuint _culledBuffer;
+	size_t _culledCapacity;
+
+	/// GPU culling, the output buffer and the counters are streamed in regions, orphaned when it is full
+	GpuCulling *_gpuCulling;
+	GLuint _boundsBuffer;
+	size_t _boundsCapacity;
+	GLuint _gpuCommandBuffer;
+	size_t _gpuCommandCapacity;
+	size_t _gpuCommandOffset;
+	GLuint _drawCountBuffer;
+	size_t _drawCountCapacity;
+	size_t _drawCountOffset;
+
+	/// Output of the last CullGpu(), drawn instead of the whole queue until the next Upload()
+	bool _bGpuCulled;
+	GLuint _gpuCulledCommands;
+	GLuint _gpuCulledCounters;
+
+	std::vector<DrawElementsIndirectCommand> const &ActiveCommands() const;
+	std::vector<Bucket> const &ActiveBuckets() const;
+	std::vector<Run> const &ActiveRuns() const;
+	size_t ActiveOpaqueCount() const;
+	void BindActiveCommands() const;
+	void DrawBucket(size_t index) const;
+
+	/// One multi-draw of the commands [first, first + count) of the bound indirect buffer,
+	/// `commands` is their copy on the CPU, for the render counters
+	static void MultiDraw(VertexFormat format, GLenum indexType, GLuint first, size_t count,
+		DrawElementsIndirectCommand const *commands);
+	static std::vector<Run> BuildRuns(std::vector<Bucket> const &buckets);
+
+	/// Run the cull shader on the queue, returns the offsets of the output and the counters
+	std::pair<GLuint, GLuint> DispatchGpuCull(GLuint commandBuffer, Frustum const &frustum, bool bOcclusion,
+		bool bPerBucket);
+	bool UsesGpuCulling() const;
+
+public:
+	DrawQueue();
+	~DrawQueue();
+
+	DrawQueue(DrawQueue const &) = delete;
+	void operator=(DrawQueue const &) = delete;
+
+	void Clear();
+
+	/// Queue a mesh for drawing, `bounds` is its world-space bounding box. The levels of
+	/// detail are clamped to the ones of the mesh, `shadowLod` is used by DrawVisible().
+	void Submit(Mesh const &mesh, DrawData const &data, BucketKey const &key, Aabb const &bounds,
+		size_t lod = 0, size_t shadowLod = 0);
+
+	/// Sort the queued draws by bucket and upload the commands and per-draw data
+	void Upload();
+
+	/// Bind the indirect buffer and the per-draw data, the arena is bound by each draw
+	void Bind() const;
+
+	/// Issue one multi-draw per bucket, `bindBucket` is called before each of them
+	void Draw(std::function<void(BucketKey const &)> const &bindBucket) const;
+
+	/// Issue one multi-draw per run for every queued mesh
+	void DrawAll() const;
+
+	/// Issue one multi-draw per run for the meshes that are not alpha-tested
+	void DrawOpaque() const;
+
+	/// Issue one multi-draw per alpha-tested bucket, `bindBucket` is called before each of them
+	void DrawAlphaTested(std::function<void(BucketKey const &)> const &bindBucket) const;
+
+	/// Issue one multi-draw per run for the queued meshes whose bounds intersect `frustum`,
+	/// at their shadow level of detail
+	void DrawVisible(Frustum const &frustum);
+
+	/// Restrict Draw(), DrawOpaque() and DrawAlphaTested() to the meshes whose bounds pass
+	/// `isVisible`, DrawAll() and DrawVisible() still see the whole queue.
+	/// Returns the number of culled draws.
+	size_t Cull(std::function<bool(Aabb const &)> const &isVisible);
+
+	///
+	/// Cull on the GPU instead of the CPU, nullptr to go back to the CPU
+	///
+	/// DrawVisible() then culls in a compute shader, and CullGpu() can replace Cull().
+	/// The bounds are uploaded by Upload() from then on.
+	///
+	void SetGpuCulling(GpuCulling *culling);
+
+	/// Same as Cull() with a frustum and, with `bOcclusion`, the previous frame's depth
+	void CullGpu(Frustum const &frustum, bool bOcclusion);
+
+	size_t GetDrawCount() const { return _commands.size(); }
+	/// Draws issued by the camera passes
+	size_t GetActiveDrawCount() const { return ActiveCommands().size(); }
+	std::vector<Aabb> const &GetBounds() const { return _bounds; }
+	std::vector<Bucket> const &GetBuckets() const { return _buckets; }
+};
+
+}
@@ -4,28 +4,53 @@
 #include "stb_image.h"
 #include "components/SelectedComponent.hpp"
 #include "engine/Model.hpp"
+#include "GLState.hpp"
+#include "Profiler.hpp"
+#include "StreamBuffer.hpp"
+#include "OffscreenContext.hpp"
 
 namespace engine
 {
 
 unsigned int Engine::_nextId = 0;
 unsigned int Engine::_nextMaterialId = 0;
+glm::ivec2 Engine::_headlessSize(0);
+
+void Engine::EnableHeadless(int width, int height)
+{
+	_headlessSize = glm::ivec2(width, height);
+}
 
 Engine::Engine()
 {
-	_display = std::make_unique<Display>("3D Engine", 1920, 1080);
-	_display->enableCap(GL_DEPTH_TEST);
-	_display->enableCap(GL_CULL_FACE);
-	_display->enableCap(GL_BLEND);
-	_display->setFullscreen(false);
-	_display->showCursor(false);
+	if (_headlessSize.x > 0 && _headlessSize.y > 0) {
+		_offscreen = std::make_unique<OffscreenContext>(_headlessSize.x, _headlessSize.y);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_CULL_FACE);
+	}
+	else {
+		_display = std::make_unique<Display>("3D Engine", 1920, 1080);
+		_display->enableCap(GL_DEPTH_TEST);
+		_display->enableCap(GL_CULL_FACE);
+		_display->enableCap(GL_BLEND);
+		_display->setFullscreen(false);
+		_display->showCursor(false);
+
+		maths::transform t = { glm::vec3(32, 64, 32), glm::quat(), glm::vec3(1), nullptr };
+		_camera = std::make_unique<Camera>(*_display, t);
+		_camera->setProjection(glm::radians(80.0f), 0.1f, 1000.0f);
+	}
 	glEnable(GL_DEBUG_OUTPUT);
 
-	maths::transform t = { glm::vec3(32, 64, 32), glm::quat(), glm::vec3(1), nullptr };
-	_camera = std::make_unique<Camera>(*_display, t);
-	_camera->setProjection(glm::radians(80.0f), 0.1f, 1000.0f);
+	glm::ivec2 const displaySize = GetDisplaySize();
+	_ui = std::make_unique<UI>(displaySize.x, displaySize.y);
 
-	_ui = std::make_unique<UI>(_display->getWidth(), _display->getHeight());
+	PbrMaterial fallback{};
+		fallback.Name = "default";
+		fallback.BaseColor = glm::vec4(1.0f);
+		fallback.MetallicFactor = 1.0f;
+		fallback.RoughnessFactor = 1.0f;
+	AddPbrMaterial(fallback);
 
 	_systemManager = _ecs.GetSystemManager();
 	_entityManager = _ecs.GetEntityManager();
@@ -70,23 +95,56 @@ int Engine::Run()
 {
 	Settings::instance().load("config.ini");
 
+	if (!_display) {
+		Logger::Warn("Run() needs a window, headless frames are driven by RenderFrame()\n");
+		return 1;
+	}
+
 	while (!_display->isClosed())
 	{
-		float deltaTime = Time::instance().getDeltaTime();
+		RenderFrame(Time::instance().getDeltaTime());
+	}
+
+	return 0;
+}
+
+void Engine::RenderFrame(float deltaTime)
+{
+	// The UI and the display touch the GL state behind the cache's back
+	GLState::Instance().BeginFrame();
 
-		Update();
+	Update();
 
+	if (_camera) {
 		_camera->update();
-		_ecs.Update(deltaTime);
+	}
+	_ecs.Update(deltaTime);
+
+	for (auto const &timing : _ecs.GetSystemManager()->GetTimings()) {
+		Profiler::Instance().AddCpuTiming(timing.Name, timing.Milliseconds);
+	}
 
+	if (_display) {
 		_display->update();
 		_display->updateInputs();
-
-		_ui->update();
-		_ui->render();
 	}
 
-	return 0;
+	_ui->update();
+
+	Profiler::Instance().BeginPass("UI");
+	_ui->render();
+	Profiler::Instance().EndPass();
+
+	Profiler::Instance().EndFrame();
+	StreamBuffer::Instance().EndFrame();
+}
+
+glm::ivec2 Engine::GetDisplaySize()
+{
+	if (_offscreen) {
+		return _offscreen->GetSize();
+	}
+	return glm::ivec2(_display->getWidth(), _display->getHeight());
 }
 
 void Engine::Update()
@@ -14,6 +14,8 @@
 #include "Logger.hpp"
 #include "Action.hpp"
 #include "Level.hpp"
+#include "GLState.hpp"
+#include "ResolutionGovernor.hpp"
 
 using namespace lazy;
 using namespace graphics;
@@ -30,12 +32,15 @@ namespace engine
 {
 
 class Model;
+class RenderGraph;
+class OffscreenContext;
 
 class Engine
 {
 private:
 	std::unique_ptr<Display> _display;
 	std::unique_ptr<Camera> _camera;
+	std::unique_ptr<OffscreenContext> _offscreen;
 	std::unique_ptr<UI> _ui;
 
 	ecs::ECSEngine _ecs;
@@ -53,11 +58,16 @@ private:
 	using MaterialContainer = std::pair<unsigned int, Material>;
 
 	std::unordered_map<std::string, MaterialContainer> _materials;
-	std::unordered_map<std::string, PbrMaterial> _pbrMaterials;
+	/// Indexed by material id, see AddPbrMaterial()
+	std::vector<PbrMaterial> _pbrMaterials;
+	std::unordered_map<std::string, unsigned int> _pbrMaterialIds;
 
 	static unsigned int _nextId;
 	static unsigned int _nextMaterialId;
 
+	/// Size of the offscreen context, zero to open a window
+	static glm::ivec2 _headlessSize;
+
 private:
 	Engine();
 	~Engine();
@@ -72,6 +82,36 @@ public:
 	/// Select an item in the editor
 	Action<size_t> OnSelectItem;
 
+	/// Switch the G-buffer between the compact and wide layouts
+	Action<bool> OnCompactGBuffer;
+
+	/// Enable or disable the depth pre-pass of the geometry pass
+	Action<bool> OnDepthPrepass;
+
+	/// Enable or disable screen space ambient occlusion
+	Action<bool> OnSsao;
+
+	/// Select the shadow filter, an index in ShadowAtlas::Filters
+	Action<size_t> OnShadowFilter;
+
+	/// Store shadows in 32-bit float depth instead of 16-bit
+	Action<bool> OnShadowDepth32;
+
+	/// Enable or disable the software occlusion culling of the camera passes
+	Action<bool> OnOcclusionCulling;
+
+	/// Cull the draws in a compute shader instead of on the CPU
+	Action<bool> OnGpuCulling;
+
+	/// Change the frame budget and the limits of the dynamic resolution
+	Action<GovernorSettings const &> OnResolutionGovernor;
+
+	/// Upscale the scene with a Catmull-Rom filter instead of a bilinear one
+	Action<bool> OnBicubicUpscale;
+
+	/// Add passes to the frame after the ones of the renderer, before the graph is compiled
+	Action<RenderGraph &> OnBuildRenderGraph;
+
 public:
 	Engine(Engine const &) = delete;
 	void operator=(Engine const &) = delete;
@@ -82,12 +122,32 @@ public:
 		return engine;
 	}
 
+	///
+	/// Render without a window, into an offscreen context of this size
+	///
+	/// Must be called before the first Instance(). There is then no Display, no input
+	/// and no Run(): the caller drives the frames with RenderFrame().
+	///
+	static void EnableHeadless(int width, int height);
+
 	int Run();
+	/// Update the objects and the systems, and render the frame
+	void RenderFrame(float deltaTime);
 	void Update();
 	void UpdateObjects();
 	void UpdateSubobjects(std::vector<EngineObject*> subobjects);
 
+	/// Null when headless
 	lazy::graphics::Display *GetDisplay() { return _display.get(); }
+	bool IsHeadless() const { return _offscreen != nullptr; }
+	/// Size of the default framebuffer, the window or the offscreen context
+	glm::ivec2 GetDisplaySize();
+
+	template <typename ... ArgTypes>
+	[[nodiscard]] std::vector<ecs::IEntity<ArgTypes...> *> GetEntities()
+	{
+		return _entityManager->GetEntities<ArgTypes...>();
+	}
 
 	template <typename T, typename ... ArgTypes>
 	[[nodiscard]] T *CreateEngineObject(ArgTypes... args)
@@ -144,58 +204,69 @@ public:
 		return _nextId++;
 	}
 
-	void AddPbrMaterial(PbrMaterial material)
-	{
-		if (_pbrMaterials.find(material.Name) != _pbrMaterials.end()) {
-			Logger::Warn("Material {} already exists\n", material.Name);
-		}
+	/// Material of the meshes that have none
+	static constexpr unsigned int DefaultPbrMaterial = 0;
 
-		_pbrMaterials[material.Name] = material;
-	}
-
-	void BindPbrMaterial(std::string const &name)
+	///
+	/// Register a material and resolve its textures, which must already be loaded
+	///
+	/// The id is the index of the material in GetPbrMaterials(), and of its parameters in
+	/// the GPU material table. A name that is already taken keeps its material.
+	///
+	unsigned int AddPbrMaterial(PbrMaterial material)
 	{
-		if (name.size() == 0) {
-			Logger::Warn("Material name not given\n");
-			return ;
-		}
-		if (_pbrMaterials.find(name) == _pbrMaterials.end()) {
-			Logger::Warn("Material not found ({})\n", name);
-			return ;
+		auto const existing = _pbrMaterialIds.find(material.Name);
+
+		if (existing != _pbrMaterialIds.end()) {
+			Logger::Warn("Material {} already exists\n", material.Name);
+			return existing->second;
 		}
 
-		auto const &material = _pbrMaterials[name];
+		auto &textures = TextureManager::instance();
 
 		if (material.Albedo.has_value()) {
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, TextureManager::instance().get(material.Albedo.value()));
+			material.AlbedoTexture = textures.get(material.Albedo.value());
+			material.bAlphaTested = textures.hasAlpha(material.Albedo.value());
 		}
 		if (material.Normal.has_value()) {
-			glActiveTexture(GL_TEXTURE2);
-			glBindTexture(GL_TEXTURE_2D, TextureManager::instance().get(material.Normal.value()));
+			material.NormalTexture = textures.get(material.Normal.value());
+		}
+		if (material.MetallicRoughness.has_value()) {
+			material.MetallicRoughnessTexture = textures.get(material.MetallicRoughness.value());
 		}
+
+		unsigned int const id = _pbrMaterials.size();
+
+		_pbrMaterialIds[material.Name] = id;
+		_pbrMaterials.push_back(std::move(material));
+
+		return id;
 	}
 
 	void UnbindPbrMaterial()
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::Instance().BindTexture(0, 0);
+		GLState::Instance().BindTexture(1, 0);
+		GLState::Instance().BindTexture(2, 0);
+	}
 
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	/// Id of a material by name, to resolve it once when loading
+	std::optional<unsigned int> FindPbrMaterial(std::string const &name) const
+	{
+		auto const id = _pbrMaterialIds.find(name);
 
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		if (id == _pbrMaterialIds.end()) { return std::nullopt; }
+		return id->second;
 	}
 
-	std::optional<PbrMaterial const *> GetPbrMaterial(std::string const &name)
+	/// Valid until the next AddPbrMaterial(), nullptr for an unknown id
+	PbrMaterial const *GetPbrMaterial(unsigned int id) const
 	{
-		if (_pbrMaterials.find(name) != _pbrMaterials.end()) {
-			return std::make_optional(&_pbrMaterials[name]);
-		}
-		return std::nullopt;
+		return id < _pbrMaterials.size() ? &_pbrMaterials[id] : nullptr;
 	}
 
+	std::vector<PbrMaterial> const &GetPbrMaterials() const { return _pbrMaterials; }
+
 	void AddMaterial(std::string const &name, Material mat)
 	{
 		if (name.size() == 0) {
@@ -221,29 +292,21 @@ public:
 		auto const &material = _materials[name].second;
 
 		if (material.diffuse > 0) {
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, material.diffuse);
+			GLState::Instance().BindTexture(0, material.diffuse);
 		}
 		if (material.specular > 0) {
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, material.specular);
+			GLState::Instance().BindTexture(1, material.specular);
 		}
 		if (material.normal > 0) {
-			glActiveTexture(GL_TEXTURE2);
-			glBindTexture(GL_TEXTURE_2D, material.normal);
+			GLState::Instance().BindTexture(2, material.normal);
 		}
 	}
 
 	void UnbindMaterial()
 	{
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::Instance().BindTexture(0, 0);
+		GLState::Instance().BindTexture(1, 0);
+		GLState::Instance().BindTexture(2, 0);
 	}
 
 	unsigned int GetMaterialId(std::string const &name)
@@ -263,6 +326,7 @@ public:
 
 	void Close()
 	{
+		if (!_display) { return ; }
 		glfwSetWindowShouldClose(_display->getWindow(), GLFW_TRUE);
 	}
 
@@ -51,13 +51,12 @@ bool Framebuffer::IsComplete()
 
 void Framebuffer::AttachColorBuffer()
 {
-	int width = Engine::Instance().GetDisplay()->getWidth();
-	int height = Engine::Instance().GetDisplay()->getHeight();
+	glm::ivec2 const size = Engine::Instance().GetDisplaySize();
 
 	glGenTextures(1, &_texture);
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, _texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size.x, size.y, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
@@ -68,12 +67,11 @@ void Framebuffer::AttachColorBuffer()
 
 void Framebuffer::AttachDepthBuffer()
 {
-	int width = Engine::Instance().GetDisplay()->getWidth();
-	int height = Engine::Instance().GetDisplay()->getHeight();
+	glm::ivec2 const size = Engine::Instance().GetDisplaySize();
 
 	glGenRenderbuffers(1, &_depth);
 	glBindRenderbuffer(GL_RENDERBUFFER, _depth);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
 	glBindRenderbuffer(GL_RENDERBUFFER, 0);
 
 	Bind();
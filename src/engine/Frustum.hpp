@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+#include <limits>
+
+namespace engine
+{
+
+///
+/// Axis-aligned bounding box
+///
+struct Aabb
+{
+	glm::vec3 Min{ std::numeric_limits<float>::max() };
+	glm::vec3 Max{ std::numeric_limits<float>::lowest() };
+
+	Aabb() = default;
+	Aabb(glm::vec3 const &min, glm::vec3 const &max) : Min(min), Max(max) {}
+
+	bool IsEmpty() const
+	{
+		return Min.x > Max.x || Min.y > Max.y || Min.z > Max.z;
+	}
+
+	void Merge(Aabb const &other)
+	{
+		Min = glm::min(Min, other.Min);
+		Max = glm::max(Max, other.Max);
+	}
+
+	/// Bounding box of this box once transformed by `matrix`
+	Aabb Transform(glm::mat4 const &matrix) const
+	{
+		glm::vec3 const center = (Min + Max) * 0.5f;
+		glm::vec3 const extents = (Max - Min) * 0.5f;
+
+		glm::vec3 const newCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+		glm::vec3 newExtents(0.0f);
+
+		for (int i = 0; i < 3; i++) {
+			newExtents += glm::abs(glm::vec3(matrix[i])) * extents[i];
+		}
+
+		return Aabb(newCenter - newExtents, newCenter + newExtents);
+	}
+
+	bool operator==(Aabb const &rhs) const { return Min == rhs.Min && Max == rhs.Max; }
+	bool operator!=(Aabb const &rhs) const { return !(*this == rhs); }
+};
+
+///
+/// The six planes of a view-projection matrix, normals pointing inside
+///
+class Frustum
+{
+private:
+	std::array<glm::vec4, 6> _planes;
+
+public:
+	Frustum() = default;
+
+	explicit Frustum(glm::mat4 const &viewProjection)
+	{
+		glm::mat4 const m = glm::transpose(viewProjection);
+
+		_planes[0] = m[3] + m[0]; // Left
+		_planes[1] = m[3] - m[0]; // Right
+		_planes[2] = m[3] + m[1]; // Bottom
+		_planes[3] = m[3] - m[1]; // Top
+		_planes[4] = m[3] + m[2]; // Near
+		_planes[5] = m[3] - m[2]; // Far
+	}
+
+	/// Conservative test, may report boxes near the corners as intersecting
+	bool Intersects(Aabb const &box) const
+	{
+		for (auto const &plane : _planes) {
+			glm::vec3 const normal(plane);
+
+			// Corner of the box the furthest along the plane normal
+			glm::vec3 const positive = glm::mix(box.Min, box.Max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+
+			if (glm::dot(normal, positive) + plane.w < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::array<glm::vec4, 6> const &GetPlanes() const { return _planes; }
+};
+
+}
@@ -1,108 +1,90 @@
 #pragma once
 
 #include "lazy.hpp"
-#include "Engine.hpp"
-
+#include "RenderGraph.hpp"
+
+///
+/// Render targets of the geometry pass, declared in the render graph of each frame
+///
+/// Both layouts share the attachment order written by basic.fs.glsl:
+///   0: normal
+///   1: albedo (rgb) and metallic (a)
+///   2: roughness (r)
+///   3: world position, wide layout only
+///
+/// The compact layout stores the normal octahedral-encoded in RG16 and rebuilds the
+/// position from the depth texture, the wide one keeps everything in RGBA16F.
+///
 class GBuffer
 {
-private:
-	GLuint _gBuffer;
-	GLuint _gPosition;
-	GLuint _gNormal;
-	GLuint _gAlbedoSpec;
-	GLuint _gDepth;
-	GLuint _gMetallicRoughness;
-
-	void Init()
+public:
+	enum class Layout
 	{
-		auto display = engine::Engine::Instance().GetDisplay();
-		auto [ width, height ] = std::tuple(display->getWidth(), display->getHeight());
-
-		glGenFramebuffers(1, &_gBuffer);
-		glBindFramebuffer(GL_FRAMEBUFFER, _gBuffer);
-
-		glGenTextures(1, &_gPosition);
-		glBindTexture(GL_TEXTURE_2D, _gPosition);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _gPosition, 0);
-
-		glGenTextures(1, &_gNormal);
-		glBindTexture(GL_TEXTURE_2D, _gNormal);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, _gNormal, 0);
+		Wide,
+		Compact,
+	};
 
-		glGenTextures(1, &_gAlbedoSpec);
-		glBindTexture(GL_TEXTURE_2D, _gAlbedoSpec);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, _gAlbedoSpec, 0);
+	using Handle = engine::RenderGraph::Handle;
 
-		glGenTextures(1, &_gMetallicRoughness);
-		glBindTexture(GL_TEXTURE_2D, _gMetallicRoughness);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, _gMetallicRoughness, 0);
+	Handle Normal;
+	Handle AlbedoMetallic;
+	Handle Roughness;
+	/// Invalid with the compact layout, rebuild the position from the depth instead
+	Handle Position;
+	Handle Depth;
 
-		glBindTexture(GL_TEXTURE_2D, 0);
+private:
+	Layout _layout;
 
-		glGenRenderbuffers(1, &_gDepth);
-		glBindRenderbuffer(GL_RENDERBUFFER, _gDepth);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _gDepth);
+public:
+	/// `scale` is the fraction of the display size the targets are allocated at
+	GBuffer(engine::RenderGraph &graph, Layout layout, float scale = 1.0f) : _layout(layout)
+	{
+		bool const bIsCompact = (_layout == Layout::Compact);
 
-		GLuint st = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-		assert(st == GL_FRAMEBUFFER_COMPLETE);
+		GLenum const normalFormat = bIsCompact ? GL_RG16 : GL_RGBA16F;
+		GLenum const albedoFormat = bIsCompact ? GL_RGBA8 : GL_RGBA16F;
+		GLenum const roughnessFormat = bIsCompact ? GL_R8 : GL_RGBA16F;
 
-		std::array<GLuint, 4> attachments = {
-			GL_COLOR_ATTACHMENT0,
-			GL_COLOR_ATTACHMENT1,
-			GL_COLOR_ATTACHMENT2,
-			GL_COLOR_ATTACHMENT3,
-		};
-		glDrawBuffers(attachments.size(), attachments.data());
+		Normal = graph.Create("GBuffer normal", { normalFormat, scale });
+		AlbedoMetallic = graph.Create("GBuffer albedo", { albedoFormat, scale });
+		Roughness = graph.Create("GBuffer roughness", { roughnessFormat, scale });
+		Position = bIsCompact ? engine::RenderGraph::Invalid : graph.Create("GBuffer position", { GL_RGBA16F, scale });
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		// Sampled by the lighting pass, 24 bits to stay blittable to the default framebuffer
+		Depth = graph.Create("GBuffer depth", { GL_DEPTH_COMPONENT24, scale });
 	}
 
-public:
-	GBuffer()
+	/// Draw into every target, in the attachment order of basic.fs.glsl
+	void Write(engine::RenderGraph::PassBuilder &pass)
 	{
-		Init();
+		Normal = pass.Write(Normal);
+		AlbedoMetallic = pass.Write(AlbedoMetallic);
+		Roughness = pass.Write(Roughness);
+		if (!IsCompact()) {
+			Position = pass.Write(Position);
+		}
+		Depth = pass.Write(Depth);
 	}
 
-	~GBuffer()
+	/// Sample every target
+	void Read(engine::RenderGraph::PassBuilder &pass) const
 	{
-		glDeleteFramebuffers(1, &_gBuffer);
-		glDeleteTextures(1, &_gPosition);
-		glDeleteTextures(1, &_gNormal);
-		glDeleteTextures(1, &_gAlbedoSpec);
-		glDeleteTextures(1, &_gDepth);
-		glDeleteTextures(1, &_gMetallicRoughness);
+		pass.Read(Normal);
+		pass.Read(AlbedoMetallic);
+		pass.Read(Roughness);
+		if (!IsCompact()) {
+			pass.Read(Position);
+		}
+		pass.Read(Depth);
 	}
 
-	void Bind()
-	{
-		glBindFramebuffer(GL_FRAMEBUFFER, _gBuffer);
-	}
+	Layout GetLayout() const { return _layout; }
+	bool IsCompact() const { return _layout == Layout::Compact; }
 
-	void Unbind()
+	/// Bytes written per pixel, depth included
+	static constexpr size_t BytesPerPixel(Layout layout)
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return layout == Layout::Compact ? 4 + 4 + 1 + 4 : 8 * 4 + 4;
 	}
-
-	GLuint GetFramebufferId() const { return _gBuffer; }
-	GLuint GetPositionTex() const { return _gPosition; }
-	GLuint GetNormalTex() const { return _gNormal; }
-	GLuint GetAlbedoSpecTex() const { return _gAlbedoSpec; }
-	GLuint GetDepthTex() const { return _gDepth; }
-	GLuint GetMetallicRoughnessTex() const { return _gMetallicRoughness; }
 };
@@ -0,0 +1,187 @@
+#include "GLState.hpp"
+#include "RenderCounters.hpp"
+
+namespace engine
+{
+
+GLState::GLState()
+{
+	Invalidate();
+}
+
+void GLState::Invalidate()
+{
+	_program = Unknown;
+	_vertexArray = Unknown;
+	_drawFramebuffer = Unknown;
+	_readFramebuffer = Unknown;
+	_textures.fill(Unknown);
+
+	_depthTest = Unknown;
+	_depthWrite = Unknown;
+	_depthFunc = Unknown;
+	_blend = Unknown;
+	_blendSrc = Unknown;
+	_blendDst = Unknown;
+	_cullFace = Unknown;
+	_cullMode = Unknown;
+	_viewport.fill(-1);
+}
+
+void GLState::BeginFrame()
+{
+	Invalidate();
+
+	_lastFrame = _counters;
+	_counters = Counters{};
+}
+
+void GLState::UseProgram(GLuint program)
+{
+	if (Update(_program, program)) {
+		gl::CountProgramBind();
+		glUseProgram(program);
+	}
+}
+
+void GLState::BindVertexArray(GLuint vao)
+{
+	if (Update(_vertexArray, vao)) {
+		gl::CountVertexArrayBind();
+		glBindVertexArray(vao);
+	}
+}
+
+void GLState::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	switch (target) {
+	case GL_DRAW_FRAMEBUFFER:
+		if (Update(_drawFramebuffer, framebuffer)) {
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+		}
+		break ;
+	case GL_READ_FRAMEBUFFER:
+		if (Update(_readFramebuffer, framebuffer)) {
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		}
+		break ;
+	default:
+		if (_drawFramebuffer == framebuffer && _readFramebuffer == framebuffer) {
+			_counters.Elided++;
+			break ;
+		}
+		_counters.Issued++;
+		_drawFramebuffer = framebuffer;
+		_readFramebuffer = framebuffer;
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		break ;
+	}
+}
+
+void GLState::BindTexture(GLuint unit, GLuint texture)
+{
+	if (unit >= GL_TEXTURE0) {
+		unit -= GL_TEXTURE0;
+	}
+
+	if (unit >= MaxTextureUnits) {
+		_counters.Issued++;
+		gl::CountTextureBind();
+		glBindTextureUnit(unit, texture);
+		return ;
+	}
+
+	if (Update(_textures[unit], texture)) {
+		gl::CountTextureBind();
+		glBindTextureUnit(unit, texture);
+	}
+}
+
+void GLState::Viewport(GLint x, GLint y, GLint width, GLint height)
+{
+	std::array<GLint, 4> const viewport = { x, y, width, height };
+
+	if (Update(_viewport, viewport)) {
+		glViewport(x, y, width, height);
+	}
+}
+
+void GLState::SetCapability(GLenum cap, GLuint &current, bool enabled)
+{
+	if (Update(current, enabled ? 1u : 0u)) {
+		if (enabled) {
+			glEnable(cap);
+		}
+		else {
+			glDisable(cap);
+		}
+	}
+}
+
+void GLState::DepthTest(bool enabled)
+{
+	SetCapability(GL_DEPTH_TEST, _depthTest, enabled);
+}
+
+void GLState::DepthWrite(bool enabled)
+{
+	if (Update(_depthWrite, enabled ? 1u : 0u)) {
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLState::DepthFunc(GLenum func)
+{
+	if (Update(_depthFunc, func)) {
+		glDepthFunc(func);
+	}
+}
+
+void GLState::Blend(bool enabled)
+{
+	SetCapability(GL_BLEND, _blend, enabled);
+}
+
+void GLState::BlendFunc(GLenum src, GLenum dst)
+{
+	if (_blendSrc == src && _blendDst == dst) {
+		_counters.Elided++;
+		return ;
+	}
+
+	_counters.Issued++;
+	_blendSrc = src;
+	_blendDst = dst;
+	glBlendFunc(src, dst);
+}
+
+void GLState::CullFace(bool enabled)
+{
+	SetCapability(GL_CULL_FACE, _cullFace, enabled);
+}
+
+void GLState::CullMode(GLenum mode)
+{
+	if (Update(_cullMode, mode)) {
+		glCullFace(mode);
+	}
+}
+
+void GLState::Apply(PipelineState const &state)
+{
+	DepthTest(state.DepthTest);
+	DepthWrite(state.DepthWrite);
+	DepthFunc(state.DepthFunc);
+
+	Blend(state.Blend);
+	if (state.Blend) {
+		BlendFunc(state.BlendSrc, state.BlendDst);
+	}
+
+	CullFace(state.CullFace);
+	if (state.CullFace) {
+		CullMode(state.CullMode);
+	}
+}
+
+}
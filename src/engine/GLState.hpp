@@ -0,0 +1,133 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <array>
+
+namespace engine
+{
+
+///
+/// Fixed-function state of a pass, applied at once with GLState::Apply()
+///
+struct PipelineState
+{
+	bool DepthTest = true;
+	bool DepthWrite = true;
+	GLenum DepthFunc = GL_LEQUAL;
+
+	bool Blend = false;
+	GLenum BlendSrc = GL_SRC_ALPHA;
+	GLenum BlendDst = GL_ONE_MINUS_SRC_ALPHA;
+
+	bool CullFace = true;
+	GLenum CullMode = GL_BACK;
+};
+
+///
+/// Shadows the OpenGL state and skips the calls that would not change anything
+///
+/// Every state change made while rendering a frame should go through this class.
+/// Code that modifies the state behind its back (loading, third party libraries)
+/// must call Invalidate() afterwards; the engine does it at the start of each frame.
+///
+class GLState
+{
+public:
+	static constexpr size_t MaxTextureUnits = 32;
+
+	struct Counters
+	{
+		/// Calls forwarded to the driver
+		size_t Issued = 0;
+		/// Calls skipped because the state was already set
+		size_t Elided = 0;
+	};
+
+private:
+	/// Value used for state that is not known (after an invalidation)
+	static constexpr GLuint Unknown = ~0u;
+
+	GLuint _program;
+	GLuint _vertexArray;
+	GLuint _drawFramebuffer;
+	GLuint _readFramebuffer;
+	std::array<GLuint, MaxTextureUnits> _textures;
+
+	GLuint _depthTest;
+	GLuint _depthWrite;
+	GLenum _depthFunc;
+	GLuint _blend;
+	GLenum _blendSrc;
+	GLenum _blendDst;
+	GLuint _cullFace;
+	GLenum _cullMode;
+	std::array<GLint, 4> _viewport;
+
+	Counters _counters;
+	Counters _lastFrame;
+
+	GLState();
+
+	/// Returns true if `current` had to be updated to `value`
+	template <typename T, typename U>
+	bool Update(T &current, U value)
+	{
+		if (current == static_cast<T>(value)) {
+			_counters.Elided++;
+			return false;
+		}
+		current = static_cast<T>(value);
+		_counters.Issued++;
+		return true;
+	}
+
+	void SetCapability(GLenum cap, GLuint &current, bool enabled);
+
+public:
+	static GLState &Instance()
+	{
+		static GLState state;
+		return state;
+	}
+
+	GLState(GLState const &) = delete;
+	void operator=(GLState const &) = delete;
+
+	/// Forget everything that is known about the state
+	void Invalidate();
+
+	/// Invalidate the state and start counting the calls of a new frame
+	void BeginFrame();
+
+	/// Bind a program by name
+	void UseProgram(GLuint program);
+
+	void BindVertexArray(GLuint vao);
+
+	/// GL_FRAMEBUFFER binds both the draw and the read framebuffers
+	void BindFramebuffer(GLenum target, GLuint framebuffer);
+
+	/// Bind a texture to a texture unit, `unit` may be given as GL_TEXTUREi
+	void BindTexture(GLuint unit, GLuint texture);
+
+	void Viewport(GLint x, GLint y, GLint width, GLint height);
+
+	void DepthTest(bool enabled);
+	void DepthWrite(bool enabled);
+	void DepthFunc(GLenum func);
+	void Blend(bool enabled);
+	void BlendFunc(GLenum src, GLenum dst);
+	void CullFace(bool enabled);
+	void CullMode(GLenum mode);
+
+	/// Set every fixed-function state of a pass
+	void Apply(PipelineState const &state);
+
+	/// Counters of the frame being rendered
+	Counters const &GetCounters() const { return _counters; }
+
+	/// Counters of the last complete frame
+	Counters const &GetLastFrameCounters() const { return _lastFrame; }
+};
+
+}
@@ -0,0 +1,282 @@
+#include "GeometryArena.hpp"
+#include "RenderCounters.hpp"
+#include <glm/gtc/packing.hpp>
+#include <numeric>
+#include <limits>
+#include <cstddef>
+#include "Logger.hpp"
+
+namespace engine
+{
+
+GeometryArena::GeometryArena() : _vaos{}, _drawIdBuffer(0), _drawIdCapacity(0)
+{
+	// Full vertices are left to the UI, the skybox and the batches, models are packed
+	_vertexPools[static_cast<size_t>(VertexFormat::Full)].Stride = sizeof(Vertex);
+	_vertexPools[static_cast<size_t>(VertexFormat::Full)].InitialCapacity = 1 << 16;
+	_vertexPools[static_cast<size_t>(VertexFormat::Packed)].Stride = sizeof(PackedVertex);
+	_vertexPools[static_cast<size_t>(VertexFormat::Packed)].InitialCapacity = 1 << 20;
+	_indexPools[IndexPool(GL_UNSIGNED_INT)].Stride = sizeof(GLuint);
+	_indexPools[IndexPool(GL_UNSIGNED_INT)].InitialCapacity = 1 << 20;
+	_indexPools[IndexPool(GL_UNSIGNED_SHORT)].Stride = sizeof(GLushort);
+	_indexPools[IndexPool(GL_UNSIGNED_SHORT)].InitialCapacity = 1 << 22;
+
+	glCreateVertexArrays(_vaos.size(), _vaos.data());
+
+	for (size_t i = 0; i < _vaos.size(); i++) {
+		GLuint const vao = _vaos[i];
+
+		glEnableVertexArrayAttrib(vao, PositionAttrib);
+		glEnableVertexArrayAttrib(vao, NormalAttrib);
+		glEnableVertexArrayAttrib(vao, UvAttrib);
+		glEnableVertexArrayAttrib(vao, TangentAttrib);
+
+		if (static_cast<VertexFormat>(i / 2) == VertexFormat::Full) {
+			glVertexArrayAttribFormat(vao, PositionAttrib, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position));
+			glVertexArrayAttribFormat(vao, NormalAttrib,   3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal));
+			glVertexArrayAttribFormat(vao, UvAttrib,       2, GL_FLOAT, GL_FALSE, offsetof(Vertex, Uv));
+			glVertexArrayAttribFormat(vao, TangentAttrib,  4, GL_FLOAT, GL_FALSE, offsetof(Vertex, Tangent));
+		}
+		else {
+			glVertexArrayAttribFormat(vao, PositionAttrib, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+				offsetof(PackedVertex, Position));
+			glVertexArrayAttribFormat(vao, NormalAttrib,   4, GL_INT_2_10_10_10_REV, GL_TRUE,
+				offsetof(PackedVertex, Normal));
+			glVertexArrayAttribFormat(vao, UvAttrib,       2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, Uv));
+			glVertexArrayAttribFormat(vao, TangentAttrib,  4, GL_INT_2_10_10_10_REV, GL_TRUE,
+				offsetof(PackedVertex, Tangent));
+		}
+
+		glVertexArrayAttribBinding(vao, PositionAttrib, 0);
+		glVertexArrayAttribBinding(vao, NormalAttrib,   0);
+		glVertexArrayAttribBinding(vao, UvAttrib,       0);
+		glVertexArrayAttribBinding(vao, TangentAttrib,  0);
+
+		// Per-draw index
+		glEnableVertexArrayAttrib(vao, DrawIdAttrib);
+		glVertexArrayAttribIFormat(vao, DrawIdAttrib, 1, GL_UNSIGNED_INT, 0);
+		glVertexArrayAttribBinding(vao, DrawIdAttrib, 1);
+		glVertexArrayBindingDivisor(vao, 1, 1);
+	}
+
+	for (auto &pool : _vertexPools) {
+		Grow(pool, pool.InitialCapacity);
+	}
+	for (auto &pool : _indexPools) {
+		Grow(pool, pool.InitialCapacity);
+	}
+	ReserveDrawIds(InitialDrawIdCapacity);
+}
+
+GeometryArena::~GeometryArena()
+{
+	glDeleteVertexArrays(_vaos.size(), _vaos.data());
+	for (auto const &pool : _vertexPools) {
+		glDeleteBuffers(1, &pool.Buffer);
+	}
+	for (auto const &pool : _indexPools) {
+		glDeleteBuffers(1, &pool.Buffer);
+	}
+	glDeleteBuffers(1, &_drawIdBuffer);
+}
+
+void GeometryArena::Grow(Pool &pool, size_t minCapacity)
+{
+	size_t const oldCapacity = pool.Range.GetCapacity();
+	size_t newCapacity = std::max<size_t>(oldCapacity * 2, pool.InitialCapacity);
+
+	while (newCapacity < minCapacity) { newCapacity *= 2; }
+
+	GLuint buffer = 0;
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, newCapacity * pool.Stride, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+	if (pool.Buffer != 0) {
+		glCopyNamedBufferSubData(pool.Buffer, buffer, 0, 0, oldCapacity * pool.Stride);
+		glDeleteBuffers(1, &pool.Buffer);
+	}
+
+	pool.Buffer = buffer;
+	pool.Range.Grow(newCapacity);
+	Attach();
+
+	Logger::Verbose("Geometry arena: {} elements of {} bytes ({} MiB)\n", newCapacity, pool.Stride,
+		newCapacity * pool.Stride / (1024 * 1024));
+}
+
+void GeometryArena::Attach()
+{
+	for (size_t i = 0; i < _vaos.size(); i++) {
+		auto const &vertices = _vertexPools[i / 2];
+		auto const &indices = _indexPools[i % 2];
+
+		glVertexArrayVertexBuffer(_vaos[i], 0, vertices.Buffer, 0, vertices.Stride);
+		glVertexArrayElementBuffer(_vaos[i], indices.Buffer);
+	}
+}
+
+size_t GeometryArena::Allocate(Pool &pool, size_t count)
+{
+	auto offset = pool.Range.Allocate(count);
+	if (!offset.has_value()) {
+		// The free space can be fragmented, only the grown tail is sure to be contiguous
+		Grow(pool, pool.Range.GetCapacity() + count);
+		offset = pool.Range.Allocate(count);
+	}
+	return offset.value();
+}
+
+void GeometryArena::ReserveDrawIds(size_t count)
+{
+	if (count <= _drawIdCapacity) { return ; }
+
+	size_t newCapacity = std::max<size_t>(_drawIdCapacity * 2, InitialDrawIdCapacity);
+	while (newCapacity < count) { newCapacity *= 2; }
+
+	std::vector<GLuint> ids(newCapacity);
+	std::iota(ids.begin(), ids.end(), 0);
+
+	glDeleteBuffers(1, &_drawIdBuffer);
+	glCreateBuffers(1, &_drawIdBuffer);
+	glNamedBufferStorage(_drawIdBuffer, ids.size() * sizeof(GLuint), ids.data(), 0);
+
+	_drawIdCapacity = newCapacity;
+	for (auto const vao : _vaos) {
+		glVertexArrayVertexBuffer(vao, 1, _drawIdBuffer, 0, sizeof(GLuint));
+	}
+}
+
+GeometryAllocation GeometryArena::Allocate(std::vector<Vertex> const &vertices, std::vector<GLuint> const &indices,
+	VertexFormat format)
+{
+	GeometryAllocation allocation;
+
+	if (vertices.empty() || indices.empty()) { return allocation; }
+
+	auto &pool = _vertexPools[static_cast<size_t>(format)];
+
+	allocation.Format = format;
+	allocation.IndexType = vertices.size() <= MaxShortIndexVertices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	allocation.BaseVertex = static_cast<GLint>(Allocate(pool, vertices.size()));
+	allocation.VertexCount = static_cast<GLuint>(vertices.size());
+
+	if (format == VertexFormat::Full) {
+		gl::NamedBufferSubData(pool.Buffer, allocation.BaseVertex * sizeof(Vertex),
+			vertices.size() * sizeof(Vertex), vertices.data());
+	}
+	else {
+		glm::vec3 min(std::numeric_limits<float>::max());
+		glm::vec3 max(std::numeric_limits<float>::lowest());
+
+		for (auto const &v : vertices) {
+			min = glm::min(min, v.Position);
+			max = glm::max(max, v.Position);
+		}
+
+		allocation.PositionOffset = min;
+		allocation.PositionScale = max - min;
+
+		// Flat meshes have no extent along an axis, every vertex sits at the offset
+		glm::vec3 const invScale = glm::vec3(
+			allocation.PositionScale.x > 0.0f ? 1.0f / allocation.PositionScale.x : 0.0f,
+			allocation.PositionScale.y > 0.0f ? 1.0f / allocation.PositionScale.y : 0.0f,
+			allocation.PositionScale.z > 0.0f ? 1.0f / allocation.PositionScale.z : 0.0f);
+
+		std::vector<PackedVertex> packed(vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); i++) {
+			auto const &v = vertices[i];
+			glm::vec3 const position = glm::clamp((v.Position - min) * invScale, 0.0f, 1.0f);
+			float const handedness = v.Tangent.w < 0.0f ? -1.0f : 1.0f;
+
+			packed[i].Position = glm::u16vec4(glm::round(position * 65535.0f), 0);
+			packed[i].Normal = glm::packSnorm3x10_1x2(glm::vec4(v.Normal, 0.0f));
+			packed[i].Tangent = glm::packSnorm3x10_1x2(glm::vec4(glm::vec3(v.Tangent), handedness));
+			packed[i].Uv = glm::packHalf2x16(v.Uv);
+		}
+
+		gl::NamedBufferSubData(pool.Buffer, allocation.BaseVertex * sizeof(PackedVertex),
+			packed.size() * sizeof(PackedVertex), packed.data());
+	}
+
+	UploadIndices(allocation, indices);
+
+	return allocation;
+}
+
+GeometryAllocation GeometryArena::AllocateIndices(GeometryAllocation const &base, std::vector<GLuint> const &indices)
+{
+	GeometryAllocation allocation = base;
+
+	if (!base.IsValid() || indices.empty()) { return GeometryAllocation{}; }
+
+	allocation.VertexCount = 0;
+	UploadIndices(allocation, indices);
+
+	return allocation;
+}
+
+void GeometryArena::UploadIndices(GeometryAllocation &allocation, std::vector<GLuint> const &indices)
+{
+	auto &pool = _indexPools[IndexPool(allocation.IndexType)];
+
+	allocation.FirstIndex = static_cast<GLuint>(Allocate(pool, indices.size()));
+	allocation.IndexCount = static_cast<GLuint>(indices.size());
+
+	if (allocation.IndexType == GL_UNSIGNED_SHORT) {
+		std::vector<GLushort> const shortIndices(indices.begin(), indices.end());
+
+		gl::NamedBufferSubData(pool.Buffer, allocation.FirstIndex * sizeof(GLushort),
+			shortIndices.size() * sizeof(GLushort), shortIndices.data());
+	}
+	else {
+		gl::NamedBufferSubData(pool.Buffer, allocation.FirstIndex * sizeof(GLuint),
+			indices.size() * sizeof(GLuint), indices.data());
+	}
+}
+
+void GeometryArena::Free(GeometryAllocation const &allocation)
+{
+	if (!allocation.IsValid()) { return ; }
+
+	_vertexPools[static_cast<size_t>(allocation.Format)].Range.Free(allocation.BaseVertex, allocation.VertexCount);
+	_indexPools[IndexPool(allocation.IndexType)].Range.Free(allocation.FirstIndex, allocation.IndexCount);
+}
+
+size_t GeometryArena::GetVertexCount() const
+{
+	size_t count = 0;
+	for (auto const &pool : _vertexPools) {
+		count += pool.Range.GetUsed();
+	}
+	return count;
+}
+
+size_t GeometryArena::GetVertexBytes() const
+{
+	size_t bytes = 0;
+	for (auto const &pool : _vertexPools) {
+		bytes += pool.Range.GetUsed() * pool.Stride;
+	}
+	return bytes;
+}
+
+size_t GeometryArena::GetIndexBytes() const
+{
+	size_t bytes = 0;
+	for (auto const &pool : _indexPools) {
+		bytes += pool.Range.GetUsed() * pool.Stride;
+	}
+	return bytes;
+}
+
+size_t GeometryArena::GetUnpackedBytes() const
+{
+	size_t indexCount = 0;
+	for (auto const &pool : _indexPools) {
+		indexCount += pool.Range.GetUsed();
+	}
+	return GetVertexCount() * sizeof(Vertex) + indexCount * sizeof(GLuint);
+}
+
+}
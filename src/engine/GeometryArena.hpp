@@ -0,0 +1,183 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <vector>
+#include <array>
+#include <glm/gtc/type_precision.hpp>
+#include "RangeAllocator.hpp"
+#include "GLState.hpp"
+
+namespace engine
+{
+
+///
+/// The vertex format meshes are built from, and stored as when they are not packed
+///
+struct Vertex
+{
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec2 Uv;
+	glm::vec4 Tangent;
+};
+
+///
+/// Compressed vertex format, decoded by the vertex fetch
+///
+/// Positions are 16-bit unorm relative to the bounds of the mesh and are rescaled in the
+/// shaders with the offset and scale of the draw. Normals and tangents are 10-10-10-2
+/// snorm, the 2-bit w holding the handedness, and UVs are half floats.
+///
+struct PackedVertex
+{
+	glm::u16vec4 Position;
+	GLuint Normal;
+	GLuint Tangent;
+	GLuint Uv;
+};
+
+enum class VertexFormat
+{
+	Full,
+	Packed,
+};
+
+///
+/// Where a mesh lives inside the arena's vertex and index buffers
+///
+struct GeometryAllocation
+{
+	GLint BaseVertex = 0;
+	GLuint VertexCount = 0;
+	GLuint FirstIndex = 0;
+	GLuint IndexCount = 0;
+
+	VertexFormat Format = VertexFormat::Full;
+	/// GL_UNSIGNED_SHORT when the vertices of the mesh fit in 16 bits
+	GLenum IndexType = GL_UNSIGNED_INT;
+
+	/// position = PositionOffset + attribute * PositionScale
+	glm::vec3 PositionOffset = glm::vec3(0.0f);
+	glm::vec3 PositionScale = glm::vec3(1.0f);
+
+	bool IsValid() const { return IndexCount > 0; }
+
+	size_t GetIndexSize() const { return IndexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+
+	/// Byte offset of the first index, as expected by glDrawElements
+	void const *GetIndexOffset() const { return reinterpret_cast<void const *>(FirstIndex * GetIndexSize()); }
+};
+
+///
+/// Vertex and index buffers, and the VAOs that read them, holding the geometry of every mesh
+///
+/// Meshes sub-allocate a range of vertices and indices and are drawn with a base vertex
+/// so that all of them can be submitted together through glMultiDrawElementsIndirect.
+/// There is one vertex pool per vertex format and one index pool per index type, and a
+/// VAO for each combination: draws can only share a multi-draw when they share a VAO.
+///
+/// Attribute 5 is a per-instance draw index (divisor 1) fed from a buffer of 0..N;
+/// indirect commands set their base instance to the index of the draw so shaders can
+/// fetch their per-draw data without relying on gl_DrawID.
+///
+class GeometryArena
+{
+public:
+	static constexpr GLuint PositionAttrib = 0;
+	static constexpr GLuint NormalAttrib   = 1;
+	static constexpr GLuint UvAttrib       = 2;
+	static constexpr GLuint TangentAttrib  = 3;
+	static constexpr GLuint DrawIdAttrib   = 5;
+
+	/// Meshes with at most this many vertices get 16-bit indices
+	static constexpr size_t MaxShortIndexVertices = 1 << 16;
+
+private:
+	///
+	/// A buffer sub-allocated in elements of `Stride` bytes
+	///
+	struct Pool
+	{
+		GLuint Buffer = 0;
+		RangeAllocator Range;
+		size_t Stride;
+		size_t InitialCapacity;
+	};
+
+	/// Indexed by VertexFormat
+	std::array<Pool, 2> _vertexPools;
+	/// 32-bit then 16-bit indices
+	std::array<Pool, 2> _indexPools;
+	/// Indexed by vertex pool * 2 + index pool
+	std::array<GLuint, 4> _vaos;
+
+	GLuint _drawIdBuffer;
+	size_t _drawIdCapacity;
+
+	static constexpr size_t InitialDrawIdCapacity = 1 << 12;
+
+	GeometryArena();
+
+	static size_t IndexPool(GLenum indexType) { return indexType == GL_UNSIGNED_SHORT ? 1 : 0; }
+
+	GLuint GetVertexArray(VertexFormat format, GLenum indexType) const
+	{
+		return _vaos[static_cast<size_t>(format) * 2 + IndexPool(indexType)];
+	}
+
+	/// Reallocate a pool with room for at least `minCapacity` elements and attach it to the VAOs
+	void Grow(Pool &pool, size_t minCapacity);
+	size_t Allocate(Pool &pool, size_t count);
+	void Attach();
+
+	void UploadIndices(GeometryAllocation &allocation, std::vector<GLuint> const &indices);
+
+public:
+	static GeometryArena &Instance()
+	{
+		static GeometryArena arena;
+		return arena;
+	}
+
+	GeometryArena(GeometryArena const &) = delete;
+	void operator=(GeometryArena const &) = delete;
+
+	~GeometryArena();
+
+	///
+	/// Copy the vertices and indices in the arena. Indices are relative to the first vertex.
+	///
+	GeometryAllocation Allocate(std::vector<Vertex> const &vertices, std::vector<GLuint> const &indices,
+		VertexFormat format = VertexFormat::Full);
+
+	///
+	/// Copy more indices over the vertices of `base`, e.g. a level of detail. The returned
+	/// allocation owns no vertices.
+	///
+	GeometryAllocation AllocateIndices(GeometryAllocation const &base, std::vector<GLuint> const &indices);
+
+	///
+	/// Release the ranges used by an allocation
+	///
+	void Free(GeometryAllocation const &allocation);
+
+	///
+	/// Make sure the draw index attribute covers at least `count` draws
+	///
+	void ReserveDrawIds(size_t count);
+
+	void Bind(VertexFormat format = VertexFormat::Full, GLenum indexType = GL_UNSIGNED_INT) const
+	{
+		GLState::Instance().BindVertexArray(GetVertexArray(format, indexType));
+	}
+
+	void Bind(GeometryAllocation const &allocation) const { Bind(allocation.Format, allocation.IndexType); }
+
+	size_t GetVertexCount() const;
+	size_t GetVertexBytes() const;
+	size_t GetIndexBytes() const;
+	/// Size the same geometry would take with full vertices and 32-bit indices
+	size_t GetUnpackedBytes() const;
+};
+
+}
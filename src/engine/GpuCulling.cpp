@@ -0,0 +1,114 @@
+#include "GpuCulling.hpp"
+#include "GLState.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace engine
+{
+
+GpuCulling::GpuCulling() : _bHasDrawCount(false), _hiZ(0), _depthSize(0), _hiZLevels(0),
+	_hiZViewProjection(1.0f), _bHasHiZ(false)
+{
+	_cullProgram.AddComputeShader("shaders/drawcull.cs.glsl").Link();
+	_cullProgram.SetUniform1i("hiZ", 0);
+
+	_hiZProgram.AddComputeShader("shaders/hiz.cs.glsl").Link();
+	_hiZProgram.SetUniform1i("source", 0);
+
+	if (!IsSupported()) {
+		Logger::Warn("Draw culling compute shaders unavailable, culling on the CPU\n");
+	}
+
+	_bHasDrawCount = GLEW_ARB_indirect_parameters;
+}
+
+GpuCulling::~GpuCulling()
+{
+	glDeleteTextures(1, &_hiZ);
+}
+
+void GpuCulling::CreateHiZ(glm::ivec2 const &depthSize)
+{
+	glDeleteTextures(1, &_hiZ);
+
+	// The texture name may be reused
+	GLState::Instance().Invalidate();
+
+	_depthSize = depthSize;
+
+	glm::ivec2 const size = glm::max((depthSize + 1) / 2, glm::ivec2(1));
+	_hiZLevels = static_cast<GLint>(std::log2(std::max(size.x, size.y))) + 1;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &_hiZ);
+	glTextureStorage2D(_hiZ, _hiZLevels, GL_R32F, size.x, size.y);
+	glTextureParameteri(_hiZ, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(_hiZ, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTextureParameteri(_hiZ, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(_hiZ, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void GpuCulling::BuildHiZ(GLuint depthTexture, glm::mat4 const &viewProjection)
+{
+	if (!IsSupported()) { return ; }
+
+	glm::ivec2 depthSize;
+	glGetTextureLevelParameteriv(depthTexture, 0, GL_TEXTURE_WIDTH, &depthSize.x);
+	glGetTextureLevelParameteriv(depthTexture, 0, GL_TEXTURE_HEIGHT, &depthSize.y);
+
+	if (depthSize != _depthSize) {
+		CreateHiZ(depthSize);
+	}
+
+	auto &state = GLState::Instance();
+
+	_hiZProgram.Bind();
+
+	glm::ivec2 size = depthSize;
+
+	for (GLint level = 0; level < _hiZLevels; level++) {
+		size = glm::max((size + 1) / 2, glm::ivec2(1));
+
+		state.BindTexture(0, level == 0 ? depthTexture : _hiZ);
+		_hiZProgram.SetUniform1i("sourceLevel", level == 0 ? 0 : level - 1);
+		glBindImageTexture(0, _hiZ, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		_hiZProgram.Dispatch((size.x + HiZGroupSize - 1) / HiZGroupSize, (size.y + HiZGroupSize - 1) / HiZGroupSize);
+
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+
+	_hiZViewProjection = viewProjection;
+	_bHasHiZ = true;
+}
+
+void GpuCulling::Dispatch(GLuint firstCommand, size_t commandCount, Frustum const &frustum, bool bOcclusion,
+	bool bPerBucket, GLuint outputOffset, GLuint counterOffset)
+{
+	bool const bOcclusionTest = bOcclusion && _bHasHiZ;
+
+	if (commandCount == 0) { return ; }
+
+	_cullProgram.SetUniform1ui("firstCommand", firstCommand);
+	_cullProgram.SetUniform1ui("commandCount", static_cast<GLuint>(commandCount));
+	_cullProgram.SetUniform4fv("frustumPlanes", 6, frustum.GetPlanes().data());
+	_cullProgram.SetUniform1i("compact", _bHasDrawCount);
+	_cullProgram.SetUniform1i("perBucket", bPerBucket);
+	_cullProgram.SetUniform1ui("outputOffset", outputOffset);
+	_cullProgram.SetUniform1ui("counterOffset", counterOffset);
+	_cullProgram.SetUniform1i("occlusion", bOcclusionTest);
+
+	if (bOcclusionTest) {
+		_cullProgram.SetUniform4x4f("hiZViewProjection", _hiZViewProjection);
+		_cullProgram.SetUniform2f("depthSize", glm::vec2(_depthSize));
+		_cullProgram.SetUniform1i("hiZLevels", _hiZLevels);
+		GLState::Instance().BindTexture(0, _hiZ);
+	}
+
+	_cullProgram.Bind();
+	_cullProgram.Dispatch((commandCount + CullGroupSize - 1) / CullGroupSize);
+
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+}
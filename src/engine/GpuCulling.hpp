@@ -0,0 +1,81 @@
+#pragma once
+
+#include "lazy.hpp"
+#include "ShaderProgram.hpp"
+#include "Frustum.hpp"
+
+namespace engine
+{
+
+///
+/// Frustum and occlusion culling of indirect draws in a compute shader
+///
+/// The draw queues bind their commands and bounds, this class runs drawcull.cs.glsl on
+/// them and keeps the depth pyramid (Hi-Z) the occlusion test reads. The pyramid is
+/// built from the depth of the previous frame and tested with that frame's camera, so
+/// an object that gets uncovered shows up one frame late.
+///
+/// When GL_ARB_indirect_parameters is available the visible commands are compacted
+/// and counted on the GPU, otherwise hidden commands are kept with no instance.
+///
+/// Buffers used by the cull shader:
+///   binding 5: DrawElementsIndirectCommand[], input
+///   binding 6: DrawBounds[]
+///   binding 7: DrawElementsIndirectCommand[], output
+///   binding 8: draw counts
+///
+class GpuCulling
+{
+public:
+	static constexpr GLuint CommandBinding       = 5;
+	static constexpr GLuint BoundsBinding        = 6;
+	static constexpr GLuint CulledCommandBinding = 7;
+	static constexpr GLuint DrawCountBinding     = 8;
+
+	/// Must match the local sizes of drawcull.cs.glsl and hiz.cs.glsl
+	static constexpr GLuint CullGroupSize = 64;
+	static constexpr GLuint HiZGroupSize = 8;
+
+private:
+	ShaderProgram _cullProgram;
+	ShaderProgram _hiZProgram;
+	bool _bHasDrawCount;
+
+	GLuint _hiZ;
+	glm::ivec2 _depthSize;
+	GLint _hiZLevels;
+	glm::mat4 _hiZViewProjection;
+	bool _bHasHiZ;
+
+	void CreateHiZ(glm::ivec2 const &depthSize);
+
+public:
+	GpuCulling();
+	~GpuCulling();
+
+	GpuCulling(GpuCulling const &) = delete;
+	void operator=(GpuCulling const &) = delete;
+
+	bool IsSupported() const { return _cullProgram.IsValid() && _hiZProgram.IsValid(); }
+
+	/// Visible commands are compacted and drawn with glMultiDrawElementsIndirectCount
+	bool HasDrawCount() const { return _bHasDrawCount; }
+
+	/// Build the pyramid from the depth of this frame, read by the next frame's tests
+	void BuildHiZ(GLuint depthTexture, glm::mat4 const &viewProjection);
+
+	/// Forget the pyramid, the next tests are frustum-only until it is built again
+	void Invalidate() { _bHasHiZ = false; }
+
+	///
+	/// Cull the commands bound by the queue
+	///
+	/// With `bPerBucket`, visible commands are appended to the range and counter of their
+	/// bucket, otherwise to a single list. Offsets are in commands and counters, the output
+	/// offset is the one of `firstCommand`.
+	///
+	void Dispatch(GLuint firstCommand, size_t commandCount, Frustum const &frustum, bool bOcclusion,
+		bool bPerBucket, GLuint outputOffset, GLuint counterOffset);
+};
+
+}
@@ -0,0 +1,75 @@
+#include "GpuQuery.hpp"
+
+namespace engine
+{
+
+GpuQuery::GpuQuery(GLenum target) : _target(target), _queries{}, _bPending{}, _current(0), _result(0),
+	_resultCount(0), _bIsSupported(true)
+{
+	switch (target) {
+	case GL_VERTICES_SUBMITTED_ARB:
+	case GL_PRIMITIVES_SUBMITTED_ARB:
+	case GL_VERTEX_SHADER_INVOCATIONS_ARB:
+	case GL_CLIPPING_INPUT_PRIMITIVES_ARB:
+	case GL_CLIPPING_OUTPUT_PRIMITIVES_ARB:
+	case GL_FRAGMENT_SHADER_INVOCATIONS_ARB:
+	case GL_COMPUTE_SHADER_INVOCATIONS_ARB:
+		_bIsSupported = GLEW_ARB_pipeline_statistics_query;
+		break ;
+	default:
+		break ;
+	}
+
+	if (_bIsSupported) {
+		glCreateQueries(_target, _queries.size(), _queries.data());
+	}
+}
+
+GpuQuery::~GpuQuery()
+{
+	if (_bIsSupported) {
+		glDeleteQueries(_queries.size(), _queries.data());
+	}
+}
+
+void GpuQuery::Collect(size_t slot, bool bWait)
+{
+	if (!_bPending[slot]) { return ; }
+
+	if (!bWait) {
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (available == GL_FALSE) { return ; }
+	}
+
+	glGetQueryObjectui64v(_queries[slot], GL_QUERY_RESULT, &_result);
+	_bPending[slot] = false;
+	_resultCount++;
+}
+
+void GpuQuery::Begin()
+{
+	if (!_bIsSupported) { return ; }
+
+	// Only blocks when the GPU is more than `Latency` frames behind
+	Collect(_current, true);
+
+	glBeginQuery(_target, _queries[_current]);
+}
+
+void GpuQuery::End()
+{
+	if (!_bIsSupported) { return ; }
+
+	glEndQuery(_target);
+	_bPending[_current] = true;
+	_current = (_current + 1) % Latency;
+
+	// Oldest first so that the newest available result is kept
+	for (size_t i = 0; i < Latency; i++) {
+		Collect((_current + i) % Latency, false);
+	}
+}
+
+}
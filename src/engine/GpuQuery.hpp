@@ -0,0 +1,53 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <array>
+
+namespace engine
+{
+
+///
+/// A query object read back a few frames after it was issued
+///
+/// Each Begin()/End() pair uses the next query of a small ring, and the results are
+/// only collected once the GPU made them available so reading never stalls the
+/// pipeline. The result is therefore `Latency - 1` frames old at best.
+///
+class GpuQuery
+{
+public:
+	static constexpr size_t Latency = 3;
+
+private:
+	GLenum _target;
+	std::array<GLuint, Latency> _queries;
+	std::array<bool, Latency> _bPending;
+	size_t _current;
+	GLuint64 _result;
+	size_t _resultCount;
+	bool _bIsSupported;
+
+	void Collect(size_t slot, bool bWait);
+
+public:
+	/// `target` is any query target: GL_TIME_ELAPSED, GL_SAMPLES_PASSED, a pipeline statistic...
+	explicit GpuQuery(GLenum target);
+	~GpuQuery();
+
+	GpuQuery(GpuQuery const &) = delete;
+	void operator=(GpuQuery const &) = delete;
+
+	void Begin();
+	void End();
+
+	/// False when the driver does not know the target, Begin() and End() do nothing
+	bool IsSupported() const { return _bIsSupported; }
+
+	/// Most recent result available
+	GLuint64 GetResult() const { return _result; }
+
+	/// Results collected so far, changes whenever GetResult() does
+	size_t GetResultCount() const { return _resultCount; }
+};
+
+}
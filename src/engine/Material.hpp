@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
 #include <fmt/format.h>
 #include <glm/vec4.hpp>
 
@@ -17,6 +20,42 @@ struct PbrMaterial
 
 	bool hasMetallic;
 	bool hasRoughness;
+
+	/// Resolved from the names by Engine::AddPbrMaterial(), 0 without the map
+	unsigned int AlbedoTexture = 0;
+	unsigned int NormalTexture = 0;
+	unsigned int MetallicRoughnessTexture = 0;
+	/// The albedo map has an alpha channel, its transparent texels are discarded
+	bool bAlphaTested = false;
+};
+
+///
+/// Mirrors `struct Material` in material.glsl (std430), one per PbrMaterial in the
+/// order of their ids
+///
+struct GpuMaterial
+{
+	glm::vec4 BaseColor;
+	float MetallicFactor;
+	float RoughnessFactor;
+	uint32_t Padding[2];
+};
+
+/// Features of the mesh shader permutations, see basic.fs.glsl
+enum MaterialFeatures : uint32_t
+{
+	AlbedoMap            = 1 << 0,
+	MetallicRoughnessMap = 1 << 1,
+	NormalMap            = 1 << 2,
+	/// Discards the transparent texels, when there is no depth pre-pass to do it
+	AlphaTest            = 1 << 3,
+	/// Octahedral normals, see GBuffer.hpp
+	CompactGBuffer       = 1 << 4,
+};
+
+/// Names of the MaterialFeatures in the shaders, in bit order
+inline std::vector<std::string> const MaterialFeatureNames = {
+	"ALBEDO_MAP", "METALLIC_ROUGHNESS_MAP", "NORMAL_MAP", "ALPHA_TEST", "COMPACT_GBUFFER",
 };
 
 /// Keeps track of which OpenGL texture id each material uses
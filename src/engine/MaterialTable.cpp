@@ -0,0 +1,54 @@
+#include "MaterialTable.hpp"
+#include "RenderCounters.hpp"
+#include <algorithm>
+
+namespace engine
+{
+
+static GpuMaterial ToGpu(PbrMaterial const &material)
+{
+	GpuMaterial gpu{};
+		gpu.BaseColor = material.BaseColor;
+		gpu.MetallicFactor = material.MetallicFactor;
+		gpu.RoughnessFactor = material.RoughnessFactor;
+	return gpu;
+}
+
+MaterialTable::MaterialTable() : _buffer(0), _capacity(0), _count(0)
+{
+	glCreateBuffers(1, &_buffer);
+}
+
+MaterialTable::~MaterialTable()
+{
+	glDeleteBuffers(1, &_buffer);
+}
+
+void MaterialTable::Update(std::vector<PbrMaterial> const &materials)
+{
+	if (materials.size() <= _count) { return ; }
+
+	// Growing orphans the buffer, everything is uploaded again
+	if (materials.size() > _capacity) {
+		_capacity = std::max(materials.size(), _capacity * 2);
+		glNamedBufferData(_buffer, _capacity * sizeof(GpuMaterial), nullptr, GL_STATIC_DRAW);
+		_count = 0;
+	}
+
+	std::vector<GpuMaterial> added;
+	added.reserve(materials.size() - _count);
+
+	for (size_t id = _count; id < materials.size(); id++) {
+		added.push_back(ToGpu(materials[id]));
+	}
+
+	gl::NamedBufferSubData(_buffer, _count * sizeof(GpuMaterial), added.size() * sizeof(GpuMaterial), added.data());
+	_count = materials.size();
+}
+
+void MaterialTable::Bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, Binding, _buffer);
+}
+
+}
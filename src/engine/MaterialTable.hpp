@@ -0,0 +1,43 @@
+#pragma once
+
+#include "lazy.hpp"
+#include "Material.hpp"
+#include <vector>
+
+namespace engine
+{
+
+///
+/// Parameters of every PbrMaterial in a shader storage buffer, indexed by material id
+///
+/// The draws only carry the id of their material, the shaders fetch the rest from the
+/// table. Materials never change once registered, so only the new ones are uploaded.
+///
+class MaterialTable
+{
+public:
+	/// Shader storage binding point of the GpuMaterial array
+	static constexpr GLuint Binding = 9;
+
+private:
+	GLuint _buffer;
+	size_t _capacity;
+	/// Materials in the buffer
+	size_t _count;
+
+public:
+	MaterialTable();
+	~MaterialTable();
+
+	MaterialTable(MaterialTable const &) = delete;
+	void operator=(MaterialTable const &) = delete;
+
+	/// Upload the materials added since the last call, `materials` is indexed by id
+	void Update(std::vector<PbrMaterial> const &materials);
+
+	void Bind() const;
+
+	size_t GetCount() const { return _count; }
+};
+
+}
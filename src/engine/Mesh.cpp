@@ -1,19 +1,22 @@
 #include "Mesh.hpp"
 #include <fmt/format.h>
 #include "TextureManager.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+#include "RenderCounters.hpp"
+#include "Logger.hpp"
 
 namespace engine
 {
-	Mesh::Mesh() : vao(0), ibo(0), objectBuffer(0), lightMap(0)
+	Mesh::Mesh() : lightMap(0), _boundsMin(0.0f), _boundsMax(0.0f)
 	{
 		addTexture("prototype_tile_8", TextureType::TT_Diffuse);
 	}
 
 	Mesh::~Mesh()
 	{
-		glDeleteBuffers(1, &ibo);
-		glDeleteBuffers(1, &objectBuffer);
-		glDeleteVertexArrays(1, &vao);
+		FreeLods();
+		GeometryArena::Instance().Free(_geometry);
 		glDeleteTextures(1, &lightMap);
 	}
 
@@ -27,14 +30,13 @@ namespace engine
 		textures = std::move(m.textures);
 		_material = std::move(m._material);
 
-		vao = m.vao;
-		m.vao = 0;
+		_geometry = m._geometry;
+		m._geometry = GeometryAllocation{};
+		_lods = std::move(m._lods);
+		m._lods.clear();
 
-		objectBuffer = m.objectBuffer;
-		m.objectBuffer = 0;
-
-		ibo = m.ibo;
-		m.ibo = 0;
+		_boundsMin = m._boundsMin;
+		_boundsMax = m._boundsMax;
 
 		lightMap = m.lightMap;
 		m.lightMap = 0;
@@ -47,8 +49,8 @@ namespace engine
 	{
 		if (this != &rhs)
 		{
-			glDeleteVertexArrays(1, &vao);
-			glDeleteBuffers(1, &objectBuffer);
+			FreeLods();
+			GeometryArena::Instance().Free(_geometry);
 			glDeleteTextures(1, &lightMap);
 
 			vPositions = std::move(rhs.vPositions);
@@ -59,14 +61,13 @@ namespace engine
 			textures = std::move(rhs.textures);
 			_material = std::move(rhs._material);
 
-			vao = rhs.vao;
-			rhs.vao = 0;
-
-			objectBuffer = rhs.objectBuffer;
-			rhs.objectBuffer = 0;
+			_geometry = rhs._geometry;
+			rhs._geometry = GeometryAllocation{};
+			_lods = std::move(rhs._lods);
+			rhs._lods.clear();
 
-			ibo = rhs.ibo;
-			rhs.ibo = 0;
+			_boundsMin = rhs._boundsMin;
+			_boundsMax = rhs._boundsMax;
 
 			lightMap = rhs.lightMap;
 			rhs.lightMap = 0;
@@ -141,60 +142,119 @@ namespace engine
 		return textures;
 	}
 
-	Mesh &Mesh::build()
+	void Mesh::Optimize()
 	{
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		size_t const vertexCount = vPositions.size() / 3;
 
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
-		glEnableVertexAttribArray(3);
+		if (indices.size() < 3) { return ; }
 
-		const size_t bufferSize = (vPositions.size()
-								  + vNormals.size()
-								  + vUvs.size()
-								  + vTangents.size()) * sizeof(GLfloat);
-		size_t offset = 0;
+		auto const before = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
 
-		glGenBuffers(1, &objectBuffer);
-		glBindBuffer(GL_ARRAY_BUFFER, objectBuffer);
-		glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STATIC_DRAW);
-		if (vPositions.size() > 0) {
-			glBufferSubData(GL_ARRAY_BUFFER, offset, vPositions.size() * sizeof(GLfloat), vPositions.data());
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-			offset += vPositions.size() * sizeof(GLfloat);
-		}
-		if (vNormals.size() > 0) {
-			glBufferSubData(GL_ARRAY_BUFFER, offset, vNormals.size() * sizeof(GLfloat), vNormals.data());
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-			offset += vNormals.size() * sizeof(GLfloat);
+		indices = MeshOptimizer::OptimizeVertexCache(indices, vertexCount);
+		indices = MeshOptimizer::OptimizeOverdraw(indices, vPositions);
+
+		// Vertices can only move when every attribute has one value per vertex
+		auto isComplete = [vertexCount] (std::vector<GLfloat> const &stream, size_t components) {
+			return stream.empty() || stream.size() == vertexCount * components;
+		};
+
+		if (isComplete(vNormals, 3) && isComplete(vUvs, 2) && isComplete(vTangents, 4)) {
+			auto const order = MeshOptimizer::OptimizeVertexFetch(indices, vertexCount);
+
+			auto reorder = [&order] (std::vector<GLfloat> &stream, size_t components) {
+				if (stream.empty()) { return ; }
+
+				std::vector<GLfloat> reordered(stream.size());
+				for (size_t i = 0; i < order.size(); i++) {
+					std::copy_n(stream.begin() + order[i] * components, components, reordered.begin() + i * components);
+				}
+				stream = std::move(reordered);
+			};
+
+			reorder(vPositions, 3);
+			reorder(vNormals, 3);
+			reorder(vUvs, 2);
+			reorder(vTangents, 4);
 		}
-		if (vUvs.size() > 0) {
-			glBufferSubData(GL_ARRAY_BUFFER, offset, vUvs.size() * sizeof(GLfloat), vUvs.data());
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-			offset += vUvs.size() * sizeof(GLfloat);
+
+		auto const after = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+
+		Logger::Verbose("Mesh of {} triangles: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}\n", indices.size() / 3,
+			before.Acmr, after.Acmr, before.Atvr, after.Atvr);
+	}
+
+	Mesh &Mesh::build(VertexFormat format)
+	{
+		Optimize();
+
+		const size_t vertexCount = vPositions.size() / 3;
+		std::vector<Vertex> vertices(vertexCount, Vertex{
+			glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f), glm::vec4(0.0f) });
+
+		// Interleave the streams into the shared vertex format,
+		// missing attributes are left to zero
+		for (size_t i = 0; i < vertexCount; i++) {
+			auto &v = vertices[i];
+
+			v.Position = glm::vec3(vPositions[i * 3 + 0], vPositions[i * 3 + 1], vPositions[i * 3 + 2]);
+			if (vNormals.size() >= (i + 1) * 3) {
+				v.Normal = glm::vec3(vNormals[i * 3 + 0], vNormals[i * 3 + 1], vNormals[i * 3 + 2]);
+			}
+			if (vUvs.size() >= (i + 1) * 2) {
+				v.Uv = glm::vec2(vUvs[i * 2 + 0], vUvs[i * 2 + 1]);
+			}
+			if (vTangents.size() >= (i + 1) * 4) {
+				v.Tangent = glm::vec4(vTangents[i * 4 + 0], vTangents[i * 4 + 1],
+					vTangents[i * 4 + 2], vTangents[i * 4 + 3]);
+			}
 		}
-		if (vTangents.size() > 0) {
-			glBufferSubData(GL_ARRAY_BUFFER, offset, vTangents.size() * sizeof(GLfloat), vTangents.data());
-			glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), reinterpret_cast<void*>(offset));
-			offset += vTangents.size() * sizeof(GLfloat);
+
+		if (vertexCount > 0) {
+			_boundsMin = vertices[0].Position;
+			_boundsMax = vertices[0].Position;
+			for (auto const &v : vertices) {
+				_boundsMin = glm::min(_boundsMin, v.Position);
+				_boundsMax = glm::max(_boundsMax, v.Position);
+			}
 		}
 
-		glGenBuffers(1, &ibo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		// The levels of detail point at the old vertices
+		FreeLods();
+		GeometryArena::Instance().Free(_geometry);
+		_geometry = GeometryArena::Instance().Allocate(vertices, indices, format);
+
+		return *this;
+	}
+
+	Mesh &Mesh::GenerateLods()
+	{
+		FreeLods();
+
+		if (!_geometry.IsValid()) { return *this; }
 
-		glBindVertexArray(0);
+		MeshSimplifier simplifier(vPositions, indices);
+
+		for (auto const &lod : simplifier.GenerateLods(indices)) {
+			auto const optimized = MeshOptimizer::OptimizeVertexCache(lod, vPositions.size() / 3);
+			_lods.push_back(GeometryArena::Instance().AllocateIndices(_geometry, optimized));
+		}
 
 		return *this;
 	}
 
+	void Mesh::FreeLods()
+	{
+		for (auto const &lod : _lods) {
+			GeometryArena::Instance().Free(lod);
+		}
+		_lods.clear();
+	}
+
 	void Mesh::Draw() const
 	{
-		glBindVertexArray(vao);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, nullptr);
-		glBindVertexArray(0);
+		GeometryArena::Instance().Bind(_geometry);
+		gl::DrawElementsBaseVertex(GL_TRIANGLES, _geometry.IndexCount, _geometry.IndexType,
+			_geometry.GetIndexOffset(), _geometry.BaseVertex);
 	}
 
 	std::vector<GLuint> const Mesh::GetTextureIDs() const
@@ -2,8 +2,10 @@
 
 #include "lazy.hpp"
 #include <vector>
+#include <algorithm>
 #include "IDrawable.hpp"
 #include "Material.hpp"
+#include "GeometryArena.hpp"
 
 namespace engine
 {
@@ -30,15 +32,20 @@ private:
 	std::vector<GLuint> indices;
 	std::vector<Texture> textures;
 
-	GLuint vao;
-	GLuint ibo;
-	GLuint objectBuffer;
+	GeometryAllocation _geometry;
+	/// Simplified index lists over the same vertices, from LOD 1
+	std::vector<GeometryAllocation> _lods;
 	GLuint lightMap;
 
+	glm::vec3 _boundsMin;
+	glm::vec3 _boundsMax;
+
 	std::string _material;
-	std::optional<std::string> _pbrMaterial;
+	std::optional<unsigned int> _pbrMaterial;
 
 	void InitLightmap();
+	void FreeLods();
+	void Optimize();
 
 public:
 	Mesh();
@@ -62,13 +69,35 @@ public:
 	std::vector<GLuint>  const GetTextureIDs() const;
 	GLuint GetLightmap() const { return lightMap; }
 
+	/// Location of the mesh in the geometry arena, valid after build()
+	GeometryAllocation const &GetGeometry() const { return _geometry; }
+
+	/// Geometry of a level of detail, clamped to the coarsest one
+	GeometryAllocation const &GetGeometry(size_t lod) const
+	{
+		return (lod == 0 || _lods.empty()) ? _geometry : _lods[std::min(lod, _lods.size()) - 1];
+	}
+
+	/// Levels of detail, the full resolution mesh included
+	size_t GetLodCount() const { return _lods.size() + 1; }
+
+	/// Object-space bounding box, valid after build()
+	glm::vec3 const &GetBoundsMin() const { return _boundsMin; }
+	glm::vec3 const &GetBoundsMax() const { return _boundsMax; }
+
 	void SetMaterial(std::string name) { _material = name; }
 	std::string GetMaterial() const { return _material; }
 
-	void SetPbrMaterial(std::string name) { _pbrMaterial = name; }
-	std::optional<std::string> GetPbrMaterial() { return _pbrMaterial; }
+	/// Id from Engine::AddPbrMaterial()
+	void SetPbrMaterial(unsigned int id) { _pbrMaterial = id; }
+	std::optional<unsigned int> GetPbrMaterial() const { return _pbrMaterial; }
+
+	/// Reorder the triangles and vertices for the GPU caches and upload the mesh to the
+	/// geometry arena, packed meshes can only be drawn through a DrawQueue
+	Mesh &build(VertexFormat format = VertexFormat::Full);
 
-	Mesh &build();
+	/// Simplify the mesh into levels of detail, after build()
+	Mesh &GenerateLods();
 
 	void Draw() const override;
 	std::vector<Texture> const &getTextures() const;
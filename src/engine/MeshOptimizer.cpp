@@ -0,0 +1,370 @@
+#include "MeshOptimizer.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace engine
+{
+
+/// Scoring of Forsyth's "Linear-Speed Vertex Cache Optimisation"
+static constexpr float CacheDecayPower = 1.5f;
+static constexpr float LastTriangleScore = 0.75f;
+static constexpr float ValenceBoostScale = 2.0f;
+static constexpr float ValenceBoostPower = 0.5f;
+
+static constexpr size_t NoTriangle = static_cast<size_t>(-1);
+
+///
+/// Vertices in the cache are worth more, the three of the last triangle a bit less so that
+/// strips do not turn back, and vertices with few triangles left are worth more so that
+/// they are not left alone
+///
+static float VertexScore(int cachePosition, unsigned int remaining)
+{
+	if (remaining == 0) { return -1.0f; }
+
+	float score = 0.0f;
+
+	if (cachePosition >= 0) {
+		if (cachePosition < 3) {
+			score = LastTriangleScore;
+		}
+		else {
+			float const scaler = 1.0f / (MeshOptimizer::CacheSize - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+		}
+	}
+
+	return score + ValenceBoostScale * std::pow(static_cast<float>(remaining), -ValenceBoostPower);
+}
+
+///
+/// FIFO cache simulation, the cache is emptied by moving `time` forward by more than its size
+///
+class FifoCache
+{
+private:
+	std::vector<unsigned int> _timestamps;
+	unsigned int _time;
+	size_t _size;
+
+public:
+	FifoCache(size_t vertexCount, size_t size) : _timestamps(vertexCount, 0), _time(size + 1), _size(size) {}
+
+	/// True when the vertex had to be transformed
+	bool Miss(unsigned int vertex)
+	{
+		if (_time - _timestamps[vertex] <= _size) { return false; }
+
+		_timestamps[vertex] = _time++;
+		return true;
+	}
+
+	void Clear() { _time += _size + 1; }
+};
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(std::vector<unsigned int> const &indices,
+	size_t vertexCount, size_t cacheSize)
+{
+	CacheStatistics statistics;
+
+	size_t const triangleCount = indices.size() / 3;
+	if (triangleCount == 0) { return statistics; }
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	size_t misses = 0;
+	size_t usedCount = 0;
+
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		misses += cache.Miss(indices[i]);
+
+		if (!used[indices[i]]) {
+			used[indices[i]] = true;
+			usedCount++;
+		}
+	}
+
+	statistics.Acmr = static_cast<float>(misses) / triangleCount;
+	statistics.Atvr = static_cast<float>(misses) / usedCount;
+
+	return statistics;
+}
+
+std::vector<unsigned int> MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int> const &indices,
+	size_t vertexCount)
+{
+	size_t const triangleCount = indices.size() / 3;
+
+	std::vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+
+	if (triangleCount == 0) { return result; }
+
+	// Triangles of each vertex, the ones not emitted yet are kept at the front
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		offsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++) {
+		offsets[v + 1] += offsets[v];
+	}
+
+	std::vector<unsigned int> remaining(vertexCount);
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+
+	for (size_t v = 0; v < vertexCount; v++) {
+		remaining[v] = offsets[v + 1] - offsets[v];
+	}
+
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+
+	for (size_t v = 0; v < vertexCount; v++) {
+		vertexScores[v] = VertexScore(-1, remaining[v]);
+	}
+
+	size_t best = NoTriangle;
+	float bestScore = -1.0f;
+
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]]
+			+ vertexScores[indices[t * 3 + 2]];
+
+		if (triangleScores[t] > bestScore) {
+			best = t;
+			bestScore = triangleScores[t];
+		}
+	}
+
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	cache.reserve(CacheSize + 3);
+	newCache.reserve(CacheSize + 3);
+
+	size_t cursor = 0;
+
+	for (size_t count = 0; count < triangleCount; count++) {
+
+		// Dead end, restart from the first triangle left in the input order
+		if (best == NoTriangle) {
+			while (emitted[cursor]) { cursor++; }
+			best = cursor;
+		}
+
+		unsigned int const *triangle = &indices[best * 3];
+
+		result.insert(result.end(), triangle, triangle + 3);
+		emitted[best] = true;
+
+		for (size_t k = 0; k < 3; k++) {
+			unsigned int const v = triangle[k];
+			auto const begin = adjacency.begin() + offsets[v];
+			auto const end = begin + remaining[v];
+
+			*std::find(begin, end, static_cast<unsigned int>(best)) = *(end - 1);
+			remaining[v]--;
+		}
+
+		// The triangle's vertices move to the front of the LRU cache
+		newCache.clear();
+		for (size_t k = 0; k < 3; k++) {
+			if (std::find(newCache.begin(), newCache.end(), triangle[k]) == newCache.end()) {
+				newCache.push_back(triangle[k]);
+			}
+		}
+		for (auto const v : cache) {
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+				newCache.push_back(v);
+			}
+		}
+
+		for (size_t i = 0; i < newCache.size(); i++) {
+			unsigned int const v = newCache[i];
+
+			cachePositions[v] = i < CacheSize ? static_cast<int>(i) : -1;
+			vertexScores[v] = VertexScore(cachePositions[v], remaining[v]);
+		}
+
+		// Only the triangles of the cached vertices changed, the next one is picked among them
+		best = NoTriangle;
+		bestScore = -1.0f;
+
+		for (auto const v : newCache) {
+			for (unsigned int i = offsets[v]; i < offsets[v] + remaining[v]; i++) {
+				unsigned int const t = adjacency[i];
+
+				triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]]
+					+ vertexScores[indices[t * 3 + 2]];
+
+				if (triangleScores[t] > bestScore) {
+					best = t;
+					bestScore = triangleScores[t];
+				}
+			}
+		}
+
+		newCache.resize(std::min(newCache.size(), CacheSize));
+		std::swap(cache, newCache);
+	}
+
+	return result;
+}
+
+std::vector<unsigned int> MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int> const &indices,
+	std::vector<float> const &positions, float threshold)
+{
+	size_t const triangleCount = indices.size() / 3;
+	size_t const vertexCount = positions.size() / 3;
+
+	if (triangleCount == 0) { return indices; }
+
+	auto position = [&positions] (unsigned int v) {
+		return glm::vec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+	};
+
+	// Hard boundaries, the three vertices of the triangle miss the cache anyway
+	std::vector<unsigned int> misses(triangleCount);
+	std::vector<size_t> hardClusters;
+	{
+		FifoCache cache(vertexCount, AnalyzeCacheSize);
+
+		for (size_t t = 0; t < triangleCount; t++) {
+			misses[t] = cache.Miss(indices[t * 3]) + cache.Miss(indices[t * 3 + 1]) + cache.Miss(indices[t * 3 + 2]);
+
+			if (misses[t] == 3) {
+				hardClusters.push_back(t);
+			}
+		}
+	}
+	hardClusters.push_back(triangleCount);
+
+	// Soft boundaries, a hard cluster is split wherever the part so far, drawn with a cold
+	// cache, is not much worse than the whole cluster
+	std::vector<size_t> clusters;
+	{
+		FifoCache cache(vertexCount, AnalyzeCacheSize);
+
+		for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+			size_t const start = hardClusters[c];
+			size_t const end = hardClusters[c + 1];
+
+			size_t clusterMisses = 0;
+			for (size_t t = start; t < end; t++) {
+				clusterMisses += misses[t];
+			}
+
+			float const maxAcmr = threshold * clusterMisses / (end - start);
+
+			cache.Clear();
+			clusters.push_back(start);
+
+			size_t softStart = start;
+			size_t softMisses = 0;
+
+			for (size_t t = start; t < end; t++) {
+				softMisses += cache.Miss(indices[t * 3]) + cache.Miss(indices[t * 3 + 1]) + cache.Miss(indices[t * 3 + 2]);
+
+				if (t + 1 < end && static_cast<float>(softMisses) / (t - softStart + 1) <= maxAcmr) {
+					cache.Clear();
+					clusters.push_back(t + 1);
+					softStart = t + 1;
+					softMisses = 0;
+				}
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// Center of the mesh, weighted by area
+	std::vector<glm::vec3> clusterCenters(clusters.size() - 1, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusters.size() - 1, glm::vec3(0.0f));
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c + 1 < clusters.size(); c++) {
+		float clusterArea = 0.0f;
+
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			glm::vec3 const p0 = position(indices[t * 3]);
+			glm::vec3 const p1 = position(indices[t * 3 + 1]);
+			glm::vec3 const p2 = position(indices[t * 3 + 2]);
+
+			glm::vec3 const normal = glm::cross(p1 - p0, p2 - p0);
+			float const area = glm::length(normal);
+
+			clusterCenters[c] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+
+		meshCenter += clusterCenters[c];
+		meshArea += clusterArea;
+
+		if (clusterArea > 0.0f) {
+			clusterCenters[c] /= clusterArea;
+		}
+	}
+
+	if (meshArea > 0.0f) {
+		meshCenter /= meshArea;
+	}
+
+	// Clusters facing away from the center are in front of the others
+	std::vector<float> keys(clusters.size() - 1);
+	std::vector<size_t> order(clusters.size() - 1);
+
+	for (size_t c = 0; c < keys.size(); c++) {
+		float const length = glm::length(clusterNormals[c]);
+
+		keys[c] = length > 0.0f ? glm::dot(clusterCenters[c] - meshCenter, clusterNormals[c] / length) : 0.0f;
+		order[c] = c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&keys] (size_t a, size_t b) {
+		return keys[a] > keys[b];
+	});
+
+	std::vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+
+	for (auto const c : order) {
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+
+	return result;
+}
+
+std::vector<unsigned int> MeshOptimizer::OptimizeVertexFetch(std::vector<unsigned int> &indices, size_t vertexCount)
+{
+	unsigned int const unused = static_cast<unsigned int>(-1);
+
+	std::vector<unsigned int> remap(vertexCount, unused);
+	std::vector<unsigned int> order;
+	order.reserve(vertexCount);
+
+	for (auto &index : indices) {
+		if (remap[index] == unused) {
+			remap[index] = static_cast<unsigned int>(order.size());
+			order.push_back(index);
+		}
+		index = remap[index];
+	}
+
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		if (remap[v] == unused) {
+			order.push_back(v);
+		}
+	}
+
+	return order;
+}
+
+}
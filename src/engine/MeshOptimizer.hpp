@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace engine
+{
+
+///
+/// Reordering of index and vertex buffers for the post-transform cache, overdraw and vertex fetch
+///
+/// The passes are meant to run in order at import: triangles are first sorted for the
+/// vertex cache (Forsyth), then clusters of them are sorted so that the outer ones are
+/// drawn first, and the vertices are finally renumbered in the order they are used.
+/// Every pass is deterministic so that the same input always gives the same buffers.
+///
+class MeshOptimizer
+{
+public:
+	/// Size of the LRU cache modelled by OptimizeVertexCache()
+	static constexpr size_t CacheSize = 32;
+
+	/// Size of the FIFO cache used by AnalyzeVertexCache(), a common hardware size
+	static constexpr size_t AnalyzeCacheSize = 16;
+
+	/// Cache efficiency OptimizeOverdraw() may lose to sort smaller clusters, 1 keeps the ACMR
+	static constexpr float OverdrawThreshold = 1.05f;
+
+	struct CacheStatistics
+	{
+		/// Average cache miss ratio, transformed vertices per triangle (0.5 to 3)
+		float Acmr = 0.0f;
+		/// Average transform to vertex ratio, transformed vertices per vertex (1 is ideal)
+		float Atvr = 0.0f;
+	};
+
+	/// Simulate a FIFO post-transform cache over the triangles
+	static CacheStatistics AnalyzeVertexCache(std::vector<unsigned int> const &indices, size_t vertexCount,
+		size_t cacheSize = AnalyzeCacheSize);
+
+	/// Triangles reordered to reuse the vertices that are still in the cache
+	static std::vector<unsigned int> OptimizeVertexCache(std::vector<unsigned int> const &indices, size_t vertexCount);
+
+	///
+	/// Triangles reordered by cluster so that the clusters facing away from the center of
+	/// the mesh are drawn first and hide the others. `indices` should already be sorted
+	/// for the vertex cache, clusters are split on cache misses. `positions` are packed xyz.
+	///
+	static std::vector<unsigned int> OptimizeOverdraw(std::vector<unsigned int> const &indices,
+		std::vector<float> const &positions, float threshold = OverdrawThreshold);
+
+	///
+	/// Renumber the vertices in the order the triangles use them, `indices` are rewritten.
+	/// Returns the old index of each new vertex, unused vertices are kept at the end.
+	///
+	static std::vector<unsigned int> OptimizeVertexFetch(std::vector<unsigned int> &indices, size_t vertexCount);
+};
+
+}
@@ -0,0 +1,314 @@
+#include "MeshSimplifier.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <cmath>
+
+namespace engine
+{
+
+MeshSimplifier::Quadric::Quadric(glm::vec3 const &normal, float distance)
+{
+	A00 = normal.x * normal.x;
+	A01 = normal.x * normal.y;
+	A02 = normal.x * normal.z;
+	A11 = normal.y * normal.y;
+	A12 = normal.y * normal.z;
+	A22 = normal.z * normal.z;
+	B0 = normal.x * distance;
+	B1 = normal.y * distance;
+	B2 = normal.z * distance;
+	C = distance * distance;
+}
+
+MeshSimplifier::Quadric &MeshSimplifier::Quadric::operator+=(Quadric const &rhs)
+{
+	A00 += rhs.A00; A01 += rhs.A01; A02 += rhs.A02;
+	A11 += rhs.A11; A12 += rhs.A12; A22 += rhs.A22;
+	B0 += rhs.B0; B1 += rhs.B1; B2 += rhs.B2;
+	C += rhs.C;
+
+	return *this;
+}
+
+float MeshSimplifier::Quadric::Error(glm::vec3 const &p) const
+{
+	double const x = p.x, y = p.y, z = p.z;
+
+	double const error = A00 * x * x + A11 * y * y + A22 * z * z
+		+ 2.0 * (A01 * x * y + A02 * x * z + A12 * y * z)
+		+ 2.0 * (B0 * x + B1 * y + B2 * z)
+		+ C;
+
+	return static_cast<float>(std::max(error, 0.0));
+}
+
+MeshSimplifier::MeshSimplifier(std::vector<float> const &positions, std::vector<unsigned int> const &indices) :
+	_positions(positions.size() / 3), _locked(positions.size() / 3, false), _size(0.0f)
+{
+	glm::vec3 min(std::numeric_limits<float>::max());
+	glm::vec3 max(std::numeric_limits<float>::lowest());
+
+	for (size_t i = 0; i < _positions.size(); i++) {
+		_positions[i] = glm::vec3(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+		min = glm::min(min, _positions[i]);
+		max = glm::max(max, _positions[i]);
+	}
+
+	if (!_positions.empty()) {
+		_size = glm::length(max - min);
+	}
+
+	// Weld the vertices by position, the attributes are not compared
+	struct PositionHash
+	{
+		size_t operator()(glm::vec3 const &p) const
+		{
+			uint32_t bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	std::unordered_map<glm::vec3, unsigned int, PositionHash> welded;
+	std::vector<unsigned int> representative(_positions.size());
+	std::vector<unsigned int> wedges(_positions.size(), 0);
+
+	for (unsigned int i = 0; i < _positions.size(); i++) {
+		representative[i] = welded.emplace(_positions[i], i).first->second;
+		wedges[representative[i]]++;
+	}
+
+	// Count each directed edge of the welded mesh, a manifold interior edge is seen once
+	// in each direction
+	std::unordered_map<uint64_t, unsigned int> edges;
+
+	auto edgeKey = [] (unsigned int a, unsigned int b) {
+		return (static_cast<uint64_t>(a) << 32) | b;
+	};
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		for (size_t k = 0; k < 3; k++) {
+			unsigned int const a = representative[indices[i + k]];
+			unsigned int const b = representative[indices[i + (k + 1) % 3]];
+
+			edges[edgeKey(a, b)]++;
+		}
+	}
+
+	std::vector<bool> lockedPosition(_positions.size(), false);
+
+	for (auto const &[ key, count ] : edges) {
+		unsigned int const a = static_cast<unsigned int>(key >> 32);
+		unsigned int const b = static_cast<unsigned int>(key & 0xffffffffu);
+
+		auto const opposite = edges.find(edgeKey(b, a));
+
+		// Border or non-manifold edge
+		if (count != 1 || opposite == edges.end() || opposite->second != 1) {
+			lockedPosition[a] = true;
+			lockedPosition[b] = true;
+		}
+	}
+
+	for (size_t i = 0; i < _positions.size(); i++) {
+		_locked[i] = lockedPosition[representative[i]] || wedges[representative[i]] > 1;
+	}
+}
+
+bool MeshSimplifier::Flips(std::vector<unsigned int> const &indices, std::vector<unsigned int> const &triangles,
+	unsigned int from, unsigned int to) const
+{
+	for (auto const triangle : triangles) {
+		unsigned int const *v = &indices[triangle * 3];
+
+		if (v[0] == to || v[1] == to || v[2] == to) { continue ; }
+
+		size_t const k = (v[0] == from) ? 0 : (v[1] == from) ? 1 : 2;
+		glm::vec3 const &p1 = _positions[v[(k + 1) % 3]];
+		glm::vec3 const &p2 = _positions[v[(k + 2) % 3]];
+
+		glm::vec3 const before = glm::cross(p1 - _positions[from], p2 - _positions[from]);
+		glm::vec3 const after = glm::cross(p1 - _positions[to], p2 - _positions[to]);
+
+		if (glm::dot(before, after) <= 0.0f) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<unsigned int> MeshSimplifier::Simplify(std::vector<unsigned int> const &indices, size_t targetIndexCount,
+	float maxError, float *resultError) const
+{
+	struct Collapse
+	{
+		unsigned int From;
+		unsigned int To;
+		float Cost;
+	};
+
+	size_t const vertexCount = _positions.size();
+	float const maxCost = (maxError * _size) * (maxError * _size);
+	float worstCost = 0.0f;
+
+	std::vector<unsigned int> result = indices;
+	std::vector<Quadric> quadrics(vertexCount);
+
+	for (size_t i = 0; i + 2 < result.size(); i += 3) {
+		glm::vec3 const &p0 = _positions[result[i]];
+		glm::vec3 normal = glm::cross(_positions[result[i + 1]] - p0, _positions[result[i + 2]] - p0);
+		float const area = glm::length(normal);
+
+		if (area == 0.0f) { continue ; }
+
+		// Unweighted planes keep the error in squared distance units, an upper bound of
+		// the actual distance to the original surface
+		normal /= area;
+		Quadric const quadric(normal, -glm::dot(normal, p0));
+
+		for (size_t k = 0; k < 3; k++) {
+			quadrics[result[i + k]] += quadric;
+		}
+	}
+
+	std::vector<unsigned int> triangleOffsets(vertexCount + 1);
+	std::vector<unsigned int> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+
+	// Each pass collapses the cheapest edge of as many vertices as possible without two
+	// collapses touching the same triangles
+	while (result.size() > targetIndexCount) {
+		size_t const triangleCount = result.size() / 3;
+
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (auto const index : result) {
+			triangleOffsets[index + 1]++;
+		}
+		for (size_t i = 0; i < vertexCount; i++) {
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		}
+
+		vertexTriangles.resize(result.size());
+		std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++) {
+			vertexTriangles[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+		}
+
+		auto trianglesOf = [&] (unsigned int vertex) {
+			return std::vector<unsigned int>(vertexTriangles.begin() + triangleOffsets[vertex],
+				vertexTriangles.begin() + triangleOffsets[vertex + 1]);
+		};
+
+		// Cheapest collapse of every free vertex
+		std::vector<Collapse> best(vertexCount, Collapse{ 0, 0, std::numeric_limits<float>::max() });
+
+		for (size_t i = 0; i < result.size(); i++) {
+			unsigned int const from = result[i];
+			unsigned int const to = result[i - i % 3 + (i + 1) % 3];
+
+			for (auto const &[ a, b ] : { std::pair(from, to), std::pair(to, from) }) {
+				if (_locked[a]) { continue ; }
+
+				float const cost = quadrics[a].Error(_positions[b]);
+				if (cost < best[a].Cost) {
+					best[a] = Collapse{ a, b, cost };
+				}
+			}
+		}
+
+		collapses.clear();
+		for (auto const &collapse : best) {
+			if (collapse.Cost <= maxCost) {
+				collapses.push_back(collapse);
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [] (Collapse const &a, Collapse const &b) {
+			return a.Cost < b.Cost;
+		});
+
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			remap[i] = i;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+
+		size_t trianglesLeft = triangleCount;
+		size_t collapsed = 0;
+
+		for (auto const &collapse : collapses) {
+			if (trianglesLeft * 3 <= targetIndexCount) { break ; }
+			if (touched[collapse.From] || touched[collapse.To]) { continue ; }
+
+			auto const triangles = trianglesOf(collapse.From);
+
+			if (Flips(result, triangles, collapse.From, collapse.To)) { continue ; }
+
+			remap[collapse.From] = collapse.To;
+			quadrics[collapse.To] += quadrics[collapse.From];
+			worstCost = std::max(worstCost, collapse.Cost);
+			collapsed++;
+
+			for (auto const triangle : triangles) {
+				unsigned int const *v = &result[triangle * 3];
+
+				touched[v[0]] = touched[v[1]] = touched[v[2]] = true;
+
+				if (v[0] == collapse.To || v[1] == collapse.To || v[2] == collapse.To) {
+					trianglesLeft--;
+				}
+			}
+		}
+
+		if (collapsed == 0) { break ; }
+
+		// Apply the collapses and drop the triangles that became degenerate
+		size_t write = 0;
+
+		for (size_t i = 0; i < result.size(); i += 3) {
+			unsigned int const a = remap[result[i]];
+			unsigned int const b = remap[result[i + 1]];
+			unsigned int const c = remap[result[i + 2]];
+
+			if (a == b || b == c || a == c) { continue ; }
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	if (resultError != nullptr) {
+		*resultError = _size > 0.0f ? std::sqrt(worstCost) / _size : 0.0f;
+	}
+
+	return result;
+}
+
+std::vector<std::vector<unsigned int>> MeshSimplifier::GenerateLods(std::vector<unsigned int> const &indices) const
+{
+	std::vector<std::vector<unsigned int>> lods;
+	std::vector<unsigned int> const *previous = &indices;
+	float maxError = LodError;
+
+	while (lods.size() < MaxLods && previous->size() / 3 >= MinLodTriangles) {
+		size_t const target = static_cast<size_t>(previous->size() / 3 * LodRatio) * 3;
+
+		auto lod = Simplify(*previous, target, maxError);
+
+		if (lod.size() > previous->size() * (1.0f - MinReduction)) { break ; }
+
+		lods.push_back(std::move(lod));
+		previous = &lods.back();
+		maxError *= 2.0f;
+	}
+
+	return lods;
+}
+
+}
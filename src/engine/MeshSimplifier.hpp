@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+
+namespace engine
+{
+
+///
+/// Quadric error edge-collapse simplification over the vertices of a mesh
+///
+/// Vertices are collapsed onto one of their neighbours, so every level of detail reuses
+/// the vertex buffer of the mesh and only needs its own indices. Vertices on an open
+/// border or on an attribute seam (several vertices sharing a position with different
+/// normals or UVs) are never removed, which keeps borders and UV charts in place.
+///
+class MeshSimplifier
+{
+public:
+	/// Levels generated on top of the full resolution mesh
+	static constexpr size_t MaxLods = 4;
+
+	/// Each level aims for this fraction of the triangles of the previous one
+	static constexpr float LodRatio = 0.5f;
+
+	/// Level generation stops when a level removes less than this fraction of the triangles
+	static constexpr float MinReduction = 0.1f;
+
+	/// Meshes with fewer triangles are not simplified further
+	static constexpr size_t MinLodTriangles = 64;
+
+	/// Error allowed for the first level relative to the size of the mesh, doubled at each level
+	static constexpr float LodError = 0.005f;
+
+private:
+	///
+	/// Sum of squared distances to a set of planes, symmetric 4x4 matrix
+	///
+	struct Quadric
+	{
+		double A00 = 0, A01 = 0, A02 = 0, A11 = 0, A12 = 0, A22 = 0;
+		double B0 = 0, B1 = 0, B2 = 0;
+		double C = 0;
+
+		Quadric() = default;
+		Quadric(glm::vec3 const &normal, float distance);
+
+		Quadric &operator+=(Quadric const &rhs);
+		float Error(glm::vec3 const &p) const;
+	};
+
+	std::vector<glm::vec3> _positions;
+	std::vector<bool> _locked;
+	/// Diagonal of the bounding box
+	float _size;
+
+	bool Flips(std::vector<unsigned int> const &indices, std::vector<unsigned int> const &triangles,
+		unsigned int from, unsigned int to) const;
+
+public:
+	/// `positions` are packed xyz, `indices` is the full resolution triangle list
+	MeshSimplifier(std::vector<float> const &positions, std::vector<unsigned int> const &indices);
+
+	///
+	/// Collapse edges of `indices` until at most `targetIndexCount` indices are left or the
+	/// next collapse would move the surface by more than `maxError` times the mesh size.
+	/// The error reached is written to `resultError` when it is not null.
+	///
+	std::vector<unsigned int> Simplify(std::vector<unsigned int> const &indices, size_t targetIndexCount,
+		float maxError, float *resultError = nullptr) const;
+
+	/// Successive levels of detail, the full resolution `indices` are not included
+	std::vector<std::vector<unsigned int>> GenerateLods(std::vector<unsigned int> const &indices) const;
+
+	/// The vertex is on a border or a seam and is never collapsed
+	bool IsLocked(unsigned int vertex) const { return _locked[vertex]; }
+};
+
+}
@@ -15,7 +15,7 @@ private:
 	unsigned int _id;
 	std::vector<unsigned int> _meshes;
 
-	std::optional<std::vector<unsigned int>> TinyProcessNode(tinygltf::Node const &node, tinygltf::Model const &model, std::vector<std::string> const &materials)
+	std::optional<std::vector<unsigned int>> TinyProcessNode(tinygltf::Node const &node, tinygltf::Model const &model, std::vector<unsigned int> const &materials)
 	{
 		std::vector<unsigned int> allMeshes;
 
@@ -114,8 +114,11 @@ private:
 					});
 				}
 
-				current.build();
-				current.SetPbrMaterial(materials[primitive.material]);
+				current.build(engine::VertexFormat::Packed);
+				current.GenerateLods();
+				if (primitive.material >= 0) {
+					current.SetPbrMaterial(materials[primitive.material]);
+				}
 
 				// Register this mesh to the engine and save its index
 				allMeshes.push_back(engine::Engine::Instance().AddMesh(std::move(current)));
@@ -175,10 +178,59 @@ private:
 
 		//fmt::print("Model name is \"{}\"\n", modelName);
 
+		// Load texture images
+		// -------------------
+
+		std::string directory = path.substr(0, path.find_last_of('/')) + "/";
+
+		// The albedo maps are in sRGB
+		std::vector<bool> isAlbedo(model.textures.size(), false);
+		for (auto const &material : model.materials) {
+			auto const baseColorTexture = material.pbrMetallicRoughness.baseColorTexture.index;
+			if (baseColorTexture >= 0) {
+				isAlbedo[baseColorTexture] = true;
+			}
+		}
+
+		for (size_t textureIndex = 0; textureIndex < model.textures.size(); textureIndex++) {
+
+			auto const &t = model.textures[textureIndex];
+			auto const &image = model.images[t.source];
+
+			std::string name = image.uri;
+			std::string path = directory + image.uri;
+
+			if (isAlbedo[textureIndex]) {
+				TextureManager::instance().createTexture(name, path, {
+					{ GL_TEXTURE_MAG_FILTER, GL_LINEAR },
+					{ GL_TEXTURE_MIN_FILTER, GL_LINEAR },
+					{ GL_TEXTURE_WRAP_S, GL_REPEAT },
+					{ GL_TEXTURE_WRAP_T, GL_REPEAT },
+				}, GL_TEXTURE_2D, true);
+			}
+			else if (t.sampler >= 0) {
+				auto const &sampler = model.samplers[t.sampler];
+
+				TextureManager::instance().createTexture(name, path, {
+					{ GL_TEXTURE_MAG_FILTER, sampler.magFilter },
+					{ GL_TEXTURE_MIN_FILTER, sampler.minFilter },
+					{ GL_TEXTURE_WRAP_S, sampler.wrapS },
+					{ GL_TEXTURE_WRAP_T, sampler.wrapT },
+				}, GL_TEXTURE_2D);
+			}
+			else {
+				TextureManager::instance().createTexture(name, path, {
+					{ GL_TEXTURE_MAG_FILTER, GL_LINEAR },
+					{ GL_TEXTURE_MIN_FILTER, GL_LINEAR },
+					{ GL_TEXTURE_WRAP_S, GL_REPEAT },
+					{ GL_TEXTURE_WRAP_T, GL_REPEAT },
+				}, GL_TEXTURE_2D);
+			}
+		}
+
 		// Load Materials
 		// --------------
-		std::vector<std::string> pbrMaterials; // Save the materials' index to be able to set the material of the mesh later
-		std::string directory = path.substr(0, path.find_last_of('/')) + "/";
+		std::vector<unsigned int> pbrMaterials; // Ids of the materials, by glTF index, to set the material of the meshes
 
 		size_t currentMaterialIndex = 0;
 		for (auto const &material : model.materials) {
@@ -196,13 +248,6 @@ private:
 			auto const baseColorTexture = material.pbrMetallicRoughness.baseColorTexture.index;
 			if (baseColorTexture >= 0) {
 				pbrMaterial.Albedo = model.images[model.textures[baseColorTexture].source].uri;
-
-				TextureManager::instance().createTexture(pbrMaterial.Albedo.value(), directory + pbrMaterial.Albedo.value(), {
-					{ GL_TEXTURE_MAG_FILTER, GL_LINEAR },
-					{ GL_TEXTURE_MIN_FILTER, GL_LINEAR },
-					{ GL_TEXTURE_WRAP_S, GL_REPEAT },
-					{ GL_TEXTURE_WRAP_T, GL_REPEAT },
-				}, GL_TEXTURE_2D, true);
 			}
 
 			auto const normalTexture = material.normalTexture.index;
@@ -225,42 +270,11 @@ private:
 
 			//fmt::print("{}\n", pbrMaterial);
 
-			pbrMaterials.push_back(pbrMaterial.Name);
-			engine::Engine::Instance().AddPbrMaterial(pbrMaterial);
+			pbrMaterials.push_back(engine::Engine::Instance().AddPbrMaterial(pbrMaterial));
 
 			currentMaterialIndex++;
 		}
 
-		// Load texture images
-		// -------------------
-
-		for (auto const &t : model.textures) {
-
-			auto const &image = model.images[t.source];
-
-			std::string name = image.uri;
-			std::string path = directory + image.uri;
-
-			if (t.sampler >= 0) {
-				auto const &sampler = model.samplers[t.sampler];
-
-				TextureManager::instance().createTexture(name, path, {
-					{ GL_TEXTURE_MAG_FILTER, sampler.magFilter },
-					{ GL_TEXTURE_MIN_FILTER, sampler.minFilter },
-					{ GL_TEXTURE_WRAP_S, sampler.wrapS },
-					{ GL_TEXTURE_WRAP_T, sampler.wrapT },
-				}, GL_TEXTURE_2D);
-			}
-			else {
-				TextureManager::instance().createTexture(name, path, {
-					{ GL_TEXTURE_MAG_FILTER, GL_LINEAR },
-					{ GL_TEXTURE_MIN_FILTER, GL_LINEAR },
-					{ GL_TEXTURE_WRAP_S, GL_REPEAT },
-					{ GL_TEXTURE_WRAP_T, GL_REPEAT },
-				}, GL_TEXTURE_2D);
-			}
-		}
-
 		std::vector<unsigned int> meshes;
 
 		for (auto const &scene : model.scenes) {
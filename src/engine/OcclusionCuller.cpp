@@ -0,0 +1,306 @@
+#include "OcclusionCuller.hpp"
+#include <algorithm>
+#include <thread>
+#include <limits>
+#include <cmath>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+namespace engine
+{
+
+/// Clip-space w under which a vertex is considered to be on or behind the eye
+static constexpr float MinW = 1e-5f;
+
+OcclusionCuller::OcclusionCuller(int width, int height, unsigned int threadCount) :
+	_width((std::max(width, 4) + 3) & ~3), _height(std::max(height, 1)), _threadCount(threadCount),
+	_viewProjection(1.0f)
+{
+	if (_threadCount == 0) {
+		_threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	_threadCount = std::min<unsigned int>(_threadCount, _height);
+
+	_depth.assign(_width * _height, 1.0f);
+	BuildPyramid();
+}
+
+void OcclusionCuller::BeginFrame(glm::mat4 const &viewProjection)
+{
+	_viewProjection = viewProjection;
+	_triangles.clear();
+	std::fill(_depth.begin(), _depth.end(), 1.0f);
+}
+
+void OcclusionCuller::AddOccluder(std::vector<float> const &positions, std::vector<unsigned int> const &indices,
+	glm::mat4 const &model)
+{
+	glm::mat4 const mvp = _viewProjection * model;
+
+	std::vector<glm::vec4> clip(positions.size() / 3);
+
+	for (size_t i = 0; i < clip.size(); i++) {
+		clip[i] = mvp * glm::vec4(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+	}
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		AddTriangle(clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]);
+	}
+}
+
+void OcclusionCuller::AddTriangle(glm::vec4 const &a, glm::vec4 const &b, glm::vec4 const &c)
+{
+	// Triangles crossing the near plane are dropped, an occluder can always be ignored
+	for (auto const *v : { &a, &b, &c }) {
+		if (v->w < MinW || v->z < -v->w) { return ; }
+	}
+
+	glm::vec2 const size(_width, _height);
+
+	auto toWindow = [&] (glm::vec4 const &v) {
+		glm::vec3 const ndc = glm::vec3(v) / v.w;
+		return glm::vec3((glm::vec2(ndc) * 0.5f + 0.5f) * size, ndc.z * 0.5f + 0.5f);
+	};
+
+	glm::vec3 const p0 = toWindow(a);
+	glm::vec3 const p1 = toWindow(b);
+	glm::vec3 const p2 = toWindow(c);
+
+	// Back-facing and degenerate triangles
+	float const area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+	if (area <= 0.0f) { return ; }
+
+	glm::vec2 const min = glm::min(glm::min(glm::vec2(p0), glm::vec2(p1)), glm::vec2(p2));
+	glm::vec2 const max = glm::max(glm::max(glm::vec2(p0), glm::vec2(p1)), glm::vec2(p2));
+
+	Triangle t;
+		t.Min = glm::max(glm::ivec2(glm::floor(min)), glm::ivec2(0));
+		t.Max = glm::min(glm::ivec2(glm::ceil(max)), glm::ivec2(_width - 1, _height - 1));
+
+	if (t.Min.x > t.Max.x || t.Min.y > t.Max.y) { return ; }
+
+	// Edge i goes from vertex i to vertex i + 1
+	auto edge = [] (glm::vec3 const &from, glm::vec3 const &to) {
+		return glm::vec3(from.y - to.y, to.x - from.x, from.x * to.y - from.y * to.x);
+	};
+
+	glm::vec3 const e0 = edge(p0, p1);
+	glm::vec3 const e1 = edge(p1, p2);
+	glm::vec3 const e2 = edge(p2, p0);
+
+	t.EdgeA = glm::vec3(e0.x, e1.x, e2.x);
+	t.EdgeB = glm::vec3(e0.y, e1.y, e2.y);
+	t.EdgeC = glm::vec3(e0.z, e1.z, e2.z);
+
+	// The barycentric weight of a vertex is the edge function of the opposite edge
+	glm::vec3 const depths = glm::vec3(p2.z, p0.z, p1.z) / area;
+
+	t.DepthPlane = glm::vec3(glm::dot(t.EdgeA, depths), glm::dot(t.EdgeB, depths), glm::dot(t.EdgeC, depths));
+
+	_triangles.push_back(t);
+}
+
+void OcclusionCuller::RasterizeRows(int firstRow, int lastRow)
+{
+	for (auto const &t : _triangles) {
+
+		int const yMin = std::max(t.Min.y, firstRow);
+		int const yMax = std::min(t.Max.y, lastRow);
+		int const xMin = t.Min.x & ~3;
+
+		for (int y = yMin; y <= yMax; y++) {
+			float const py = y + 0.5f;
+			float *row = _depth.data() + y * _width;
+
+			// Part of the edge and depth functions that is constant along the row
+			glm::vec3 const rowEdge = t.EdgeB * py + t.EdgeC;
+			float const rowDepth = t.DepthPlane.y * py + t.DepthPlane.z;
+
+#if defined(__SSE2__)
+			__m128 const zero = _mm_setzero_ps();
+			__m128 const offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+			for (int x = xMin; x <= t.Max.x; x += 4) {
+				__m128 const px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+
+				__m128 const w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.EdgeA.x), px), _mm_set1_ps(rowEdge.x));
+				__m128 const w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.EdgeA.y), px), _mm_set1_ps(rowEdge.y));
+				__m128 const w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.EdgeA.z), px), _mm_set1_ps(rowEdge.z));
+
+				__m128 const inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+					_mm_cmpge_ps(w2, zero));
+
+				if (_mm_movemask_ps(inside) == 0) { continue ; }
+
+				__m128 const depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.DepthPlane.x), px), _mm_set1_ps(rowDepth));
+				__m128 const current = _mm_loadu_ps(row + x);
+				__m128 const closer = _mm_min_ps(current, depth);
+
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, current)));
+			}
+#else
+			for (int x = xMin; x <= t.Max.x; x++) {
+				float const px = x + 0.5f;
+				glm::vec3 const w = t.EdgeA * px + rowEdge;
+
+				if (w.x >= 0.0f && w.y >= 0.0f && w.z >= 0.0f) {
+					row[x] = std::min(row[x], t.DepthPlane.x * px + rowDepth);
+				}
+			}
+#endif
+		}
+	}
+}
+
+void OcclusionCuller::Rasterize()
+{
+	// Each thread owns a band of rows, no synchronization is needed
+	int const rowsPerBand = (_height + _threadCount - 1) / _threadCount;
+
+	std::vector<std::thread> workers;
+	workers.reserve(_threadCount - 1);
+
+	for (unsigned int band = 1; band < _threadCount; band++) {
+		int const first = band * rowsPerBand;
+		int const last = std::min(first + rowsPerBand, _height) - 1;
+
+		if (first <= last) {
+			workers.emplace_back(&OcclusionCuller::RasterizeRows, this, first, last);
+		}
+	}
+
+	RasterizeRows(0, std::min(rowsPerBand, _height) - 1);
+
+	for (auto &worker : workers) {
+		worker.join();
+	}
+
+	BuildPyramid();
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+	_levels.resize(1);
+	_levels[0].Width = _width;
+	_levels[0].Height = _height;
+	_levels[0].MinDepth = _depth;
+	_levels[0].MaxDepth = _depth;
+
+	while (_levels.back().Width > 1 || _levels.back().Height > 1) {
+		Level const &previous = _levels.back();
+		Level level;
+			level.Width = (previous.Width + 1) / 2;
+			level.Height = (previous.Height + 1) / 2;
+			level.MinDepth.resize(level.Width * level.Height);
+			level.MaxDepth.resize(level.Width * level.Height);
+
+		for (int y = 0; y < level.Height; y++) {
+			for (int x = 0; x < level.Width; x++) {
+				float minDepth = 1.0f;
+				float maxDepth = 0.0f;
+
+				// Odd sizes repeat the last row or column
+				for (int i = 0; i < 4; i++) {
+					int const sx = std::min(x * 2 + (i & 1), previous.Width - 1);
+					int const sy = std::min(y * 2 + (i >> 1), previous.Height - 1);
+
+					minDepth = std::min(minDepth, previous.MinDepth[sy * previous.Width + sx]);
+					maxDepth = std::max(maxDepth, previous.MaxDepth[sy * previous.Width + sx]);
+				}
+
+				level.MinDepth[y * level.Width + x] = minDepth;
+				level.MaxDepth[y * level.Width + x] = maxDepth;
+			}
+		}
+
+		_levels.push_back(std::move(level));
+	}
+}
+
+bool OcclusionCuller::IsVisible(Aabb const &bounds) const
+{
+	glm::vec2 rectMin(std::numeric_limits<float>::max());
+	glm::vec2 rectMax(std::numeric_limits<float>::lowest());
+	float nearest = std::numeric_limits<float>::max();
+	int behind = 0;
+
+	for (int i = 0; i < 8; i++) {
+		glm::vec3 const corner(
+			(i & 1) ? bounds.Max.x : bounds.Min.x,
+			(i & 2) ? bounds.Max.y : bounds.Min.y,
+			(i & 4) ? bounds.Max.z : bounds.Min.z);
+
+		glm::vec4 const clip = _viewProjection * glm::vec4(corner, 1.0f);
+
+		if (clip.w < MinW) {
+			behind++;
+			continue ;
+		}
+
+		glm::vec3 const ndc = glm::vec3(clip) / clip.w;
+
+		rectMin = glm::min(rectMin, glm::vec2(ndc));
+		rectMax = glm::max(rectMax, glm::vec2(ndc));
+		nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+
+	// Around the camera the projection of the box is unbounded
+	if (behind == 8) { return false; }
+	if (behind > 0) { return true; }
+
+	if (rectMax.x < -1.0f || rectMax.y < -1.0f || rectMin.x > 1.0f || rectMin.y > 1.0f || nearest > 1.0f) {
+		return false;
+	}
+
+	glm::vec2 const size(_width, _height);
+	glm::ivec2 const pixelMin = glm::max(glm::ivec2(glm::floor((rectMin * 0.5f + 0.5f) * size)), glm::ivec2(0));
+	glm::ivec2 const pixelMax = glm::min(glm::ivec2(glm::floor((rectMax * 0.5f + 0.5f) * size)),
+		glm::ivec2(_width - 1, _height - 1));
+
+	// Coarsest level where the rectangle spans a few texels
+	size_t start = 0;
+	int extent = std::max(pixelMax.x - pixelMin.x, pixelMax.y - pixelMin.y) + 1;
+
+	while (extent > 4 && start + 1 < _levels.size()) {
+		extent = (extent + 1) / 2;
+		start++;
+	}
+
+	for (size_t level = start; ; level--) {
+		auto const &data = _levels[level];
+		glm::ivec2 const min = pixelMin >> static_cast<int>(level);
+		glm::ivec2 const max = pixelMax >> static_cast<int>(level);
+
+		bool bHidden = true;
+
+		for (int y = min.y; y <= max.y; y++) {
+			for (int x = min.x; x <= max.x; x++) {
+				size_t const texel = y * data.Width + x;
+
+				// Every pixel of the texel is behind the box
+				if (nearest <= data.MinDepth[texel]) { return true; }
+
+				if (nearest <= data.MaxDepth[texel]) {
+					bHidden = false;
+				}
+			}
+		}
+
+		if (bHidden) { return false; }
+		if (level == 0 || start - level >= MaxRefinement) { return true; }
+	}
+}
+
+float OcclusionCuller::GetMinDepth(size_t level, int x, int y) const
+{
+	return _levels[level].MinDepth[y * _levels[level].Width + x];
+}
+
+float OcclusionCuller::GetMaxDepth(size_t level, int x, int y) const
+{
+	return _levels[level].MaxDepth[y * _levels[level].Width + x];
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include "Frustum.hpp"
+
+namespace engine
+{
+
+///
+/// Software occlusion culling against a low resolution depth buffer
+///
+/// Occluder triangles are rasterized on the CPU, four pixels at a time with SSE when it
+/// is available, by several threads that each own a band of rows. A pyramid holding the
+/// minimum and maximum depth of each block is built from the result, and bounding boxes
+/// are tested against the level where their screen rectangle spans a few texels.
+///
+/// Depth is the window depth in [0, 1], 1 being the far plane.
+///
+class OcclusionCuller
+{
+public:
+	static constexpr int DefaultWidth = 256;
+	static constexpr int DefaultHeight = 144;
+
+	/// Finer levels visited when the coarse test is not conclusive
+	static constexpr size_t MaxRefinement = 2;
+
+private:
+	struct Triangle
+	{
+		/// Edge functions A * x + B * y + C of the three edges, positive inside
+		glm::vec3 EdgeA;
+		glm::vec3 EdgeB;
+		glm::vec3 EdgeC;
+		/// depth = x * DepthPlane.x + y * DepthPlane.y + DepthPlane.z
+		glm::vec3 DepthPlane;
+		/// Pixel bounds, inclusive
+		glm::ivec2 Min;
+		glm::ivec2 Max;
+	};
+
+	struct Level
+	{
+		int Width;
+		int Height;
+		std::vector<float> MinDepth;
+		std::vector<float> MaxDepth;
+	};
+
+	int _width;
+	int _height;
+	unsigned int _threadCount;
+
+	glm::mat4 _viewProjection;
+	std::vector<float> _depth;
+	std::vector<Triangle> _triangles;
+	/// Level 0 is a copy of the depth buffer
+	std::vector<Level> _levels;
+
+	void AddTriangle(glm::vec4 const &a, glm::vec4 const &b, glm::vec4 const &c);
+	void RasterizeRows(int firstRow, int lastRow);
+	void BuildPyramid();
+
+public:
+	/// `width` is rounded up to a multiple of 4, 0 threads means one per hardware thread
+	OcclusionCuller(int width = DefaultWidth, int height = DefaultHeight, unsigned int threadCount = 0);
+
+	/// Clear the depth and the occluders, `viewProjection` is used until the next call
+	void BeginFrame(glm::mat4 const &viewProjection);
+
+	/// Queue the triangles of a mesh, positions are packed xyz
+	void AddOccluder(std::vector<float> const &positions, std::vector<unsigned int> const &indices,
+		glm::mat4 const &model);
+
+	/// Rasterize the queued occluders and build the depth pyramid
+	void Rasterize();
+
+	/// False if the box is outside the view or hidden behind the occluders
+	bool IsVisible(Aabb const &bounds) const;
+
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+	size_t GetTriangleCount() const { return _triangles.size(); }
+	size_t GetLevelCount() const { return _levels.size(); }
+
+	float GetDepth(int x, int y) const { return _depth[y * _width + x]; }
+	float GetMinDepth(size_t level, int x, int y) const;
+	float GetMaxDepth(size_t level, int x, int y) const;
+};
+
+}
@@ -0,0 +1,115 @@
+#include "OffscreenContext.hpp"
+#include "lazy.hpp"
+#include "Logger.hpp"
+#include <stdexcept>
+
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace engine
+{
+
+static EGLDisplay GetSurfacelessDisplay()
+{
+	auto const getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+		eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+	if (getPlatformDisplay) {
+		EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (display != EGL_NO_DISPLAY) { return display; }
+	}
+
+	// Not Mesa: the default display of the driver may still work without a window
+	Logger::Warn("EGL surfaceless platform not available, using the default display\n");
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+OffscreenContext::OffscreenContext(int width, int height) : _display(EGL_NO_DISPLAY), _surface(EGL_NO_SURFACE),
+	_context(EGL_NO_CONTEXT), _size(width, height)
+{
+	EGLint major = 0;
+	EGLint minor = 0;
+
+	_display = GetSurfacelessDisplay();
+	if (_display == EGL_NO_DISPLAY || !eglInitialize(_display, &major, &minor)) {
+		throw std::runtime_error("Could not initialize EGL");
+	}
+	Logger::Info("EGL {}.{} ({})\n", major, minor, eglQueryString(_display, EGL_VENDOR));
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		throw std::runtime_error("EGL cannot create desktop OpenGL contexts");
+	}
+
+	EGLint const configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_STENCIL_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint configCount = 0;
+
+	if (!eglChooseConfig(_display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+		throw std::runtime_error("No EGL config with a pbuffer and OpenGL");
+	}
+
+	EGLint const surfaceAttribs[] = {
+		EGL_WIDTH, width,
+		EGL_HEIGHT, height,
+		EGL_NONE
+	};
+
+	_surface = eglCreatePbufferSurface(_display, config, surfaceAttribs);
+	if (_surface == EGL_NO_SURFACE) {
+		throw std::runtime_error("Could not create the EGL pbuffer");
+	}
+
+	EGLint const contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	_context = eglCreateContext(_display, config, EGL_NO_CONTEXT, contextAttribs);
+	if (_context == EGL_NO_CONTEXT) {
+		throw std::runtime_error("Could not create an OpenGL 4.5 core context");
+	}
+
+	if (!eglMakeCurrent(_display, _surface, _surface, _context)) {
+		throw std::runtime_error("Could not make the EGL context current");
+	}
+
+	// glewInit() asks GLX for the context, there is none: only load the functions
+	glewExperimental = GL_TRUE;
+	GLenum const status = glewContextInit();
+	if (status != GLEW_OK) {
+		throw std::runtime_error(reinterpret_cast<char const *>(glewGetErrorString(status)));
+	}
+
+	Logger::Info("OpenGL {} on {}\n", reinterpret_cast<char const *>(glGetString(GL_VERSION)),
+		reinterpret_cast<char const *>(glGetString(GL_RENDERER)));
+}
+
+OffscreenContext::~OffscreenContext()
+{
+	if (_display == EGL_NO_DISPLAY) { return ; }
+
+	eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (_context != EGL_NO_CONTEXT) {
+		eglDestroyContext(_display, _context);
+	}
+	if (_surface != EGL_NO_SURFACE) {
+		eglDestroySurface(_display, _surface);
+	}
+	eglTerminate(_display);
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+namespace engine
+{
+
+///
+/// OpenGL 4.5 core context without a window, for the benchmark and the CI
+///
+/// It runs on the EGL surfaceless platform of Mesa, so it works with llvmpipe on a
+/// machine without a display server. The context renders into a pbuffer of the
+/// requested size, which stands for the default framebuffer the renderer draws to.
+///
+/// The EGL handles are kept opaque: the EGL headers pull in the ones of X11 and their
+/// macros.
+///
+class OffscreenContext
+{
+private:
+	void *_display;
+	void *_surface;
+	void *_context;
+	glm::ivec2 _size;
+
+public:
+	/// Create the context and make it current, throws a std::runtime_error on failure
+	OffscreenContext(int width, int height);
+	~OffscreenContext();
+
+	OffscreenContext(OffscreenContext const &) = delete;
+	void operator=(OffscreenContext const &) = delete;
+
+	glm::ivec2 GetSize() const { return _size; }
+};
+
+}
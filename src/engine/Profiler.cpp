@@ -0,0 +1,116 @@
+#include "Profiler.hpp"
+#include "RenderCounters.hpp"
+#include <algorithm>
+
+namespace engine
+{
+
+void TimingHistory::Add(float milliseconds)
+{
+	_samples[_next] = milliseconds;
+	_next = (_next + 1) % Size;
+	_count = std::min(_count + 1, Size);
+}
+
+float TimingHistory::GetMin() const
+{
+	if (_count == 0) { return 0.0f; }
+	return *std::min_element(_samples.begin(), _samples.begin() + _count);
+}
+
+float TimingHistory::GetMax() const
+{
+	if (_count == 0) { return 0.0f; }
+	return *std::max_element(_samples.begin(), _samples.begin() + _count);
+}
+
+float TimingHistory::GetAverage() const
+{
+	if (_count == 0) { return 0.0f; }
+
+	float sum = 0.0f;
+	for (size_t i = 0; i < _count; i++) {
+		sum += _samples[i];
+	}
+	return sum / _count;
+}
+
+void Profiler::BeginPass(std::string const &name)
+{
+	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name.c_str());
+	FrameCounters::Instance().BeginPass(name);
+
+	if (_depth++ > 0) { return ; }
+
+	auto timer = std::find_if(_gpuTimers.begin(), _gpuTimers.end(), [&name] (GpuTimer const &t) {
+		return t.History.GetName() == name;
+	});
+
+	if (timer == _gpuTimers.end()) {
+		_gpuTimers.push_back({ TimingHistory(name), std::make_unique<GpuQuery>(GL_TIME_ELAPSED), 0 });
+		timer = _gpuTimers.end() - 1;
+	}
+
+	_activeTimer = timer - _gpuTimers.begin();
+	timer->Query->Begin();
+}
+
+void Profiler::EndPass()
+{
+	if (_depth == 0) { return ; }
+
+	FrameCounters::Instance().EndPass();
+
+	if (--_depth == 0) {
+		_gpuTimers[_activeTimer].Query->End();
+		_activeTimer = NoTimer;
+	}
+
+	glPopDebugGroup();
+}
+
+void Profiler::AddCpuTiming(std::string const &name, float milliseconds)
+{
+	auto timing = std::find_if(_cpuTimings.begin(), _cpuTimings.end(), [&name] (TimingHistory const &t) {
+		return t.GetName() == name;
+	});
+
+	if (timing == _cpuTimings.end()) {
+		_cpuTimings.emplace_back(name);
+		timing = _cpuTimings.end() - 1;
+	}
+
+	timing->Add(milliseconds);
+}
+
+void Profiler::EndFrame()
+{
+	FrameCounters::Instance().EndFrame();
+
+	float frameTime = 0.0f;
+
+	for (auto &timer : _gpuTimers) {
+		if (timer.Query->GetResultCount() == timer.ResultCount) { continue ; }
+
+		timer.ResultCount = timer.Query->GetResultCount();
+		timer.History.Add(timer.Query->GetResult() / 1e6f);
+		frameTime += timer.History.GetLast();
+	}
+
+	// Passes that were not run are left out, they have no new result
+	if (frameTime > 0.0f) {
+		_gpuFrameTime = frameTime;
+	}
+}
+
+std::vector<TimingHistory const *> Profiler::GetGpuTimings() const
+{
+	std::vector<TimingHistory const *> timings;
+
+	for (auto const &timer : _gpuTimers) {
+		timings.push_back(&timer.History);
+	}
+	return timings;
+}
+
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "lazy.hpp"
+#include "GpuQuery.hpp"
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+
+namespace engine
+{
+
+///
+/// Last samples of a timing, in milliseconds
+///
+class TimingHistory
+{
+public:
+	static constexpr size_t Size = 120;
+
+private:
+	std::string _name;
+	std::array<float, Size> _samples;
+	size_t _count;
+	size_t _next;
+
+public:
+	explicit TimingHistory(std::string name) : _name(std::move(name)), _samples{}, _count(0), _next(0) {}
+
+	void Add(float milliseconds);
+
+	std::string const &GetName() const { return _name; }
+
+	/// Ring of samples, the oldest one is at GetOffset() once it is full
+	float const *GetSamples() const { return _samples.data(); }
+	size_t GetCount() const { return _count; }
+	size_t GetOffset() const { return _count < Size ? 0 : _next; }
+
+	float GetLast() const { return _count > 0 ? _samples[(_next + Size - 1) % Size] : 0.0f; }
+	float GetMin() const;
+	float GetMax() const;
+	float GetAverage() const;
+};
+
+///
+/// GPU time of the render passes and CPU time of the systems
+///
+/// Each pass is wrapped in a debug group, so it shows up in RenderDoc or apitrace, and
+/// in a GL_TIME_ELAPSED query read back a few frames later by GpuQuery. Timer queries
+/// cannot overlap: a pass begun inside another one only gets a debug group and its time
+/// is counted in the outer pass. The passes also split the FrameCounters.
+///
+class Profiler
+{
+private:
+	struct GpuTimer
+	{
+		TimingHistory History;
+		std::unique_ptr<GpuQuery> Query;
+		size_t ResultCount;
+	};
+
+	static constexpr size_t NoTimer = static_cast<size_t>(-1);
+
+	std::vector<GpuTimer> _gpuTimers;
+	std::vector<TimingHistory> _cpuTimings;
+
+	/// Timer of the outermost open pass
+	size_t _activeTimer;
+	size_t _depth;
+
+	float _gpuFrameTime;
+
+	Profiler() : _activeTimer(NoTimer), _depth(0), _gpuFrameTime(0.0f) {}
+
+public:
+	static Profiler &Instance()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+	Profiler(Profiler const &) = delete;
+	void operator=(Profiler const &) = delete;
+
+	void BeginPass(std::string const &name);
+	void EndPass();
+
+	void AddCpuTiming(std::string const &name, float milliseconds);
+
+	/// Move the GPU results that came back into the histories
+	void EndFrame();
+
+	std::vector<TimingHistory const *> GetGpuTimings() const;
+
+	/// Sum of the GPU passes whose results came back during the last EndFrame(), in milliseconds
+	float GetGpuFrameTime() const { return _gpuFrameTime; }
+	std::vector<TimingHistory> const &GetCpuTimings() const { return _cpuTimings; }
+};
+
+}
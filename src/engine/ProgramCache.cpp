@@ -0,0 +1,131 @@
+#include "ProgramCache.hpp"
+#include "Logger.hpp"
+#include <fmt/format.h>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <chrono>
+
+namespace engine
+{
+
+static constexpr uint32_t Magic = 0x4e494250; // "PBIN"
+static constexpr uint32_t Version = 1;
+
+struct EntryHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t Key;
+	GLenum Format;
+	uint32_t Size;
+	float BuildMs;
+};
+
+static std::string GetString(GLenum name)
+{
+	auto const string = reinterpret_cast<char const *>(glGetString(name));
+	return string ? string : "";
+}
+
+ProgramCache::ProgramCache() : _directory("cache/programs"), _bIsSupported(false), _bEnabled(true)
+{
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+	_bIsSupported = formats > 0;
+	_driver = GetString(GL_VENDOR) + "\n" + GetString(GL_RENDERER) + "\n" + GetString(GL_VERSION);
+
+	if (!_bIsSupported) {
+		Logger::Warn("The driver has no program binary format, shaders are compiled on every launch\n");
+	}
+}
+
+uint64_t ProgramCache::GetKey(std::string const &sources) const
+{
+	// FNV-1a, std::hash is not guaranteed to be the same from one build to the next
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	auto const add = [&hash] (std::string const &text) {
+		for (unsigned char const c : text) {
+			hash = (hash ^ c) * 0x100000001b3ull;
+		}
+	};
+
+	add(_driver);
+	add(sources);
+	return hash;
+}
+
+std::string ProgramCache::GetPath(uint64_t key) const
+{
+	return fmt::format("{}/{:016x}.bin", _directory, key);
+}
+
+bool ProgramCache::Load(GLuint program, uint64_t key)
+{
+	if (!IsEnabled()) { return false; }
+
+	auto const start = std::chrono::steady_clock::now();
+
+	std::ifstream file(GetPath(key), std::ios::binary);
+	if (!file) { return false; }
+
+	EntryHeader header{};
+	file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+	if (!file || header.Magic != Magic || header.Version != Version || header.Key != key) { return false; }
+
+	std::vector<char> binary(header.Size);
+	file.read(binary.data(), binary.size());
+	if (!file) { return false; }
+
+	glProgramBinary(program, header.Format, binary.data(), binary.size());
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		Logger::Verbose("Program binary {:016x} rejected by the driver\n", key);
+		return false;
+	}
+
+	float const loadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	_stats.Hits++;
+	_stats.LoadMs += loadMs;
+	_stats.SavedMs += header.BuildMs - loadMs;
+	return true;
+}
+
+void ProgramCache::Store(GLuint program, uint64_t key, float buildMs)
+{
+	_stats.Misses++;
+	_stats.BuildMs += buildMs;
+
+	if (!IsEnabled()) { return ; }
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) { return ; }
+
+	EntryHeader header{ Magic, Version, key, 0, 0, buildMs };
+	std::vector<char> binary(length);
+	GLsizei written = 0;
+
+	glGetProgramBinary(program, length, &written, &header.Format, binary.data());
+	header.Size = written;
+
+	std::error_code error;
+	std::filesystem::create_directories(_directory, error);
+
+	std::ofstream file(GetPath(key), std::ios::binary | std::ios::trunc);
+	if (!file) {
+		Logger::Warn("Could not write the program cache in {}\n", _directory);
+		return ;
+	}
+
+	file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+	file.write(binary.data(), written);
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <string>
+#include <cstdint>
+
+namespace engine
+{
+
+///
+/// Linked programs saved to disk with glGetProgramBinary, reloaded on the next launches
+///
+/// A program is keyed by a hash of its sources and of the driver, so an edited shader
+/// or a driver update is a miss instead of a stale binary. The driver may still reject a
+/// binary it wrote itself; ShaderProgram then compiles the sources as if nothing was
+/// cached and the entry is overwritten.
+///
+/// Each entry records how long the program took to build from source, the time saved
+/// by a hit is that minus the time glProgramBinary took.
+///
+class ProgramCache
+{
+public:
+	struct Stats
+	{
+		size_t Hits = 0;
+		size_t Misses = 0;
+		/// Spent compiling and linking the misses, and loading the hits
+		float BuildMs = 0.0f;
+		float LoadMs = 0.0f;
+		/// Recorded build time of the hits, minus the time it took to load them
+		float SavedMs = 0.0f;
+	};
+
+private:
+	std::string _directory;
+	/// Vendor, renderer and version: a binary is only valid for the driver that wrote it
+	std::string _driver;
+	bool _bIsSupported;
+	bool _bEnabled;
+
+	Stats _stats;
+
+	ProgramCache();
+
+	std::string GetPath(uint64_t key) const;
+
+public:
+	static ProgramCache &Instance()
+	{
+		static ProgramCache cache;
+		return cache;
+	}
+
+	ProgramCache(ProgramCache const &) = delete;
+	void operator=(ProgramCache const &) = delete;
+
+	/// Hash of the sources of a program, which must include its defines
+	uint64_t GetKey(std::string const &sources) const;
+
+	/// Load the binary of `key` into `program`, false on a miss or if the driver rejects it
+	bool Load(GLuint program, uint64_t key);
+
+	/// Save a program that was linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+	void Store(GLuint program, uint64_t key, float buildMs);
+
+	/// Compile everything from source, for instance when editing shaders
+	void SetEnabled(bool bEnabled) { _bEnabled = bEnabled; }
+	bool IsEnabled() const { return _bEnabled && _bIsSupported; }
+
+	Stats const &GetStats() const { return _stats; }
+};
+
+}
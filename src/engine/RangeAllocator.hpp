@@ -0,0 +1,104 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <cstddef>
+
+namespace engine
+{
+
+///
+/// First-fit sub-allocator over a linear range of elements
+///
+/// Free blocks are kept sorted by offset so that neighbours can be merged
+/// back together when a block is released.
+///
+class RangeAllocator
+{
+private:
+	/// Offset -> size of each free block
+	std::map<size_t, size_t> _freeBlocks;
+	size_t _capacity;
+	size_t _used;
+
+public:
+	RangeAllocator(size_t capacity = 0) : _capacity(0), _used(0)
+	{
+		Grow(capacity);
+	}
+
+	///
+	/// Find room for `size` contiguous elements
+	///
+	/// Returns the offset of the allocated block or nothing if the range is full
+	///
+	std::optional<size_t> Allocate(size_t size)
+	{
+		if (size == 0) { return std::nullopt; }
+
+		for (auto it = _freeBlocks.begin(); it != _freeBlocks.end(); it++) {
+			auto const [ offset, blockSize ] = *it;
+
+			if (blockSize < size) { continue ; }
+
+			_freeBlocks.erase(it);
+			if (blockSize > size) {
+				_freeBlocks[offset + size] = blockSize - size;
+			}
+			_used += size;
+
+			return offset;
+		}
+
+		return std::nullopt;
+	}
+
+	///
+	/// Give back a block previously returned by Allocate()
+	///
+	void Free(size_t offset, size_t size)
+	{
+		if (size == 0) { return ; }
+
+		_used -= size;
+
+		auto next = _freeBlocks.lower_bound(offset);
+
+		// Merge with the following block
+		if (next != _freeBlocks.end() && offset + size == next->first) {
+			size += next->second;
+			next = _freeBlocks.erase(next);
+		}
+
+		// Merge with the preceding block
+		if (next != _freeBlocks.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				prev->second += size;
+				return ;
+			}
+		}
+
+		_freeBlocks[offset] = size;
+	}
+
+	///
+	/// Extend the range to `capacity` elements, the new space is appended as a free block
+	///
+	void Grow(size_t capacity)
+	{
+		if (capacity <= _capacity) { return ; }
+
+		size_t const oldCapacity = _capacity;
+		size_t const extra = capacity - _capacity;
+
+		_capacity = capacity;
+		_used += extra;
+		Free(oldCapacity, extra);
+	}
+
+	size_t GetCapacity() const { return _capacity; }
+	size_t GetUsed() const { return _used; }
+};
+
+}
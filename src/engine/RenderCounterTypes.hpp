@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace engine
+{
+
+///
+/// Work submitted to OpenGL
+///
+/// Indirect draws are counted from the commands recorded on the CPU, before the GPU
+/// culling: their instances and triangles are an upper bound.
+///
+struct RenderCounters
+{
+	size_t DrawCalls = 0;
+	size_t Instances = 0;
+	size_t Triangles = 0;
+	size_t ProgramBinds = 0;
+	size_t VertexArrayBinds = 0;
+	size_t TextureBinds = 0;
+	size_t UniformCalls = 0;
+	size_t BufferBytes = 0;
+	size_t TextureBytes = 0;
+
+	RenderCounters &operator+=(RenderCounters const &other);
+	RenderCounters operator-(RenderCounters const &other) const;
+	/// Every counter divided by `count`, rounded down
+	RenderCounters operator/(size_t count) const;
+};
+
+struct PassCounters
+{
+	std::string Name;
+	RenderCounters Counters;
+};
+
+}
@@ -0,0 +1,142 @@
+#include "RenderCounters.hpp"
+#include "RenderStats.hpp"
+#include <ostream>
+
+namespace engine
+{
+
+RenderCounters &RenderCounters::operator+=(RenderCounters const &other)
+{
+	DrawCalls += other.DrawCalls;
+	Instances += other.Instances;
+	Triangles += other.Triangles;
+	ProgramBinds += other.ProgramBinds;
+	VertexArrayBinds += other.VertexArrayBinds;
+	TextureBinds += other.TextureBinds;
+	UniformCalls += other.UniformCalls;
+	BufferBytes += other.BufferBytes;
+	TextureBytes += other.TextureBytes;
+	return *this;
+}
+
+RenderCounters RenderCounters::operator-(RenderCounters const &other) const
+{
+	RenderCounters result;
+
+	result.DrawCalls = DrawCalls - other.DrawCalls;
+	result.Instances = Instances - other.Instances;
+	result.Triangles = Triangles - other.Triangles;
+	result.ProgramBinds = ProgramBinds - other.ProgramBinds;
+	result.VertexArrayBinds = VertexArrayBinds - other.VertexArrayBinds;
+	result.TextureBinds = TextureBinds - other.TextureBinds;
+	result.UniformCalls = UniformCalls - other.UniformCalls;
+	result.BufferBytes = BufferBytes - other.BufferBytes;
+	result.TextureBytes = TextureBytes - other.TextureBytes;
+	return result;
+}
+
+RenderCounters RenderCounters::operator/(size_t count) const
+{
+	RenderCounters result;
+
+	if (count == 0) { return result; }
+
+	result.DrawCalls = DrawCalls / count;
+	result.Instances = Instances / count;
+	result.Triangles = Triangles / count;
+	result.ProgramBinds = ProgramBinds / count;
+	result.VertexArrayBinds = VertexArrayBinds / count;
+	result.TextureBinds = TextureBinds / count;
+	result.UniformCalls = UniformCalls / count;
+	result.BufferBytes = BufferBytes / count;
+	result.TextureBytes = TextureBytes / count;
+	return result;
+}
+
+void FrameCounters::BeginPass(std::string const &name)
+{
+	if (_depth++ > 0) { return ; }
+
+	_passes.push_back({ name, {} });
+	_passStart = _current;
+}
+
+void FrameCounters::EndPass()
+{
+	if (_depth == 0) { return ; }
+	if (--_depth > 0) { return ; }
+
+	_passes.back().Counters = _current - _passStart;
+}
+
+void FrameCounters::EndFrame()
+{
+	auto &stats = RenderStats::Instance();
+
+	stats.Counters = _current;
+	stats.Passes.swap(_passes);
+
+	_current = {};
+	_passes.clear();
+}
+
+void WriteCounters(std::ostream &out, std::vector<PassCounters> const &passes, RenderCounters const &frame)
+{
+	auto const line = [&out] (std::string const &name, RenderCounters const &c) {
+		out << name << '\t' << c.DrawCalls << '\t' << c.Instances << '\t' << c.Triangles
+			<< '\t' << c.ProgramBinds << '\t' << c.VertexArrayBinds << '\t' << c.TextureBinds
+			<< '\t' << c.UniformCalls << '\t' << c.BufferBytes << '\t' << c.TextureBytes << '\n';
+	};
+
+	out << "pass\tdraws\tinstances\ttriangles\tprograms\tvaos\ttextures\tuniforms\tbuffer_bytes\ttexture_bytes\n";
+	for (auto const &pass : passes) {
+		line(pass.Name, pass.Counters);
+	}
+	line("frame", frame);
+}
+
+size_t TriangleCount(GLenum mode, size_t count)
+{
+	switch (mode) {
+	case GL_TRIANGLES:
+		return count / 3;
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN:
+		return count > 2 ? count - 2 : 0;
+	default:
+		return 0;
+	}
+}
+
+size_t PixelBytes(GLenum format, GLenum type)
+{
+	size_t components = 4;
+	switch (format) {
+	case GL_RED:
+	case GL_DEPTH_COMPONENT:
+		components = 1;
+		break ;
+	case GL_RG:
+		components = 2;
+		break ;
+	case GL_RGB:
+	case GL_BGR:
+		components = 3;
+		break ;
+	default:
+		break ;
+	}
+
+	switch (type) {
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:
+		return components * 2;
+	case GL_FLOAT:
+	case GL_UNSIGNED_INT:
+		return components * 4;
+	default:
+		return components;
+	}
+}
+
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include "lazy.hpp"
+#include "RenderCounterTypes.hpp"
+#include <vector>
+#include <string>
+#include <iosfwd>
+
+/// Build with -DENGINE_RENDER_COUNTERS=0 (meson -Drender_stats=false) to compile the
+/// counting out, the functions of engine::gl then only forward to OpenGL
+#ifndef ENGINE_RENDER_COUNTERS
+# define ENGINE_RENDER_COUNTERS 1
+#endif
+
+namespace engine
+{
+
+///
+/// Counters of the frame being recorded, and of the outermost passes in it
+///
+/// The passes are the ones of the Profiler, which forwards its BeginPass and EndPass.
+/// EndFrame publishes the totals in RenderStats and starts the next frame.
+///
+class FrameCounters
+{
+private:
+	RenderCounters _current;
+	std::vector<PassCounters> _passes;
+
+	/// Counters when the outermost open pass began
+	RenderCounters _passStart;
+	size_t _depth;
+
+	FrameCounters() : _depth(0) {}
+
+public:
+	static FrameCounters &Instance()
+	{
+		static FrameCounters counters;
+		return counters;
+	}
+
+	FrameCounters(FrameCounters const &) = delete;
+	void operator=(FrameCounters const &) = delete;
+
+	RenderCounters &Current() { return _current; }
+
+	void BeginPass(std::string const &name);
+	void EndPass();
+	void EndFrame();
+};
+
+/// One tab-separated line per pass and one for the frame, for benchmark logs
+void WriteCounters(std::ostream &out, std::vector<PassCounters> const &passes, RenderCounters const &frame);
+
+/// Triangles assembled from `count` vertices
+size_t TriangleCount(GLenum mode, size_t count);
+
+/// Bytes of a pixel given to glTexImage or glTexSubImage
+size_t PixelBytes(GLenum format, GLenum type);
+
+///
+/// Counting layer in front of the OpenGL calls submitting work
+///
+/// The bindings are counted by GLState, which is the only one issuing them.
+///
+namespace gl
+{
+
+inline void CountDraw([[maybe_unused]] GLenum mode, [[maybe_unused]] size_t vertices,
+	[[maybe_unused]] size_t instances = 1)
+{
+#if ENGINE_RENDER_COUNTERS
+	auto &counters = FrameCounters::Instance().Current();
+	counters.DrawCalls++;
+	counters.Instances += instances;
+	counters.Triangles += TriangleCount(mode, vertices) * instances;
+#endif
+}
+
+/// Uniforms set on a ShaderProgram
+inline void CountUniforms([[maybe_unused]] size_t count = 1)
+{
+#if ENGINE_RENDER_COUNTERS
+	FrameCounters::Instance().Current().UniformCalls += count;
+#endif
+}
+
+inline void CountProgramBind()
+{
+#if ENGINE_RENDER_COUNTERS
+	FrameCounters::Instance().Current().ProgramBinds++;
+#endif
+}
+
+inline void CountVertexArrayBind()
+{
+#if ENGINE_RENDER_COUNTERS
+	FrameCounters::Instance().Current().VertexArrayBinds++;
+#endif
+}
+
+inline void CountTextureBind()
+{
+#if ENGINE_RENDER_COUNTERS
+	FrameCounters::Instance().Current().TextureBinds++;
+#endif
+}
+
+/// Written straight into mapped memory
+inline void CountBufferBytes([[maybe_unused]] size_t bytes)
+{
+#if ENGINE_RENDER_COUNTERS
+	FrameCounters::Instance().Current().BufferBytes += bytes;
+#endif
+}
+
+inline void DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	CountDraw(mode, count);
+	glDrawArrays(mode, first, count);
+}
+
+inline void DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, void const *indices, GLint baseVertex)
+{
+	CountDraw(mode, count);
+	glDrawElementsBaseVertex(mode, count, type, const_cast<void *>(indices), baseVertex);
+}
+
+/// `triangles` is the sum over the commands, the buffer only lives on the GPU
+inline void MultiDrawElementsIndirect(GLenum mode, GLenum type, void const *indirect, GLsizei drawCount,
+	GLsizei stride, [[maybe_unused]] size_t instances, [[maybe_unused]] size_t triangles)
+{
+#if ENGINE_RENDER_COUNTERS
+	auto &counters = FrameCounters::Instance().Current();
+	counters.DrawCalls++;
+	counters.Instances += instances;
+	counters.Triangles += triangles;
+#endif
+	glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+}
+
+/// Same as MultiDrawElementsIndirect, with at most `maxDrawCount` commands
+inline void MultiDrawElementsIndirectCount(GLenum mode, GLenum type, void const *indirect, GLintptr drawCount,
+	GLsizei maxDrawCount, GLsizei stride, [[maybe_unused]] size_t instances, [[maybe_unused]] size_t triangles)
+{
+#if ENGINE_RENDER_COUNTERS
+	auto &counters = FrameCounters::Instance().Current();
+	counters.DrawCalls++;
+	counters.Instances += instances;
+	counters.Triangles += triangles;
+#endif
+	glMultiDrawElementsIndirectCountARB(mode, type, indirect, drawCount, maxDrawCount, stride);
+}
+
+inline void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void const *data)
+{
+#if ENGINE_RENDER_COUNTERS
+	FrameCounters::Instance().Current().BufferBytes += size;
+#endif
+	glBufferSubData(target, offset, size, data);
+}
+
+inline void NamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, void const *data)
+{
+#if ENGINE_RENDER_COUNTERS
+	FrameCounters::Instance().Current().BufferBytes += size;
+#endif
+	glNamedBufferSubData(buffer, offset, size, data);
+}
+
+inline void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, void const *pixels)
+{
+#if ENGINE_RENDER_COUNTERS
+	if (pixels) {
+		FrameCounters::Instance().Current().TextureBytes += size_t(width) * height * PixelBytes(format, type);
+	}
+#endif
+	glTexImage2D(target, level, internalFormat, width, height, 0, format, type, pixels);
+}
+
+inline void TextureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, void const *pixels)
+{
+#if ENGINE_RENDER_COUNTERS
+	FrameCounters::Instance().Current().TextureBytes += size_t(width) * height * PixelBytes(format, type);
+#endif
+	glTextureSubImage2D(texture, level, x, y, width, height, format, type, pixels);
+}
+
+}
+
+}
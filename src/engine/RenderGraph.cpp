@@ -0,0 +1,475 @@
+#include "RenderGraph.hpp"
+#include "GLState.hpp"
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace engine
+{
+
+static size_t FormatBytes(GLenum format)
+{
+	switch (format) {
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16:
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGBA16:
+	case GL_RGBA16F:
+	case GL_RG32F:
+	case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGBA32F:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+static bool IsDepthFormat(GLenum format)
+{
+	switch (format) {
+	case GL_DEPTH_COMPONENT16:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32F:
+	case GL_DEPTH24_STENCIL8:
+	case GL_DEPTH32F_STENCIL8:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/// Barrier making storage writes visible to an access
+static GLbitfield BarrierBits(RenderGraph::Access access)
+{
+	switch (access) {
+	case RenderGraph::Access::Sampled:
+		return GL_TEXTURE_FETCH_BARRIER_BIT;
+	case RenderGraph::Access::Attachment:
+		return GL_FRAMEBUFFER_BARRIER_BIT;
+	case RenderGraph::Access::Storage:
+		return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+	}
+	return 0;
+}
+
+GLuint RenderGraph::Resources::GetTexture(Handle handle) const
+{
+	return _graph._resources[_graph._versions[handle].Resource].Texture;
+}
+
+glm::ivec2 RenderGraph::Resources::GetSize(Handle handle) const
+{
+	return _graph._resources[_graph._versions[handle].Resource].Size;
+}
+
+GLuint RenderGraph::Resources::GetFramebuffer() const
+{
+	return _graph._passes[_pass].Framebuffer;
+}
+
+RenderGraph::Handle RenderGraph::PassBuilder::Read(Handle handle, Access access)
+{
+	assert(handle < _graph._versions.size());
+
+	auto &pass = _graph._passes[_pass];
+	size_t const resource = _graph._versions[handle].Resource;
+
+	pass.Uses.push_back({ handle, access, false });
+
+	if (access == Access::Attachment && !_graph._resources[resource].bImported) {
+		pass.Attachments.push_back(resource);
+	}
+
+	return handle;
+}
+
+RenderGraph::Handle RenderGraph::PassBuilder::Write(Handle handle, Access access)
+{
+	assert(handle < _graph._versions.size());
+
+	auto &pass = _graph._passes[_pass];
+	size_t const resource = _graph._versions[handle].Resource;
+	auto const &target = _graph._resources[resource];
+
+	pass.Uses.push_back({ handle, access, true });
+
+	if (target.bImported && target.Texture == 0) {
+		pass.bWritesBackbuffer = true;
+	}
+	else if (access == Access::Attachment && !target.bImported) {
+		pass.Attachments.push_back(resource);
+	}
+
+	return _graph.AddVersion(resource, _pass);
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::SideEffect()
+{
+	_graph._passes[_pass].bSideEffect = true;
+	return *this;
+}
+
+RenderGraph::~RenderGraph()
+{
+	ReleaseFramebuffers();
+	for (auto const &texture : _pool) {
+		glDeleteTextures(1, &texture.Texture);
+	}
+}
+
+void RenderGraph::Reset(glm::ivec2 const &displaySize)
+{
+	_displaySize = displaySize;
+
+	_resources.clear();
+	_versions.clear();
+	_passes.clear();
+	_order.clear();
+	_slots.clear();
+}
+
+RenderGraph::Handle RenderGraph::AddVersion(size_t resource, size_t producer)
+{
+	_versions.push_back({ resource, producer });
+	_resources[resource].Current = _versions.size() - 1;
+
+	return _versions.size() - 1;
+}
+
+RenderGraph::Handle RenderGraph::Create(std::string name, TextureDesc const &desc)
+{
+	glm::ivec2 size = desc.Size;
+
+	if (size.x == 0 || size.y == 0) {
+		size = glm::max(glm::ivec2(glm::vec2(_displaySize) * desc.Scale), glm::ivec2(1));
+	}
+
+	_resources.push_back({ std::move(name), desc, size, false, 0, NoPass, Invalid });
+	return AddVersion(_resources.size() - 1, NoPass);
+}
+
+RenderGraph::Handle RenderGraph::Import(std::string name, GLuint texture, glm::ivec2 const &size)
+{
+	_resources.push_back({ std::move(name), TextureDesc{}, size, true, texture, NoPass, Invalid });
+	return AddVersion(_resources.size() - 1, NoPass);
+}
+
+RenderGraph::Handle RenderGraph::Find(std::string const &name) const
+{
+	for (auto const &resource : _resources) {
+		if (resource.Name == name) { return resource.Current; }
+	}
+	return Invalid;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(std::string name, ExecuteFunc execute)
+{
+	Pass pass;
+
+	pass.Name = std::move(name);
+	pass.Execute = std::move(execute);
+	pass.bSideEffect = false;
+	pass.bCulled = false;
+	pass.bWritesBackbuffer = false;
+	pass.Barriers = 0;
+	pass.Framebuffer = 0;
+
+	_passes.push_back(std::move(pass));
+
+	return PassBuilder(*this, _passes.size() - 1);
+}
+
+void RenderGraph::Compile()
+{
+	Cull();
+	Sort();
+	Allocate();
+	ComputeBarriers();
+	Materialize();
+}
+
+void RenderGraph::Cull()
+{
+	std::vector<bool> needed(_passes.size(), false);
+
+	for (size_t p = 0; p < _passes.size(); p++) {
+		needed[p] = _passes[p].bSideEffect;
+
+		for (auto const &use : _passes[p].Uses) {
+			if (use.bWrite && _resources[_versions[use.Id].Resource].bImported) {
+				needed[p] = true;
+			}
+		}
+	}
+
+	// A version only exists once its producer is declared, so producers always come first
+	for (size_t p = _passes.size(); p-- > 0;) {
+		if (!needed[p]) { continue ; }
+
+		for (auto const &use : _passes[p].Uses) {
+			size_t const producer = _versions[use.Id].Producer;
+
+			if (producer != NoPass) {
+				needed[producer] = true;
+			}
+		}
+	}
+
+	for (size_t p = 0; p < _passes.size(); p++) {
+		_passes[p].bCulled = !needed[p];
+	}
+}
+
+void RenderGraph::Sort()
+{
+	// Every pass comes after the producers of the versions it uses, the declaration order
+	// is a topological order of the dependencies
+	for (size_t p = 0; p < _passes.size(); p++) {
+		if (!_passes[p].bCulled) {
+			_order.push_back(p);
+		}
+	}
+}
+
+void RenderGraph::Allocate()
+{
+	std::vector<size_t> first(_resources.size(), NoPass);
+	std::vector<size_t> last(_resources.size(), 0);
+
+	for (size_t i = 0; i < _order.size(); i++) {
+		for (auto const &use : _passes[_order[i]].Uses) {
+			size_t const r = _versions[use.Id].Resource;
+
+			first[r] = std::min(first[r], i);
+			last[r] = std::max(last[r], i);
+		}
+	}
+
+	for (size_t i = 0; i < _order.size(); i++) {
+		for (auto const &use : _passes[_order[i]].Uses) {
+			size_t const r = _versions[use.Id].Resource;
+			auto &resource = _resources[r];
+
+			if (resource.bImported || first[r] != i || resource.Slot != NoPass) { continue ; }
+
+			// The first free texture of the same kind, the same frames always get the same slots
+			for (size_t s = 0; s < _slots.size(); s++) {
+				auto const &slot = _slots[s];
+
+				if (slot.Format == resource.Desc.Format && slot.Size == resource.Size && slot.BusyUntil < i) {
+					resource.Slot = s;
+					break ;
+				}
+			}
+
+			if (resource.Slot == NoPass) {
+				_slots.push_back({ resource.Desc.Format, resource.Size, 0, 0 });
+				resource.Slot = _slots.size() - 1;
+			}
+
+			_slots[resource.Slot].BusyUntil = last[r];
+		}
+	}
+}
+
+void RenderGraph::ComputeBarriers()
+{
+	// Storage writes not yet made visible, by slot then by imported resource
+	std::vector<bool> pending(_slots.size() + _resources.size(), false);
+
+	for (auto const p : _order) {
+		auto &pass = _passes[p];
+
+		for (auto const &use : pass.Uses) {
+			size_t const r = _versions[use.Id].Resource;
+			size_t const key = _resources[r].bImported ? _slots.size() + r : _resources[r].Slot;
+
+			if (pending[key]) {
+				pass.Barriers |= BarrierBits(use.Mode);
+			}
+		}
+
+		for (auto const &use : pass.Uses) {
+			size_t const r = _versions[use.Id].Resource;
+			size_t const key = _resources[r].bImported ? _slots.size() + r : _resources[r].Slot;
+
+			if (use.bWrite) {
+				pending[key] = (use.Mode == Access::Storage);
+			}
+		}
+	}
+}
+
+void RenderGraph::Materialize()
+{
+	for (auto &texture : _pool) {
+		texture.bClaimed = false;
+	}
+
+	for (auto &slot : _slots) {
+		for (auto &texture : _pool) {
+			if (!texture.bClaimed && texture.Format == slot.Format && texture.Size == slot.Size) {
+				texture.bClaimed = true;
+				slot.Texture = texture.Texture;
+				break ;
+			}
+		}
+
+		if (slot.Texture != 0) { continue ; }
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &slot.Texture);
+		glTextureStorage2D(slot.Texture, 1, slot.Format, slot.Size.x, slot.Size.y);
+		glTextureParameteri(slot.Texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(slot.Texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(slot.Texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(slot.Texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		_pool.push_back({ slot.Format, slot.Size, slot.Texture, true });
+	}
+
+	// Targets of a disabled pass or of the previous display size
+	auto const unused = std::partition(_pool.begin(), _pool.end(), [] (PooledTexture const &texture) {
+		return texture.bClaimed;
+	});
+
+	if (unused != _pool.end()) {
+		for (auto it = unused; it != _pool.end(); it++) {
+			glDeleteTextures(1, &it->Texture);
+		}
+		_pool.erase(unused, _pool.end());
+		ReleaseFramebuffers();
+
+		// The new objects may reuse the names of the deleted ones
+		GLState::Instance().Invalidate();
+	}
+
+	for (auto &resource : _resources) {
+		if (!resource.bImported && resource.Slot != NoPass) {
+			resource.Texture = _slots[resource.Slot].Texture;
+		}
+	}
+
+	for (auto const p : _order) {
+		if (!_passes[p].Attachments.empty()) {
+			_passes[p].Framebuffer = GetFramebuffer(_passes[p].Attachments);
+		}
+	}
+}
+
+GLuint RenderGraph::GetFramebuffer(std::vector<size_t> const &attachments)
+{
+	std::vector<GLuint> key;
+	for (auto const r : attachments) {
+		key.push_back(_resources[r].Texture);
+	}
+
+	auto const it = _framebuffers.find(key);
+	if (it != _framebuffers.end()) { return it->second; }
+
+	GLuint framebuffer = 0;
+	std::vector<GLenum> drawBuffers;
+
+	glCreateFramebuffers(1, &framebuffer);
+
+	for (auto const r : attachments) {
+		GLenum const format = _resources[r].Desc.Format;
+
+		if (IsDepthFormat(format)) {
+			bool const bStencil = format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+			glNamedFramebufferTexture(framebuffer, bStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+				_resources[r].Texture, 0);
+		}
+		else {
+			GLenum const attachment = GL_COLOR_ATTACHMENT0 + drawBuffers.size();
+			glNamedFramebufferTexture(framebuffer, attachment, _resources[r].Texture, 0);
+			drawBuffers.push_back(attachment);
+		}
+	}
+
+	if (drawBuffers.empty()) {
+		glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+	}
+	else {
+		glNamedFramebufferDrawBuffers(framebuffer, drawBuffers.size(), drawBuffers.data());
+	}
+
+	assert(glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	_framebuffers.emplace(std::move(key), framebuffer);
+	return framebuffer;
+}
+
+void RenderGraph::ReleaseFramebuffers()
+{
+	for (auto const &[ attachments, framebuffer ] : _framebuffers) {
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+	_framebuffers.clear();
+}
+
+void RenderGraph::Execute()
+{
+	auto &state = GLState::Instance();
+
+	for (auto const p : _order) {
+		auto const &pass = _passes[p];
+
+		Profiler::Instance().BeginPass(pass.Name);
+
+		if (pass.Barriers != 0) {
+			glMemoryBarrier(pass.Barriers);
+		}
+
+		// The attachments of a pass drawing to the screen can be read, e.g. by a blit
+		if (pass.bWritesBackbuffer) {
+			state.BindFramebuffer(GL_FRAMEBUFFER, 0);
+			if (pass.Framebuffer != 0) {
+				state.BindFramebuffer(GL_READ_FRAMEBUFFER, pass.Framebuffer);
+			}
+			state.Viewport(0, 0, _displaySize.x, _displaySize.y);
+		}
+		else if (pass.Framebuffer != 0) {
+			glm::ivec2 const size = _resources[pass.Attachments.front()].Size;
+
+			state.BindFramebuffer(GL_FRAMEBUFFER, pass.Framebuffer);
+			state.Viewport(0, 0, size.x, size.y);
+		}
+
+		pass.Execute(Resources(*this, p));
+
+		Profiler::Instance().EndPass();
+	}
+
+	state.BindFramebuffer(GL_FRAMEBUFFER, 0);
+	state.Viewport(0, 0, _displaySize.x, _displaySize.y);
+}
+
+size_t RenderGraph::GetCulledCount() const
+{
+	return _passes.size() - _order.size();
+}
+
+size_t RenderGraph::GetTransientCount() const
+{
+	size_t count = 0;
+	for (auto const &resource : _resources) {
+		count += !resource.bImported;
+	}
+	return count;
+}
+
+size_t RenderGraph::GetTextureBytes() const
+{
+	size_t bytes = 0;
+	for (auto const &texture : _pool) {
+		bytes += static_cast<size_t>(texture.Size.x) * texture.Size.y * FormatBytes(texture.Format);
+	}
+	return bytes;
+}
+
+}
@@ -0,0 +1,218 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <functional>
+#include <map>
+
+namespace engine
+{
+
+///
+/// Format and size of a texture owned by the render graph
+///
+struct TextureDesc
+{
+	GLenum Format = GL_RGBA8;
+	/// Fraction of the display size, used when Size is zero
+	float Scale = 1.0f;
+	glm::ivec2 Size = glm::ivec2(0);
+};
+
+///
+/// Passes of a frame and the textures they exchange
+///
+/// The graph is declared again every frame: each pass tells which textures it reads and
+/// writes, and gives the function recording its commands. Compile() then
+///   - culls the passes whose results are never read, unless they have side effects,
+///   - orders the others after the passes producing their inputs,
+///   - finds the memory barriers needed after storage writes,
+///   - backs every transient texture with a texture of the pool, textures that are not
+///     alive at the same time share one when they have the same format and size.
+///
+/// Writing a texture returns a new handle to it, a version: reading a version makes the
+/// pass depend on the pass that wrote it, and writing over a version keeps its content.
+/// Imported textures, the default framebuffer included, are never aliased and writing
+/// them is a side effect.
+///
+/// The pool outlives the frames. Textures the last frame did not use are released, which
+/// is also how the targets of the old size go away when the display is resized.
+///
+class RenderGraph
+{
+public:
+	using Handle = size_t;
+	static constexpr Handle Invalid = static_cast<Handle>(-1);
+
+	enum class Access
+	{
+		/// Sampled or fetched in a shader, or read by a blit
+		Sampled,
+		/// Attachment of the framebuffer of the pass
+		Attachment,
+		/// Image load and store
+		Storage,
+	};
+
+	///
+	/// What a pass can see of the graph while it records its commands
+	///
+	class Resources
+	{
+	private:
+		RenderGraph const &_graph;
+		size_t _pass;
+
+	public:
+		Resources(RenderGraph const &graph, size_t pass) : _graph(graph), _pass(pass) {}
+
+		/// 0 for the default framebuffer
+		GLuint GetTexture(Handle handle) const;
+		glm::ivec2 GetSize(Handle handle) const;
+		/// Framebuffer of the texture attachments of the pass, 0 when it has none
+		GLuint GetFramebuffer() const;
+	};
+
+	using ExecuteFunc = std::function<void(Resources const &)>;
+
+	///
+	/// Declares the accesses of a pass
+	///
+	class PassBuilder
+	{
+	private:
+		RenderGraph &_graph;
+		size_t _pass;
+
+	public:
+		PassBuilder(RenderGraph &graph, size_t pass) : _graph(graph), _pass(pass) {}
+
+		Handle Read(Handle handle, Access access = Access::Sampled);
+		/// Returns the version written by the pass
+		Handle Write(Handle handle, Access access = Access::Attachment);
+		/// Never cull the pass, e.g. it writes a buffer outside of the graph
+		PassBuilder &SideEffect();
+	};
+
+private:
+	static constexpr size_t NoPass = static_cast<size_t>(-1);
+
+	struct Resource
+	{
+		std::string Name;
+		TextureDesc Desc;
+		glm::ivec2 Size;
+		bool bImported;
+		GLuint Texture;
+		/// Index in _slots, transient textures only
+		size_t Slot;
+		/// Latest version
+		Handle Current;
+	};
+
+	struct Version
+	{
+		size_t Resource;
+		/// Pass that wrote this version, NoPass for the initial content
+		size_t Producer;
+	};
+
+	struct Use
+	{
+		Handle Id;
+		Access Mode;
+		bool bWrite;
+	};
+
+	struct Pass
+	{
+		std::string Name;
+		ExecuteFunc Execute;
+		std::vector<Use> Uses;
+		bool bSideEffect;
+		bool bCulled;
+		bool bWritesBackbuffer;
+		GLbitfield Barriers;
+		/// Texture attachments in declaration order, the color ones get the draw buffers
+		std::vector<size_t> Attachments;
+		GLuint Framebuffer;
+	};
+
+	///
+	/// A texture of the frame, shared by transient resources whose lifetimes do not overlap
+	///
+	struct Slot
+	{
+		GLenum Format;
+		glm::ivec2 Size;
+		/// Order of the last pass using it
+		size_t BusyUntil;
+		GLuint Texture;
+	};
+
+	struct PooledTexture
+	{
+		GLenum Format;
+		glm::ivec2 Size;
+		GLuint Texture;
+		bool bClaimed;
+	};
+
+	glm::ivec2 _displaySize;
+
+	std::vector<Resource> _resources;
+	std::vector<Version> _versions;
+	std::vector<Pass> _passes;
+	std::vector<size_t> _order;
+	std::vector<Slot> _slots;
+
+	std::vector<PooledTexture> _pool;
+	/// Framebuffers by attachments, dropped whenever a pooled texture is released
+	std::map<std::vector<GLuint>, GLuint> _framebuffers;
+
+	Handle AddVersion(size_t resource, size_t producer);
+
+	void Cull();
+	void Sort();
+	void Allocate();
+	void ComputeBarriers();
+	void Materialize();
+	GLuint GetFramebuffer(std::vector<size_t> const &attachments);
+	void ReleaseFramebuffers();
+
+public:
+	RenderGraph() : _displaySize(0) {}
+	~RenderGraph();
+
+	RenderGraph(RenderGraph const &) = delete;
+	void operator=(RenderGraph const &) = delete;
+
+	/// Forget the passes and resources of the last frame, the pool is kept
+	void Reset(glm::ivec2 const &displaySize);
+
+	/// Texture owned by the graph, only alive between its first and last use
+	Handle Create(std::string name, TextureDesc const &desc);
+
+	/// Texture owned elsewhere, 0 being the default framebuffer
+	Handle Import(std::string name, GLuint texture, glm::ivec2 const &size);
+
+	/// Latest version of a resource by name, Invalid when there is none
+	Handle Find(std::string const &name) const;
+
+	/// The pass runs `execute` with its framebuffer bound once the graph is compiled
+	PassBuilder AddPass(std::string name, ExecuteFunc execute);
+
+	void Compile();
+	void Execute();
+
+	size_t GetPassCount() const { return _passes.size(); }
+	size_t GetCulledCount() const;
+	size_t GetTransientCount() const;
+	size_t GetTextureCount() const { return _pool.size(); }
+	/// Memory held by the pool
+	size_t GetTextureBytes() const;
+};
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "lazy.hpp"
+#include "RenderCounters.hpp"
+#include <vector>
+
+namespace engine
+{
+
+///
+/// Numbers published by the renderer for the editor
+///
+struct RenderStats
+{
+	/// Fragment shader invocations, 0 when pipeline statistics are not supported
+	GLuint64 PrepassFragments = 0;
+	GLuint64 GeometryFragments = 0;
+	bool bHasPipelineStatistics = false;
+
+	/// Software occlusion culling, 0 when it is disabled
+	size_t OccluderTriangles = 0;
+	size_t OccludedDraws = 0;
+
+	/// Render graph of the last frame
+	size_t RenderPasses = 0;
+	size_t CulledPasses = 0;
+	size_t TransientTargets = 0;
+	size_t TargetTextures = 0;
+	size_t TargetBytes = 0;
+
+	/// Quality picked by the resolution governor and the GPU time it reacts to
+	float RenderScale = 1.0f;
+	bool bReducedSsao = false;
+	unsigned int ShadowShift = 0;
+	float GpuFrameTime = 0.0f;
+
+	/// Work submitted during the last frame, and by each of its outermost passes
+	RenderCounters Counters;
+	std::vector<PassCounters> Passes;
+
+	static RenderStats &Instance()
+	{
+		static RenderStats stats;
+		return stats;
+	}
+};
+
+}
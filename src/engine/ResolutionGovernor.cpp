@@ -0,0 +1,97 @@
+#include "ResolutionGovernor.hpp"
+#include <algorithm>
+
+namespace engine
+{
+
+ResolutionGovernor::ResolutionGovernor(GovernorSettings const &settings) : _settings(settings), _level(0),
+	_sum(0.0f), _samples(0), _cooldown(0), _average(0.0f)
+{
+	BuildLevels();
+}
+
+void ResolutionGovernor::BuildLevels()
+{
+	float const maxScale = std::clamp(_settings.MaxScale, 0.1f, 1.0f);
+	float const minScale = std::clamp(_settings.MinScale, 0.1f, maxScale);
+	float const step = std::max(_settings.ScaleStep, 0.01f);
+
+	_levels.clear();
+
+	RenderQuality quality;
+	quality.RenderScale = maxScale;
+	_levels.push_back(quality);
+
+	if (!_settings.bEnabled) { return ; }
+
+	while (quality.RenderScale > minScale) {
+		quality.RenderScale = std::max(quality.RenderScale - step, minScale);
+		_levels.push_back(quality);
+	}
+
+	// Effects only go once the resolution cannot go lower
+	if (_settings.bAdjustSsao) {
+		quality.bReducedSsao = true;
+		_levels.push_back(quality);
+	}
+	if (_settings.bAdjustShadows) {
+		for (unsigned int shift = 1; shift <= MaxShadowShift; shift++) {
+			quality.ShadowShift = shift;
+			_levels.push_back(quality);
+		}
+	}
+}
+
+void ResolutionGovernor::SetSettings(GovernorSettings const &settings)
+{
+	RenderQuality const current = GetQuality();
+
+	_settings = settings;
+	BuildLevels();
+
+	auto const same = std::find(_levels.begin(), _levels.end(), current);
+	_level = same != _levels.end() ? std::distance(_levels.begin(), same) : 0;
+
+	_sum = 0.0f;
+	_samples = 0;
+	_cooldown = _settings.Cooldown;
+}
+
+bool ResolutionGovernor::Update(float gpuMilliseconds)
+{
+	if (!_settings.bEnabled || gpuMilliseconds <= 0.0f) { return false; }
+
+	if (_cooldown > 0) {
+		_cooldown--;
+		return false;
+	}
+
+	_sum += gpuMilliseconds;
+	if (++_samples < std::max(_settings.Window, size_t(1))) { return false; }
+
+	_average = _sum / _samples;
+	_sum = 0.0f;
+	_samples = 0;
+
+	size_t next = _level;
+
+	if (_average > _settings.BudgetMs) {
+		next = std::min(_level + 1, _levels.size() - 1);
+	}
+	else if (_level > 0) {
+		float const ratio = _levels[_level - 1].RenderScale / _levels[_level].RenderScale;
+		float const predicted = _average * ratio * ratio;
+
+		if (predicted < _settings.BudgetMs * _settings.Headroom) {
+			next = _level - 1;
+		}
+	}
+
+	if (next == _level) { return false; }
+
+	_level = next;
+	_cooldown = _settings.Cooldown;
+	return true;
+}
+
+}
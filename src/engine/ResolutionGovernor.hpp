@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+namespace engine
+{
+
+///
+/// Knobs turned by the ResolutionGovernor
+///
+struct RenderQuality
+{
+	/// Fraction of the display size the G-buffer, SSAO and lighting are rendered at
+	float RenderScale = 1.0f;
+	/// SSAO at a quarter of the render resolution with half the samples
+	bool bReducedSsao = false;
+	/// Shadow tiers are rendered at their resolution divided by 2^ShadowShift
+	unsigned int ShadowShift = 0;
+
+	bool operator==(RenderQuality const &other) const
+	{
+		return RenderScale == other.RenderScale && bReducedSsao == other.bReducedSsao
+			&& ShadowShift == other.ShadowShift;
+	}
+	bool operator!=(RenderQuality const &other) const { return !(*this == other); }
+};
+
+///
+/// Budget and limits of the ResolutionGovernor
+///
+struct GovernorSettings
+{
+	bool bEnabled = false;
+	float BudgetMs = 16.0f;
+	float MinScale = 0.5f;
+	float MaxScale = 1.0f;
+	float ScaleStep = 0.1f;
+	/// Fraction of the budget the step above must fit in
+	float Headroom = 0.85f;
+	/// Frames averaged for each decision
+	size_t Window = 20;
+	/// Frames ignored after a change
+	size_t Cooldown = 10;
+	bool bAdjustSsao = true;
+	bool bAdjustShadows = true;
+};
+
+///
+/// Keeps the GPU frame time under a budget by lowering the render quality
+///
+/// The qualities form a ladder: the render scale goes from MaxScale down to MinScale by
+/// ScaleStep, then the SSAO and the shadows are reduced if allowed. The average GPU time
+/// of a window of frames moves one step at a time:
+///   - down when it is over the budget,
+///   - up when the time predicted for the step above, assuming it scales with the
+///     number of pixels, is under Headroom times the budget.
+/// The gap between both thresholds and the frames ignored after each change, while the
+/// timer queries still report the old quality, keep it from oscillating.
+///
+/// Disabled, the governor stays on the first step: MaxScale is then a manual render scale.
+///
+class ResolutionGovernor
+{
+public:
+	static constexpr unsigned int MaxShadowShift = 2;
+
+private:
+	GovernorSettings _settings;
+	std::vector<RenderQuality> _levels;
+	size_t _level;
+
+	float _sum;
+	size_t _samples;
+	size_t _cooldown;
+	float _average;
+
+	void BuildLevels();
+
+public:
+	explicit ResolutionGovernor(GovernorSettings const &settings = GovernorSettings());
+
+	/// Keeps the current step when it still exists
+	void SetSettings(GovernorSettings const &settings);
+	GovernorSettings const &GetSettings() const { return _settings; }
+
+	///
+	/// Add the GPU time of a frame
+	///
+	/// Returns true when the quality changed
+	///
+	bool Update(float gpuMilliseconds);
+
+	RenderQuality const &GetQuality() const { return _levels[_level]; }
+
+	/// 0 is the best quality
+	size_t GetLevel() const { return _level; }
+	size_t GetLevelCount() const { return _levels.size(); }
+
+	/// Average of the last complete window
+	float GetAverage() const { return _average; }
+};
+
+}
@@ -1,8 +1,34 @@
 #pragma once
 
-#include "lazy.hpp"
+#include "ShaderProgram.hpp"
+#include <optional>
+#include <tuple>
 #include <memory>
 #include <vector>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+/// Bit `i` turns on the feature `i` of a ShaderPermutationDesc
+using ShaderFeatures = uint32_t;
+
+///
+/// Program compiled once per combination of features
+///
+/// Every feature is defined to 1 or 0 in all the stages, the shaders test them with `#if`
+/// so each variant has no branch on them.
+///
+struct ShaderPermutationDesc
+{
+	std::string VertexPath;
+	std::string FragmentPath;
+	/// Names of the features, in bit order
+	std::vector<std::string> Features;
+	/// Defined in every variant
+	engine::ShaderDefines Defines;
+	/// Called once per variant when it is linked, to set the samplers for instance
+	std::function<void(engine::ShaderProgram &)> OnLinked;
+};
 
 class ShaderManager
 {
@@ -14,29 +40,138 @@ public:
 	ShaderManager(ShaderManager const &) = delete;
 	void operator=(ShaderManager const &) = delete;
 
-	std::tuple<unsigned int, lazy::graphics::Shader&> Create()
+	std::tuple<unsigned int, engine::ShaderProgram&> Create()
+	{
+		Entry entry;
+		entry.Program = std::make_unique<engine::ShaderProgram>();
+
+		_shaders.push_back(std::move(entry));
+
+		return { _shaders.size() - 1, *_shaders.back().Program };
+	}
+
+	/// Register a permutation set, the variants are only built when first used
+	unsigned int CreatePermutations(ShaderPermutationDesc desc)
 	{
-		auto shader = std::make_unique<lazy::graphics::Shader>();
+		Entry entry;
+		entry.Permutations = std::make_unique<ShaderPermutationDesc>(std::move(desc));
 
-		_shaders.push_back(std::move(shader));
+		_shaders.push_back(std::move(entry));
 
-		return { _shaders.size() - 1, *_shaders.back() };
+		return _shaders.size() - 1;
 	}
-	std::optional<lazy::graphics::Shader*> Get(unsigned int id)
+
+	///
+	/// The program `id`, the variant with `features` for a permutation set
+	///
+	/// A variant is linked the first time it is asked for, or waited for when Prepare()
+	/// started it. `features` is ignored for the programs made with Create().
+	///
+	std::optional<engine::ShaderProgram*> Get(unsigned int id, ShaderFeatures features = 0)
 	{
-		std::optional<lazy::graphics::Shader*> shader;
-		if (id < _shaders.size()) {
-			shader = _shaders[id].get();
+		std::optional<engine::ShaderProgram*> shader;
+		if (id >= _shaders.size()) {
+			return shader;
+		}
+
+		auto &entry = _shaders[id];
+
+		if (!entry.Permutations) {
+			shader = entry.Program.get();
+			return shader;
+		}
+
+		auto &variant = GetVariant(entry, features);
+		if (variant.IsPending()) {
+			Finish(entry, variant);
 		}
+
+		shader = &variant;
 		return shader;
 	}
 
+	///
+	/// Start linking a variant without waiting for it
+	///
+	/// The driver compiles it in the background when it has KHR_parallel_shader_compile,
+	/// the next Get() of the variant only waits for what is left.
+	///
+	void Prepare(unsigned int id, ShaderFeatures features)
+	{
+		if (id >= _shaders.size() || !_shaders[id].Permutations) { return ; }
+
+		GetVariant(_shaders[id], features);
+	}
+
+	/// Number of variants built so far
+	size_t GetVariantCount() const
+	{
+		size_t count = 0;
+		for (auto const &entry : _shaders) {
+			count += entry.Variants.size();
+		}
+		return count;
+	}
+
 private:
-	std::vector<std::unique_ptr<lazy::graphics::Shader>> _shaders;
+	struct Entry
+	{
+		/// Programs made with Create()
+		std::unique_ptr<engine::ShaderProgram> Program;
+
+		std::unique_ptr<ShaderPermutationDesc> Permutations;
+		std::unordered_map<ShaderFeatures, std::unique_ptr<engine::ShaderProgram>> Variants;
+	};
+
+	std::vector<Entry> _shaders;
+
+	engine::ShaderProgram &GetVariant(Entry &entry, ShaderFeatures features)
+	{
+		auto &variant = entry.Variants[features];
+		if (variant) {
+			return *variant;
+		}
+
+		auto const &desc = *entry.Permutations;
+
+		variant = std::make_unique<engine::ShaderProgram>();
+
+		for (size_t i = 0; i < desc.Features.size(); i++) {
+			variant->Define(desc.Features[i], features & (1u << i) ? "1" : "0");
+		}
+		for (auto const &[ name, value ] : desc.Defines) {
+			variant->Define(name, value);
+		}
+
+		variant->AddVertexShader(desc.VertexPath)
+			.AddFragmentShader(desc.FragmentPath)
+			.LinkAsync();
+
+		// Loaded from the program cache, or a stage could not be read
+		if (!variant->IsPending()) {
+			Finish(entry, *variant);
+		}
+
+		return *variant;
+	}
+
+	void Finish(Entry &entry, engine::ShaderProgram &variant)
+	{
+		variant.Finish();
+
+		if (variant.IsValid() && entry.Permutations->OnLinked) {
+			entry.Permutations->OnLinked(variant);
+		}
+	}
 
 private:
 	ShaderManager()
 	{
 		_shaders.reserve(10);
+
+		// Let the driver pick the number of compiler threads
+		if (GLEW_KHR_parallel_shader_compile) {
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		}
 	};
 };
@@ -0,0 +1,123 @@
+#include "ShaderPreprocessor.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace engine
+{
+
+ShaderPreprocessor::ShaderPreprocessor(Loader loader) : _loader(std::move(loader))
+{
+}
+
+std::optional<std::string> ShaderPreprocessor::ReadFile(std::string const &path)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) { return std::nullopt; }
+
+	std::stringstream source;
+	source << file.rdbuf();
+	return source.str();
+}
+
+static std::string Directory(std::string const &path)
+{
+	auto const slash = path.find_last_of('/');
+	return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+/// The text after `directive` when `line` starts with it, ignoring the leading blanks
+static std::optional<std::string> Directive(std::string const &line, std::string const &directive)
+{
+	auto const first = line.find_first_not_of(" \t");
+	if (first == std::string::npos || line.compare(first, directive.size(), directive) != 0) { return std::nullopt; }
+
+	return line.substr(first + directive.size());
+}
+
+bool ShaderPreprocessor::Expand(std::string const &path, ShaderDefines const *defines, std::string &output,
+	size_t depth)
+{
+	if (depth > MaxDepth) {
+		_error = "Includes nested too deep in " + path;
+		return false;
+	}
+
+	auto const source = _loader(path);
+	if (!source) {
+		_error = "Could not open " + path;
+		return false;
+	}
+
+	size_t const index = _files.size();
+	_files.push_back(path);
+
+	std::istringstream lines(source.value());
+	std::string line;
+	size_t lineNumber = 0;
+	bool bDefined = false;
+
+	auto const insertDefines = [&] {
+		for (auto const &[ name, value ] : *defines) {
+			output += "#define " + name + " " + value + "\n";
+		}
+		bDefined = true;
+	};
+
+	// The defines go after #version, which has to come first, or at the top without it
+	if (defines && source->find("#version") == std::string::npos) {
+		insertDefines();
+		output += "#line 1 " + std::to_string(index) + "\n";
+	}
+
+	while (std::getline(lines, line)) {
+		lineNumber++;
+
+		auto const include = Directive(line, "#include");
+
+		if (!include) {
+			output += line + "\n";
+
+			if (defines && !bDefined && Directive(line, "#version")) {
+				insertDefines();
+				output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+			}
+			continue ;
+		}
+
+		auto const open = include->find('"');
+		auto const close = open == std::string::npos ? open : include->find('"', open + 1);
+
+		if (close == std::string::npos) {
+			_error = path + ":" + std::to_string(lineNumber) + ": malformed #include";
+			return false;
+		}
+
+		std::string const included = Directory(path) + include->substr(open + 1, close - open - 1);
+
+		if (std::find(_files.begin(), _files.end(), included) != _files.end()) {
+			output += "\n";
+			continue ;
+		}
+
+		output += "#line 1 " + std::to_string(_files.size()) + "\n";
+		if (!Expand(included, nullptr, output, depth + 1)) { return false; }
+		output += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+	}
+
+	return true;
+}
+
+std::optional<std::string> ShaderPreprocessor::Process(std::string const &path, ShaderDefines const &defines)
+{
+	std::string output;
+
+	_files.clear();
+	_error.clear();
+
+	if (!Expand(path, defines.empty() ? nullptr : &defines, output, 0)) { return std::nullopt; }
+
+	return output;
+}
+
+}
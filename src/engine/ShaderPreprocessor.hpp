@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <functional>
+
+namespace engine
+{
+
+/// `#define <first> <second>`, in order
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+///
+/// Expands `#include "file"` in GLSL sources and inserts defines after `#version`
+///
+/// Included paths are relative to the including file. A file is only included once,
+/// like with `#pragma once`, which also breaks include cycles. `#line` directives keep
+/// the compiler errors pointing at the right line: the source string number of a file
+/// is its index in GetFiles().
+///
+class ShaderPreprocessor
+{
+public:
+	using Loader = std::function<std::optional<std::string>(std::string const &path)>;
+
+private:
+	static constexpr size_t MaxDepth = 16;
+
+	Loader _loader;
+	std::vector<std::string> _files;
+	std::string _error;
+
+	bool Expand(std::string const &path, ShaderDefines const *defines, std::string &output, size_t depth);
+
+public:
+	/// `loader` gives the content of a file, the default reads it from the disk
+	explicit ShaderPreprocessor(Loader loader = ReadFile);
+
+	static std::optional<std::string> ReadFile(std::string const &path);
+
+	/// Source of `path` ready to compile, nothing on an error
+	std::optional<std::string> Process(std::string const &path, ShaderDefines const &defines = {});
+
+	/// Files read by the last Process(), the first one is the root
+	std::vector<std::string> const &GetFiles() const { return _files; }
+	std::string const &GetError() const { return _error; }
+};
+
+}
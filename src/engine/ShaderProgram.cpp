@@ -0,0 +1,282 @@
+#include "ShaderProgram.hpp"
+#include "GLState.hpp"
+#include "RenderCounters.hpp"
+#include "ProgramCache.hpp"
+#include "Logger.hpp"
+#include <fmt/format.h>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace engine
+{
+
+ShaderProgram::ShaderProgram() : _program(0), _bMissingStage(false), _bIsValid(false), _bPending(false), _key(0)
+{
+	_program = glCreateProgram();
+}
+
+ShaderProgram::~ShaderProgram()
+{
+	for (auto shader : _shaders) {
+		glDeleteShader(shader);
+	}
+	glDeleteProgram(_program);
+}
+
+ShaderProgram &ShaderProgram::Define(std::string const &name, std::string const &value)
+{
+	_defines.emplace_back(name, value);
+	return *this;
+}
+
+ShaderProgram &ShaderProgram::AddStage(GLenum type, std::string const &path)
+{
+	ShaderPreprocessor preprocessor;
+	auto source = preprocessor.Process(path, _defines);
+
+	if (!source) {
+		Logger::Error("Could not load shader {}: {}\n", path, preprocessor.GetError());
+		_bMissingStage = true;
+		return *this;
+	}
+
+	_stages.push_back({ type, path, std::move(source.value()), preprocessor.GetFiles() });
+	return *this;
+}
+
+ShaderProgram &ShaderProgram::AddVertexShader(std::string const &path)
+{
+	return AddStage(GL_VERTEX_SHADER, path);
+}
+
+ShaderProgram &ShaderProgram::AddFragmentShader(std::string const &path)
+{
+	return AddStage(GL_FRAGMENT_SHADER, path);
+}
+
+ShaderProgram &ShaderProgram::AddGeometryShader(std::string const &path)
+{
+	return AddStage(GL_GEOMETRY_SHADER, path);
+}
+
+ShaderProgram &ShaderProgram::AddComputeShader(std::string const &path)
+{
+	return AddStage(GL_COMPUTE_SHADER, path);
+}
+
+void ShaderProgram::Submit()
+{
+	// No status is queried here, with KHR_parallel_shader_compile that would wait for the
+	// compiler threads
+	for (auto const &stage : _stages) {
+		char const *code = stage.Source.c_str();
+
+		GLuint shader = glCreateShader(stage.Type);
+		glShaderSource(shader, 1, &code, nullptr);
+		glCompileShader(shader);
+		glAttachShader(_program, shader);
+
+		_shaders.push_back(shader);
+	}
+
+	glProgramParameteri(_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(_program);
+}
+
+bool ShaderProgram::Check()
+{
+	bool bCompiled = true;
+
+	for (size_t i = 0; i < _shaders.size(); i++) {
+		GLint status = GL_FALSE;
+		glGetShaderiv(_shaders[i], GL_COMPILE_STATUS, &status);
+
+		if (status != GL_TRUE) {
+			GLint length = 0;
+			glGetShaderiv(_shaders[i], GL_INFO_LOG_LENGTH, &length);
+
+			std::string log(length, '\0');
+			glGetShaderInfoLog(_shaders[i], length, nullptr, log.data());
+
+			std::string files;
+			for (size_t file = 0; file < _stages[i].Files.size(); file++) {
+				files += fmt::format("  source {} = {}\n", file, _stages[i].Files[file]);
+			}
+
+			Logger::Error("Failed to compile {}:\n{}\n{}", _stages[i].Path, log, files);
+			bCompiled = false;
+		}
+	}
+
+	for (auto shader : _shaders) {
+		glDetachShader(_program, shader);
+		glDeleteShader(shader);
+	}
+	_shaders.clear();
+
+	if (!bCompiled) { return false; }
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(_program, GL_LINK_STATUS, &status);
+
+	if (status != GL_TRUE) {
+		GLint length = 0;
+		glGetProgramiv(_program, GL_INFO_LOG_LENGTH, &length);
+
+		std::string log(length, '\0');
+		glGetProgramInfoLog(_program, length, nullptr, log.data());
+
+		Logger::Error("Failed to link program:\n{}\n", log);
+		return false;
+	}
+
+	return true;
+}
+
+ShaderProgram &ShaderProgram::Link()
+{
+	return LinkAsync().Finish();
+}
+
+ShaderProgram &ShaderProgram::LinkAsync()
+{
+	// A link still in flight is finished first, its shaders are reused otherwise
+	if (_bPending) { Finish(); }
+
+	_uniformLocations.clear();
+	_bIsValid = false;
+
+	if (_bMissingStage || _stages.empty()) {
+		_stages.clear();
+		_defines.clear();
+		_bMissingStage = false;
+		return *this;
+	}
+
+	auto &cache = ProgramCache::Instance();
+	std::string sources;
+
+	for (auto const &stage : _stages) {
+		sources += std::to_string(stage.Type) + "\n" + stage.Source;
+	}
+
+	_key = cache.GetKey(sources);
+
+	if (cache.Load(_program, _key)) {
+		_bIsValid = true;
+		_stages.clear();
+		_defines.clear();
+		return *this;
+	}
+
+	_buildStart = std::chrono::steady_clock::now();
+	Submit();
+	_bPending = true;
+	return *this;
+}
+
+ShaderProgram &ShaderProgram::Finish()
+{
+	if (!_bPending) { return *this; }
+
+	_bPending = false;
+	_bIsValid = Check();
+
+	if (_bIsValid) {
+		// Includes the time spent on other work while the driver compiled in the background
+		auto const end = std::chrono::steady_clock::now();
+		ProgramCache::Instance().Store(_program, _key, std::chrono::duration<float, std::milli>(end - _buildStart).count());
+	}
+
+	_stages.clear();
+	_defines.clear();
+	return *this;
+}
+
+bool ShaderProgram::IsReady() const
+{
+	if (!_bPending || !GLEW_KHR_parallel_shader_compile) { return true; }
+
+	GLint bCompleted = GL_FALSE;
+	glGetProgramiv(_program, GL_COMPLETION_STATUS_KHR, &bCompleted);
+	return bCompleted == GL_TRUE;
+}
+
+void ShaderProgram::Bind() const
+{
+	GLState::Instance().UseProgram(_program);
+}
+
+void ShaderProgram::Dispatch(GLuint groupsX, GLuint groupsY, GLuint groupsZ) const
+{
+	glDispatchCompute(groupsX, groupsY, groupsZ);
+}
+
+GLint ShaderProgram::GetUniformLocation(std::string const &name)
+{
+	auto it = _uniformLocations.find(name);
+
+	if (it != _uniformLocations.end()) {
+		return it->second;
+	}
+
+	GLint const location = glGetUniformLocation(_program, name.c_str());
+	_uniformLocations[name] = location;
+
+	return location;
+}
+
+void ShaderProgram::SetUniform1i(std::string const &name, GLint value)
+{
+	gl::CountUniforms();
+	glProgramUniform1i(_program, GetUniformLocation(name), value);
+}
+
+void ShaderProgram::SetUniform1ui(std::string const &name, GLuint value)
+{
+	gl::CountUniforms();
+	glProgramUniform1ui(_program, GetUniformLocation(name), value);
+}
+
+void ShaderProgram::SetUniform1f(std::string const &name, GLfloat value)
+{
+	gl::CountUniforms();
+	glProgramUniform1f(_program, GetUniformLocation(name), value);
+}
+
+void ShaderProgram::SetUniform2f(std::string const &name, glm::vec2 const &value)
+{
+	gl::CountUniforms();
+	glProgramUniform2f(_program, GetUniformLocation(name), value.x, value.y);
+}
+
+void ShaderProgram::SetUniform3f(std::string const &name, glm::vec3 const &value)
+{
+	gl::CountUniforms();
+	glProgramUniform3f(_program, GetUniformLocation(name), value.x, value.y, value.z);
+}
+
+void ShaderProgram::SetUniform3ui(std::string const &name, glm::uvec3 const &value)
+{
+	gl::CountUniforms();
+	glProgramUniform3ui(_program, GetUniformLocation(name), value.x, value.y, value.z);
+}
+
+void ShaderProgram::SetUniform4f(std::string const &name, glm::vec4 const &value)
+{
+	gl::CountUniforms();
+	glProgramUniform4f(_program, GetUniformLocation(name), value.x, value.y, value.z, value.w);
+}
+
+void ShaderProgram::SetUniform4fv(std::string const &name, GLsizei count, glm::vec4 const *values)
+{
+	gl::CountUniforms();
+	glProgramUniform4fv(_program, GetUniformLocation(name), count, glm::value_ptr(values[0]));
+}
+
+void ShaderProgram::SetUniform4x4f(std::string const &name, glm::mat4 const &value)
+{
+	gl::CountUniforms();
+	glProgramUniformMatrix4fv(_program, GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+}
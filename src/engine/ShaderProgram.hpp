@@ -0,0 +1,106 @@
+#pragma once
+
+#include "lazy.hpp"
+#include "ShaderPreprocessor.hpp"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+
+namespace engine
+{
+
+///
+/// A GLSL program built from source files
+///
+///   program.AddVertexShader("shaders/foo.vs.glsl").AddFragmentShader("shaders/foo.fs.glsl").Link();
+///
+/// The stages are only read when added, they are compiled by Link() and only if the
+/// ProgramCache has no binary of the program. The sources go through ShaderPreprocessor:
+/// `#include "file"` is expanded and the defines are inserted after `#version`.
+///
+/// LinkAsync() returns before the driver is done when it has KHR_parallel_shader_compile,
+/// the program is usable once Finish() returned.
+///
+class ShaderProgram
+{
+private:
+	struct Stage
+	{
+		GLenum Type;
+		std::string Path;
+		std::string Source;
+		/// Source string numbers of the compiler errors, see ShaderPreprocessor
+		std::vector<std::string> Files;
+	};
+
+	GLuint _program;
+	std::vector<Stage> _stages;
+	ShaderDefines _defines;
+	/// A stage could not be read, the program cannot be linked
+	bool _bMissingStage;
+	bool _bIsValid;
+
+	/// Link started by LinkAsync() and not finished yet
+	bool _bPending;
+	std::vector<GLuint> _shaders;
+	uint64_t _key;
+	std::chrono::steady_clock::time_point _buildStart;
+
+	std::unordered_map<std::string, GLint> _uniformLocations;
+
+	ShaderProgram &AddStage(GLenum type, std::string const &path);
+	/// Compile the stages and link them without waiting for the driver
+	void Submit();
+	/// Wait for the submitted stages, false if compiling or linking failed
+	bool Check();
+
+public:
+	ShaderProgram();
+	~ShaderProgram();
+
+	ShaderProgram(ShaderProgram const &) = delete;
+	void operator=(ShaderProgram const &) = delete;
+
+	/// `#define name value` in the stages added after it
+	ShaderProgram &Define(std::string const &name, std::string const &value = "1");
+
+	ShaderProgram &AddVertexShader(std::string const &path);
+	ShaderProgram &AddFragmentShader(std::string const &path);
+	ShaderProgram &AddGeometryShader(std::string const &path);
+	ShaderProgram &AddComputeShader(std::string const &path);
+
+	/// Link the stages added so far, from the program cache when possible, errors are logged
+	ShaderProgram &Link();
+	/// Like Link() but Finish() has to be called before using the program
+	ShaderProgram &LinkAsync();
+	/// Wait for the link started by LinkAsync()
+	ShaderProgram &Finish();
+
+	/// Finish() would not wait, always true without KHR_parallel_shader_compile
+	bool IsReady() const;
+	bool IsPending() const { return _bPending; }
+
+	/// Make the program current through the state cache
+	void Bind() const;
+
+	/// Run a compute program, the program must be bound
+	void Dispatch(GLuint groupsX, GLuint groupsY = 1, GLuint groupsZ = 1) const;
+
+	bool IsValid() const { return _bIsValid; }
+	GLuint GetId() const { return _program; }
+
+	GLint GetUniformLocation(std::string const &name);
+
+	void SetUniform1i(std::string const &name, GLint value);
+	void SetUniform1ui(std::string const &name, GLuint value);
+	void SetUniform1f(std::string const &name, GLfloat value);
+	void SetUniform2f(std::string const &name, glm::vec2 const &value);
+	void SetUniform3f(std::string const &name, glm::vec3 const &value);
+	void SetUniform3ui(std::string const &name, glm::uvec3 const &value);
+	void SetUniform4f(std::string const &name, glm::vec4 const &value);
+	void SetUniform4fv(std::string const &name, GLsizei count, glm::vec4 const *values);
+	void SetUniform4x4f(std::string const &name, glm::mat4 const &value);
+};
+
+}
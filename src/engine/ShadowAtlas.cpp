@@ -0,0 +1,386 @@
+#include "ShadowAtlas.hpp"
+#include "GLState.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace engine
+{
+
+/// Score multiplier of lights that already own a slot, keeps them from swapping every frame
+static constexpr float HysteresisFactor = 1.25f;
+
+/// Weight of the distance a light moved against the number of frames a face waited
+static constexpr float MovementWeight = 0.5f;
+
+static float const ClearDepth = 1.0f;
+
+ShadowAtlas::ShadowAtlas() : _framebuffer(0), _depthFormat(DepthFormat::Depth16), _filter(Filter::Poisson),
+	_resolutionShift(0),
+	_faceBudget(DefaultFaceBudget), _frame(0), _bStaticDirty(true),
+	_renderedFaces(0), _pendingFaces(0)
+{
+	_shader.AddVertexShader("shaders/shadowface.vs.glsl")
+		.AddFragmentShader("shaders/shadow.fs.glsl")
+		.Link();
+	assert(_shader.IsValid());
+
+	for (size_t tier = 0; tier < Tiers.size(); tier++) {
+		_tiers[tier].Slots.resize(Tiers[tier].Slots);
+	}
+	CreateTextures();
+
+	glCreateFramebuffers(1, &_framebuffer);
+	glNamedFramebufferDrawBuffer(_framebuffer, GL_NONE);
+	glNamedFramebufferReadBuffer(_framebuffer, GL_NONE);
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+	glDeleteFramebuffers(1, &_framebuffer);
+	DestroyTextures();
+}
+
+void ShadowAtlas::CreateTextures()
+{
+	GLenum const format = _depthFormat == DepthFormat::Depth16 ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT32F;
+
+	for (size_t tier = 0; tier < Tiers.size(); tier++) {
+		unsigned int const resolution = GetResolution(tier);
+		unsigned int const slots = Tiers[tier].Slots;
+		auto &data = _tiers[tier];
+
+		for (GLuint *texture : { &data.StaticArray, &data.Array }) {
+			glCreateTextures(GL_TEXTURE_CUBE_MAP_ARRAY, 1, texture);
+			glTextureStorage3D(*texture, 1, format, resolution, resolution, slots * 6);
+			glTextureParameteri(*texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(*texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(*texture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+			glClearTexImage(*texture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &ClearDepth);
+		}
+
+		// Hardware PCF: the lookup compares and filters the four nearest texels
+		glTextureParameteri(data.Array, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(data.Array, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(data.Array, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTextureParameteri(data.Array, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		// Only copied from, never sampled
+		glTextureParameteri(data.StaticArray, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(data.StaticArray, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	}
+}
+
+void ShadowAtlas::DestroyTextures()
+{
+	for (auto &data : _tiers) {
+		glDeleteTextures(1, &data.StaticArray);
+		glDeleteTextures(1, &data.Array);
+	}
+}
+
+void ShadowAtlas::SetDepthFormat(DepthFormat format)
+{
+	if (format == _depthFormat) { return ; }
+
+	_depthFormat = format;
+	RecreateTextures();
+}
+
+void ShadowAtlas::SetResolutionShift(unsigned int shift)
+{
+	if (shift == _resolutionShift) { return ; }
+
+	_resolutionShift = shift;
+	RecreateTextures();
+}
+
+void ShadowAtlas::RecreateTextures()
+{
+	// The new textures may reuse the names of the deleted ones
+	GLState::Instance().Invalidate();
+
+	DestroyTextures();
+	CreateTextures();
+
+	for (auto &data : _tiers) {
+		for (auto &slot : data.Slots) {
+			slot.Faces = {};
+			for (auto &face : slot.Faces) {
+				face.DirtySince = _frame;
+			}
+		}
+	}
+}
+
+void ShadowAtlas::SetSlotPosition(Slot &slot, glm::vec3 const &position)
+{
+	static std::array<std::pair<glm::vec3, glm::vec3>, 6> const directions = {{
+		{ glm::vec3( 1.0f, 0.0f, 0.0f), glm::vec3(0.0f,-1.0f, 0.0f) },
+		{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f,-1.0f, 0.0f) },
+		{ glm::vec3( 0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) },
+		{ glm::vec3( 0.0f,-1.0f, 0.0f), glm::vec3(0.0f, 0.0f,-1.0f) },
+		{ glm::vec3( 0.0f, 0.0f, 1.0f), glm::vec3(0.0f,-1.0f, 0.0f) },
+		{ glm::vec3( 0.0f, 0.0f,-1.0f), glm::vec3(0.0f,-1.0f, 0.0f) },
+	}};
+	static glm::mat4 const projection = glm::perspective(glm::radians(90.0f), 1.0f, NearPlane, FarPlane);
+
+	slot.Position = position;
+
+	for (size_t face = 0; face < 6; face++) {
+		auto const &[ forward, up ] = directions[face];
+
+		slot.Matrices[face] = projection * glm::lookAt(position, position + forward, up);
+		slot.Frustums[face] = Frustum(slot.Matrices[face]);
+	}
+}
+
+void ShadowAtlas::MarkFaces(Slot &slot, bool staticDirty, float movement)
+{
+	for (auto &face : slot.Faces) {
+		if (!face.StaticDirty && !face.DynamicDirty) {
+			face.DirtySince = _frame;
+		}
+		face.StaticDirty |= staticDirty;
+		face.DynamicDirty = true;
+		face.Movement += movement;
+	}
+}
+
+std::vector<ShadowAtlas::Assignment> const &ShadowAtlas::Assign(std::vector<Request> const &requests)
+{
+	// Rank the lights, the ones that already own a slot are favoured
+	std::vector<std::pair<float, size_t>> ranking;
+	ranking.reserve(requests.size());
+
+	for (size_t i = 0; i < requests.size(); i++) {
+		float score = requests[i].Score;
+
+		if (score <= 0.0f) { continue ; }
+		if (_lights.find(requests[i].Id) != _lights.end()) {
+			score *= HysteresisFactor;
+		}
+		ranking.emplace_back(score, i);
+	}
+
+	std::sort(ranking.begin(), ranking.end(), [] (auto const &a, auto const &b) {
+		return a.first > b.first;
+	});
+
+	// Fill the tiers in order
+	std::vector<int> desiredTier(requests.size(), -1);
+	size_t tier = 0;
+	size_t used = 0;
+
+	for (auto const &[ score, i ] : ranking) {
+		while (tier < Tiers.size() && used >= Tiers[tier].Slots) {
+			tier++;
+			used = 0;
+		}
+		if (tier >= Tiers.size()) { break ; }
+
+		desiredTier[i] = static_cast<int>(tier);
+		used++;
+	}
+
+	// Release the slots of the lights that are gone or changed tier
+	std::unordered_map<unsigned int, Assignment> kept;
+
+	for (size_t i = 0; i < requests.size(); i++) {
+		auto it = _lights.find(requests[i].Id);
+
+		if (it != _lights.end() && it->second.Tier == desiredTier[i]) {
+			kept.insert(*it);
+		}
+	}
+	for (auto const &[ id, assignment ] : _lights) {
+		if (kept.find(id) == kept.end()) {
+			_tiers[assignment.Tier].Slots[assignment.Layer].Light = -1;
+		}
+	}
+	_lights = std::move(kept);
+
+	_assignments.assign(requests.size(), Assignment{});
+
+	for (size_t i = 0; i < requests.size(); i++) {
+		auto const &request = requests[i];
+
+		if (desiredTier[i] < 0) { continue ; }
+
+		auto it = _lights.find(request.Id);
+
+		if (it == _lights.end()) {
+			auto &slots = _tiers[desiredTier[i]].Slots;
+			auto freeSlot = std::find_if(slots.begin(), slots.end(), [] (Slot const &slot) {
+				return slot.Light < 0;
+			});
+			assert(freeSlot != slots.end());
+
+			Assignment assignment;
+				assignment.Tier = desiredTier[i];
+				assignment.Layer = static_cast<int>(std::distance(slots.begin(), freeSlot));
+
+			freeSlot->Light = request.Id;
+			freeSlot->Faces = {};
+			for (auto &face : freeSlot->Faces) {
+				face.DirtySince = _frame;
+			}
+			SetSlotPosition(*freeSlot, request.Position);
+
+			// Do not show the shadow of the previous owner until the faces are rendered
+			unsigned int const resolution = GetResolution(assignment.Tier);
+			glClearTexSubImage(_tiers[assignment.Tier].Array, 0, 0, 0, assignment.Layer * 6,
+				resolution, resolution, 6, GL_DEPTH_COMPONENT, GL_FLOAT, &ClearDepth);
+
+			it = _lights.emplace(request.Id, assignment).first;
+		}
+		else {
+			auto &slot = _tiers[it->second.Tier].Slots[it->second.Layer];
+
+			if (slot.Position != request.Position) {
+				float const movement = glm::distance(slot.Position, request.Position);
+
+				SetSlotPosition(slot, request.Position);
+				MarkFaces(slot, true, movement);
+			}
+		}
+
+		_assignments[i] = it->second;
+	}
+
+	return _assignments;
+}
+
+void ShadowAtlas::RenderFace(size_t tier, size_t slotIndex, size_t faceIndex,
+	DrawQueue &staticCasters, DrawQueue &dynamicCasters)
+{
+	auto &state = GLState::Instance();
+	auto &data = _tiers[tier];
+	auto &slot = data.Slots[slotIndex];
+	auto &face = slot.Faces[faceIndex];
+
+	GLint const layer = static_cast<GLint>(slotIndex * 6 + faceIndex);
+	GLsizei const resolution = GetResolution(tier);
+
+	state.Viewport(0, 0, resolution, resolution);
+	_shader.Bind();
+	_shader.SetUniform4x4f("shadowMatrix", slot.Matrices[faceIndex]);
+	_shader.SetUniform1f("far_plane", FarPlane);
+	_shader.SetUniform3f("lightPos", slot.Position);
+
+	if (face.StaticDirty) {
+		glNamedFramebufferTextureLayer(_framebuffer, GL_DEPTH_ATTACHMENT, data.StaticArray, 0, layer);
+		state.BindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		staticCasters.DrawVisible(slot.Frustums[faceIndex]);
+	}
+
+	// Restore the static casters before drawing the dynamic ones on top
+	glCopyImageSubData(data.StaticArray, GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, layer,
+		data.Array, GL_TEXTURE_CUBE_MAP_ARRAY, 0, 0, 0, layer,
+		resolution, resolution, 1);
+
+	if (dynamicCasters.GetDrawCount() > 0) {
+		glNamedFramebufferTextureLayer(_framebuffer, GL_DEPTH_ATTACHMENT, data.Array, 0, layer);
+		state.BindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+
+		dynamicCasters.DrawVisible(slot.Frustums[faceIndex]);
+	}
+
+	face = Face{};
+	face.StaticDirty = false;
+	face.DynamicDirty = false;
+	face.Empty = false;
+}
+
+void ShadowAtlas::Update(DrawQueue &staticCasters, DrawQueue &dynamicCasters, std::vector<Aabb> const &changedBounds)
+{
+	_frame++;
+
+	for (auto &data : _tiers) {
+		for (auto &slot : data.Slots) {
+
+			if (slot.Light < 0) { continue ; }
+
+			if (_bStaticDirty) {
+				MarkFaces(slot, true, 0.0f);
+				continue ;
+			}
+
+			for (size_t i = 0; i < 6; i++) {
+				auto &face = slot.Faces[i];
+
+				for (auto const &bounds : changedBounds) {
+					if (slot.Frustums[i].Intersects(bounds)) {
+						if (!face.StaticDirty && !face.DynamicDirty) {
+							face.DirtySince = _frame;
+						}
+						face.DynamicDirty = true;
+						face.Movement += glm::distance(bounds.Min, bounds.Max);
+						break ;
+					}
+				}
+			}
+		}
+	}
+	_bStaticDirty = false;
+
+	// Pick the most urgent faces
+	struct Candidate
+	{
+		float Priority;
+		size_t Tier;
+		size_t Slot;
+		size_t Face;
+	};
+	std::vector<Candidate> candidates;
+
+	for (size_t tier = 0; tier < _tiers.size(); tier++) {
+		auto const &slots = _tiers[tier].Slots;
+
+		for (size_t slot = 0; slot < slots.size(); slot++) {
+
+			if (slots[slot].Light < 0) { continue ; }
+
+			for (size_t i = 0; i < 6; i++) {
+				auto const &face = slots[slot].Faces[i];
+
+				if (!face.StaticDirty && !face.DynamicDirty) { continue ; }
+
+				float const priority = face.Empty
+					? std::numeric_limits<float>::max()
+					: static_cast<float>(_frame - face.DirtySince) + MovementWeight * face.Movement;
+
+				candidates.push_back(Candidate{ priority, tier, slot, i });
+			}
+		}
+	}
+
+	size_t const count = std::min(candidates.size(), _faceBudget);
+
+	std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+		[] (Candidate const &a, Candidate const &b) {
+			return a.Priority > b.Priority;
+		});
+
+	_renderedFaces = count;
+	_pendingFaces = candidates.size() - count;
+
+	if (count == 0) { return ; }
+
+	auto &state = GLState::Instance();
+
+	state.DepthTest(true);
+	state.DepthWrite(true);
+	state.Blend(false);
+
+	for (size_t i = 0; i < count; i++) {
+		auto const &candidate = candidates[i];
+
+		RenderFace(candidate.Tier, candidate.Slot, candidate.Face, staticCasters, dynamicCasters);
+	}
+}
+
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <array>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "DrawQueue.hpp"
+#include "Frustum.hpp"
+#include "ShaderProgram.hpp"
+
+namespace engine
+{
+
+///
+/// Omnidirectional shadows of many point lights stored in cubemap arrays
+///
+/// The atlas has a few resolution tiers, each one a cubemap array with a fixed number of
+/// slots. Lights are ranked by a score computed by the caller (screen coverage times
+/// intensity and luminance) and the best ones get a slot in the highest tiers.
+///
+/// Every face of a slot keeps its own dirty state and at most `FaceBudget` faces are
+/// rendered each frame, the most stale and the ones that moved the most first.
+/// Static casters are cached in a separate array so that a face only invalidated by a
+/// dynamic caster is restored with a copy before the dynamic casters are drawn again.
+///
+/// The arrays are sampled with hardware depth comparison and bilinear filtering, the
+/// lighting shader takes a few of these taps on a rotated Poisson disk (see Filter).
+///
+class ShadowAtlas
+{
+public:
+	struct Tier
+	{
+		unsigned int Resolution;
+		unsigned int Slots;
+	};
+
+	static constexpr std::array<Tier, 3> Tiers = {{
+		{ 1024, 4 },
+		{ 512, 12 },
+		{ 256, 48 },
+	}};
+
+	static constexpr float NearPlane = 1.0f;
+	static constexpr float FarPlane = 1000.0f;
+
+	/// Faces rendered per frame unless changed with SetFaceBudget()
+	static constexpr size_t DefaultFaceBudget = 24;
+
+	enum class DepthFormat
+	{
+		Depth16,
+		Depth32F,
+	};
+
+	///
+	/// Shadow filtering quality, each tap is a 2x2 hardware PCF
+	///
+	enum class Filter
+	{
+		/// A single tap
+		Hard,
+		/// Four taps on a rotated Poisson disk
+		Poisson,
+		/// Twelve taps on a wider rotated Poisson disk
+		PoissonWide,
+	};
+
+	struct FilterSettings
+	{
+		char const *Name;
+		/// Taps near the camera, halved each `TapDistance` units further away
+		int Taps;
+		/// Radius of the disk in world units
+		float Radius;
+		float TapDistance;
+	};
+
+	static constexpr std::array<FilterSettings, 3> Filters = {{
+		{ "Hard",         1,  0.0f,  0.0f },
+		{ "Poisson",      4,  0.1f,  20.0f },
+		{ "Poisson wide", 12, 0.2f,  20.0f },
+	}};
+
+	///
+	/// A light that wants a shadow
+	///
+	struct Request
+	{
+		unsigned int Id;
+		glm::vec3 Position;
+		/// Lights with the highest score get the best resolution, 0 means no shadow
+		float Score;
+	};
+
+	///
+	/// Where the shadow of a light lives, layer is the cube index in the tier's array
+	///
+	struct Assignment
+	{
+		int Tier = -1;
+		int Layer = -1;
+
+		bool IsValid() const { return Tier >= 0; }
+	};
+
+private:
+	struct Face
+	{
+		bool StaticDirty = true;
+		bool DynamicDirty = true;
+		/// Nothing was rendered yet, the face holds garbage
+		bool Empty = true;
+		uint64_t DirtySince = 0;
+		float Movement = 0.0f;
+	};
+
+	struct Slot
+	{
+		/// Id of the light using the slot, -1 when free
+		int64_t Light = -1;
+		glm::vec3 Position;
+		std::array<Face, 6> Faces;
+		std::array<glm::mat4, 6> Matrices;
+		std::array<Frustum, 6> Frustums;
+	};
+
+	struct TierData
+	{
+		/// Static casters only
+		GLuint StaticArray = 0;
+		/// Static and dynamic casters, sampled when lighting
+		GLuint Array = 0;
+		std::vector<Slot> Slots;
+	};
+
+	std::array<TierData, Tiers.size()> _tiers;
+	std::unordered_map<unsigned int, Assignment> _lights;
+	std::vector<Assignment> _assignments;
+
+	ShaderProgram _shader;
+	GLuint _framebuffer;
+
+	DepthFormat _depthFormat;
+	Filter _filter;
+	unsigned int _resolutionShift;
+
+	size_t _faceBudget;
+	uint64_t _frame;
+	bool _bStaticDirty;
+
+	size_t _renderedFaces;
+	size_t _pendingFaces;
+
+	void CreateTextures();
+	void DestroyTextures();
+	void RecreateTextures();
+	void SetSlotPosition(Slot &slot, glm::vec3 const &position);
+	void MarkFaces(Slot &slot, bool staticDirty, float movement);
+	void RenderFace(size_t tier, size_t slot, size_t face, DrawQueue &staticCasters, DrawQueue &dynamicCasters);
+
+public:
+	ShadowAtlas();
+	~ShadowAtlas();
+
+	ShadowAtlas(ShadowAtlas const &) = delete;
+	void operator=(ShadowAtlas const &) = delete;
+
+	/// Render the static casters of every face again
+	void Invalidate() { _bStaticDirty = true; }
+
+	void SetFaceBudget(size_t faces) { _faceBudget = faces; }
+
+	/// Reallocate the arrays with another depth format, every face is rendered again
+	void SetDepthFormat(DepthFormat format);
+	DepthFormat GetDepthFormat() const { return _depthFormat; }
+
+	/// Divide the resolution of every tier by 2^shift, every face is rendered again
+	void SetResolutionShift(unsigned int shift);
+	unsigned int GetResolutionShift() const { return _resolutionShift; }
+	unsigned int GetResolution(size_t tier) const { return Tiers[tier].Resolution >> _resolutionShift; }
+
+	void SetFilter(Filter filter) { _filter = filter; }
+	Filter GetFilter() const { return _filter; }
+	FilterSettings const &GetFilterSettings() const { return Filters[static_cast<size_t>(_filter)]; }
+
+	///
+	/// Give a slot to the best lights of the frame
+	///
+	/// Returns the assignment of each request, in the same order
+	///
+	std::vector<Assignment> const &Assign(std::vector<Request> const &requests);
+
+	///
+	/// Render the most urgent dirty faces within the budget
+	///
+	/// `changedBounds` holds the world bounds, before and after the move, of every
+	/// dynamic caster that changed since the last update
+	///
+	void Update(DrawQueue &staticCasters, DrawQueue &dynamicCasters, std::vector<Aabb> const &changedBounds);
+
+	GLuint GetTexture(size_t tier) const { return _tiers[tier].Array; }
+
+	/// Faces rendered by the last update
+	size_t GetRenderedFaces() const { return _renderedFaces; }
+
+	/// Dirty faces left for the next frames
+	size_t GetPendingFaces() const { return _pendingFaces; }
+};
+
+}
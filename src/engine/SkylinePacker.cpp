@@ -0,0 +1,93 @@
+#include "SkylinePacker.hpp"
+#include <algorithm>
+
+namespace engine
+{
+
+SkylinePacker::SkylinePacker(int width, int height) : _width(width), _height(height)
+{
+	_skyline.push_back({ 0, 0, width });
+}
+
+std::optional<int> SkylinePacker::Fit(size_t index, int width, int height) const
+{
+	int const x = _skyline[index].X;
+
+	if (x + width > _width) { return std::nullopt; }
+
+	int y = 0;
+	int remaining = width;
+
+	for (size_t i = index; remaining > 0; i++) {
+		y = std::max(y, _skyline[i].Y);
+		if (y + height > _height) { return std::nullopt; }
+
+		remaining -= _skyline[i].Width;
+	}
+
+	return y;
+}
+
+std::optional<SkylinePacker::Position> SkylinePacker::Pack(int width, int height)
+{
+	if (width <= 0 || height <= 0) { return Position{ 0, 0 }; }
+
+	size_t best = _skyline.size();
+	int bestTop = 0;
+	int bestY = 0;
+
+	for (size_t i = 0; i < _skyline.size(); i++) {
+		auto const y = Fit(i, width, height);
+
+		if (!y) { continue ; }
+
+		// Lowest top first, then the leftmost
+		if (best == _skyline.size() || *y + height < bestTop) {
+			best = i;
+			bestTop = *y + height;
+			bestY = *y;
+		}
+	}
+
+	if (best == _skyline.size()) { return std::nullopt; }
+
+	Position const position{ _skyline[best].X, bestY };
+
+	// The new segment covers the ones under the rectangle, the last one may be cut
+	_skyline.insert(_skyline.begin() + best, Segment{ position.X, bestTop, width });
+
+	int const right = position.X + width;
+	size_t i = best + 1;
+
+	while (i < _skyline.size() && _skyline[i].X < right) {
+		int const end = _skyline[i].X + _skyline[i].Width;
+
+		if (end <= right) {
+			_skyline.erase(_skyline.begin() + i);
+			continue ;
+		}
+
+		_skyline[i].Width = end - right;
+		_skyline[i].X = right;
+		break ;
+	}
+
+	// Neighbours at the same height become one segment
+	for (size_t j = 0; j + 1 < _skyline.size();) {
+		if (_skyline[j].Y == _skyline[j + 1].Y) {
+			_skyline[j].Width += _skyline[j + 1].Width;
+			_skyline.erase(_skyline.begin() + j + 1);
+			continue ;
+		}
+		j++;
+	}
+
+	return position;
+}
+
+void SkylinePacker::Grow(int height)
+{
+	_height = std::max(_height, height);
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+
+namespace engine
+{
+
+///
+/// Packs rectangles in a fixed-width area, e.g. the glyphs of a texture atlas
+///
+/// The top of the packed rectangles is kept as a skyline, a list of horizontal segments.
+/// A rectangle goes where its top ends the lowest, resting on the segments below it
+/// (bottom-left rule). Rectangles cannot be freed, the area can only grow taller.
+///
+class SkylinePacker
+{
+public:
+	struct Position
+	{
+		int X;
+		int Y;
+	};
+
+private:
+	struct Segment
+	{
+		int X;
+		int Y;
+		int Width;
+	};
+
+	int _width;
+	int _height;
+	std::vector<Segment> _skyline;
+
+	/// Lowest y at which a rectangle of `width` fits when its left edge is on segment `index`
+	std::optional<int> Fit(size_t index, int width, int height) const;
+
+public:
+	SkylinePacker(int width, int height);
+
+	///
+	/// Find room for a `width` x `height` rectangle
+	///
+	/// Returns its top-left corner, or nothing when the area is full
+	///
+	std::optional<Position> Pack(int width, int height);
+
+	/// Make the area taller, the packed rectangles stay where they are
+	void Grow(int height);
+
+	int GetWidth() const { return _width; }
+	int GetHeight() const { return _height; }
+};
+
+}
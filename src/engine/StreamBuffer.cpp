@@ -0,0 +1,107 @@
+#include "StreamBuffer.hpp"
+#include "RenderCounters.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+
+namespace engine
+{
+
+StreamBuffer::StreamBuffer() : _buffer(0), _mapping(nullptr), _regionSize(0), _region(0), _head(0), _fences{},
+	_uniformAlignment(256), _storageAlignment(256)
+{
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &_uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &_storageAlignment);
+
+	Create(InitialRegionSize);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+	for (auto &fence : _fences) {
+		if (fence) {
+			glDeleteSync(fence);
+		}
+	}
+	glDeleteBuffers(_retired.size(), _retired.data());
+	glDeleteBuffers(1, &_buffer);
+}
+
+void StreamBuffer::Create(size_t regionSize)
+{
+	GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	// Nothing is pending on a new buffer
+	for (auto &fence : _fences) {
+		if (fence) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	if (_buffer) {
+		_retired.push_back(_buffer);
+	}
+
+	_regionSize = regionSize;
+	_region = 0;
+	_head = 0;
+
+	glCreateBuffers(1, &_buffer);
+	glNamedBufferStorage(_buffer, _regionSize * FramesInFlight, nullptr, flags);
+	_mapping = static_cast<std::byte *>(glMapNamedBufferRange(_buffer, 0, _regionSize * FramesInFlight, flags));
+}
+
+void StreamBuffer::Wait(GLsync &fence)
+{
+	if (!fence) { return ; }
+
+	// Flush once, in case the fence is still in the command queue of this context
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+	while (true) {
+		GLenum const status = glClientWaitSync(fence, flags, 1000000);
+
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) {
+			break ;
+		}
+		flags = 0;
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+StreamBuffer::Allocation StreamBuffer::Allocate(size_t size, size_t alignment)
+{
+	size_t const base = _region * _regionSize;
+	size_t offset = (base + _head + alignment - 1) / alignment * alignment;
+
+	if (offset + size > base + _regionSize) {
+		size_t const regionSize = std::max(_regionSize * 2, size + alignment);
+
+		Logger::Verbose("Stream buffer regions grow to {} KiB\n", regionSize >> 10);
+		Create(regionSize);
+		offset = (_head + alignment - 1) / alignment * alignment;
+	}
+
+	_head = offset + size - _region * _regionSize;
+
+	gl::CountBufferBytes(size);
+
+	return { _mapping + offset, _buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size) };
+}
+
+void StreamBuffer::EndFrame()
+{
+	_fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	_region = (_region + 1) % FramesInFlight;
+	_head = 0;
+	Wait(_fences[_region]);
+
+	// No allocation of the frame that ended points at them anymore
+	glDeleteBuffers(_retired.size(), _retired.data());
+	_retired.clear();
+}
+
+}
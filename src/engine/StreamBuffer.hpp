@@ -0,0 +1,98 @@
+#pragma once
+
+#include "lazy.hpp"
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+
+namespace engine
+{
+
+///
+/// Ring of persistently mapped memory for the data rewritten every frame
+///
+/// The buffer is split in FramesInFlight regions. A frame suballocates from its own
+/// region and writes straight into the mapping: it is coherent, so there is no flush, no
+/// copy in the driver and no implicit synchronization. EndFrame() fences the region and
+/// moves on to the next one, only waiting if the GPU still reads it from three frames ago.
+///
+/// A frame asking for more than a region grows the ring. The old buffer stays alive until
+/// the end of the frame, allocations made before keep pointing at it.
+///
+class StreamBuffer
+{
+public:
+	static constexpr size_t FramesInFlight = 3;
+
+	struct Allocation
+	{
+		void *Data = nullptr;
+		GLuint Buffer = 0;
+		GLintptr Offset = 0;
+		GLsizeiptr Size = 0;
+
+		bool IsValid() const { return Data != nullptr; }
+	};
+
+private:
+	static constexpr size_t InitialRegionSize = 4 << 20;
+
+	GLuint _buffer;
+	std::byte *_mapping;
+	size_t _regionSize;
+
+	size_t _region;
+	/// Offset of the next allocation in the current region
+	size_t _head;
+	std::array<GLsync, FramesInFlight> _fences;
+
+	/// Replaced by a bigger buffer during the frame
+	std::vector<GLuint> _retired;
+
+	GLint _uniformAlignment;
+	GLint _storageAlignment;
+
+	StreamBuffer();
+
+	void Create(size_t regionSize);
+	void Wait(GLsync &fence);
+
+public:
+	static StreamBuffer &Instance()
+	{
+		static StreamBuffer buffer;
+		return buffer;
+	}
+
+	StreamBuffer(StreamBuffer const &) = delete;
+	void operator=(StreamBuffer const &) = delete;
+
+	~StreamBuffer();
+
+	///
+	/// Room for `size` bytes in the current frame, the offset is a multiple of `alignment`
+	///
+	Allocation Allocate(size_t size, size_t alignment = 16);
+
+	/// Copy `count` elements in the current frame, aligned on their size
+	template <typename T>
+	Allocation Upload(T const *data, size_t count, size_t alignment = sizeof(T))
+	{
+		Allocation allocation = Allocate(count * sizeof(T), alignment);
+		std::copy(data, data + count, static_cast<T *>(allocation.Data));
+		return allocation;
+	}
+
+	/// Offset alignments of glBindBufferRange
+	size_t GetUniformAlignment() const { return _uniformAlignment; }
+	size_t GetStorageAlignment() const { return _storageAlignment; }
+
+	/// Fence what the frame wrote and move to the next region
+	void EndFrame();
+
+	size_t GetRegionSize() const { return _regionSize; }
+	size_t GetUsedBytes() const { return _head; }
+};
+
+}
@@ -1,10 +1,14 @@
 #include "Texture.hpp"
 #include "stb_image.h"
+#include "RenderCounters.hpp"
 #include <fmt/format.h>
+#include <algorithm>
+#include <cmath>
+#include "GLState.hpp"
 
 Texture::Texture(std::string const &name, GLenum target) : _name(name), _target(target)
 {
-	glGenTextures(1, &_glId);
+	glCreateTextures(target, 1, &_glId);
 }
 
 Texture::Texture(Texture &&rhs)
@@ -30,48 +34,48 @@ bool Texture::load(std::string const &path)
 	unsigned char *data = stbi_load(path.c_str(), &_width, &_height, &_nChannel, 0);
 
 	if (data) {
-		GLuint format = 3;
+		GLenum internalFormat = GL_RGBA8;
+		GLenum format = GL_RGBA;
 
-		if (_nChannel == 3) {
-			if (_srgb) {
-				format = GL_SRGB;
-			}
-			else {
-				format = GL_RGB;
-			}
-		}
-		else if (_nChannel == 4) {
-			if (_srgb) {
-				format = GL_SRGB_ALPHA;
-			}
-			else {
-				format = GL_RGBA;
-			}
+		switch (_nChannel) {
+		case 1:
+			internalFormat = GL_R8;
+			format = GL_RED;
+			break ;
+		case 2:
+			internalFormat = GL_RG8;
+			format = GL_RG;
+			break ;
+		case 3:
+			internalFormat = _srgb ? GL_SRGB8 : GL_RGB8;
+			format = GL_RGB;
+			break ;
+		default:
+			internalFormat = _srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+			format = GL_RGBA;
+			break ;
 		}
 
-		float outFormat;
-		if      (format == GL_SRGB) { outFormat = GL_RGB; }
-		else if (format == GL_SRGB_ALPHA) { outFormat = GL_RGBA; }
-		else { outFormat = format; }
+		GLsizei const levels = 1 + static_cast<GLsizei>(std::floor(std::log2(std::max(_width, _height))));
 
-		glTexImage2D(GL_TEXTURE_2D, 0,
-			format, _width, _height, 0,
-			outFormat, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		// Direct state access, loading a texture does not disturb the bindings
+		glTextureStorage2D(_glId, levels, internalFormat, _width, _height);
+		// stb_image rows are tightly packed
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		engine::gl::TextureSubImage2D(_glId, 0, 0, 0, _width, _height, format, GL_UNSIGNED_BYTE, data);
+		glGenerateTextureMipmap(_glId);
 		stbi_image_free(data);
 		return true;
 	}
 	return false;
 }
 
-void Texture::setParameter(GLenum target, GLenum param, GLenum value)
+void Texture::setParameter(GLenum, GLenum param, GLenum value)
 {
-	glBindTexture(GL_TEXTURE_2D, _glId);
-	glTexParameteri(target, param, value);
+	glTextureParameteri(_glId, param, value);
 }
 
 void Texture::bind(GLuint textureNumber)
 {
-	glActiveTexture(GL_TEXTURE0 + textureNumber);
-	glBindTexture(_target, _glId);
+	engine::GLState::Instance().BindTexture(textureNumber, _glId);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lazy.hpp"
+#include "GLState.hpp"
 #include <exception>
 #include <optional>
 
@@ -30,12 +31,8 @@ public:
 		Bind();
 	}
 
-	~TextureAutoBind()
-	{
-		if (_bIsBound && _texture.has_value()) {
-			Unbind();
-		}
-	}
+	/// The texture is left bound, the next bind of the unit replaces it
+	~TextureAutoBind() = default;
 
 	TextureAutoBind(TextureAutoBind &&other)
 	{
@@ -74,8 +71,7 @@ public:
 	{
 		if (_bIsBound) {
 			_bIsBound = false;
-			glActiveTexture(_unit);
-			glBindTexture(_target, 0);
+			engine::GLState::Instance().BindTexture(_unit, 0);
 		}
 		else throw std::runtime_error("Tried to unbind an unbound texture");
 	}
@@ -87,8 +83,7 @@ public:
 		}
 		if (!_bIsBound) {
 			_bIsBound = true;
-			glActiveTexture(_unit);
-			glBindTexture(_target, _texture.value());
+			engine::GLState::Instance().BindTexture(_unit, _texture.value());
 		}
 		else throw std::runtime_error("Tried to bind a bound texture");
 	}
@@ -1,4 +1,5 @@
 #include "TextureManager.hpp"
+#include "Logger.hpp"
 #include <fmt/format.h>
 
 void TextureManager::createTexture(std::string const &name, std::string const &path,
@@ -8,7 +9,6 @@ void TextureManager::createTexture(std::string const &name, std::string const &p
 
 	_textures[name] = std::make_unique<Texture>(name, target);
 
-	_textures[name]->bind(GL_TEXTURE0);
 	for (auto const &p : parameters) {
 		_textures[name]->setParameter(GL_TEXTURE_2D, p.first, p.second);
 	}
@@ -29,3 +29,21 @@ void TextureManager::add(std::string const &name, Texture t)
 	auto pTexture = std::make_unique<Texture>(std::move(t));
 	_textures[name] = std::move(pTexture);
 }
+
+GLuint TextureManager::get(std::string const &name) const
+{
+	auto it = _textures.find(name);
+
+	if (it == _textures.end()) {
+		Logger::Warn("Texture {} does not exist\n", name);
+		return 0;
+	}
+	return it->second->id();
+}
+
+bool TextureManager::hasAlpha(std::string const &name) const
+{
+	auto it = _textures.find(name);
+
+	return it != _textures.end() && it->second->nChannel() == 4;
+}
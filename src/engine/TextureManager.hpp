@@ -1,6 +1,6 @@
 #pragma once
 
-#include <map>
+#include <unordered_map>
 #include <string>
 #include <memory>
 #include "Texture.hpp"
@@ -19,10 +19,13 @@ public:
 		std::vector<std::pair<GLenum, GLenum>>, GLenum target, bool srgb = false);
 	void bind(std::string const &name, GLuint textureNumber);
 	void add(std::string const &name, Texture t);
-	GLuint get(std::string const &name) { return _textures[name]->id(); }
+	/// 0 when there is no such texture
+	GLuint get(std::string const &name) const;
+	/// True if the texture was loaded with an alpha channel
+	bool hasAlpha(std::string const &name) const;
 
 private:
-	std::map<std::string, std::unique_ptr<Texture>> _textures;
+	std::unordered_map<std::string, std::unique_ptr<Texture>> _textures;
 
 private:
 	TextureManager() {};
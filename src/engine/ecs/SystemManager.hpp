@@ -2,13 +2,30 @@
 
 #include <memory>
 #include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <typeinfo>
 #include <type_traits>
 #include "System.hpp"
 
+#ifdef __GNUG__
+# include <cxxabi.h>
+#endif
+
 namespace ecs {
 
 class ECSEngine;
 
+///
+/// CPU time of the last update of a system
+///
+struct SystemTiming
+{
+	std::string Name;
+	float Milliseconds = 0.0f;
+};
+
 class SystemManager_Impl
 {
 	friend class SystemManager;
@@ -17,8 +34,27 @@ private:
 	SystemManager_Impl() = default;
 
 	std::vector<std::unique_ptr<ISystemBase>> Systems;
+	std::vector<SystemTiming> Timings;
 	EntityManager *EntityMgr;
 
+	template <typename T>
+	static std::string SystemName()
+	{
+		std::string name = typeid(T).name();
+
+#ifdef __GNUG__
+		int status = 0;
+		char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+
+		if (status == 0) {
+			name = demangled;
+		}
+		free(demangled);
+#endif
+
+		return name;
+	}
+
 	template <typename T>
 	void InstantiateSystem()
 	{
@@ -30,12 +66,19 @@ private:
 		newSystem->EntityMgr = EntityMgr;
 
 		Systems.push_back(std::move(newSystem));
+		Timings.push_back({ SystemName<T>() });
 	}
 
 	void Update(float deltaTime)
 	{
-		for (auto &s : Systems) {
-			s->OnUpdate(deltaTime);
+		using Clock = std::chrono::steady_clock;
+
+		for (size_t i = 0; i < Systems.size(); i++) {
+			auto const start = Clock::now();
+
+			Systems[i]->OnUpdate(deltaTime);
+
+			Timings[i].Milliseconds = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
 		}
 	}
 };
@@ -64,6 +107,12 @@ public:
 	{
 		Manager.Update(deltaTime);
 	}
+
+	/// Systems in update order
+	std::vector<SystemTiming> const &GetTimings() const
+	{
+		return Manager.Timings;
+	}
 };
 
 }
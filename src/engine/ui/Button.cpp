@@ -1,5 +1,5 @@
 #include "Button.hpp"
-#include "TextureManager.hpp"
+#include "UIAtlas.hpp"
 #include "Anchor.hpp"
 #include "TextComponent.hpp"
 
@@ -10,18 +10,9 @@ Button::Button(IUIScene *scene) : ASceneComponent(scene)
 
 void Button::setup(glm::vec2 size, Anchor anchorPoint)
 {
-	TextureManager::instance().createTexture("Button", "img/button.png", {
-		{ GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE },
-		{ GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE },
-		{ GL_TEXTURE_MIN_FILTER, GL_NEAREST },
-		{ GL_TEXTURE_MAG_FILTER, GL_NEAREST }
-	}, GL_TEXTURE_2D);
-	TextureManager::instance().createTexture("ButtonHovering", "img/button_hover.png", {
-		{ GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE },
-		{ GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE },
-		{ GL_TEXTURE_MIN_FILTER, GL_NEAREST },
-		{ GL_TEXTURE_MAG_FILTER, GL_NEAREST }
-	}, GL_TEXTURE_2D);
+	_region = UIAtlas::instance().add("Button", "img/button.png");
+	_hoveringRegion = UIAtlas::instance().add("ButtonHovering", "img/button_hover.png");
+	_isHovering = false;
 
 	setAnchor(anchorPoint);
 	setOrigin(Origin::Center);
@@ -34,44 +25,10 @@ void Button::setup(glm::vec2 size, Anchor anchorPoint)
 	_label->setAnchor(Anchor::Center);
 	_label->setText("Hello");
 
-	buildMesh();
-
 	_canBeClicked = true;
 	lazy::inputs::input::getMouse().attach(this);
 }
 
-void Button::buildMesh()
-{
-	glm::vec3 quad[] = {
-		glm::vec3(0.0f,               0.0f,               0.0f),
-		glm::vec3(0.0f + getSize().x, 0.0f,               0.0f),
-		glm::vec3(0.0f + getSize().x, 0.0f + getSize().y, 0.0f),
-		glm::vec3(0.0f,               0.0f + getSize().y, 0.0f),
-	};
-	glm::uvec3 inds[] = {
-		glm::uvec3(0, 1, 2),
-		glm::uvec3(0, 2, 3),
-	};
-	glm::vec2 tex[] = {
-		glm::vec2(0.0f, 0.0f),
-		glm::vec2(1.0f, 0.0f),
-		glm::vec2(1.0f, 1.0f),
-		glm::vec2(0.0f, 1.0f),
-	};
-
-	_mesh = Mesh();
-	for (auto const &p : quad) {
-		_mesh.addPosition(p);
-	}
-	for (auto const &i : inds) {
-		_mesh.addTriangle(i);
-	}
-	for (auto const &t : tex) {
-		_mesh.addUv(t);
-	}
-	_mesh.build();
-}
-
 Button::~Button()
 {
 }
@@ -80,15 +37,9 @@ void Button::update()
 {
 }
 
-void Button::draw(Shader &shader)
+void Button::draw(UIBatch &batch, glm::vec2 position)
 {
-	if (_isHovering) {
-		TextureManager::instance().bind("ButtonHovering", GL_TEXTURE0);
-	}
-	else {
-		TextureManager::instance().bind("Button", GL_TEXTURE0);
-	}
-	_mesh.draw();
+	batch.addQuad(position, position + getSize(), _isHovering ? _hoveringRegion : _region, UIBatch::Mode::Image);
 }
 
 void Button::setText(std::string const &text)
@@ -104,7 +55,10 @@ void Button::onClickUpInside()
 
 void Button::onHover(bool val)
 {
+	if (val == _isHovering) { return ; }
+
 	_isHovering = val;
+	invalidate();
 }
 
 glm::vec4 Button::getObservedArea() const
@@ -0,0 +1,171 @@
+#include "GlyphAtlas.hpp"
+#include "RenderCounters.hpp"
+#include "GLState.hpp"
+#include <iostream>
+#include <vector>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+struct GlyphAtlas::FreeType {
+	FT_Library library = nullptr;
+	FT_Face face = nullptr;
+};
+
+GlyphAtlas::GlyphAtlas() : _freeType(std::make_unique<FreeType>()), _texture(0), _packer(Width, Width)
+{
+	if (FT_Init_FreeType(&_freeType->library)) {
+		std::cout << "ERROR::FREETYPE: Could not init FreeType library" << std::endl;
+	}
+	else if (FT_New_Face(_freeType->library, "./fonts/MinecraftRegular-Bmg3.otf", 0, &_freeType->face)) {
+		std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+		_freeType->face = nullptr;
+	}
+	else {
+		FT_Set_Pixel_Sizes(_freeType->face, 0, PixelSize);
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &_texture);
+	glTextureStorage2D(_texture, 1, GL_R8, _packer.GetWidth(), _packer.GetHeight());
+	glTextureParameteri(_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// The padding has to be empty
+	GLubyte const zero = 0;
+	glClearTexImage(_texture, 0, GL_RED, GL_UNSIGNED_BYTE, &zero);
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	glDeleteTextures(1, &_texture);
+	engine::GLState::Instance().Invalidate();
+
+	if (_freeType->face) {
+		FT_Done_Face(_freeType->face);
+	}
+	if (_freeType->library) {
+		FT_Done_FreeType(_freeType->library);
+	}
+}
+
+GlyphAtlas::Glyph const &GlyphAtlas::get(char32_t codepoint)
+{
+	auto const glyph = _glyphs.find(codepoint);
+
+	if (glyph != _glyphs.end()) {
+		return glyph->second;
+	}
+	return rasterize(codepoint);
+}
+
+GlyphAtlas::Glyph const &GlyphAtlas::rasterize(char32_t codepoint)
+{
+	Glyph &glyph = _glyphs[codepoint];
+	glyph = Glyph{ glm::ivec2(0), glm::ivec2(0), glm::ivec2(0), 0 };
+
+	FT_Face const face = _freeType->face;
+
+	if (!face || FT_Load_Char(face, codepoint, FT_LOAD_RENDER)) {
+		std::cout << "ERROR::FREETYTPE: Failed to load Glyph " << static_cast<uint32_t>(codepoint) << std::endl;
+		return glyph;
+	}
+
+	FT_Bitmap const &bitmap = face->glyph->bitmap;
+	glm::ivec2 const size(bitmap.width, bitmap.rows);
+
+	glyph.bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+	glyph.advance = static_cast<GLuint>(face->glyph->advance.x);
+
+	// Spaces only advance
+	if (size.x == 0 || size.y == 0) { return glyph; }
+
+	auto position = _packer.Pack(size.x + Padding, size.y + Padding);
+
+	while (!position && grow()) {
+		position = _packer.Pack(size.x + Padding, size.y + Padding);
+	}
+	if (!position) {
+		std::cout << "ERROR::FREETYPE: Glyph atlas is full" << std::endl;
+		return glyph;
+	}
+
+	glyph.position = glm::ivec2(position->X, position->Y);
+	glyph.size = size;
+
+	GLint alignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, bitmap.pitch);
+	engine::gl::TextureSubImage2D(_texture, 0, glyph.position.x, glyph.position.y, size.x, size.y,
+		GL_RED, GL_UNSIGNED_BYTE, bitmap.buffer);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+	return glyph;
+}
+
+bool GlyphAtlas::grow()
+{
+	int const oldHeight = _packer.GetHeight();
+
+	if (oldHeight * 2 > MaxHeight) { return false; }
+
+	_packer.Grow(oldHeight * 2);
+
+	GLuint texture;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, GL_R8, _packer.GetWidth(), _packer.GetHeight());
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	GLubyte const zero = 0;
+	glClearTexImage(texture, 0, GL_RED, GL_UNSIGNED_BYTE, &zero);
+	glCopyImageSubData(_texture, GL_TEXTURE_2D, 0, 0, 0, 0, texture, GL_TEXTURE_2D, 0, 0, 0, 0,
+		_packer.GetWidth(), oldHeight, 1);
+
+	glDeleteTextures(1, &_texture);
+	engine::GLState::Instance().Invalidate();
+
+	_texture = texture;
+	return true;
+}
+
+char32_t nextCodepoint(std::string const &text, size_t &i)
+{
+	char32_t const replacement = 0xFFFD;
+	unsigned char const lead = text[i++];
+
+	if (lead < 0x80) { return lead; }
+
+	size_t length;
+	char32_t codepoint;
+
+	if ((lead & 0xE0) == 0xC0) {
+		length = 1;
+		codepoint = lead & 0x1F;
+	}
+	else if ((lead & 0xF0) == 0xE0) {
+		length = 2;
+		codepoint = lead & 0x0F;
+	}
+	else if ((lead & 0xF8) == 0xF0) {
+		length = 3;
+		codepoint = lead & 0x07;
+	}
+	else {
+		return replacement;
+	}
+
+	for (size_t n = 0; n < length; n++) {
+		if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80) {
+			return replacement;
+		}
+		codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[i++]) & 0x3F);
+	}
+
+	return codepoint;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <lazy.hpp>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include "SkylinePacker.hpp"
+
+///
+/// Glyphs of the UI font, rasterized on demand into one texture
+///
+/// A glyph is rendered by FreeType the first time it is asked for and packed in the
+/// atlas with a skyline packer. When the atlas is full it doubles in height, which
+/// moves no glyph: their positions in texels stay valid, only the texture changes.
+///
+class GlyphAtlas
+{
+public:
+	struct Glyph {
+		/// Top-left corner in the atlas, in pixels
+		glm::ivec2 position;
+		glm::ivec2 size;
+		glm::ivec2 bearing;
+		/// In 1/64th of a pixel
+		GLuint advance;
+	};
+
+	static constexpr int PixelSize = 48;
+
+private:
+	static constexpr int Width = 512;
+	static constexpr int MaxHeight = 4096;
+	/// Empty texels around each glyph, so that filtering never picks a neighbour
+	static constexpr int Padding = 1;
+
+	struct FreeType;
+	std::unique_ptr<FreeType> _freeType;
+
+	GLuint _texture;
+	engine::SkylinePacker _packer;
+	std::unordered_map<char32_t, Glyph> _glyphs;
+
+	GlyphAtlas();
+
+	Glyph const &rasterize(char32_t codepoint);
+	bool grow();
+
+public:
+	static GlyphAtlas &instance()
+	{
+		static GlyphAtlas atlas;
+		return atlas;
+	}
+
+	GlyphAtlas(GlyphAtlas const &) = delete;
+	void operator=(GlyphAtlas const &) = delete;
+
+	~GlyphAtlas();
+
+	Glyph const &get(char32_t codepoint);
+
+	GLuint getTexture() const { return _texture; }
+};
+
+/// Codepoint starting at `i`, which moves past it. Malformed sequences give U+FFFD.
+char32_t nextCodepoint(std::string const &text, size_t &i);
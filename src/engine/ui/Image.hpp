@@ -2,10 +2,7 @@
 
 #include "SceneComponent.hpp"
 #include <glm/glm.hpp>
-#include "lazy.hpp"
-#include "TextureManager.hpp"
-
-using lazy::graphics::Mesh;
+#include "UIAtlas.hpp"
 
 class Image : public ASceneComponent
 {
@@ -16,50 +13,19 @@ public:
 
 	void setImage(float width, float height, std::string const &path)
 	{
-		TextureManager::instance().createTexture(path, path, {
-			{ GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE },
-			{ GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE },
-			{ GL_TEXTURE_MIN_FILTER, GL_NEAREST },
-			{ GL_TEXTURE_MAG_FILTER, GL_NEAREST },
-		});
 		// TODO: use a UUID rather than the path
-		_textureName = path;
+		_region = UIAtlas::instance().add(path, path);
 
-		_quad = Mesh();
 		setSize(glm::vec2(width, height));
-		std::array<glm::vec3, 4> verts = {
-			glm::vec3(-(width / 2.0f), -(height / 2.0f), 0.0f),
-			glm::vec3( (width / 2.0f), -(height / 2.0f), 0.0f),
-			glm::vec3( (width / 2.0f),  (height / 2.0f), 0.0f),
-			glm::vec3(-(width / 2.0f),  (height / 2.0f), 0.0f),
-		};
-
-		std::array<glm::vec3, 4> tex = {
-			glm::vec3(  0.0f,   0.0f, 0.0f ),
-			glm::vec3(  1.0f,   0.0f, 0.0f ),
-			glm::vec3(  1.0f,   1.0f, 0.0f ),
-			glm::vec3(  0.0f,   1.0f, 0.0f ),
-		};
-
-		for (auto const &v : verts) {
-			_quad.addPosition(v);
-		}
-		for (auto const &t : tex) {
-			_quad.addUv(t);
-		}
-
-		_quad.addTriangle(glm::uvec3(0, 1, 2))
-			 .addTriangle(glm::uvec3(0, 2, 3));
-		_quad.build();
 	}
 
-	void draw(Shader &shader) override
+	void draw(UIBatch &batch, glm::vec2 position) override
 	{
-		TextureManager::instance().bind(_textureName, GL_TEXTURE0);
-		_quad.draw();
+		glm::vec2 const halfSize = getSize() / 2.0f;
+
+		batch.addQuad(position - halfSize, position + halfSize, _region, UIBatch::Mode::Image);
 	}
 
 private:
-	Mesh _quad;
-	std::string _textureName;
+	glm::vec4 _region;
 };
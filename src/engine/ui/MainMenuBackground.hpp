@@ -1,10 +1,6 @@
 #pragma once
 
 #include "SceneComponent.hpp"
-#include "TextureManager.hpp"
-#include "lazy.hpp"
-
-using lazy::graphics::Mesh;
 
 class IUIScene;
 
@@ -13,13 +9,14 @@ class MainMenuBackground : public ASceneComponent
 public:
 	MainMenuBackground(IUIScene *parent);
 
-	void draw(Shader &shader) override
+	void draw(UIBatch &batch, glm::vec2 position) override
 	{
-		TextureManager::instance().bind("MenuBackground", GL_TEXTURE0);
-		_background.draw();
+		// The tile repeats every 64 pixels
+		batch.addQuad(position, position + _size, _region, UIBatch::Mode::TiledImage,
+			glm::vec4(1.0f), glm::vec2(0.0f), _size / 64.0f);
 	}
 
 private:
 	glm::vec2 _size;
-	Mesh _background;
+	glm::vec4 _region;
 };
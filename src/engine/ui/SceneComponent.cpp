@@ -7,9 +7,15 @@ void ASceneComponent::call(std::string const &funcName)
 	_scene->call(funcName);
 }
 
+void ASceneComponent::invalidate()
+{
+	_scene->invalidate();
+}
+
 void ASceneComponent::setSize(glm::vec2 size)
 {
 	_size = size;
+	invalidate();
 }
 
 glm::vec2 ASceneComponent::getScreenPosition() const
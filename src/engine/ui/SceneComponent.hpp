@@ -5,10 +5,10 @@
 #include <glm/glm.hpp>
 #include "Anchor.hpp"
 #include "lazy.hpp"
+#include "UIBatch.hpp"
 
 using namespace anchor;
 using Origin = Anchor;
-using lazy::graphics::Shader;
 
 class IUIScene;
 
@@ -21,7 +21,8 @@ public:
 
 	virtual ~ASceneComponent() {}
 	virtual void update() {};
-	virtual void draw(Shader &shader) = 0;
+	/// Add the quads of the component, `position` is its origin on the screen
+	virtual void draw(UIBatch &batch, glm::vec2 position) = 0;
 
 	glm::vec2 getSize() const { return _size; }
 	Anchor getAnchor() const { return _anchor; }
@@ -31,10 +32,10 @@ public:
 	glm::vec4 getColor() { return _color; }
 
 	void setSize(glm::vec2 size);
-	void setOrigin(Origin origin) { _origin = origin; }
-	void setAnchor(Anchor anchor) { _anchor = anchor; }
-	void setOffset(glm::vec2 off) { _offset = off; }
-	void setColor(glm::vec4 color) { _color = color; }
+	void setOrigin(Origin origin) { _origin = origin; invalidate(); }
+	void setAnchor(Anchor anchor) { _anchor = anchor; invalidate(); }
+	void setOffset(glm::vec2 off) { _offset = off; invalidate(); }
+	void setColor(glm::vec4 color) { _color = color; invalidate(); }
 
 	std::vector<std::shared_ptr<ASceneComponent>> &getSubComponents() {
 		return _subComponents;
@@ -48,6 +49,7 @@ protected:
 		auto component = std::make_shared<T>(_scene, std::forward<Args>(args)...);
 
 		_subComponents.push_back(component);
+		invalidate();
 		return component;
 	}
 
@@ -56,6 +58,11 @@ protected:
 	 */
 	void call(std::string const &funcName);
 
+	/*
+	 * The quads of the scene must be built again before the next render
+	 */
+	void invalidate();
+
 private:
 	std::vector<std::shared_ptr<ASceneComponent>> _subComponents;
 	IUIScene *_scene;
@@ -18,7 +18,7 @@ public:
 	{
 	}
 
-	void draw(Shader &shader) override
+	void draw(UIBatch &, glm::vec2) override
 	{
 	}
 };
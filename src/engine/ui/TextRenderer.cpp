@@ -1,6 +1,6 @@
 #include "TextRenderer.hpp"
-#include <ft2build.h>
-#include FT_FREETYPE_H
+#include "GlyphAtlas.hpp"
+#include <algorithm>
 
 using namespace anchor;
 
@@ -8,137 +8,63 @@ TextRenderer::TextRenderer(float width, float height)
 {
 	_width = width;
 	_height = height;
-	setup();
 }
 
-void TextRenderer::setup()
+void TextRenderer::layout(std::string const &text, GLfloat scale, Anchor anchor)
 {
-	GLfloat texCoords [6][2] = {
-		{ 0.0, 0.0 },
-		{ 0.0, 1.0 },
-		{ 1.0, 1.0 },
+	auto &atlas = GlyphAtlas::instance();
 
-		{ 0.0, 0.0 },
-		{ 1.0, 1.0 },
-		{ 1.0, 0.0 }
-	};
-
-	glGenVertexArrays(1, &_vao);
-	glGenBuffers(1, &_vbo);
-	glGenBuffers(1, &_ubo);
-
-	glBindVertexArray(_vao);
+	std::vector<GlyphAtlas::Glyph const *> glyphs;
+	float textWidth = 0.0f;
+	float maxHeight = 0.0f;
 
-	glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * 6 * 2, nullptr, GL_DYNAMIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 2, 0);
+	for (size_t i = 0; i < text.size();) {
+		GlyphAtlas::Glyph const &glyph = atlas.get(nextCodepoint(text, i));
 
-	glBindBuffer(GL_ARRAY_BUFFER, _ubo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(texCoords), texCoords, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 2, 0);
+		glyphs.push_back(&glyph);
+		textWidth += (glyph.advance >> 6) * scale;
+		maxHeight = std::max(maxHeight, glyph.bearing.y * scale);
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
+	// Calculate anchor offset to align text to the desired side
+	glm::vec2 pos = calculateOffset(anchor, glm::vec2(textWidth, maxHeight));
 
-	FT_Library lib;
-	if (FT_Init_FreeType(&lib)) {
-		std::cout << "ERROR::FREETYPE: Could not init FreeType library" << std::endl;
-		return ;
-	}
-	FT_Face face;
-	if (FT_New_Face(lib, "./fonts/MinecraftRegular-Bmg3.otf", 0, &face)) {
-		std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
-		return ;
-	}
-	FT_Set_Pixel_Sizes(face, 0, 48);
+	_layout.quads.clear();
+	for (auto const *glyph : glyphs)
+	{
+		GLfloat xpos = pos.x + glyph->bearing.x * scale;
+		GLfloat ypos = pos.y - (glyph->size.y - glyph->bearing.y) * scale;
 
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		GLfloat w = glyph->size.x * scale;
+		GLfloat h = glyph->size.y * scale;
 
-	for (GLubyte c = 0; c < 128; c++) {
-		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-			std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-			continue ;
-		}
-		GLuint texture;
+		// Now advance cursors for next glyph (note that advance is number of 1/64 pixels)
+		pos.x += (glyph->advance >> 6) * scale; // Bitshift by 6 to get value in pixels (2^6 = 64)
 
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED,
-			face->glyph->bitmap.width, face->glyph->bitmap.rows,
-			0, GL_RED, GL_UNSIGNED_BYTE, face->glyph->bitmap.buffer);
-		    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		if (glyph->size.x == 0 || glyph->size.y == 0) { continue ; }
 
-		Character character = {
-			texture,
-			glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-			glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-			static_cast<GLuint>(face->glyph->advance.x)
-		};
-		_characters.insert(std::pair<GLchar, Character>(c, character));
+		_layout.quads.push_back({
+			glm::vec2(xpos, ypos),
+			glm::vec2(xpos + w, ypos + h),
+			glm::vec4(glyph->position, glyph->size),
+		});
 	}
 
-	FT_Done_Face(face);
-	FT_Done_FreeType(lib);
+	_layout.text = text;
+	_layout.scale = scale;
+	_layout.anchor = anchor;
 }
 
-void TextRenderer::drawText(std::string text, GLfloat scale, glm::vec3 color, Anchor anchor)
+void TextRenderer::addText(UIBatch &batch, glm::vec2 position, std::string const &text, GLfloat scale,
+	glm::vec4 const &color, Anchor anchor)
 {
-	glm::vec2 pos(0.0f);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindVertexArray(_vao);
-
-	float textWidth = 0.0f;
-	float maxHeight = 0.0f;
-	for (auto &c : text) {
-        Character const &ch = _characters[c];
-		textWidth += (ch.advance >> 6) * scale;
-		maxHeight = ch.bearing.y * scale > maxHeight ? ch.bearing.y * scale : maxHeight;
+	if (text != _layout.text || scale != _layout.scale || anchor != _layout.anchor) {
+		layout(text, scale, anchor);
 	}
 
-	// Calculate anchor offset to align text to the desired side
-	glm::vec2 anchorOffset = calculateOffset(anchor, glm::vec2(textWidth, maxHeight));
-	pos += anchorOffset;
-
-	for (auto &c : text)
-	{
-        Character const &ch = _characters[c];
-
-        GLfloat xpos = pos.x + ch.bearing.x * scale;
-        GLfloat ypos = pos.y - (ch.size.y - ch.bearing.y) * scale;
-
-        GLfloat w = ch.size.x * scale;
-        GLfloat h = ch.size.y * scale;
-
-        // Update VBO for each character
-        GLfloat vertices[6][2] = {
-            { xpos,     ypos + h, },
-            { xpos,     ypos,     },
-            { xpos + w, ypos,     },
-
-            { xpos,     ypos + h, },
-            { xpos + w, ypos,     },
-            { xpos + w, ypos + h, },
-        };
-        // Render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.texture);
-
-        // Update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, _vbo);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        // Render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        // Now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        pos.x += (ch.advance >> 6) * scale; // Bitshift by 6 to get value in pixels (2^6 = 64)
-    }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+	// Bitmap rows go down, the top of the quad samples the first row of the glyph
+	for (auto const &quad : _layout.quads) {
+		batch.addQuad(position + quad.min, position + quad.max, quad.rect, UIBatch::Mode::Glyph, color,
+			glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 0.0f));
+	}
 }
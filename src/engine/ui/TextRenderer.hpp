@@ -1,11 +1,20 @@
 #pragma once
 
 #include <lazy.hpp>
+#include <string>
+#include <vector>
 #include "Anchor.hpp"
+#include "UIBatch.hpp"
 
 using namespace lazy::graphics;
 using namespace anchor;
 
+///
+/// Lays strings out with the glyphs of the GlyphAtlas and adds them to a UIBatch
+///
+/// The quads of the last string are kept and reused as long as the text, its scale and
+/// its anchor do not change.
+///
 class TextRenderer
 {
 public:
@@ -15,23 +24,28 @@ public:
 
 	void operator=(TextRenderer const &) = delete;
 
-	void setup();
-	void drawText(std::string text, GLfloat scale, glm::vec3 color, Anchor anchor = Anchor::BottomLeft);
+	/// Add the glyphs of `text` to `batch`, anchored at `position`
+	void addText(UIBatch &batch, glm::vec2 position, std::string const &text, GLfloat scale,
+		glm::vec4 const &color, Anchor anchor = Anchor::BottomLeft);
 
 private:
-	GLuint _vao;
-	GLuint _vbo;
-	GLuint _ubo;
-	Shader _shader;
 	int _width;
 	int _height;
 
-	struct Character {
-		GLuint texture;
-		glm::ivec2 size;
-		glm::ivec2 bearing;
-		GLuint advance;
+	struct GlyphQuad {
+		glm::vec2 min;
+		glm::vec2 max;
+		/// Glyph in the atlas, in texels
+		glm::vec4 rect;
 	};
-	std::map<GLchar, Character> _characters;
 
+	struct Layout {
+		std::string text;
+		GLfloat scale = 0.0f;
+		Anchor anchor = Anchor::BottomLeft;
+		std::vector<GlyphQuad> quads;
+	};
+	Layout _layout;
+
+	void layout(std::string const &text, GLfloat scale, Anchor anchor);
 };
@@ -1,19 +1,48 @@
 #include "UI.hpp"
+#include "UIAtlas.hpp"
+#include "GlyphAtlas.hpp"
+#include "RenderCounters.hpp"
+#include "GLState.hpp"
+#include <algorithm>
 #include <iostream>
 #include <type_traits>
 
-UI::UI(float width, float height)
+UI::UI(float width, float height) : _builtScene(nullptr), _vbo(0), _capacity(0), _vertexCount(0)
 {
-	_shader.addVertexShader("shaders/ui.vs.glsl")
-		.addFragmentShader("shaders/ui.fs.glsl")
-		.link();
+	_shader.AddVertexShader("shaders/ui.vs.glsl")
+		.AddFragmentShader("shaders/ui.fs.glsl")
+		.Link();
 
-	_shader.bind();
-	_shader.setUniform4x4f("projectionMatrix", glm::ortho(0.0f, width, 0.0f, height));
-	_shader.setUniform4x4f("modelMatrix", glm::mat4(1.0f));
-	_shader.unbind();
+	_shader.SetUniform4x4f("projectionMatrix", glm::ortho(0.0f, width, 0.0f, height));
+	_shader.SetUniform1i("images", 0);
+	_shader.SetUniform1i("glyphs", 1);
 
 	_size = glm::vec2(width, height);
+
+	glCreateVertexArrays(1, &_vao);
+
+	glEnableVertexArrayAttrib(_vao, 0);
+	glEnableVertexArrayAttrib(_vao, 1);
+	glEnableVertexArrayAttrib(_vao, 2);
+	glEnableVertexArrayAttrib(_vao, 3);
+	glEnableVertexArrayAttrib(_vao, 4);
+
+	glVertexArrayAttribFormat(_vao, 0, 2, GL_FLOAT, GL_FALSE, offsetof(UIBatch::Vertex, position));
+	glVertexArrayAttribFormat(_vao, 1, 2, GL_FLOAT, GL_FALSE, offsetof(UIBatch::Vertex, uv));
+	glVertexArrayAttribFormat(_vao, 2, 4, GL_FLOAT, GL_FALSE, offsetof(UIBatch::Vertex, rect));
+	glVertexArrayAttribFormat(_vao, 3, 4, GL_FLOAT, GL_FALSE, offsetof(UIBatch::Vertex, color));
+	glVertexArrayAttribIFormat(_vao, 4, 1, GL_UNSIGNED_INT, offsetof(UIBatch::Vertex, mode));
+
+	for (GLuint attrib = 0; attrib <= 4; attrib++) {
+		glVertexArrayAttribBinding(_vao, attrib, 0);
+	}
+}
+
+UI::~UI()
+{
+	glDeleteVertexArrays(1, &_vao);
+	glDeleteBuffers(1, &_vbo);
+	engine::GLState::Instance().Invalidate();
 }
 
 void UI::update()
@@ -24,7 +53,7 @@ void UI::update()
 	}
 }
 
-void UI::updateComponents(std::vector<std::shared_ptr<ASceneComponent>> components)
+void UI::updateComponents(std::vector<std::shared_ptr<ASceneComponent>> const &components)
 {
 	for (auto &c : components)
 	{
@@ -35,9 +64,23 @@ void UI::updateComponents(std::vector<std::shared_ptr<ASceneComponent>> componen
 
 void UI::render()
 {
-	if (_state.currentScene) {
-		renderScene(*_state.currentScene);
+	if (!_state.currentScene) { return ; }
+
+	IUIScene &scene = *_state.currentScene;
+
+	if (scene.isDirty() || &scene != _builtScene) {
+		buildScene(scene);
 	}
+	if (_vertexCount == 0) { return ; }
+
+	auto &state = engine::GLState::Instance();
+
+	_shader.Bind();
+	state.BindVertexArray(_vao);
+	state.BindTexture(0, UIAtlas::instance().getTexture());
+	state.BindTexture(1, GlyphAtlas::instance().getTexture());
+
+	engine::gl::DrawArrays(GL_TRIANGLES, 0, _vertexCount);
 }
 
 void UI::action(UIAction action, std::string const &val)
@@ -78,20 +121,36 @@ bool UI::loadScene(std::string const &name)
 	return true;
 }
 
-void UI::renderScene(IUIScene &scene)
+void UI::buildScene(IUIScene &scene)
 {
-	_shader.bind();
-	renderComponents(scene.getSceneComponents());
-	_shader.unbind();
+	_batch.clear();
+	buildComponents(scene.getSceneComponents());
+
+	scene.clean();
+	_builtScene = &scene;
+
+	auto const &vertices = _batch.getVertices();
+	_vertexCount = vertices.size();
+
+	if (_vertexCount > _capacity) {
+		_capacity = std::max(_vertexCount, _capacity * 2);
+
+		glDeleteBuffers(1, &_vbo);
+		glCreateBuffers(1, &_vbo);
+		glNamedBufferData(_vbo, _capacity * sizeof(UIBatch::Vertex), nullptr, GL_DYNAMIC_DRAW);
+		glVertexArrayVertexBuffer(_vao, 0, _vbo, 0, sizeof(UIBatch::Vertex));
+	}
+	if (_vertexCount > 0) {
+		engine::gl::NamedBufferSubData(_vbo, 0, _vertexCount * sizeof(UIBatch::Vertex), vertices.data());
+	}
 }
 
-void UI::renderComponents(std::vector<std::shared_ptr<ASceneComponent>> components,
+void UI::buildComponents(std::vector<std::shared_ptr<ASceneComponent>> const &components,
 	ASceneComponent *parent, glm::vec2 parentPos)
 {
 	for (auto &c : components) {
 		glm::vec2 position(0.0f);
 		glm::vec2 anchorOff = calculateOffset(c->getAnchor(), c->getSize());
-		glm::mat4 modelMatrix(1.0f);
 
 		// TODO: Do this switch in ASceneComponent::getScreenPosition()
 		//       (getScreenPosition needs to access the parent's size)
@@ -133,15 +192,9 @@ void UI::renderComponents(std::vector<std::shared_ptr<ASceneComponent>> componen
 		position += anchorOff;
 		position += offset;
 
-		modelMatrix = glm::translate(glm::mat4(1.0f),
-			glm::vec3(parentPos + position, 0.0f));
-
-		_shader.bind();
-		_shader.setUniform4x4f("modelMatrix", modelMatrix);
-
-		c->draw(_shader);
+		c->draw(_batch, parentPos + position);
 
-		renderComponents(c->getSubComponents(), c.get(), position);
+		buildComponents(c->getSubComponents(), c.get(), parentPos + position);
 	}
 }
 
@@ -5,9 +5,10 @@
 #include <optional>
 #include <memory>
 #include "UIScene.hpp"
+#include "UIBatch.hpp"
 #include "lazy.hpp"
+#include "ShaderProgram.hpp"
 
-using lazy::graphics::Shader;
 
 class UI
 {
@@ -22,6 +23,10 @@ private:
 	};
 public:
 	UI(float width, float height);
+	~UI();
+
+	UI(UI const &) = delete;
+	void operator=(UI const &) = delete;
 
 	void update();
 	void render();
@@ -47,17 +52,30 @@ private:
 	typename = std::enable_if_t<std::is_base_of<IUIScene, T>::value>>
 	bool loadScene(std::string const &name);
 
-	void renderScene(IUIScene &scene);
+	/*
+	 * Build the quads of the scene again and upload them
+	 */
+	void buildScene(IUIScene &scene);
 
-	void renderComponents(std::vector<std::shared_ptr<ASceneComponent>> components,
+	void buildComponents(std::vector<std::shared_ptr<ASceneComponent>> const &components,
 		ASceneComponent *parent = nullptr, glm::vec2 parentPos = glm::vec2(0.0f, 0.0f));
 
-	void updateComponents(std::vector<std::shared_ptr<ASceneComponent>> components);
+	void updateComponents(std::vector<std::shared_ptr<ASceneComponent>> const &components);
 
 private:
 	UIState _state;
 	std::map<std::string, std::shared_ptr<IUIScene>> _scenes;
-	Shader _shader;
+	engine::ShaderProgram _shader;
 	std::map<std::string, std::function<void()>> _callbacks;
 	glm::vec2 _size;
+
+	/// Quads of the scene, kept until a component changes
+	UIBatch _batch;
+	IUIScene *_builtScene;
+
+	GLuint _vao;
+	GLuint _vbo;
+	/// In vertices
+	size_t _capacity;
+	size_t _vertexCount;
 };
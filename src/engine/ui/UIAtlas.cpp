@@ -0,0 +1,95 @@
+#include "UIAtlas.hpp"
+#include "RenderCounters.hpp"
+#include "GLState.hpp"
+#include "stb_image.h"
+#include <iostream>
+
+UIAtlas::UIAtlas() : _texture(0), _packer(Width, Width / 2)
+{
+	_texture = createTexture();
+}
+
+UIAtlas::~UIAtlas()
+{
+	glDeleteTextures(1, &_texture);
+	engine::GLState::Instance().Invalidate();
+}
+
+GLuint UIAtlas::createTexture() const
+{
+	GLuint texture;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, GL_RGBA8, _packer.GetWidth(), _packer.GetHeight());
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	GLubyte const zero[4] = { 0, 0, 0, 0 };
+	glClearTexImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, zero);
+
+	return texture;
+}
+
+bool UIAtlas::grow()
+{
+	int const oldHeight = _packer.GetHeight();
+
+	if (oldHeight * 2 > MaxHeight) { return false; }
+
+	_packer.Grow(oldHeight * 2);
+
+	GLuint const texture = createTexture();
+	glCopyImageSubData(_texture, GL_TEXTURE_2D, 0, 0, 0, 0, texture, GL_TEXTURE_2D, 0, 0, 0, 0,
+		_packer.GetWidth(), oldHeight, 1);
+
+	glDeleteTextures(1, &_texture);
+	engine::GLState::Instance().Invalidate();
+
+	_texture = texture;
+	return true;
+}
+
+glm::vec4 UIAtlas::add(std::string const &name, std::string const &path)
+{
+	auto const region = _regions.find(name);
+
+	if (region != _regions.end()) {
+		return region->second;
+	}
+
+	int width, height, channels;
+
+	stbi_set_flip_vertically_on_load(0);
+	unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+
+	if (!data) {
+		std::cerr << "WARNING::UI_ATLAS::IMAGE_NOT_FOUND " << path << std::endl;
+		return _regions[name] = glm::vec4(0.0f);
+	}
+
+	auto position = _packer.Pack(width + Padding, height + Padding);
+
+	while (!position && grow()) {
+		position = _packer.Pack(width + Padding, height + Padding);
+	}
+	if (!position) {
+		std::cerr << "WARNING::UI_ATLAS::FULL " << path << std::endl;
+		stbi_image_free(data);
+		return _regions[name] = glm::vec4(0.0f);
+	}
+
+	engine::gl::TextureSubImage2D(_texture, 0, position->X, position->Y, width, height,
+		GL_RGBA, GL_UNSIGNED_BYTE, data);
+	stbi_image_free(data);
+
+	return _regions[name] = glm::vec4(position->X, position->Y, width, height);
+}
+
+glm::vec4 UIAtlas::get(std::string const &name) const
+{
+	auto const region = _regions.find(name);
+
+	return region != _regions.end() ? region->second : glm::vec4(0.0f);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <lazy.hpp>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <string>
+#include "SkylinePacker.hpp"
+
+///
+/// Images of the UI packed into one RGBA texture
+///
+/// Regions are in texels: when the atlas is full it doubles in height, which moves no
+/// image, and only the texture has to be bound again.
+///
+class UIAtlas
+{
+private:
+	static constexpr int Width = 1024;
+	static constexpr int MaxHeight = 4096;
+	static constexpr int Padding = 1;
+
+	GLuint _texture;
+	engine::SkylinePacker _packer;
+	/// x, y, width, height in texels
+	std::unordered_map<std::string, glm::vec4> _regions;
+
+	UIAtlas();
+
+	GLuint createTexture() const;
+	bool grow();
+
+public:
+	static UIAtlas &instance()
+	{
+		static UIAtlas atlas;
+		return atlas;
+	}
+
+	UIAtlas(UIAtlas const &) = delete;
+	void operator=(UIAtlas const &) = delete;
+
+	~UIAtlas();
+
+	/// Load an image once, later calls with the same name return its region
+	glm::vec4 add(std::string const &name, std::string const &path);
+
+	/// Empty region when the image was never added
+	glm::vec4 get(std::string const &name) const;
+
+	GLuint getTexture() const { return _texture; }
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <lazy.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+///
+/// Quads of the UI, in the order they are drawn
+///
+/// Every quad samples a rectangle of the UIAtlas or of the GlyphAtlas, given in texels
+/// so that the atlases can grow without touching the quads already built. All of them
+/// are drawn together by ui.vs.glsl and ui.fs.glsl.
+///
+class UIBatch
+{
+public:
+	enum class Mode : GLuint {
+		Image = 0,
+		/// UVs above 1 repeat the rectangle
+		TiledImage = 1,
+		/// Coverage of a glyph, tinted by the color
+		Glyph = 2,
+	};
+
+	struct Vertex {
+		glm::vec2 position;
+		glm::vec2 uv;
+		/// Source rectangle: x, y, width, height in texels
+		glm::vec4 rect;
+		glm::vec4 color;
+		GLuint mode;
+	};
+
+	void clear() { _vertices.clear(); }
+
+	///
+	/// Screen rectangle [min, max], the UVs go from uvMin at min to uvMax at max
+	///
+	void addQuad(glm::vec2 min, glm::vec2 max, glm::vec4 const &rect, Mode mode,
+		glm::vec4 const &color = glm::vec4(1.0f), glm::vec2 uvMin = glm::vec2(0.0f), glm::vec2 uvMax = glm::vec2(1.0f))
+	{
+		GLuint const m = static_cast<GLuint>(mode);
+
+		Vertex const bottomLeft  = { min,                      uvMin,                      rect, color, m };
+		Vertex const bottomRight = { glm::vec2(max.x, min.y), glm::vec2(uvMax.x, uvMin.y), rect, color, m };
+		Vertex const topRight    = { max,                      uvMax,                      rect, color, m };
+		Vertex const topLeft     = { glm::vec2(min.x, max.y), glm::vec2(uvMin.x, uvMax.y), rect, color, m };
+
+		_vertices.insert(_vertices.end(), { bottomLeft, bottomRight, topRight, bottomLeft, topRight, topLeft });
+	}
+
+	std::vector<Vertex> const &getVertices() const { return _vertices; }
+
+private:
+	std::vector<Vertex> _vertices;
+};
@@ -13,12 +13,13 @@ public:
 	IUIScene(UI *uiController, glm::vec2 size) {
 		_uiController = uiController;
 		_size = size;
+		_dirty = true;
 	}
 
 	virtual ~IUIScene() {};
 	virtual void update() {};
 
-	std::vector<std::shared_ptr<ASceneComponent>> getSceneComponents()
+	std::vector<std::shared_ptr<ASceneComponent>> const &getSceneComponents() const
 	{
 		return _sceneComponents;
 	}
@@ -30,6 +31,7 @@ public:
 		auto component = std::make_shared<T>(this, std::forward<Args>(args)...);
 
 		_sceneComponents.push_back(component);
+		invalidate();
 		return component;
 	}
 
@@ -37,8 +39,16 @@ public:
 
 	glm::vec2 getSize() { return _size; };
 
+	/*
+	 * The UI keeps the quads of the scene until a component changes
+	 */
+	void invalidate() { _dirty = true; }
+	bool isDirty() const { return _dirty; }
+	void clean() { _dirty = false; }
+
 private:
 	std::vector<std::shared_ptr<ASceneComponent>> _sceneComponents;
 	UI *_uiController;
 	glm::vec2 _size;
+	bool _dirty;
 };
@@ -3,6 +3,7 @@
 #include "Engine.hpp"
 #include "Level.hpp"
 #include "ShaderManager.hpp"
+#include "TextureManager.hpp"
 #include "Model.hpp"
 
 #include "components/PlayerCameraComponent.hpp"
@@ -14,6 +15,7 @@
 #include "components/SelectedComponent.hpp"
 #include "components/PointLightComponent.hpp"
 #include "components/LuaScriptComponent.hpp"
+#include "components/OccluderComponent.hpp"
 
 // TODO: Something better
 MeshComponent initSkybox();
@@ -33,11 +35,22 @@ private:
 	unsigned int _pbrSphere;
 	unsigned int _env;
 
+	/// Occluder selection, sizes are the diagonal of the bounds in model space
+	static constexpr size_t MaxOccluderTriangles = 4096;
+	static constexpr float MinOccluderSize = 200.0f;
+
 public:
 	void Load() override
 	{
 		auto &engine = engine::Engine::Instance();
 
+		TextureManager::instance().createTexture("prototype_tile_8", "./img/prototype_tile_8.png", {
+			{ GL_TEXTURE_MAG_FILTER, GL_LINEAR },
+			{ GL_TEXTURE_MIN_FILTER, GL_LINEAR },
+			{ GL_TEXTURE_WRAP_R, GL_REPEAT },
+			{ GL_TEXTURE_WRAP_S, GL_REPEAT },
+		}, GL_TEXTURE_2D);
+
 		_player = engine.CreateEntity<PlayerCameraComponent, TransformComponent>();
 
 		PlayerCameraComponent p{};
@@ -54,18 +67,17 @@ public:
 			t.position = glm::vec3(0.0f, 18.0f, -0.5f);
 		_player->Set(t);
 
-		auto [ shaderId, meshShader ] = ShaderManager::instance().Create();
-		meshShader.addVertexShader("./shaders/basic.vs.glsl")
-			.addFragmentShader("./shaders/basic.fs.glsl")
-			.link();
-
-		meshShader.bind();
-		meshShader.setUniform1i("material.albedo", 0);
-		meshShader.setUniform1i("material.metallicRoughness", 1);
-		meshShader.setUniform1i("material.normal", 2);
-		meshShader.setUniform1f("material.metallicFactor", 1.0f);
-		meshShader.setUniform1f("material.roughnessFactor", 1.0f);
-		meshShader.unbind();
+		// One variant per combination of MaterialFeatures, built when first drawn
+		ShaderPermutationDesc meshShader;
+			meshShader.VertexPath = "./shaders/basic.vs.glsl";
+			meshShader.FragmentPath = "./shaders/basic.fs.glsl";
+			meshShader.Features = MaterialFeatureNames;
+			meshShader.OnLinked = [] (engine::ShaderProgram &variant) {
+				variant.SetUniform1i("material.albedo", 0);
+				variant.SetUniform1i("material.metallicRoughness", 1);
+				variant.SetUniform1i("material.normal", 2);
+			};
+		auto const shaderId = ShaderManager::instance().CreatePermutations(std::move(meshShader));
 
 		_meshShader = shaderId;
 
@@ -76,12 +88,10 @@ public:
 		_display->SetName("Display");
 
 		auto [ skyboxShaderId, skyboxShader ] = ShaderManager::instance().Create();
-		skyboxShader.addVertexShader("./shaders/cubemap.vs.glsl")
-			.addFragmentShader("./shaders/cubemap.fs.glsl")
-			.link();
-		skyboxShader.bind();
-		skyboxShader.setUniform1i("cubemap", 0);
-		skyboxShader.unbind();
+		skyboxShader.AddVertexShader("./shaders/cubemap.vs.glsl")
+			.AddFragmentShader("./shaders/cubemap.fs.glsl")
+			.Link();
+		skyboxShader.SetUniform1i("cubemap", 0);
 
 		_skyboxShader = skyboxShaderId;
 
@@ -107,9 +117,24 @@ public:
 			TransformComponent sponzaTransform;
 			sponzaTransform.scale = { 0.1f, 0.1f, 0.1f };
 
-			auto sponza = engine.CreateEntity<ModelComponent, TransformComponent>();
+			// Walls, floors and columns: large meshes with few triangles
+			OccluderComponent sponzaOccluder;
+
+			for (auto const meshId : sponzaModel.Meshes) {
+				auto mesh = dynamic_cast<engine::Mesh*>(engine.GetMesh(meshId));
+				if (mesh == nullptr) { continue ; }
+
+				float const size = glm::length(mesh->GetBoundsMax() - mesh->GetBoundsMin());
+
+				if (mesh->GetIndices().size() / 3 <= MaxOccluderTriangles && size >= MinOccluderSize) {
+					sponzaOccluder.Meshes.push_back(meshId);
+				}
+			}
+
+			auto sponza = engine.CreateEntity<ModelComponent, TransformComponent, OccluderComponent>();
 			sponza->Set(sponzaModel);
 			sponza->Set(sponzaTransform);
+			sponza->Set(sponzaOccluder);
 			sponza->SetName("Sponza");
 
 		}
@@ -119,14 +144,26 @@ public:
 		_pbrSphere = engine.RegisterModel(pbrSphere);
 
 		if (pbrSphere.GetMeshes().size() > 0) {
+			auto const sphereMesh = dynamic_cast<engine::Mesh*>(engine.GetMesh(pbrSphere.GetMeshes()[0]));
+			auto const sphereMaterial = engine.GetPbrMaterial(sphereMesh != nullptr
+				? sphereMesh->GetPbrMaterial().value_or(engine::Engine::DefaultPbrMaterial)
+				: engine::Engine::DefaultPbrMaterial);
+
 			for (size_t x = 0; x < 6; x++) {
 				for (int y = 0; y < 6; y++) {
 
+					// Metallic along x, rough along y
+					PbrMaterial material = *sphereMaterial;
+						material.Name = fmt::format("PBR Sphere {} {}", x, y);
+						material.MetallicFactor = (1.0f / 6.0f) * x;
+						material.RoughnessFactor = (1.0f / 6.0f) * y;
+
 					ModelComponent pbrSphereModel{};
 						pbrSphereModel.Meshes.reserve(pbrSphere.GetMeshes().size());
 						pbrSphereModel.Meshes.insert(pbrSphereModel.Meshes.begin(), pbrSphere.GetMeshes().begin(), pbrSphere.GetMeshes().end());
 						pbrSphereModel.Name = "PBR Sphere";
 						pbrSphereModel.Shader = shaderId;
+						pbrSphereModel.Material = engine.AddPbrMaterial(material);
 
 					TransformComponent t{};
 						t.scale = { 0.05f, 0.05f, 0.05f };
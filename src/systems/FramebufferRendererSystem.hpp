@@ -2,13 +2,15 @@
 
 #include "Framebuffer.hpp"
 #include "ecs/System.hpp"
+#include "ShaderProgram.hpp"
+#include "RenderCounters.hpp"
 #include <glm/vec3.hpp>
 
 class FramebufferRendererSystem : public ecs::ComponentSystem
 {
 private:
 	lazy::graphics::Mesh _quad;
-	lazy::graphics::Shader _shader;
+	engine::ShaderProgram _shader;
 
 	engine::Framebuffer _framebuffer;
 
@@ -33,13 +35,11 @@ public:
 	FramebufferRendererSystem() : _framebuffer(engine::Framebuffer_Type::RW)
 	{
 		initQuad();
-		_shader.addVertexShader("shaders/fb.vs.glsl")
-			.addFragmentShader("shaders/fb.fs.glsl")
-			.link();
+		_shader.AddVertexShader("shaders/fb.vs.glsl")
+			.AddFragmentShader("shaders/fb.fs.glsl")
+			.Link();
 
-		_shader.bind();
-		_shader.setUniform1i("screen_texture", 0);
-		_shader.unbind();
+		_shader.SetUniform1i("screen_texture", 0);
 
 		_framebuffer.AttachColorBuffer();
 		_framebuffer.AttachDepthBuffer();
@@ -59,9 +59,9 @@ public:
 		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		_shader.bind();
+		_shader.Bind();
 		glDisable(GL_DEPTH_TEST);
 //		glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		engine::gl::DrawArrays(GL_TRIANGLES, 0, 6);
 	}
 };
@@ -14,6 +14,14 @@
 #include <glm/gtx/matrix_decompose.hpp>
 #include "Engine.hpp"
 #include "Logger.hpp"
+#include "GLState.hpp"
+#include "GBuffer.hpp"
+#include "RenderStats.hpp"
+#include "Profiler.hpp"
+#include "ShadowAtlas.hpp"
+#include "GeometryArena.hpp"
+#include "ProgramCache.hpp"
+#include "ShaderManager.hpp"
 
 class ImguiSystem : public ecs::ComponentSystem
 {
@@ -21,6 +29,15 @@ private:
 	lazy::graphics::Display *_display;
 
 	bool _logAutoScroll;
+	bool _bCompactGBuffer;
+	bool _bDepthPrepass;
+	bool _bSsao;
+	int _shadowFilter;
+	bool _bShadowDepth32;
+	bool _bOcclusionCulling;
+	bool _bGpuCulling;
+	engine::GovernorSettings _governor;
+	bool _bBicubicUpscale;
 
 private:
 	void BeginFrame()
@@ -33,7 +50,10 @@ private:
 	void EndFrame()
 	{
 		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		engine::Profiler::Instance().BeginPass("ImGui");
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		engine::Profiler::Instance().EndPass();
 	}
 
 	void DrawGuizmoSelectedEnt()
@@ -255,6 +275,237 @@ private:
 		ImGui::End();
 	}
 
+	///
+	/// Last, min, average and max over the history of each timing, then their history
+	///
+	void TimingTable(char const *id, std::vector<engine::TimingHistory const *> const &timings)
+	{
+		ImGui::PushID(id);
+
+		ImGui::Columns(5, id);
+		for (auto const *header : { "", "ms", "min", "avg", "max" }) {
+			ImGui::TextUnformatted(header);
+			ImGui::NextColumn();
+		}
+		ImGui::Separator();
+
+		float total = 0.0f;
+
+		for (auto const *timing : timings) {
+			ImGui::TextUnformatted(timing->GetName().c_str());
+			ImGui::NextColumn();
+			for (float const ms : { timing->GetLast(), timing->GetMin(), timing->GetAverage(), timing->GetMax() }) {
+				ImGui::Text("%.3f", ms);
+				ImGui::NextColumn();
+			}
+			total += timing->GetAverage();
+		}
+		ImGui::Columns(1);
+		ImGui::Text("Total: %.3f ms", total);
+
+		for (auto const *timing : timings) {
+			ImGui::PlotLines(timing->GetName().c_str(), timing->GetSamples(), timing->GetCount(),
+				timing->GetOffset(), nullptr, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+		}
+
+		ImGui::PopID();
+	}
+
+	///
+	/// Work submitted by each outermost pass of the last frame, then by the whole frame
+	///
+	void CounterTable(engine::RenderStats const &stats)
+	{
+		ImGui::Columns(7, "counters");
+		for (auto const *header : { "", "draws", "instances", "triangles", "binds", "uniforms", "upload KiB" }) {
+			ImGui::TextUnformatted(header);
+			ImGui::NextColumn();
+		}
+		ImGui::Separator();
+
+		auto row = [] (char const *name, engine::RenderCounters const &c) {
+			ImGui::TextUnformatted(name);
+			ImGui::NextColumn();
+			for (size_t const value : { c.DrawCalls, c.Instances, c.Triangles,
+				c.ProgramBinds + c.VertexArrayBinds + c.TextureBinds, c.UniformCalls }) {
+				ImGui::Text("%zu", value);
+				ImGui::NextColumn();
+			}
+			ImGui::Text("%.1f", (c.BufferBytes + c.TextureBytes) / 1024.0f);
+			ImGui::NextColumn();
+		};
+
+		for (auto const &pass : stats.Passes) {
+			row(pass.Name.c_str(), pass.Counters);
+		}
+		ImGui::Separator();
+		row("Frame", stats.Counters);
+		ImGui::Columns(1);
+	}
+
+	void Profiler()
+	{
+		ImGui::Begin("Profiler");
+
+		auto const &profiler = engine::Profiler::Instance();
+
+		if (ImGui::CollapsingHeader("GPU passes", ImGuiTreeNodeFlags_DefaultOpen)) {
+			TimingTable("gpu", profiler.GetGpuTimings());
+		}
+
+		if (ImGui::CollapsingHeader("CPU systems", ImGuiTreeNodeFlags_DefaultOpen)) {
+			std::vector<engine::TimingHistory const *> systems;
+			for (auto const &timing : profiler.GetCpuTimings()) {
+				systems.push_back(&timing);
+			}
+			TimingTable("cpu", systems);
+		}
+
+#if ENGINE_RENDER_COUNTERS
+		if (ImGui::CollapsingHeader("Submissions", ImGuiTreeNodeFlags_DefaultOpen)) {
+			CounterTable(engine::RenderStats::Instance());
+		}
+#endif
+
+		if (ImGui::CollapsingHeader("Program cache")) {
+			auto const &cache = engine::ProgramCache::Instance().GetStats();
+
+			ImGui::Text("%zu loaded in %.1f ms, %.1f ms saved", cache.Hits, cache.LoadMs, cache.SavedMs);
+			ImGui::Text("%zu built from source in %.1f ms", cache.Misses, cache.BuildMs);
+			ImGui::Text("%zu shader variants", ShaderManager::instance().GetVariantCount());
+		}
+
+		ImGui::End();
+	}
+
+	void RenderStats()
+	{
+		ImGui::Begin("Renderer");
+
+		auto const &counters = engine::GLState::Instance().GetLastFrameCounters();
+		size_t const total = counters.Issued + counters.Elided;
+
+		ImGui::Text("GL state changes: %zu", counters.Issued);
+		ImGui::Text("Redundant changes elided: %zu (%.1f%%)", counters.Elided,
+			total > 0 ? 100.0f * counters.Elided / total : 0.0f);
+
+#if ENGINE_RENDER_COUNTERS
+		auto const &submitted = engine::RenderStats::Instance().Counters;
+
+		ImGui::Text("Draw calls: %zu, %zu instances, %zu triangles", submitted.DrawCalls, submitted.Instances,
+			submitted.Triangles);
+		ImGui::Text("Binds: %zu programs, %zu vertex arrays, %zu textures", submitted.ProgramBinds,
+			submitted.VertexArrayBinds, submitted.TextureBinds);
+		ImGui::Text("Uniforms: %zu, uploads: %.1f KiB buffers, %.1f KiB textures", submitted.UniformCalls,
+			submitted.BufferBytes / 1024.0f, submitted.TextureBytes / 1024.0f);
+#endif
+
+		ImGui::Separator();
+		ImGui::Text("Frame: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+
+		if (ImGui::Checkbox("Compact G-buffer", &_bCompactGBuffer)) {
+			engine::Engine::Instance().OnCompactGBuffer(_bCompactGBuffer);
+		}
+		ImGui::Text("G-buffer: %zu bytes/pixel", GBuffer::BytesPerPixel(
+			_bCompactGBuffer ? GBuffer::Layout::Compact : GBuffer::Layout::Wide));
+
+		if (ImGui::Checkbox("SSAO", &_bSsao)) {
+			engine::Engine::Instance().OnSsao(_bSsao);
+		}
+
+		auto const &arena = engine::GeometryArena::Instance();
+		auto const &renderStats = engine::RenderStats::Instance();
+		float const mib = 1024.0f * 1024.0f;
+
+		ImGui::Text("Render graph: %zu passes, %zu culled", renderStats.RenderPasses, renderStats.CulledPasses);
+		ImGui::Text("Targets: %zu in %zu textures, %.1f MiB", renderStats.TransientTargets,
+			renderStats.TargetTextures, renderStats.TargetBytes / mib);
+
+		ImGui::Text("Geometry: %.1f MiB (%.1f MiB unpacked)",
+			(arena.GetVertexBytes() + arena.GetIndexBytes()) / mib, arena.GetUnpackedBytes() / mib);
+		ImGui::Text("Vertex: %zu bytes packed, %zu bytes full", sizeof(engine::PackedVertex), sizeof(engine::Vertex));
+
+		ImGui::Separator();
+		auto const &filters = engine::ShadowAtlas::Filters;
+		if (ImGui::BeginCombo("Shadow filter", filters[_shadowFilter].Name)) {
+			for (size_t i = 0; i < filters.size(); i++) {
+				if (ImGui::Selectable(filters[i].Name, _shadowFilter == static_cast<int>(i))) {
+					_shadowFilter = static_cast<int>(i);
+					engine::Engine::Instance().OnShadowFilter(i);
+				}
+			}
+			ImGui::EndCombo();
+		}
+		if (ImGui::Checkbox("32-bit shadow depth", &_bShadowDepth32)) {
+			engine::Engine::Instance().OnShadowDepth32(_bShadowDepth32);
+		}
+
+		ImGui::Separator();
+		if (ImGui::Checkbox("Depth pre-pass", &_bDepthPrepass)) {
+			engine::Engine::Instance().OnDepthPrepass(_bDepthPrepass);
+		}
+
+		auto const &stats = engine::RenderStats::Instance();
+
+		if (stats.bHasPipelineStatistics) {
+			ImGui::Text("Fragments shaded: G-buffer %llu, pre-pass %llu",
+				static_cast<unsigned long long>(stats.GeometryFragments),
+				static_cast<unsigned long long>(stats.PrepassFragments));
+		}
+		else {
+			ImGui::TextDisabled("Pipeline statistics queries unsupported");
+		}
+
+		ImGui::Separator();
+		if (ImGui::Checkbox("Occlusion culling", &_bOcclusionCulling)) {
+			engine::Engine::Instance().OnOcclusionCulling(_bOcclusionCulling);
+		}
+		if (ImGui::Checkbox("GPU culling", &_bGpuCulling)) {
+			engine::Engine::Instance().OnGpuCulling(_bGpuCulling);
+		}
+
+		if (_bGpuCulling) {
+			ImGui::TextDisabled("Culling results stay on the GPU");
+		}
+		else {
+			ImGui::Text("Occluder triangles %zu, draws culled %zu", stats.OccluderTriangles, stats.OccludedDraws);
+		}
+
+		ImGui::Separator();
+		DynamicResolution(stats);
+
+		ImGui::End();
+	}
+
+	///
+	/// Settings of the resolution governor and the quality it picked
+	///
+	void DynamicResolution(engine::RenderStats const &stats)
+	{
+		bool changed = false;
+
+		changed |= ImGui::Checkbox("Dynamic resolution", &_governor.bEnabled);
+		changed |= ImGui::SliderFloat("GPU budget (ms)", &_governor.BudgetMs, 4.0f, 50.0f, "%.1f");
+		changed |= ImGui::SliderFloat("Max scale", &_governor.MaxScale, 0.25f, 1.0f, "%.2f");
+		changed |= ImGui::SliderFloat("Min scale", &_governor.MinScale, 0.25f, _governor.MaxScale, "%.2f");
+		changed |= ImGui::SliderFloat("Scale step", &_governor.ScaleStep, 0.05f, 0.25f, "%.2f");
+		changed |= ImGui::SliderFloat("Headroom", &_governor.Headroom, 0.5f, 1.0f, "%.2f");
+		changed |= ImGui::Checkbox("Reduce SSAO", &_governor.bAdjustSsao);
+		ImGui::SameLine();
+		changed |= ImGui::Checkbox("Reduce shadows", &_governor.bAdjustShadows);
+
+		if (changed) {
+			engine::Engine::Instance().OnResolutionGovernor(_governor);
+		}
+		if (ImGui::Checkbox("Bicubic upscale", &_bBicubicUpscale)) {
+			engine::Engine::Instance().OnBicubicUpscale(_bBicubicUpscale);
+		}
+
+		ImGui::Text("GPU frame: %.2f ms", stats.GpuFrameTime);
+		ImGui::Text("Render scale: %.2f, SSAO %s, shadows 1/%u", stats.RenderScale,
+			stats.bReducedSsao ? "reduced" : "full", 1u << stats.ShadowShift);
+	}
+
 	size_t selectedItem = 1;
 
 	void EntityList()
@@ -281,7 +532,9 @@ private:
 	}
 
 public:
-	ImguiSystem() : _display(nullptr), _logAutoScroll(true)
+	ImguiSystem() : _display(nullptr), _logAutoScroll(true), _bCompactGBuffer(true), _bDepthPrepass(true), _bSsao(true),
+		_shadowFilter(static_cast<int>(engine::ShadowAtlas::Filter::Poisson)), _bShadowDepth32(false),
+		_bOcclusionCulling(true), _bGpuCulling(false), _bBicubicUpscale(true)
 	{
 		IMGUI_CHECKVERSION();
 		ImGui::CreateContext();
@@ -316,6 +569,8 @@ public:
 			Materials();
 			Log();
 			EntityList();
+			RenderStats();
+			Profiler();
 		EndDockspace();
 		EndFrame();
 
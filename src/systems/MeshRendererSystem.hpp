@@ -10,6 +10,8 @@
 #include "components/PointLightComponent.hpp"
 #include "components/DirectionalLightComponent.hpp"
 #include "components/ModelComponent.hpp"
+#include "components/DynamicComponent.hpp"
+#include "components/OccluderComponent.hpp"
 #include "Engine.hpp"
 #include "Framebuffer.hpp"
 #include "ShaderManager.hpp"
@@ -17,85 +19,138 @@
 #include <glm/gtx/projection.hpp>
 #include "Engine.hpp"
 #include <random>
+#include <unordered_map>
 #include "GBuffer.hpp"
-#include "TextureAutoBind.hpp"
+#include "DrawQueue.hpp"
+#include "GLState.hpp"
+#include "RenderCounters.hpp"
+#include "ShadowAtlas.hpp"
+#include "ClusteredLighting.hpp"
+#include "MaterialTable.hpp"
+#include "Frustum.hpp"
+#include "ShaderProgram.hpp"
+#include "GpuQuery.hpp"
+#include "RenderStats.hpp"
+#include "OcclusionCuller.hpp"
+#include "RenderGraph.hpp"
+#include "Profiler.hpp"
+#include "ResolutionGovernor.hpp"
 
 class MeshRendererSystem : public ecs::ComponentSystem
 {
 private:
-	lazy::graphics::Shader _billboard;
-	lazy::graphics::Shader _light;
-	lazy::graphics::Shader _shadow;
+	engine::ShaderProgram _billboard;
+	/// ShaderManager permutations, see LightFeatures
+	unsigned int _light;
 	engine::Mesh _quad;
+	GLuint _emptyVao;
 
-	GLuint _ssaoFb;
-	GLuint _ssaoBlurFb;
-	GLuint _ssaoColorBuf;
-	GLuint _ssaoNoiseTex;
-	GLuint _ssaoBlurTex;
-	lazy::graphics::Shader _ssaoShader;
-	lazy::graphics::Shader _ssaoBlurShader;
+	/// Meshes of the frame, shared by the shadow and geometry passes
+	engine::DrawQueue _staticQueue;
+	engine::DrawQueue _dynamicQueue;
 
-	GBuffer _gBuffer;
+	/// World bounds of the casters in the last frame, used to find what changed
+	std::vector<engine::Aabb> _staticBounds;
+	std::vector<engine::Aabb> _dynamicBounds;
+	std::vector<engine::Aabb> _changedBounds;
 
-	GLuint _depthmapFb;
-	GLuint _depthCubemap;
-	glm::mat4 _shadowProjection;
+	/// Level of detail of each mesh of a model in the last frame, by entity
+	std::unordered_map<unsigned int, std::vector<size_t>> _lods;
 
-	Callback<> buildShadowMap;
+	/// Hides the meshes behind the occluders from the camera passes
+	engine::OcclusionCuller _occlusionCuller;
+	bool _bOcclusionCulling;
 
-	static constexpr unsigned int ShadowWidth  = 2048;
-	static constexpr unsigned int ShadowHeight = 2048;
+	/// Frustum and Hi-Z culling in a compute shader, replaces the CPU culling
+	engine::GpuCulling _gpuCulling;
+	bool _bGpuCulling;
 
-	void InitDepthCubemap()
-	{
-		_shadow.addVertexShader("shaders/shadow.vs.glsl")
-			.addFragmentShader("shaders/shadow.fs.glsl")
-			.addGeometryShader("shaders/shadow.gs.glsl")
-			.link();
-		assert(_shadow.isValid());
+	/// Passes of the frame, owns the render targets
+	engine::RenderGraph _graph;
 
-		_shadow.bind();
+	/// Ambient occlusion at a fraction of the screen resolution, (occlusion, view depth)
+	GLuint _ssaoKernelBuffer;
+	engine::ShaderProgram _ssaoShader;
+	engine::ShaderProgram _ssaoBlurShader;
+	bool _bSsao;
+	GLuint _frameIndex;
 
-		float aspect = static_cast<float>(ShadowWidth) / static_cast<float>(ShadowHeight);
-		float near = 1.0f;
-		float far = 1000.0f;
-		_shadowProjection = glm::perspective(glm::radians(90.0f), aspect, near, far);
+	GBuffer::Layout _gBufferLayout;
 
-		glGenFramebuffers(1, &_depthmapFb);
-		glBindFramebuffer(GL_FRAMEBUFFER, _depthmapFb);
+	/// Lowers the render resolution, then the SSAO and shadows, when the GPU is over budget
+	engine::ResolutionGovernor _governor;
 
-		glGenTextures(1, &_depthCubemap);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubemap);
-		for (size_t face = 0; face < 6; face++) {
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT, ShadowWidth, ShadowHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-		}
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	/// Stretches the scene over the back buffer when it is rendered below the display size
+	engine::ShaderProgram _upscaleShader;
+	GLuint _linearSampler;
+	bool _bBicubicUpscale;
 
-		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, _depthCubemap, 0);
-		glDrawBuffer(GL_NONE);
-		glReadBuffer(GL_NONE);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	}
+	/// Depth-only pass run before the G-buffer so that each pixel is shaded once
+	engine::ShaderProgram _depthOpaque;
+	engine::ShaderProgram _depthAlphaTested;
+	bool _bDepthPrepass;
 
-	void BindShadowMap()
-	{
-		glViewport(0, 0, ShadowWidth, ShadowHeight);
-		glBindFramebuffer(GL_FRAMEBUFFER, _depthmapFb);
-	}
+	engine::GpuQuery _prepassFragments;
+	engine::GpuQuery _geometryFragments;
 
-	void UnbindShadowMap()
-	{
-		auto display = engine::Engine::Instance().GetDisplay();
-		auto [ width, height ] = std::tuple(display->getWidth(), display->getHeight());
+	engine::ShadowAtlas _shadowAtlas;
+	engine::ClusteredLighting _clusteredLighting;
+	engine::MaterialTable _materialTable;
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glViewport(0, 0, width, height);
-	}
+	std::vector<engine::PointLightData> _pointLights;
+
+	Callback<> buildShadowMap;
+	Callback<bool> setCompactGBuffer;
+	Callback<bool> setDepthPrepass;
+	Callback<bool> setSsao;
+	Callback<size_t> setShadowFilter;
+	Callback<bool> setShadowDepth32;
+	Callback<bool> setOcclusionCulling;
+	Callback<bool> setGpuCulling;
+	Callback<engine::GovernorSettings const &> setGovernorSettings;
+	Callback<bool> setBicubicUpscale;
+
+	/// The shadow tiers are bound to consecutive units starting here
+	static constexpr GLuint ShadowTextureUnit = 6;
+
+	/// Size of the directional light array of light.fs.glsl
+	static constexpr size_t MaxDirectionalLights = 1;
+
+	/// Features of the lighting pass permutations
+	enum LightFeatures : ShaderFeatures {
+		LightCompactGBuffer = 1 << 0,
+		LightSsao           = 1 << 1,
+	};
+
+	/// SSAO runs at the render resolution divided by this, the reduced quality divides it again
+	static constexpr int SsaoDownscale = 2;
+	static constexpr int ReducedSsaoDownscale = 4;
+
+	/// Must match KERNEL_SIZE and the uniform block binding in ssao.fs.glsl
+	static constexpr size_t SsaoKernelSize = 16;
+	static constexpr size_t ReducedSsaoSamples = 8;
+	static constexpr GLuint SsaoKernelBinding = 0;
+
+	/// Irradiance under which a light is considered to have no influence
+	static constexpr float LightCutoff = 0.05f;
+
+	/// Projected radius, as a fraction of the screen height, under which LOD 1 is used.
+	/// Each halving of the size moves one level coarser.
+	static constexpr float LodScreenSize = 0.5f;
+
+	/// Relative change of the size needed to switch to another level, avoids popping back and forth
+	static constexpr float LodHysteresis = 0.1f;
+
+	/// Level of detail of the shadow passes, it does not follow the camera so that moving
+	/// around never invalidates the cached static shadows
+	static constexpr size_t ShadowLodBias = 1;
+
+	/// Fixed-function state of each pass
+	static constexpr engine::PipelineState DepthPrepass = { true,  true,  GL_LESS,   false };
+	static constexpr engine::PipelineState GeometryPass = { true,  true,  GL_LEQUAL, false };
+	static constexpr engine::PipelineState GeometryPassEqual = { true, false, GL_EQUAL, false };
+	static constexpr engine::PipelineState LightPass    = { false, true,  GL_LEQUAL, false };
+	static constexpr engine::PipelineState ForwardPass  = { true,  true,  GL_LEQUAL, true };
 
 	void InitQuad()
 	{
@@ -127,75 +182,91 @@ private:
 	void InitFramebuffer()
 	{
 		InitQuad();
+
+		// Fullscreen passes generate their vertices from gl_VertexID
+		glGenVertexArrays(1, &_emptyVao);
 	}
 
-	void InitBillboard()
+	void DrawFullscreenQuad()
 	{
-		_billboard.addVertexShader("shaders/billboard.vs.glsl")
-			.addFragmentShader("shaders/billboard.fs.glsl")
-			.link();
+		engine::GLState::Instance().BindVertexArray(_emptyVao);
+		engine::gl::DrawArrays(GL_TRIANGLE_FAN, 0, 4);
 	}
 
-	void InitSSAO()
+	void InitDepthPrepass()
 	{
-		auto display = engine::Engine::Instance().GetDisplay();
-		auto [ width, height ] = std::tuple(display->getWidth(), display->getHeight());
-
-		_ssaoShader.addVertexShader("shaders/ssao.vs.glsl")
-			.addFragmentShader("shaders/ssao.fs.glsl")
-			.link();
-		assert(_ssaoShader.isValid());
+		// No fragment stage, only the depth is written
+		_depthOpaque.AddVertexShader("shaders/depth.vs.glsl").Link();
 
-		glGenFramebuffers(1, &_ssaoFb);
-		glBindFramebuffer(GL_FRAMEBUFFER, _ssaoFb);
+		_depthAlphaTested.AddVertexShader("shaders/depth.vs.glsl")
+			.AddFragmentShader("shaders/depthalpha.fs.glsl")
+			.Link();
+		_depthAlphaTested.SetUniform1i("albedo", 0);
 
-		glGenTextures(1, &_ssaoColorBuf);
-		glBindTexture(GL_TEXTURE_2D, _ssaoColorBuf);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		if (!_depthOpaque.IsValid() || !_depthAlphaTested.IsValid()) {
+			Logger::Warn("Depth pre-pass shaders unavailable, pre-pass disabled\n");
+			_bDepthPrepass = false;
+		}
+	}
 
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _ssaoColorBuf, 0);
-		assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	void InitBillboard()
+	{
+		_billboard.AddVertexShader("shaders/billboard.vs.glsl")
+			.AddFragmentShader("shaders/billboard.fs.glsl")
+			.Link();
+	}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	void InitSSAO()
+	{
+		_ssaoShader.AddVertexShader("shaders/ssao.vs.glsl")
+			.AddFragmentShader("shaders/ssao.fs.glsl")
+			.Link();
+		_ssaoShader.SetUniform1i("gNormal", 0);
+		_ssaoShader.SetUniform1i("gDepth", 1);
+		_ssaoShader.SetUniform1f("radius", 0.5f);
+		_ssaoShader.SetUniform1f("bias", 0.025f);
+
+		_ssaoBlurShader.AddVertexShader("shaders/ssao.vs.glsl")
+			.AddFragmentShader("shaders/ssaoblur.fs.glsl")
+			.Link();
+		_ssaoBlurShader.SetUniform1i("ssaoInput", 0);
+
+		if (!_ssaoShader.IsValid() || !_ssaoBlurShader.IsValid()) {
+			Logger::Warn("SSAO shaders unavailable, SSAO disabled\n");
+			_bSsao = false;
+		}
 
 		GenSSAOKernel();
+	}
 
-		_ssaoShader.bind();
-		_ssaoShader.setUniform1i("gPosition", 0);
-		_ssaoShader.setUniform1i("gNormal", 1);
-		_ssaoShader.setUniform1i("texNoise", 2);
-		_ssaoShader.unbind();
-
-		_ssaoBlurShader.addVertexShader("shaders/ssao.vs.glsl")
-			.addFragmentShader("shaders/ssaoblur.fs.glsl")
-			.link();
-		_ssaoBlurShader.bind();
-		_ssaoBlurShader.setUniform1i("ssaoInput", 0);
-
-		glGenFramebuffers(1, &_ssaoBlurFb);
-		glBindFramebuffer(GL_FRAMEBUFFER, _ssaoBlurFb);
-
-		glGenTextures(1, &_ssaoBlurFb);
-		glBindTexture(GL_TEXTURE_2D, _ssaoBlurFb);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _ssaoColorBuf, 0);
+	void InitUpscale()
+	{
+		_upscaleShader.AddVertexShader("shaders/ssao.vs.glsl")
+			.AddFragmentShader("shaders/upscale.fs.glsl")
+			.Link();
+		_upscaleShader.SetUniform1i("scene", 0);
+
+		// The targets of the render graph are sampled with nearest filtering
+		glCreateSamplers(1, &_linearSampler);
+		glSamplerParameteri(_linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glSamplerParameteri(_linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glSamplerParameteri(_linearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glSamplerParameteri(_linearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	}
 
 	void GenSSAOKernel()
 	{
 		std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f);
 		std::default_random_engine generator;
-		std::vector<glm::vec3> ssaoKernel;
+
+		// std140 arrays have a vec4 stride
+		std::array<glm::vec4, SsaoKernelSize> ssaoKernel;
 
 		auto lerp = [] (float a, float b, float f) -> float {
 			return a + f * (b - a);
 		};
 
-		for (size_t i = 0; i < 64; i++) {
+		for (size_t i = 0; i < SsaoKernelSize; i++) {
 			glm::vec3 sample(randomFloats(generator) * 2.0f - 1.0f,
 							 randomFloats(generator) * 2.0f - 1.0f,
 							 randomFloats(generator));
@@ -203,211 +274,425 @@ private:
 			sample *= randomFloats(generator);
 
 			// Make distribution closer to origin
-			float scale = static_cast<float>(i) / 64.0f;
+			float scale = static_cast<float>(i) / SsaoKernelSize;
 			scale = lerp(0.1f, 1.0f, scale * scale);
 			sample *= scale;
 
-			ssaoKernel.push_back(sample);
+			ssaoKernel[i] = glm::vec4(sample, 0.0f);
 		}
 
-		std::array<glm::vec3, 64> ssaoNoise;
-		for (size_t i = 0; i < 64; i++) {
-			glm::vec3 noise(randomFloats(generator) * 2.0f - 1.0f,
-							randomFloats(generator) * 2.0f - 1.0f,
-							0.0f);
-			ssaoNoise[i] = noise;
-		}
+		glCreateBuffers(1, &_ssaoKernelBuffer);
+		glNamedBufferStorage(_ssaoKernelBuffer, sizeof(ssaoKernel), ssaoKernel.data(), 0);
+	}
+
+	///
+	/// Occlusion at reduced resolution followed by a separable depth-aware blur
+	///
+	/// The result stays at reduced resolution, the lighting pass upsamples it with
+	/// the full resolution depth. The occlusion and the blurred result share a texture.
+	///
+	engine::RenderGraph::Handle AddSsaoPasses(GBuffer const &gBuffer, PlayerCameraComponent const &camera,
+		engine::RenderQuality const &quality)
+	{
+		int const downscale = quality.bReducedSsao ? ReducedSsaoDownscale : SsaoDownscale;
+		int const samples = quality.bReducedSsao ? ReducedSsaoSamples : SsaoKernelSize;
+
+		engine::TextureDesc const desc = { GL_RG16F, quality.RenderScale / downscale };
+		bool const bCompact = gBuffer.IsCompact();
+
+		auto occlusion = _graph.Create("SSAO", desc);
+		auto horizontal = _graph.Create("SSAO blur", desc);
+		auto result = _graph.Create("Ambient occlusion", desc);
+
+		auto ssao = _graph.AddPass("SSAO", [this, &camera, gBuffer, bCompact, samples] (auto const &resources) {
+			auto &state = engine::GLState::Instance();
+
+			state.Apply(LightPass);
+
+			_ssaoShader.SetUniform1i("compactGBuffer", bCompact);
+			_ssaoShader.SetUniform1i("sampleCount", samples);
+			_ssaoShader.SetUniform1ui("frameIndex", _frameIndex);
+			_ssaoShader.SetUniform4x4f("projectionMatrix", camera.projection);
+			_ssaoShader.SetUniform4x4f("inverseProjection", glm::inverse(camera.projection));
+			_ssaoShader.SetUniform4x4f("viewMatrix", camera.view);
+			_ssaoShader.Bind();
+
+			glBindBufferBase(GL_UNIFORM_BUFFER, SsaoKernelBinding, _ssaoKernelBuffer);
+			state.BindTexture(0, resources.GetTexture(gBuffer.Normal));
+			state.BindTexture(1, resources.GetTexture(gBuffer.Depth));
+			DrawFullscreenQuad();
+		});
+		ssao.Read(gBuffer.Normal);
+		ssao.Read(gBuffer.Depth);
+		occlusion = ssao.Write(occlusion);
+
+		auto addBlur = [this] (char const *name, engine::RenderGraph::Handle input, engine::RenderGraph::Handle output,
+			glm::vec2 const &axis)
+		{
+			auto blur = _graph.AddPass(name, [this, input, axis] (auto const &resources) {
+				engine::GLState::Instance().Apply(LightPass);
+				_ssaoBlurShader.SetUniform2f("direction", axis / glm::vec2(resources.GetSize(input)));
+				_ssaoBlurShader.Bind();
+				engine::GLState::Instance().BindTexture(0, resources.GetTexture(input));
+				DrawFullscreenQuad();
+			});
+			blur.Read(input);
+			return blur.Write(output);
+		};
+
+		horizontal = addBlur("SSAO blur X", occlusion, horizontal, glm::vec2(1.0f, 0.0f));
+		return addBlur("SSAO blur Y", horizontal, result, glm::vec2(0.0f, 1.0f));
+	}
 
-		glGenTextures(1, &_ssaoNoiseTex);
-		glBindTexture(GL_TEXTURE_2D, _ssaoNoiseTex);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, 4, 4, 0, GL_RGB, GL_FLOAT, &ssaoNoise[0]);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	static glm::mat4 ModelMatrix(TransformComponent const &transform)
+	{
+		glm::mat4 modelMatrix(1.0f);
+		modelMatrix = glm::translate(modelMatrix, transform.position);
+		modelMatrix = glm::scale(modelMatrix, transform.scale);
+
+		return modelMatrix;
+	}
 
-		_ssaoShader.bind();
-//		GLuint sampleLoc = _ssaoShader.getUniformLocation("samples");
-		for (size_t i = 0; i < 64; i++) {
-			_ssaoShader.setUniform3f("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
+	/// Material id of a mesh of `model`
+	static unsigned int FindMaterial(ModelComponent const &model, engine::Mesh const &mesh)
+	{
+		return model.Material.value_or(mesh.GetPbrMaterial().value_or(engine::Engine::DefaultPbrMaterial));
+	}
+
+	static bool IsAlphaTested(unsigned int materialId)
+	{
+		auto const *material = engine::Engine::Instance().GetPbrMaterial(materialId);
+		return material != nullptr && material->bAlphaTested;
+	}
+
+	///
+	/// Level of detail for a mesh of projected radius `screenSize`, `current` is the level of
+	/// the last frame. Switching only happens once the size is past the threshold by LodHysteresis.
+	///
+	static size_t SelectLod(float screenSize, size_t current, size_t lodCount)
+	{
+		auto ideal = [lodCount] (float size) -> size_t {
+			if (size >= LodScreenSize) { return 0; }
+			if (size <= 0.0f) { return lodCount - 1; }
+
+			float const halvings = std::floor(std::log2(LodScreenSize / size)) + 1.0f;
+			return std::min(static_cast<size_t>(halvings), lodCount - 1);
+		};
+
+		current = std::min(current, lodCount - 1);
+		size_t const target = ideal(screenSize);
+
+		if (target > current) {
+			return std::max(current, ideal(screenSize * (1.0f + LodHysteresis)));
 		}
-//		glUniform3fv(sampleLoc, 64, &ssaoKernel[0][0]);
-		_ssaoShader.unbind();
+		if (target < current) {
+			return std::min(current, ideal(screenSize * (1.0f - LodHysteresis)));
+		}
+		return current;
 	}
 
-	void RenderSSAO(PlayerCameraComponent const &camera)
+	///
+	/// Gather the meshes of every model and upload them as indirect draws
+	///
+	/// Meshes of entities with a DynamicComponent go in the dynamic queue, the others in
+	/// the static one. The world bounds of both sets are compared with the last frame's
+	/// to find out what the shadow map has to render again.
+	///
+	/// Each mesh picks its level of detail from its size on screen, the level is kept per
+	/// mesh rather than per entity so that the parts of a large model close to the camera
+	/// stay detailed.
+	///
+	void BuildDrawQueue(PlayerCameraComponent const &camera, glm::vec3 const &cameraPos)
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, _ssaoFb);
-		_ssaoShader.bind();
-		_ssaoShader.setUniform1i("gPosition", 0);
-		_ssaoShader.setUniform1i("gNormal", 1);
-		_ssaoShader.setUniform1i("texNoise", 2);
+		auto models = GetEntities<ModelComponent, TransformComponent>();
+
+		_staticQueue.Clear();
+		_dynamicQueue.Clear();
+
+		std::vector<engine::Aabb> staticBounds;
+		std::vector<engine::Aabb> dynamicBounds;
+		staticBounds.reserve(_staticBounds.size());
+		dynamicBounds.reserve(_dynamicBounds.size());
+
+		// Entities that are gone are dropped with the old map
+		std::unordered_map<unsigned int, std::vector<size_t>> lods;
+		lods.reserve(_lods.size());
+
+		for (auto const &entity : models) {
+
+			auto const [ model, transform ] = entity->GetAll();
+			bool const bIsDynamic = entity->HasComponents<DynamicComponent>();
+
+			glm::mat4 const modelMatrix = ModelMatrix(transform);
+			glm::mat4 const normalMatrix = glm::transpose(glm::inverse(modelMatrix));
+
+			auto const previous = _lods.find(entity->GetId());
+			auto &entityLods = lods[entity->GetId()];
+			entityLods.assign(model.Meshes.size(), 0);
+
+			for (size_t meshIndex = 0; meshIndex < model.Meshes.size(); meshIndex++) {
+
+				auto meshCast = dynamic_cast<engine::Mesh*>(engine::Engine::Instance().GetMesh(model.Meshes[meshIndex]));
+				if (meshCast == nullptr) { continue ; }
+
+				engine::DrawData data{};
+					data.Model = modelMatrix;
+					data.Normal = normalMatrix;
+					data.MaterialId = FindMaterial(model, *meshCast);
+
+				engine::DrawQueue::BucketKey key{ model.Shader, data.MaterialId };
+					key.AlphaTested = IsAlphaTested(data.MaterialId);
+
+				engine::Aabb const bounds = engine::Aabb(meshCast->GetBoundsMin(), meshCast->GetBoundsMax())
+					.Transform(modelMatrix);
+
+				float const radius = glm::length(bounds.Max - bounds.Min) * 0.5f;
+				float const distance = glm::distance(cameraPos, (bounds.Min + bounds.Max) * 0.5f);
+				float const screenSize = distance <= radius ? 1.0f : radius * camera.projection[1][1] / distance;
+
+				size_t const lodCount = meshCast->GetLodCount();
+				size_t const current = (previous != _lods.end() && meshIndex < previous->second.size())
+					? previous->second[meshIndex] : 0;
+				size_t const lod = SelectLod(screenSize, current, lodCount);
+				size_t const shadowLod = std::min(ShadowLodBias, lodCount - 1);
+
+				entityLods[meshIndex] = lod;
+
+				if (bIsDynamic) {
+					_dynamicQueue.Submit(*meshCast, data, key, bounds, lod, shadowLod);
+					dynamicBounds.push_back(bounds);
+				}
+				else {
+					_staticQueue.Submit(*meshCast, data, key, bounds, lod, shadowLod);
+					staticBounds.push_back(bounds);
+				}
+			}
+		}
 
-		glClear(GL_COLOR_BUFFER_BIT);
-		glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, _gBuffer.GetPositionTex());
-		glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, _gBuffer.GetNormalTex());
-		glActiveTexture(GL_TEXTURE2);
-			glBindTexture(GL_TEXTURE_2D, _ssaoNoiseTex);
+		_staticQueue.Upload();
+		_dynamicQueue.Upload();
 
-		_ssaoShader.setUniform4x4f("projectionMatrix", camera.projection);
-		_ssaoShader.setUniform4x4f("viewMatrix", camera.view);
-		_quad.Draw();
+		_materialTable.Update(engine::Engine::Instance().GetPbrMaterials());
+		_materialTable.Bind();
+
+		// New materials get their shader variant compiled while the rest of the frame is recorded
+		bool const bCompactGBuffer = _gBufferLayout == GBuffer::Layout::Compact;
+		for (auto const *queue : { &_staticQueue, &_dynamicQueue }) {
+			for (auto const &bucket : queue->GetBuckets()) {
+				ShaderManager::instance().Prepare(bucket.Key.Shader, GetMeshFeatures(bucket.Key, bCompactGBuffer));
+			}
+		}
 
-		glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, 0);
-		glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, 0);
-		glActiveTexture(GL_TEXTURE2);
-			glBindTexture(GL_TEXTURE_2D, 0);
-		_ssaoShader.unbind();
+		// The cached static shadows are drawn with the old casters
+		if (staticBounds != _staticBounds) {
+			_shadowAtlas.Invalidate();
+		}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-//		glBindFramebuffer(GL_FRAMEBUFFER, _ssaoBlurFb);
-//
-//		_ssaoBlurShader.bind();
-//		_ssaoBlurShader.setUniform1i("ssaoInput", 0);
-//		glActiveTexture(GL_TEXTURE0);
-//		glBindTexture(GL_TEXTURE_2D, _ssaoColorBuf);
-//		_quad.Draw();
-//		glBindTexture(GL_TEXTURE_2D, 0);
-//		_ssaoShader.unbind();
+		// Both the old and new bounds of a moving caster need to be redrawn
+		_changedBounds.clear();
+		if (dynamicBounds.size() != _dynamicBounds.size()) {
+			_changedBounds.insert(_changedBounds.end(), _dynamicBounds.begin(), _dynamicBounds.end());
+			_changedBounds.insert(_changedBounds.end(), dynamicBounds.begin(), dynamicBounds.end());
+		}
+		else {
+			for (size_t i = 0; i < dynamicBounds.size(); i++) {
+				if (dynamicBounds[i] != _dynamicBounds[i]) {
+					_changedBounds.push_back(_dynamicBounds[i]);
+					_changedBounds.push_back(dynamicBounds[i]);
+				}
+			}
+		}
 
-//		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		_staticBounds = std::move(staticBounds);
+		_dynamicBounds = std::move(dynamicBounds);
+		_lods = std::move(lods);
 	}
 
-	void RenderShadowMeshes()
+	///
+	/// Hide the draws of the camera passes that are behind the occluders
+	///
+	/// The occluders are rasterized on the CPU from the camera, then both queues keep the
+	/// meshes whose bounds are not hidden. The shadow passes still see every mesh.
+	///
+	/// With GPU culling the queues are culled against the frustum and the depth of the
+	/// previous frame in a compute shader instead, the result never comes back to the CPU.
+	///
+	void CullOccluded(PlayerCameraComponent const &camera)
 	{
-		auto entities = GetEntities<ModelComponent, TransformComponent>();
+		auto &stats = engine::RenderStats::Instance();
 
-		for (auto const entity: entities) {
+		if (_bGpuCulling) {
+			engine::Frustum const frustum(camera.projection * camera.view);
 
-			auto [ model, transform ] = entity->GetAll();
+			_staticQueue.CullGpu(frustum, _bOcclusionCulling);
+			_dynamicQueue.CullGpu(frustum, _bOcclusionCulling);
 
-			for (auto const meshId : model.Meshes) {
+			stats.OccluderTriangles = 0;
+			stats.OccludedDraws = 0;
+			return ;
+		}
 
-				auto const *mesh = engine::Engine::Instance().GetMesh(meshId);
+		if (!_bOcclusionCulling) {
+			stats.OccluderTriangles = 0;
+			stats.OccludedDraws = 0;
+			return ;
+		}
 
-				glm::mat4 model(1.0f);
-				model = glm::translate(model, transform.position);
-				model = glm::scale(model, transform.scale);
-				_shadow.setUniform4x4f("modelMatrix", model);
+		_occlusionCuller.BeginFrame(camera.projection * camera.view);
 
-				mesh->Draw();
+		for (auto const &entity : GetEntities<ModelComponent, TransformComponent, OccluderComponent>()) {
+
+			auto const [ model, transform, occluder ] = entity->GetAll();
+			glm::mat4 const modelMatrix = ModelMatrix(transform);
+
+			for (auto const meshId : occluder.Meshes.empty() ? model.Meshes : occluder.Meshes) {
+
+				auto meshCast = dynamic_cast<engine::Mesh*>(engine::Engine::Instance().GetMesh(meshId));
+
+				// Alpha-tested surfaces have holes
+				if (meshCast == nullptr || IsAlphaTested(FindMaterial(model, *meshCast))) { continue ; }
+
+				_occlusionCuller.AddOccluder(meshCast->GetPositions(), meshCast->GetIndices(), modelMatrix);
 			}
+		}
+
+		_occlusionCuller.Rasterize();
 
+		auto isVisible = [this] (engine::Aabb const &bounds) {
+			return _occlusionCuller.IsVisible(bounds);
+		};
+
+		stats.OccluderTriangles = _occlusionCuller.GetTriangleCount();
+		stats.OccludedDraws = _staticQueue.Cull(isVisible) + _dynamicQueue.Cull(isVisible);
+	}
+
+	/// Variant of the mesh shader drawing a bucket, see MaterialFeatures
+	ShaderFeatures GetMeshFeatures(engine::DrawQueue::BucketKey const &key, bool bCompactGBuffer) const
+	{
+		ShaderFeatures features = 0;
+
+		if (bCompactGBuffer) {
+			features |= CompactGBuffer;
 		}
+
+		// After the pre-pass the GL_EQUAL depth test rejects the holes
+		if (key.AlphaTested && !_bDepthPrepass) {
+			features |= AlphaTest;
+		}
+
+		auto const *material = engine::Engine::Instance().GetPbrMaterial(key.Material);
+		if (material == nullptr) { return features; }
+
+		if (material->AlbedoTexture != 0) {
+			features |= AlbedoMap;
+		}
+		if (material->MetallicRoughnessTexture != 0) {
+			features |= MetallicRoughnessMap;
+		}
+		if (material->NormalTexture != 0) {
+			features |= NormalMap;
+		}
+
+		return features;
 	}
 
-	int x = 0;
-	int y = 0;
+	void BindPbrTextures(unsigned int materialId)
+	{
+		auto &state = engine::GLState::Instance();
+		auto const *material = engine::Engine::Instance().GetPbrMaterial(materialId);
+
+		// The variants without a map do not sample it
+		if (material == nullptr) { return ; }
 
-	void RenderMeshes(PlayerCameraComponent const &camera, TransformComponent const &playerTransform)
+		if (material->AlbedoTexture != 0) {
+			state.BindTexture(0, material->AlbedoTexture);
+		}
+		if (material->MetallicRoughnessTexture != 0) {
+			state.BindTexture(1, material->MetallicRoughnessTexture);
+		}
+		if (material->NormalTexture != 0) {
+			state.BindTexture(2, material->NormalTexture);
+		}
+	}
+
+	void RenderMeshes(PlayerCameraComponent const &camera, TransformComponent const &playerTransform, bool bCompactGBuffer)
 	{
-		auto models = GetEntities<ModelComponent, TransformComponent>();
+		engine::ShaderProgram *current = nullptr;
 
-		x = 0;
-		y = 0;
+		auto bindBucket = [&] (engine::DrawQueue::BucketKey const &key) {
 
-		for (auto const &entity : models) {
+			auto shader = ShaderManager::instance().Get(key.Shader, GetMeshFeatures(key, bCompactGBuffer)).value();
 
-			auto const [ model, transform ] = entity->GetAll();
+			if (shader != current) {
+				shader->Bind();
+				shader->SetUniform4x4f("viewProjectionMatrix", camera.viewProjection);
+				shader->SetUniform4x4f("viewMatrix", camera.view);
+				shader->SetUniform4x4f("projectionMatrix", camera.projection);
+				shader->SetUniform3f("viewPos", playerTransform.position);
+				current = shader;
+			}
 
-			for (auto const meshId : model.Meshes) {
-
-				auto const mesh = engine::Engine::Instance().GetMesh(meshId);
-				auto const shaderId = model.Shader;
-				auto shader = ShaderManager::instance().Get(shaderId).value();
-
-				shader->bind();
-				shader->setUniform4x4f("viewProjectionMatrix", camera.viewProjection);
-				shader->setUniform4x4f("viewMatrix", camera.view);
-				shader->setUniform4x4f("projectionMatrix", camera.projection);
-				shader->setUniform3f("viewPos", playerTransform.position);
-
-				UpdateLight(*shader);
-
-				glm::mat4 modelMatrix(1.0f);
-				modelMatrix = glm::translate(modelMatrix, transform.position);
-				modelMatrix = glm::scale(modelMatrix, transform.scale);
-				shader->setUniform4x4f("modelMatrix", modelMatrix);
-
-				std::vector<TextureAutoBind> textureBindings;
-
-				// Bind each texture
-				auto meshCast = dynamic_cast<engine::Mesh*>(mesh);
-				if (meshCast != nullptr) {
-					if (meshCast->GetPbrMaterial().has_value()) {
-
-						auto material = engine::Engine::Instance().GetPbrMaterial(
-							meshCast->GetPbrMaterial().value());
-
-						if (material.has_value()) {
-							auto m = material.value();
-
-							shader->setUniform4f("material.baseColor", m->BaseColor);
-							shader->setUniform1f("material.metallicFactor", m->MetallicFactor);
-							shader->setUniform1f("material.roughnessFactor", m->RoughnessFactor);
-
-							if (model.Name.find("PBR Sphere") != std::string::npos) {
-
-								shader->setUniform1f("material.metallicFactor", (1.0f/6.0f) * x);
-								shader->setUniform1f("material.roughnessFactor",(1.0f/6.0f) * y);
-
-								x += 1;
-
-								if (x >= 6) {
-									x = 0;
-									y += 1;
-								}
-								if (y >= 6) {
-									y = 0;
-								}
-							}
-
-							if (m->Albedo.has_value()) {
-								auto albedo = m->Albedo.value();
-								auto texture = TextureManager::instance().get(albedo);
-
-								shader->setUniform1i("material.hasAlbedo", 1);
-								textureBindings.push_back(TextureAutoBind(GL_TEXTURE0, GL_TEXTURE_2D, texture));
-							}
-							else {
-								shader->setUniform1i("material.hasAlbedo", 0);
-							}
-
-							if (m->MetallicRoughness.has_value()) {
-								auto metallicRoughness = m->MetallicRoughness.value();
-								auto texture = TextureManager::instance().get(metallicRoughness);
-
-								shader->setUniform1i("material.hasMetallicRoughness", 1);
-								textureBindings.push_back(TextureAutoBind(GL_TEXTURE1, GL_TEXTURE_2D, texture));
-							}
-							else {
-								shader->setUniform1i("material.hasMetallicRoughness", 0);
-							}
-
-							if (m->Normal.has_value()) {
-								auto normal = m->Normal.value();
-								auto texture = TextureManager::instance().get(normal);
-
-								textureBindings.push_back(TextureAutoBind(GL_TEXTURE2, GL_TEXTURE_2D, texture));
-							}
-							else {
-								auto const defaultNormal = TextureManager::instance().get("default_normal");
-								textureBindings.push_back(TextureAutoBind(GL_TEXTURE2, GL_TEXTURE_2D, defaultNormal));
-							}
-						}
-					}
-				}
+			BindPbrTextures(key.Material);
+		};
 
-				mesh->Draw();
-				shader->unbind();
+		_staticQueue.Draw(bindBucket);
+		_dynamicQueue.Draw(bindBucket);
+	}
+
+	///
+	/// Fill the depth buffer so the G-buffer pass only shades the visible fragments
+	///
+	void RenderDepthPrepass(PlayerCameraComponent const &camera)
+	{
+		auto &state = engine::GLState::Instance();
+
+		_depthOpaque.SetUniform4x4f("viewProjectionMatrix", camera.viewProjection);
+		_depthOpaque.Bind();
+		_staticQueue.DrawOpaque();
+		_dynamicQueue.DrawOpaque();
+
+		auto bindAlbedo = [&] (engine::DrawQueue::BucketKey const &key) {
+			if (auto const *material = engine::Engine::Instance().GetPbrMaterial(key.Material)) {
+				state.BindTexture(0, material->AlbedoTexture);
 			}
+		};
+
+		_depthAlphaTested.SetUniform4x4f("viewProjectionMatrix", camera.viewProjection);
+		_depthAlphaTested.Bind();
+		_staticQueue.DrawAlphaTested(bindAlbedo);
+		_dynamicQueue.DrawAlphaTested(bindAlbedo);
+	}
 
+	///
+	/// G-buffer pass, preceded by the depth pre-pass when it is enabled
+	///
+	void AddGeometryPasses(GBuffer &gBuffer, PlayerCameraComponent const &camera, TransformComponent const &transform)
+	{
+		bool const bCompact = gBuffer.IsCompact();
+		bool const bPrepass = _bDepthPrepass;
+
+		if (bPrepass) {
+			auto prepass = _graph.AddPass("Depth pre-pass", [this, &camera] (auto const &) {
+				engine::GLState::Instance().Apply(DepthPrepass);
+				glClear(GL_DEPTH_BUFFER_BIT);
+
+				_prepassFragments.Begin();
+					RenderDepthPrepass(camera);
+				_prepassFragments.End();
+			});
+			gBuffer.Depth = prepass.Write(gBuffer.Depth);
 		}
+
+		auto geometry = _graph.AddPass("Geometry", [this, &camera, &transform, bCompact, bPrepass] (auto const &) {
+			engine::GLState::Instance().Apply(bPrepass ? GeometryPassEqual : GeometryPass);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(bPrepass ? GL_COLOR_BUFFER_BIT : GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+
+			_geometryFragments.Begin();
+				RenderMeshes(camera, transform, bCompact);
+			_geometryFragments.End();
+		});
+		gBuffer.Write(geometry);
 	}
 
 	void RenderSkybox(PlayerCameraComponent const &camera)
@@ -421,48 +706,38 @@ private:
 
 		auto shader = ShaderManager::instance().Get(meshComponent.Shader).value();
 
-		shader->bind();
-		shader->setUniform4x4f("viewMatrix", glm::mat4(glm::mat3(camera.view)));
-		shader->setUniform4x4f("projectionMatrix", camera.projection);
+		auto &state = engine::GLState::Instance();
+
+		shader->Bind();
+		shader->SetUniform4x4f("viewMatrix", glm::mat4(glm::mat3(camera.view)));
+		shader->SetUniform4x4f("projectionMatrix", camera.projection);
 
-		glDepthMask(GL_FALSE);
+		state.DepthWrite(false);
 		TextureManager::instance().bind("skybox-cubemap", 0);
 		mesh->Draw();
-		glDepthMask(GL_TRUE);
-
-		shader->unbind();
+		state.DepthWrite(true);
 	}
 
-	void UpdateLight(lazy::graphics::Shader &shader)
+	/// `renderSize` is the size of the G-buffer, the clusters are found from gl_FragCoord
+	void UpdateLight(engine::ShaderProgram &shader, glm::vec2 const &renderSize)
 	{
-		auto lights = GetEntities<PointLightComponent, TransformComponent>();
-
-		if (lights.size() == 0) { return ; }
-
-		shader.setUniform1i("pointLightCount", lights.size());
-
-		for (size_t i = 0; i < lights.size(); i++) {
-			auto [ light, transform ] = lights[i]->GetAll();
-
-			std::string pointLight = "pointLight[" + std::to_string(i) + "]";
-
-			shader.setUniform3f(pointLight + ".position", transform.position);
-			shader.setUniform3f(pointLight + ".color", light.Color);
-			shader.setUniform1f(pointLight + ".intensity", light.Intensity);
-		}
+		_clusteredLighting.SetUniforms(shader, renderSize);
+		_clusteredLighting.Bind();
 
 		auto dirLights = GetEntities<DirectionalLightComponent>();
 
-		shader.setUniform1i("directionalLightCount", dirLights.size());
+		size_t const dirLightCount = std::min(dirLights.size(), MaxDirectionalLights);
 
-		for (size_t i = 0; i < dirLights.size(); i++) {
+		shader.SetUniform1i("directionalLightCount", dirLightCount);
+
+		for (size_t i = 0; i < dirLightCount; i++) {
 			auto [ light ] = dirLights[i]->GetAll();
 
 			std::string directionalLight = "directionalLights[" + std::to_string(i) + "]";
 
-			shader.setUniform3f(directionalLight + ".direction", light.Direction);
-			shader.setUniform3f(directionalLight + ".color", light.Color);
-			shader.setUniform1f(directionalLight + ".intensity", light.Intensity);
+			shader.SetUniform3f(directionalLight + ".direction", light.Direction);
+			shader.SetUniform3f(directionalLight + ".color", light.Color);
+			shader.SetUniform1f(directionalLight + ".intensity", light.Intensity);
 		}
 	}
 
@@ -472,123 +747,293 @@ private:
 
 		if (lights.size() == 0 ) { return ; }
 
+		_billboard.Bind();
+		_billboard.SetUniform4x4f("viewMatrix", camera.view);
+		_billboard.SetUniform4x4f("viewProjectionMatrix", camera.viewProjection);
+		_billboard.SetUniform4x4f("projectionMatrix", camera.projection);
+		TextureManager::instance().bind("light_bulb_icon", 0);
+
 		for (auto const &lightEnt : lights) {
 			auto [ light, transform ] = lightEnt->GetAll();
 
-			_billboard.bind();
-			_billboard.setUniform4x4f("viewMatrix", camera.view);
-			_billboard.setUniform4x4f("viewProjectionMatrix", camera.viewProjection);
-			_billboard.setUniform4x4f("projectionMatrix", camera.projection);
-			_billboard.setUniform3f("particlePosition", transform.position);
-
-			TextureManager::instance().bind("light_bulb_icon", 0);
+			_billboard.SetUniform3f("particlePosition", transform.position);
 			_quad.Draw();
-
-			_billboard.unbind();
 		}
 	}
 
-	void RenderLight(glm::vec3 const &viewPos, float const exposure)
+	void RenderLight(PlayerCameraComponent const &camera, glm::vec3 const &viewPos,
+		engine::RenderGraph::Resources const &resources, GBuffer const &gBuffer, engine::RenderGraph::Handle ssao)
 	{
 		// Lighting pass
-		_light.bind();
-			UpdateLight(_light);
-			_light.setUniform1i("gPosition", 0);
-			_light.setUniform1i("gNormal", 1);
-			_light.setUniform1i("gAlbedoSpec", 2);
-			_light.setUniform1i("gSSAO", 3);
-			_light.setUniform1i("gMetallicRoughness", 5);
-			_light.setUniform1i("depthMap", 4);
-			_light.setUniform3f("viewPos", viewPos);
-			_light.setUniform1f("exposure", exposure);
+		auto &state = engine::GLState::Instance();
+
+		ShaderFeatures features = 0;
+		if (gBuffer.IsCompact()) {
+			features |= LightCompactGBuffer;
+		}
+		if (ssao != engine::RenderGraph::Invalid) {
+			features |= LightSsao;
+		}
+
+		auto &light = *ShaderManager::instance().Get(_light, features).value();
+
+		light.Bind();
+			UpdateLight(light, resources.GetSize(gBuffer.Depth));
+			light.SetUniform3f("viewPos", viewPos);
+			light.SetUniform4x4f("viewMatrix", camera.view);
+			light.SetUniform4x4f("inverseViewProjection", glm::inverse(camera.viewProjection));
+			light.SetUniform1f("exposure", camera.exposure);
+			light.SetUniform1f("shadowFarPlane", engine::ShadowAtlas::FarPlane);
+
+			auto const &filter = _shadowAtlas.GetFilterSettings();
+			light.SetUniform1i("shadowTaps", filter.Taps);
+			light.SetUniform1f("shadowRadius", filter.Radius);
+			light.SetUniform1f("shadowTapDistance", filter.TapDistance);
 
 			// Bind GBuffer Textures
-			glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, _gBuffer.GetPositionTex());
-			glActiveTexture(GL_TEXTURE1);
-				glBindTexture(GL_TEXTURE_2D, _gBuffer.GetNormalTex());
-			glActiveTexture(GL_TEXTURE2);
-				glBindTexture(GL_TEXTURE_2D, _gBuffer.GetAlbedoSpecTex());
-			glActiveTexture(GL_TEXTURE3);
-				//glBindTexture(GL_TEXTURE_2D, _ssaoBlurTex);
-				glBindTexture(GL_TEXTURE_2D, _ssaoColorBuf);
-			glActiveTexture(GL_TEXTURE4);
-				glBindTexture(GL_TEXTURE_CUBE_MAP, _depthCubemap);
-			glActiveTexture(GL_TEXTURE5);
-				glBindTexture(GL_TEXTURE_2D, _gBuffer.GetMetallicRoughnessTex());
+			auto texture = [&resources] (engine::RenderGraph::Handle handle) {
+				return handle != engine::RenderGraph::Invalid ? resources.GetTexture(handle) : 0;
+			};
+
+			state.BindTexture(0, texture(gBuffer.Normal));
+			state.BindTexture(1, texture(gBuffer.AlbedoMetallic));
+			state.BindTexture(2, texture(gBuffer.Roughness));
+			state.BindTexture(3, texture(ssao));
+			state.BindTexture(4, texture(gBuffer.Depth));
+			state.BindTexture(5, texture(gBuffer.Position));
+
+			for (size_t tier = 0; tier < engine::ShadowAtlas::Tiers.size(); tier++) {
+				state.BindTexture(ShadowTextureUnit + tier, _shadowAtlas.GetTexture(tier));
+			}
 
-			_quad.Draw();
+			DrawFullscreenQuad();
+	}
 
-			// Unbind Textures
-			glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, 0);
-			glActiveTexture(GL_TEXTURE1);
-				glBindTexture(GL_TEXTURE_2D, 0);
-			glActiveTexture(GL_TEXTURE2);
-				glBindTexture(GL_TEXTURE_2D, 0);
-			glActiveTexture(GL_TEXTURE3);
-				glBindTexture(GL_TEXTURE_2D, 0);
-			glActiveTexture(GL_TEXTURE4);
-				glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-			glActiveTexture(GL_TEXTURE5);
-				glBindTexture(GL_TEXTURE_2D, 0);
-		_light.unbind();
+	/// Depth pyramid of the GPU culling, read by the tests of the next frame
+	void AddHiZPass(GBuffer const &gBuffer, PlayerCameraComponent const &camera)
+	{
+		auto hiZ = _graph.AddPass("Hi-Z", [this, &camera, gBuffer] (auto const &resources) {
+			_gpuCulling.BuildHiZ(resources.GetTexture(gBuffer.Depth), camera.projection * camera.view);
+		});
+		hiZ.Read(gBuffer.Depth);
+		hiZ.SideEffect();
 	}
 
-	void BakeShadowMap()
+	engine::RenderGraph::Handle AddLightingPass(GBuffer const &gBuffer, engine::RenderGraph::Handle ssao,
+		engine::RenderGraph::Handle backbuffer, PlayerCameraComponent const &camera, TransformComponent const &transform)
 	{
-		//Logger::Info("Building shadow map\n");
+		auto light = _graph.AddPass("Lighting", [this, &camera, &transform, gBuffer, ssao] (auto const &resources) {
+			engine::GLState::Instance().Apply(LightPass);
+			glClearColor(0.0f, 0.0, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			RenderLight(camera, transform.position, resources, gBuffer, ssao);
+		});
+		gBuffer.Read(light);
+		if (ssao != engine::RenderGraph::Invalid) {
+			light.Read(ssao);
+		}
+		return light.Write(backbuffer);
+	}
 
-		auto lights = GetEntities<PointLightComponent, TransformComponent>();
-		auto players = GetEntities<PlayerCameraComponent, TransformComponent>();
+	///
+	/// Skybox and billboards, depth tested against the meshes
+	///
+	engine::RenderGraph::Handle AddForwardPass(GBuffer const &gBuffer, engine::RenderGraph::Handle target,
+		PlayerCameraComponent const &camera, bool bBackbuffer)
+	{
+		auto forward = _graph.AddPass("Forward", [this, &camera, gBuffer, bBackbuffer] (auto const &resources) {
+			auto &state = engine::GLState::Instance();
+			glm::ivec2 const size = resources.GetSize(gBuffer.Depth);
+
+			// The depth is attached to the read framebuffer, copy it to the default framebuffer.
+			// A scene color target shares the framebuffer of the depth instead.
+			if (bBackbuffer) {
+				glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			}
 
-		if (lights.size() == 0) return ;
-		if (players.size() == 0) return ;
+			state.Apply(ForwardPass);
+				RenderSkybox(camera);
+				RenderLightBillboard(camera);
+			state.DepthTest(false);
+			state.Blend(false);
+		});
+		forward.Read(gBuffer.Depth, engine::RenderGraph::Access::Attachment);
+		return forward.Write(target);
+	}
 
-		auto playerTransform = players[0]->Get<TransformComponent>();
-		auto lightPos = lights[0]->Get<TransformComponent>().position;
+	///
+	/// Stretch the scene rendered at a lower resolution over the back buffer
+	///
+	engine::RenderGraph::Handle AddUpscalePass(engine::RenderGraph::Handle scene, engine::RenderGraph::Handle backbuffer)
+	{
+		auto upscale = _graph.AddPass("Upscale", [this, scene] (auto const &resources) {
+			auto &state = engine::GLState::Instance();
+
+			state.Apply(LightPass);
+			_upscaleShader.SetUniform1i("bicubic", _bBicubicUpscale);
+			_upscaleShader.Bind();
+			state.BindTexture(0, resources.GetTexture(scene));
+
+			glBindSampler(0, _linearSampler);
+			DrawFullscreenQuad();
+			glBindSampler(0, 0);
+		});
+		upscale.Read(scene);
+		return upscale.Write(backbuffer);
+	}
 
-		std::array<glm::mat4, 6> shadowTransforms = {
-			_shadowProjection * glm::lookAt(lightPos, lightPos + glm::vec3( 1.0, 0.0, 0.0), glm::vec3(0.0,-1.0, 0.0)),
-			_shadowProjection * glm::lookAt(lightPos, lightPos + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0,-1.0, 0.0)),
-			_shadowProjection * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 1.0, 0.0), glm::vec3(0.0, 0.0, 1.0)),
-			_shadowProjection * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0,-1.0, 0.0), glm::vec3(0.0, 0.0,-1.0)),
-			_shadowProjection * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 0.0, 1.0), glm::vec3(0.0,-1.0, 0.0)),
-			_shadowProjection * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 0.0,-1.0), glm::vec3(0.0,-1.0, 0.0)),
-		};
+	///
+	/// Feed the GPU time of the frame to the governor and apply the quality it picks
+	///
+	engine::RenderQuality const &UpdateQuality()
+	{
+		auto &stats = engine::RenderStats::Instance();
 
-		BindShadowMap();
+		stats.GpuFrameTime = engine::Profiler::Instance().GetGpuFrameTime();
+		_governor.Update(stats.GpuFrameTime);
 
-		glDisable(GL_BLEND);
-		glEnable(GL_DEPTH_TEST);
-		glClear(GL_DEPTH_BUFFER_BIT);
+		auto const &quality = _governor.GetQuality();
 
-		_shadow.bind();
-		_shadow.setUniform4x4f("model", glm::mat4(1.0f));
-		glUniformMatrix4fv(_shadow.getUniformLocation("shadowMatrices"), 6, GL_FALSE,
-			(float *)shadowTransforms.data());
-		_shadow.setUniform1f("far_plane", 10000.0f);
-		_shadow.setUniform3f("lightPos", lightPos);
+		_shadowAtlas.SetResolutionShift(quality.ShadowShift);
 
-			RenderShadowMeshes();
+		stats.RenderScale = quality.RenderScale;
+		stats.bReducedSsao = quality.bReducedSsao;
+		stats.ShadowShift = quality.ShadowShift;
 
-		_shadow.unbind();
+		return quality;
+	}
 
-		UnbindShadowMap();
+	///
+	/// Fraction of the screen covered by the sphere of influence of a light
+	///
+	static float ScreenCoverage(PlayerCameraComponent const &camera, glm::vec3 const &cameraPos,
+		glm::vec3 const &position, float radius)
+	{
+		engine::Frustum const frustum(camera.viewProjection);
 
-		//Logger::Info("Done building shadow map\n");
+		if (!frustum.Intersects(engine::Aabb(position - glm::vec3(radius), position + glm::vec3(radius)))) {
+			return 0.0f;
+		}
+
+		float const distance = glm::distance(cameraPos, position);
+
+		if (distance <= radius) { return 1.0f; }
+
+		float const projectedRadius = radius * camera.projection[1][1] /
+			std::sqrt(distance * distance - radius * radius);
+
+		return std::min(projectedRadius * projectedRadius, 1.0f);
+	}
+
+	///
+	/// Cull the point lights per cluster and refresh the shadows of the most important ones
+	///
+	void UpdateLights(PlayerCameraComponent const &camera, glm::vec3 const &cameraPos)
+	{
+		auto lights = GetEntities<PointLightComponent, TransformComponent>();
+
+		std::vector<engine::ShadowAtlas::Request> requests;
+		requests.reserve(lights.size());
+		_pointLights.clear();
+
+		for (auto const &entity : lights) {
+			auto [ light, transform ] = entity->GetAll();
+
+			engine::PointLightData data{};
+				data.Position = transform.position;
+				data.Radius = light.Radius > 0.0f ? light.Radius : std::sqrt(light.Intensity / LightCutoff);
+				data.Color = light.Color;
+				data.Intensity = light.Intensity;
+
+			_pointLights.push_back(data);
+
+			// Coverage weighted by how bright the light is, a dim light casts a faint shadow
+			float const luminance = glm::dot(data.Color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+			float const score = ScreenCoverage(camera, cameraPos, data.Position, data.Radius)
+				* data.Intensity * luminance;
+			requests.push_back(engine::ShadowAtlas::Request{ entity->GetId(), data.Position, score });
+		}
+
+		auto const &assignments = _shadowAtlas.Assign(requests);
+
+		for (size_t i = 0; i < _pointLights.size(); i++) {
+			_pointLights[i].ShadowTier = assignments[i].Tier;
+			_pointLights[i].ShadowLayer = assignments[i].Layer;
+		}
+
+		_clusteredLighting.Update(_pointLights, camera.view, camera.projection);
+
+		engine::Profiler::Instance().BeginPass("Shadows");
+			_shadowAtlas.Update(_staticQueue, _dynamicQueue, _changedBounds);
+		engine::Profiler::Instance().EndPass();
 	}
 
 public:
-	MeshRendererSystem()
+	MeshRendererSystem() : _light(0), _bOcclusionCulling(true), _bGpuCulling(false), _bSsao(true), _frameIndex(0),
+		_gBufferLayout(GBuffer::Layout::Compact), _linearSampler(0), _bBicubicUpscale(true), _bDepthPrepass(true),
+		_prepassFragments(GL_FRAGMENT_SHADER_INVOCATIONS_ARB), _geometryFragments(GL_FRAGMENT_SHADER_INVOCATIONS_ARB)
 	{
-		buildShadowMap = [this] { BakeShadowMap(); };
+		buildShadowMap = [this] {
+			_shadowAtlas.Invalidate();
+		};
 		engine::Engine::Instance().OnBuildLighting += buildShadowMap;
 
+		setCompactGBuffer = [this] (bool bCompact) {
+			_gBufferLayout = bCompact ? GBuffer::Layout::Compact : GBuffer::Layout::Wide;
+		};
+		engine::Engine::Instance().OnCompactGBuffer += setCompactGBuffer;
+
+		setDepthPrepass = [this] (bool bEnabled) {
+			_bDepthPrepass = bEnabled && _depthOpaque.IsValid() && _depthAlphaTested.IsValid();
+		};
+		engine::Engine::Instance().OnDepthPrepass += setDepthPrepass;
+
+		setSsao = [this] (bool bEnabled) {
+			_bSsao = bEnabled && _ssaoShader.IsValid() && _ssaoBlurShader.IsValid();
+		};
+		engine::Engine::Instance().OnSsao += setSsao;
+
+		setShadowFilter = [this] (size_t filter) {
+			_shadowAtlas.SetFilter(static_cast<engine::ShadowAtlas::Filter>(filter));
+		};
+		engine::Engine::Instance().OnShadowFilter += setShadowFilter;
+
+		setShadowDepth32 = [this] (bool bEnabled) {
+			_shadowAtlas.SetDepthFormat(bEnabled
+				? engine::ShadowAtlas::DepthFormat::Depth32F
+				: engine::ShadowAtlas::DepthFormat::Depth16);
+		};
+		engine::Engine::Instance().OnShadowDepth32 += setShadowDepth32;
+
+		setOcclusionCulling = [this] (bool bEnabled) {
+			_bOcclusionCulling = bEnabled;
+			_gpuCulling.Invalidate();
+		};
+		engine::Engine::Instance().OnOcclusionCulling += setOcclusionCulling;
+
+		setGpuCulling = [this] (bool bEnabled) {
+			_bGpuCulling = bEnabled && _gpuCulling.IsSupported();
+			_gpuCulling.Invalidate();
+			_staticQueue.SetGpuCulling(_bGpuCulling ? &_gpuCulling : nullptr);
+			_dynamicQueue.SetGpuCulling(_bGpuCulling ? &_gpuCulling : nullptr);
+		};
+		engine::Engine::Instance().OnGpuCulling += setGpuCulling;
+
+		setGovernorSettings = [this] (engine::GovernorSettings const &settings) {
+			_governor.SetSettings(settings);
+		};
+		engine::Engine::Instance().OnResolutionGovernor += setGovernorSettings;
+
+		setBicubicUpscale = [this] (bool bEnabled) {
+			_bBicubicUpscale = bEnabled;
+		};
+		engine::Engine::Instance().OnBicubicUpscale += setBicubicUpscale;
+
 		InitFramebuffer();
+		InitDepthPrepass();
 		InitBillboard();
 		InitSSAO();
-		InitDepthCubemap();
+		InitUpscale();
 
 		TextureManager::instance().createTexture("light_bulb_icon", "./img/light_bulb_icon.png", {
 			{ GL_TEXTURE_WRAP_R, GL_WRAP_BORDER },
@@ -597,54 +1042,101 @@ public:
 			{ GL_TEXTURE_MAG_FILTER, GL_NEAREST },
 		}, GL_TEXTURE_2D);
 
-		_light.addVertexShader("shaders/light.vs.glsl")
-			.addFragmentShader("shaders/light.fs.glsl")
-			.link();
-//		assert(_light.isValid());
+		ShaderPermutationDesc light;
+			light.VertexPath = "shaders/light.vs.glsl";
+			light.FragmentPath = "shaders/light.fs.glsl";
+			light.Features = { "COMPACT_GBUFFER", "SSAO" };
+			light.Defines = {
+				{ "MAX_NUM_DIRECTIONAL_LIGHTS", std::to_string(MaxDirectionalLights) },
+				{ "NUM_SHADOW_TIERS", std::to_string(engine::ShadowAtlas::Tiers.size()) },
+			};
+			light.OnLinked = [] (engine::ShaderProgram &variant) {
+				variant.SetUniform1i("gNormal", 0);
+				variant.SetUniform1i("gAlbedoMetallic", 1);
+				variant.SetUniform1i("gRoughness", 2);
+				variant.SetUniform1i("gSSAO", 3);
+				variant.SetUniform1i("gDepth", 4);
+				variant.SetUniform1i("gPosition", 5);
+
+				for (size_t tier = 0; tier < engine::ShadowAtlas::Tiers.size(); tier++) {
+					variant.SetUniform1i("shadowTiers[" + std::to_string(tier) + "]", ShadowTextureUnit + tier);
+				}
+			};
+		_light = ShaderManager::instance().CreatePermutations(std::move(light));
 	}
 
 	~MeshRendererSystem()
 	{
 		engine::Engine::Instance().OnBuildLighting -= buildShadowMap;
+		engine::Engine::Instance().OnCompactGBuffer -= setCompactGBuffer;
+		engine::Engine::Instance().OnDepthPrepass -= setDepthPrepass;
+		engine::Engine::Instance().OnSsao -= setSsao;
+		engine::Engine::Instance().OnShadowFilter -= setShadowFilter;
+		engine::Engine::Instance().OnShadowDepth32 -= setShadowDepth32;
+		engine::Engine::Instance().OnOcclusionCulling -= setOcclusionCulling;
+		engine::Engine::Instance().OnGpuCulling -= setGpuCulling;
+		engine::Engine::Instance().OnResolutionGovernor -= setGovernorSettings;
+		engine::Engine::Instance().OnBicubicUpscale -= setBicubicUpscale;
+		glDeleteVertexArrays(1, &_emptyVao);
+		glDeleteSamplers(1, &_linearSampler);
+		glDeleteBuffers(1, &_ssaoKernelBuffer);
 	}
 
 	void OnUpdate(float __unused deltaTime) override
 	{
 		auto player = GetEntities<PlayerCameraComponent, TransformComponent>();
-		auto display = engine::Engine::Instance().GetDisplay();
-		auto [ width, height ] = std::tuple(display->getWidth(), display->getHeight());
+		glm::ivec2 const displaySize = engine::Engine::Instance().GetDisplaySize();
 
 		if (player.size() == 0) { return ; }
 
 		auto [ playerCamera, playerTransform ] = player[0]->GetAll();
 
-		BakeShadowMap();
+		BuildDrawQueue(playerCamera, playerTransform.position);
+		UpdateLights(playerCamera, playerTransform.position);
+		CullOccluded(playerCamera);
 
-		_gBuffer.Bind();
-			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-			glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-			glEnable(GL_DEPTH_TEST);
-			RenderMeshes(playerCamera, playerTransform);
-			glDisable(GL_DEPTH_TEST);
-		_gBuffer.Unbind();
-
-		glClearColor(0.0f, 0.0, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		RenderLight(playerTransform.position, playerCamera.exposure);
-
-		// Copy depth buffer to default framebuffer to enable depth testing with billboard
-		// and other shaders
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, _gBuffer.GetFramebufferId());
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		glEnable(GL_BLEND);
-		glEnable(GL_DEPTH_TEST);
-			RenderSkybox(playerCamera);
-//			RenderSSAO(playerCamera);
-			RenderLightBillboard(playerCamera);
-		glDisable(GL_DEPTH_TEST);
-		glDisable(GL_BLEND);
+		auto const &quality = UpdateQuality();
+		bool const bUpscale = quality.RenderScale < 1.0f;
+
+		// The targets follow the display, the pool drops the ones of the old size
+		_graph.Reset(displaySize);
+
+		auto backbuffer = _graph.Import("Backbuffer", 0, displaySize);
+		GBuffer gBuffer(_graph, _gBufferLayout, quality.RenderScale);
+
+		// Below the display resolution the scene is lit in its own target, then upscaled
+		auto target = bUpscale ? _graph.Create("Scene color", { GL_RGBA8, quality.RenderScale }) : backbuffer;
+
+		AddGeometryPasses(gBuffer, playerCamera, playerTransform);
+
+		if (_bGpuCulling && _bOcclusionCulling) {
+			AddHiZPass(gBuffer, playerCamera);
+		}
+
+		auto const ssao = _bSsao ? AddSsaoPasses(gBuffer, playerCamera, quality) : engine::RenderGraph::Invalid;
+
+		target = AddLightingPass(gBuffer, ssao, target, playerCamera, playerTransform);
+		target = AddForwardPass(gBuffer, target, playerCamera, !bUpscale);
+
+		if (bUpscale) {
+			AddUpscalePass(target, backbuffer);
+		}
+
+		engine::Engine::Instance().OnBuildRenderGraph(_graph);
+
+		_graph.Compile();
+		_graph.Execute();
+
+		auto &stats = engine::RenderStats::Instance();
+		stats.bHasPipelineStatistics = _geometryFragments.IsSupported();
+		stats.PrepassFragments = _bDepthPrepass ? _prepassFragments.GetResult() : 0;
+		stats.GeometryFragments = _geometryFragments.GetResult();
+		stats.RenderPasses = _graph.GetPassCount();
+		stats.CulledPasses = _graph.GetCulledCount();
+		stats.TransientTargets = _graph.GetTransientCount();
+		stats.TargetTextures = _graph.GetTextureCount();
+		stats.TargetBytes = _graph.GetTextureBytes();
+
+		_frameIndex++;
 	}
 };
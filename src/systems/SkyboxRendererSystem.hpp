@@ -8,6 +8,7 @@
 #include "components/MeshComponent.hpp"
 #include "Engine.hpp"
 #include "TextureManager.hpp"
+#include "GLState.hpp"
 #include <fmt/format.h>
 
 using namespace std::placeholders;
@@ -15,14 +16,14 @@ using namespace std::placeholders;
 class SkyboxRendererSystem : public ecs::ComponentSystem
 {
 private:
-	lazy::graphics::Shader _shader;
+	engine::ShaderProgram _shader;
 
 public:
 	SkyboxRendererSystem()
 	{
-		_shader.addVertexShader("shaders/cubemap.vs.glsl")
-			.addFragmentShader("shaders/cubemap.fs.glsl")
-			.link();
+		_shader.AddVertexShader("shaders/cubemap.vs.glsl")
+			.AddFragmentShader("shaders/cubemap.fs.glsl")
+			.Link();
 	}
 
 	void OnUpdate(float __unused deltaTime) override
@@ -37,15 +38,15 @@ public:
 		auto [ meshComponent, _ ] = skybox[0]->GetAll();
 		auto mesh = engine::Engine::Instance().GetMesh(meshComponent.Id);
 
-		_shader.bind();
-		_shader.setUniform4x4f("viewMatrix", glm::mat4(glm::mat3(cameraData.view)));
-		_shader.setUniform4x4f("projectionMatrix", cameraData.projection);
+		auto &state = engine::GLState::Instance();
 
-		glDepthMask(GL_FALSE);
+		_shader.Bind();
+		_shader.SetUniform4x4f("viewMatrix", glm::mat4(glm::mat3(cameraData.view)));
+		_shader.SetUniform4x4f("projectionMatrix", cameraData.projection);
+
+		state.DepthWrite(false);
 		TextureManager::instance().bind("skybox-cubemap", 0);
 		mesh->Draw();
-		glDepthMask(GL_TRUE);
-
-		_shader.unbind();
+		state.DepthWrite(true);
 	}
 };
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "Benchmark.hpp"
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+
+using namespace engine;
+
+TEST(Benchmark, Nearest_Rank_Percentiles)
+{
+	std::vector<float> samples;
+
+	// In reverse order, Summarize sorts its copy
+	for (int i = 100; i >= 1; i--) {
+		samples.push_back(static_cast<float>(i));
+	}
+
+	FrameTimeSummary const summary = Summarize(samples);
+
+	EXPECT_FLOAT_EQ(summary.Mean, 50.5f);
+	EXPECT_FLOAT_EQ(summary.P50, 50.0f);
+	EXPECT_FLOAT_EQ(summary.P90, 90.0f);
+	EXPECT_FLOAT_EQ(summary.P99, 99.0f);
+	EXPECT_FLOAT_EQ(summary.Max, 100.0f);
+}
+
+TEST(Benchmark, Summary_Of_Few_Samples)
+{
+	EXPECT_FLOAT_EQ(Summarize({}).Max, 0.0f);
+
+	FrameTimeSummary const summary = Summarize({ 4.0f, 2.0f });
+
+	EXPECT_FLOAT_EQ(summary.P50, 2.0f);
+	EXPECT_FLOAT_EQ(summary.P99, 4.0f);
+}
+
+TEST(Benchmark, Path_Goes_Through_Its_Keys)
+{
+	CameraPath const path({
+		{ glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f) },
+		{ glm::vec3(10.0f, 0.0f, 0.0f), glm::vec3(10.0f, 0.0f, 1.0f) },
+		{ glm::vec3(20.0f, 5.0f, 0.0f), glm::vec3(20.0f, 5.0f, 1.0f) },
+	});
+
+	EXPECT_FLOAT_EQ(path.Sample(0.0f).Position.x, 0.0f);
+	EXPECT_FLOAT_EQ(path.Sample(0.5f).Position.x, 10.0f);
+	EXPECT_FLOAT_EQ(path.Sample(1.0f).Position.y, 5.0f);
+	EXPECT_FLOAT_EQ(path.Sample(2.0f).Position.x, 20.0f);
+
+	float const between = path.Sample(0.25f).Position.x;
+	EXPECT_GT(between, 0.0f);
+	EXPECT_LT(between, 10.0f);
+}
+
+TEST(Benchmark, Orbit_Is_Closed)
+{
+	CameraPath const path = CameraPath::Orbit(glm::vec3(1.0f, 2.0f, 3.0f), 10.0f, 5.0f, 9);
+	CameraKey const first = path.Sample(0.0f);
+	CameraKey const last = path.Sample(1.0f);
+
+	EXPECT_EQ(path.GetKeyCount(), 9u);
+	EXPECT_NEAR(first.Position.x, last.Position.x, 1e-4f);
+	EXPECT_NEAR(first.Position.z, last.Position.z, 1e-4f);
+	EXPECT_FLOAT_EQ(first.Position.y, 7.0f);
+	EXPECT_FLOAT_EQ(first.Target.x, 1.0f);
+}
+
+TEST(Benchmark, Loads_A_Path_File)
+{
+	char const *file = "benchmark_path.txt";
+
+	std::ofstream(file) << "# position target\n\n0 1 2 3 4 5\n  6 7 8 9 10 11\n";
+	auto const path = CameraPath::Load(file);
+
+	ASSERT_TRUE(path.has_value());
+	EXPECT_EQ(path->GetKeyCount(), 2u);
+	EXPECT_FLOAT_EQ(path->Sample(1.0f).Target.z, 11.0f);
+
+	std::ofstream(file) << "0 1 2 3\n";
+	EXPECT_FALSE(CameraPath::Load(file).has_value());
+
+	std::remove(file);
+	EXPECT_FALSE(CameraPath::Load(file).has_value());
+}
+
+TEST(Benchmark, Writes_Json)
+{
+	BenchmarkReport report;
+	report.Level = "Main\"Level";
+	report.Width = 64;
+	report.Height = 32;
+	report.StartupMs = 12.5f;
+	report.CachedPrograms = 7;
+	report.CpuFrameTimes = { 1.0f, 2.0f, 3.0f };
+	report.GpuFrameTimes = { 0.5f, 0.5f, 0.5f };
+	report.GpuPasses = { { "Geometry", 0.25f }, { "Lighting", 0.125f } };
+
+	std::ostringstream out;
+	WriteJson(out, report);
+	std::string const json = out.str();
+
+	EXPECT_NE(json.find("\"level\": \"Main\\\"Level\""), std::string::npos);
+	EXPECT_NE(json.find("\"frames\": 3"), std::string::npos);
+	EXPECT_NE(json.find("\"startup_ms\": 12.500"), std::string::npos);
+	EXPECT_NE(json.find("\"program_cache\": { \"hits\": 7, \"misses\": 0"), std::string::npos);
+	EXPECT_NE(json.find("\"cpu_ms\": { \"mean\": 2.000, \"p50\": 2.000, \"p90\": 3.000"), std::string::npos);
+	EXPECT_NE(json.find("\"Lighting\": 0.125"), std::string::npos);
+
+	// The stream is left as it was given
+	out << 0.5f;
+	EXPECT_EQ(out.str().substr(json.size()), "0.5");
+}
+
+TEST(Benchmark, Writes_Counters)
+{
+	BenchmarkReport report;
+	report.CpuFrameTimes = { 1.0f };
+	report.Counters.DrawCalls = 12;
+	report.Counters.Triangles = 3000;
+	report.Counters.TextureBytes = 64;
+
+	PassCounters shadows{ "Shadows", {} };
+	shadows.Counters.DrawCalls = 4;
+	shadows.Counters.ProgramBinds = 1;
+	report.CountersByPass = { shadows, { "Geometry", {} } };
+
+	std::ostringstream out;
+	WriteJson(out, report);
+	std::string const json = out.str();
+
+	EXPECT_NE(json.find("\"counters\": { \"draws\": 12, \"instances\": 0, \"triangles\": 3000"), std::string::npos);
+	EXPECT_NE(json.find("\"texture_bytes\": 64 }"), std::string::npos);
+	EXPECT_NE(json.find("\"pass_counters\": {"), std::string::npos);
+	EXPECT_NE(json.find("\"Shadows\": { \"draws\": 4, \"instances\": 0, \"triangles\": 0, \"programs\": 1"), std::string::npos);
+	EXPECT_NE(json.find("\"Geometry\": { \"draws\": 0"), std::string::npos);
+	for (char const *key : { "\"vaos\"", "\"textures\"", "\"uniforms\"", "\"buffer_bytes\"" }) {
+		EXPECT_NE(json.find(key), std::string::npos) << key;
+	}
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "ResolutionGovernor.hpp"
+
+using namespace engine;
+
+static GovernorSettings TestSettings()
+{
+	GovernorSettings settings;
+	settings.bEnabled = true;
+	settings.BudgetMs = 10.0f;
+	settings.MinScale = 0.5f;
+	settings.ScaleStep = 0.25f;
+	settings.Window = 4;
+	settings.Cooldown = 2;
+	return settings;
+}
+
+/// Feed frames of a constant time until the quality changes or `frames` ran out
+static bool Feed(ResolutionGovernor &governor, float milliseconds, size_t frames)
+{
+	for (size_t i = 0; i < frames; i++) {
+		if (governor.Update(milliseconds)) { return true; }
+	}
+	return false;
+}
+
+TEST(ResolutionGovernor, Disabled_Keeps_Max_Scale)
+{
+	GovernorSettings settings = TestSettings();
+	settings.bEnabled = false;
+	settings.MaxScale = 0.75f;
+
+	ResolutionGovernor governor(settings);
+
+	EXPECT_FALSE(Feed(governor, 100.0f, 100));
+	EXPECT_EQ(governor.GetLevelCount(), 1u);
+	EXPECT_FLOAT_EQ(governor.GetQuality().RenderScale, 0.75f);
+}
+
+TEST(ResolutionGovernor, Steps_Down_The_Ladder)
+{
+	ResolutionGovernor governor(TestSettings());
+
+	// 1.0, 0.75, 0.5, reduced SSAO, two shadow steps
+	ASSERT_EQ(governor.GetLevelCount(), 6u);
+
+	EXPECT_TRUE(Feed(governor, 20.0f, 4));
+	EXPECT_FLOAT_EQ(governor.GetQuality().RenderScale, 0.75f);
+
+	EXPECT_TRUE(Feed(governor, 20.0f, 6));
+	EXPECT_FLOAT_EQ(governor.GetQuality().RenderScale, 0.5f);
+	EXPECT_FALSE(governor.GetQuality().bReducedSsao);
+
+	EXPECT_TRUE(Feed(governor, 20.0f, 6));
+	EXPECT_TRUE(governor.GetQuality().bReducedSsao);
+
+	EXPECT_TRUE(Feed(governor, 20.0f, 6));
+	EXPECT_TRUE(Feed(governor, 20.0f, 6));
+	EXPECT_EQ(governor.GetQuality().ShadowShift, ResolutionGovernor::MaxShadowShift);
+
+	EXPECT_FALSE(Feed(governor, 20.0f, 100));
+}
+
+TEST(ResolutionGovernor, Waits_For_The_Cooldown)
+{
+	ResolutionGovernor governor(TestSettings());
+
+	ASSERT_TRUE(Feed(governor, 20.0f, 4));
+
+	// Two frames ignored, then a full window
+	EXPECT_FALSE(Feed(governor, 20.0f, 5));
+	EXPECT_TRUE(governor.Update(20.0f));
+}
+
+TEST(ResolutionGovernor, Hysteresis_Prevents_Oscillation)
+{
+	ResolutionGovernor governor(TestSettings());
+
+	ASSERT_TRUE(Feed(governor, 12.0f, 4));
+	ASSERT_FLOAT_EQ(governor.GetQuality().RenderScale, 0.75f);
+
+	// Under budget, but going back to full resolution would cost 8 * (1 / 0.75)^2 > 8.5 ms
+	EXPECT_FALSE(Feed(governor, 8.0f, 100));
+	EXPECT_FLOAT_EQ(governor.GetQuality().RenderScale, 0.75f);
+
+	// 4 * (1 / 0.75)^2 fits in the headroom
+	EXPECT_TRUE(Feed(governor, 4.0f, 100));
+	EXPECT_FLOAT_EQ(governor.GetQuality().RenderScale, 1.0f);
+}
+
+TEST(ResolutionGovernor, Settings_Keep_The_Current_Quality)
+{
+	ResolutionGovernor governor(TestSettings());
+
+	ASSERT_TRUE(Feed(governor, 20.0f, 4));
+
+	GovernorSettings settings = TestSettings();
+	settings.BudgetMs = 12.0f;
+	settings.bAdjustShadows = false;
+	governor.SetSettings(settings);
+
+	EXPECT_EQ(governor.GetLevelCount(), 4u);
+	EXPECT_FLOAT_EQ(governor.GetQuality().RenderScale, 0.75f);
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include "OcclusionCuller.hpp"
+
+using namespace engine;
+
+/// Square facing the camera, centered on the view axis
+static std::vector<float> const QuadPositions = {
+	-1.0f, -1.0f, 0.0f,
+	 1.0f, -1.0f, 0.0f,
+	 1.0f,  1.0f, 0.0f,
+	-1.0f,  1.0f, 0.0f,
+};
+
+static std::vector<unsigned int> const QuadIndices = { 0, 1, 2, 0, 2, 3 };
+
+struct OcclusionTest : testing::Test
+{
+	OcclusionCuller Culler;
+	glm::mat4 ViewProjection;
+
+	OcclusionTest() : Culler(64, 36, 1)
+	{
+		// Camera at the origin looking down -z
+		ViewProjection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+		Culler.BeginFrame(ViewProjection);
+	}
+
+	/// Occluder quad of half-size `size` at depth `z`
+	void AddWall(float z, float size)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, z));
+		model = glm::scale(model, glm::vec3(size, size, 1.0f));
+
+		Culler.AddOccluder(QuadPositions, QuadIndices, model);
+	}
+
+	static Aabb Box(glm::vec3 const &center, float size)
+	{
+		return Aabb(center - size, center + size);
+	}
+};
+
+TEST_F(OcclusionTest, Empty_Buffer_Hides_Nothing)
+{
+	Culler.Rasterize();
+
+	EXPECT_TRUE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -50.0f), 1.0f)));
+	EXPECT_TRUE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -1.0f), 0.1f)));
+}
+
+TEST_F(OcclusionTest, Wall_Hides_Box_Behind)
+{
+	AddWall(-10.0f, 100.0f);
+	Culler.Rasterize();
+
+	EXPECT_EQ(2u, Culler.GetTriangleCount());
+	EXPECT_FALSE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -20.0f), 1.0f)));
+	EXPECT_FALSE(Culler.IsVisible(Box(glm::vec3(8.0f, 3.0f, -40.0f), 4.0f)));
+}
+
+TEST_F(OcclusionTest, Wall_Does_Not_Hide_Box_In_Front)
+{
+	AddWall(-10.0f, 100.0f);
+	Culler.Rasterize();
+
+	EXPECT_TRUE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -5.0f), 1.0f)));
+}
+
+TEST_F(OcclusionTest, Box_Crossing_Wall_Is_Visible)
+{
+	AddWall(-10.0f, 100.0f);
+	Culler.Rasterize();
+
+	EXPECT_TRUE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f)));
+}
+
+TEST_F(OcclusionTest, Partially_Covered_Box_Is_Visible)
+{
+	AddWall(-10.0f, 2.0f);
+	Culler.Rasterize();
+
+	EXPECT_FALSE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -20.0f), 1.0f)));
+	EXPECT_TRUE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -20.0f), 8.0f)));
+	EXPECT_TRUE(Culler.IsVisible(Box(glm::vec3(10.0f, 0.0f, -20.0f), 1.0f)));
+}
+
+TEST_F(OcclusionTest, Box_Around_Camera_Is_Visible)
+{
+	AddWall(-1.0f, 100.0f);
+	Culler.Rasterize();
+
+	EXPECT_TRUE(Culler.IsVisible(Box(glm::vec3(0.0f), 5.0f)));
+}
+
+TEST_F(OcclusionTest, Box_Outside_View_Is_Not_Visible)
+{
+	Culler.Rasterize();
+
+	EXPECT_FALSE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, 20.0f), 1.0f)));
+	EXPECT_FALSE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -500.0f), 1.0f)));
+}
+
+TEST_F(OcclusionTest, Back_Faces_Do_Not_Occlude)
+{
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f));
+	model = glm::scale(model, glm::vec3(-100.0f, 100.0f, 1.0f));
+
+	Culler.AddOccluder(QuadPositions, QuadIndices, model);
+	Culler.Rasterize();
+
+	EXPECT_EQ(0u, Culler.GetTriangleCount());
+	EXPECT_TRUE(Culler.IsVisible(Box(glm::vec3(0.0f, 0.0f, -20.0f), 1.0f)));
+}
+
+TEST_F(OcclusionTest, Pyramid_Bounds_Depth)
+{
+	AddWall(-10.0f, 2.0f);
+	Culler.Rasterize();
+
+	ASSERT_GT(Culler.GetLevelCount(), 1u);
+
+	for (size_t level = 1; level < Culler.GetLevelCount(); level++) {
+		int const width = std::max(Culler.GetWidth() >> level, 1);
+
+		for (int x = 0; x < width; x++) {
+			EXPECT_LE(Culler.GetMinDepth(level, x, 0), Culler.GetMaxDepth(level, x, 0));
+			EXPECT_LE(Culler.GetMinDepth(level, x, 0), Culler.GetMinDepth(level - 1, x * 2, 0));
+			EXPECT_GE(Culler.GetMaxDepth(level, x, 0), Culler.GetMaxDepth(level - 1, x * 2, 0));
+		}
+	}
+
+	size_t const top = Culler.GetLevelCount() - 1;
+	EXPECT_LT(Culler.GetMinDepth(top, 0, 0), 1.0f);
+	EXPECT_EQ(1.0f, Culler.GetMaxDepth(top, 0, 0));
+}
+
+TEST(Occlusion, Threads_Produce_The_Same_Depth)
+{
+	glm::mat4 const viewProjection = glm::perspective(glm::radians(70.0f), 1.0f, 0.1f, 100.0f);
+
+	OcclusionCuller single(128, 128, 1);
+	OcclusionCuller multiple(128, 128, 5);
+
+	for (auto *culler : { &single, &multiple }) {
+		culler->BeginFrame(viewProjection);
+
+		for (int i = 0; i < 8; i++) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(i - 4.0f, i * 0.5f - 2.0f, -5.0f - i));
+			model = glm::rotate(model, i * 0.3f, glm::vec3(0.0f, 0.0f, 1.0f));
+
+			culler->AddOccluder(QuadPositions, QuadIndices, model);
+		}
+		culler->Rasterize();
+	}
+
+	for (int y = 0; y < 128; y++) {
+		for (int x = 0; x < 128; x++) {
+			ASSERT_EQ(single.GetDepth(x, y), multiple.GetDepth(x, y));
+		}
+	}
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <random>
+#include "MeshOptimizer.hpp"
+
+using namespace engine;
+
+///
+/// Grid of `size` x `size` quads in the xy plane facing +z, triangles in a shuffled order
+///
+struct ShuffledGrid
+{
+	std::vector<float> Positions;
+	std::vector<unsigned int> Indices;
+
+	ShuffledGrid(unsigned int size)
+	{
+		for (unsigned int y = 0; y <= size; y++) {
+			for (unsigned int x = 0; x <= size; x++) {
+				Positions.insert(Positions.end(), { static_cast<float>(x), static_cast<float>(y), 0.0f });
+			}
+		}
+
+		std::vector<std::array<unsigned int, 3>> triangles;
+
+		for (unsigned int y = 0; y < size; y++) {
+			for (unsigned int x = 0; x < size; x++) {
+				unsigned int const i = y * (size + 1) + x;
+
+				triangles.push_back({ i, i + 1, i + size + 2 });
+				triangles.push_back({ i, i + size + 2, i + size + 1 });
+			}
+		}
+
+		// Fisher-Yates with a fixed seed, std::shuffle is not the same everywhere
+		std::mt19937 random(42);
+		for (size_t i = triangles.size() - 1; i > 0; i--) {
+			std::swap(triangles[i], triangles[random() % (i + 1)]);
+		}
+
+		for (auto const &t : triangles) {
+			Indices.insert(Indices.end(), t.begin(), t.end());
+		}
+	}
+
+	size_t VertexCount() const { return Positions.size() / 3; }
+};
+
+///
+/// Triangles rotated to start with their smallest index, which keeps the winding, then sorted
+///
+static std::vector<std::array<unsigned int, 3>> Triangles(std::vector<unsigned int> const &indices)
+{
+	std::vector<std::array<unsigned int, 3>> triangles;
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		std::array<unsigned int, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+		std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+		triangles.push_back(t);
+	}
+
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+TEST(OptimizerTest, Single_Triangle_Statistics)
+{
+	auto const stats = MeshOptimizer::AnalyzeVertexCache({ 0, 1, 2 }, 3);
+
+	EXPECT_FLOAT_EQ(stats.Acmr, 3.0f);
+	EXPECT_FLOAT_EQ(stats.Atvr, 1.0f);
+}
+
+TEST(OptimizerTest, Vertex_Cache_Lowers_Acmr)
+{
+	ShuffledGrid const grid(64);
+
+	auto const optimized = MeshOptimizer::OptimizeVertexCache(grid.Indices, grid.VertexCount());
+
+	auto const before = MeshOptimizer::AnalyzeVertexCache(grid.Indices, grid.VertexCount());
+	auto const after = MeshOptimizer::AnalyzeVertexCache(optimized, grid.VertexCount());
+
+	EXPECT_GT(before.Acmr, 2.0f);
+	EXPECT_LT(after.Acmr, 0.8f);
+	EXPECT_LT(after.Atvr, before.Atvr);
+	EXPECT_EQ(Triangles(optimized), Triangles(grid.Indices));
+}
+
+TEST(OptimizerTest, Passes_Are_Deterministic)
+{
+	ShuffledGrid const grid(32);
+
+	auto const a = MeshOptimizer::OptimizeOverdraw(
+		MeshOptimizer::OptimizeVertexCache(grid.Indices, grid.VertexCount()), grid.Positions);
+	auto const b = MeshOptimizer::OptimizeOverdraw(
+		MeshOptimizer::OptimizeVertexCache(grid.Indices, grid.VertexCount()), grid.Positions);
+
+	EXPECT_EQ(a, b);
+}
+
+TEST(OptimizerTest, Overdraw_Keeps_Triangles_And_Cache_Efficiency)
+{
+	ShuffledGrid const grid(64);
+
+	auto const cached = MeshOptimizer::OptimizeVertexCache(grid.Indices, grid.VertexCount());
+	auto const sorted = MeshOptimizer::OptimizeOverdraw(cached, grid.Positions);
+
+	auto const before = MeshOptimizer::AnalyzeVertexCache(cached, grid.VertexCount());
+	auto const after = MeshOptimizer::AnalyzeVertexCache(sorted, grid.VertexCount());
+
+	EXPECT_EQ(Triangles(sorted), Triangles(cached));
+	EXPECT_LE(after.Acmr, before.Acmr * MeshOptimizer::OverdrawThreshold * 1.05f);
+}
+
+TEST(OptimizerTest, Outer_Clusters_Come_First)
+{
+	// Two quads facing +z, the one at z = -1 faces the center of the mesh and is behind
+	// the one at z = 1 from every point of view that sees both
+	std::vector<float> const positions = {
+		0, 0, -1,  1, 0, -1,  1, 1, -1,  0, 1, -1,
+		0, 0,  1,  1, 0,  1,  1, 1,  1,  0, 1,  1,
+	};
+	std::vector<unsigned int> const indices = {
+		0, 1, 2,  0, 2, 3,
+		4, 5, 6,  4, 6, 7,
+	};
+
+	auto const sorted = MeshOptimizer::OptimizeOverdraw(indices, positions);
+
+	std::vector<unsigned int> const expected = {
+		4, 5, 6,  4, 6, 7,
+		0, 1, 2,  0, 2, 3,
+	};
+	EXPECT_EQ(sorted, expected);
+}
+
+TEST(OptimizerTest, Vertex_Fetch_Follows_First_Use)
+{
+	std::vector<unsigned int> indices = { 3, 1, 4,  4, 1, 0 };
+
+	auto const order = MeshOptimizer::OptimizeVertexFetch(indices, 6);
+
+	std::vector<unsigned int> const expectedIndices = { 0, 1, 2,  2, 1, 3 };
+	// Vertices 2 and 5 are not used and go last
+	std::vector<unsigned int> const expectedOrder = { 3, 1, 4, 0, 2, 5 };
+
+	EXPECT_EQ(indices, expectedIndices);
+	EXPECT_EQ(order, expectedOrder);
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "SkylinePacker.hpp"
+
+using namespace engine;
+
+struct Rect
+{
+	int X;
+	int Y;
+	int Width;
+	int Height;
+
+	bool Overlaps(Rect const &other) const
+	{
+		return X < other.X + other.Width && other.X < X + Width
+			&& Y < other.Y + other.Height && other.Y < Y + Height;
+	}
+};
+
+TEST(SkylinePacker, Packs_Bottom_Left)
+{
+	SkylinePacker packer(32, 32);
+
+	auto const first = packer.Pack(10, 10);
+	auto const second = packer.Pack(10, 20);
+	auto const third = packer.Pack(20, 5);
+
+	ASSERT_TRUE(first && second && third);
+	EXPECT_EQ(first->X, 0);
+	EXPECT_EQ(first->Y, 0);
+	EXPECT_EQ(second->X, 10);
+	EXPECT_EQ(second->Y, 0);
+	// Too wide for the remaining 12 columns, rests on the lowest segments it spans
+	EXPECT_EQ(third->X, 0);
+	EXPECT_EQ(third->Y, 20);
+}
+
+TEST(SkylinePacker, No_Overlap)
+{
+	SkylinePacker packer(256, 256);
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int> size(1, 24);
+	std::vector<Rect> packed;
+
+	for (int i = 0; i < 300; i++) {
+		int const width = size(random);
+		int const height = size(random);
+		auto const position = packer.Pack(width, height);
+
+		if (!position) { continue ; }
+
+		Rect const rect{ position->X, position->Y, width, height };
+
+		EXPECT_GE(rect.X, 0);
+		EXPECT_GE(rect.Y, 0);
+		EXPECT_LE(rect.X + rect.Width, packer.GetWidth());
+		EXPECT_LE(rect.Y + rect.Height, packer.GetHeight());
+
+		for (auto const &other : packed) {
+			ASSERT_FALSE(rect.Overlaps(other));
+		}
+		packed.push_back(rect);
+	}
+
+	// Small rectangles should fill most of the area before it is full
+	EXPECT_GT(packed.size(), 150u);
+}
+
+TEST(SkylinePacker, Grow_Makes_Room)
+{
+	SkylinePacker packer(16, 16);
+
+	ASSERT_TRUE(packer.Pack(16, 16));
+	EXPECT_FALSE(packer.Pack(4, 4));
+	EXPECT_FALSE(packer.Pack(17, 1));
+
+	packer.Grow(32);
+
+	auto const position = packer.Pack(4, 4);
+	ASSERT_TRUE(position);
+	EXPECT_EQ(position->Y, 16);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "ShaderPreprocessor.hpp"
+#include <map>
+
+using namespace engine;
+
+static ShaderPreprocessor::Loader Files(std::map<std::string, std::string> files)
+{
+	return [files] (std::string const &path) -> std::optional<std::string> {
+		auto const file = files.find(path);
+		if (file == files.end()) { return std::nullopt; }
+		return file->second;
+	};
+}
+
+TEST(ShaderPreprocessor, Defines_Follow_Version)
+{
+	ShaderPreprocessor preprocessor(Files({
+		{ "a.glsl", "#version 450 core\nvoid main() {}\n" },
+	}));
+
+	auto const source = preprocessor.Process("a.glsl", { { "ALBEDO_MAP", "1" }, { "LIGHTS", "4" } });
+
+	ASSERT_TRUE(source.has_value());
+	EXPECT_EQ(source.value(), "#version 450 core\n#define ALBEDO_MAP 1\n#define LIGHTS 4\n#line 2 0\nvoid main() {}\n");
+}
+
+TEST(ShaderPreprocessor, Defines_Without_Version)
+{
+	ShaderPreprocessor preprocessor(Files({ { "a.glsl", "int a;\n" } }));
+
+	EXPECT_EQ(preprocessor.Process("a.glsl", { { "A", "1" } }).value(), "#define A 1\n#line 1 0\nint a;\n");
+}
+
+TEST(ShaderPreprocessor, Includes_Relative_To_The_File)
+{
+	ShaderPreprocessor preprocessor(Files({
+		{ "shaders/a.glsl", "#version 450 core\n#include \"include/b.glsl\"\nvoid main() {}\n" },
+		{ "shaders/include/b.glsl", "int b;\n" },
+	}));
+
+	auto const source = preprocessor.Process("shaders/a.glsl");
+
+	ASSERT_TRUE(source.has_value());
+	EXPECT_EQ(source.value(), "#version 450 core\n#line 1 1\nint b;\n#line 3 0\nvoid main() {}\n");
+	ASSERT_EQ(preprocessor.GetFiles().size(), 2u);
+	EXPECT_EQ(preprocessor.GetFiles()[1], "shaders/include/b.glsl");
+}
+
+TEST(ShaderPreprocessor, Includes_Once)
+{
+	ShaderPreprocessor preprocessor(Files({
+		{ "a.glsl", "#include \"b.glsl\"\n#include \"c.glsl\"\n" },
+		{ "b.glsl", "#include \"c.glsl\"\nint b;\n" },
+		{ "c.glsl", "#include \"b.glsl\"\nint c;\n" },
+	}));
+
+	auto const source = preprocessor.Process("a.glsl");
+
+	ASSERT_TRUE(source.has_value());
+	EXPECT_EQ(source->find("int b;"), source->rfind("int b;"));
+	EXPECT_EQ(source->find("int c;"), source->rfind("int c;"));
+	EXPECT_LT(source->find("int c;"), source->find("int b;"));
+}
+
+TEST(ShaderPreprocessor, Reports_Errors)
+{
+	ShaderPreprocessor preprocessor(Files({
+		{ "a.glsl", "#include \"missing.glsl\"\n" },
+		{ "b.glsl", "  #include missing.glsl\n" },
+	}));
+
+	EXPECT_FALSE(preprocessor.Process("a.glsl").has_value());
+	EXPECT_EQ(preprocessor.GetError(), "Could not open missing.glsl");
+
+	EXPECT_FALSE(preprocessor.Process("b.glsl").has_value());
+	EXPECT_EQ(preprocessor.GetError(), "b.glsl:1: malformed #include");
+
+	EXPECT_FALSE(preprocessor.Process("c.glsl").has_value());
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "MeshSimplifier.hpp"
+
+using namespace engine;
+
+///
+/// Grid of `size` x `size` quads in the xy plane facing +z, `height` displaces the vertices
+///
+struct Grid
+{
+	std::vector<float> Positions;
+	std::vector<unsigned int> Indices;
+
+	Grid(unsigned int size, float (*height)(float, float) = nullptr)
+	{
+		for (unsigned int y = 0; y <= size; y++) {
+			for (unsigned int x = 0; x <= size; x++) {
+				float const fx = static_cast<float>(x) / size;
+				float const fy = static_cast<float>(y) / size;
+
+				Positions.push_back(fx);
+				Positions.push_back(fy);
+				Positions.push_back(height ? height(fx, fy) : 0.0f);
+			}
+		}
+
+		for (unsigned int y = 0; y < size; y++) {
+			for (unsigned int x = 0; x < size; x++) {
+				unsigned int const i = y * (size + 1) + x;
+
+				Indices.insert(Indices.end(), { i, i + 1, i + size + 2 });
+				Indices.insert(Indices.end(), { i, i + size + 2, i + size + 1 });
+			}
+		}
+	}
+
+	glm::vec3 Position(unsigned int index) const
+	{
+		return glm::vec3(Positions[index * 3], Positions[index * 3 + 1], Positions[index * 3 + 2]);
+	}
+
+	glm::vec3 Normal(std::vector<unsigned int> const &indices, size_t triangle) const
+	{
+		glm::vec3 const p0 = Position(indices[triangle * 3]);
+		return glm::cross(Position(indices[triangle * 3 + 1]) - p0, Position(indices[triangle * 3 + 2]) - p0);
+	}
+};
+
+static float Bump(float x, float y)
+{
+	return 0.2f * std::sin(x * 3.0f) * std::cos(y * 3.0f);
+}
+
+TEST(Simplifier, Flat_Grid_Reaches_Target)
+{
+	Grid const grid(16);
+	MeshSimplifier simplifier(grid.Positions, grid.Indices);
+
+	float error = 1.0f;
+	auto const result = simplifier.Simplify(grid.Indices, grid.Indices.size() / 4, 0.01f, &error);
+
+	EXPECT_LE(result.size(), grid.Indices.size() / 4);
+	EXPECT_EQ(0u, result.size() % 3);
+	EXPECT_LT(error, 1e-4f);
+}
+
+TEST(Simplifier, Triangles_Keep_Their_Orientation)
+{
+	Grid const grid(16);
+	MeshSimplifier simplifier(grid.Positions, grid.Indices);
+
+	auto const result = simplifier.Simplify(grid.Indices, 0, 0.01f);
+
+	ASSERT_FALSE(result.empty());
+	for (size_t i = 0; i < result.size() / 3; i++) {
+		EXPECT_GT(grid.Normal(result, i).z, 0.0f);
+	}
+}
+
+TEST(Simplifier, Border_Is_Locked)
+{
+	Grid const grid(8);
+	MeshSimplifier simplifier(grid.Positions, grid.Indices);
+
+	auto const result = simplifier.Simplify(grid.Indices, 0, 1.0f);
+
+	for (unsigned int i = 0; i < grid.Positions.size() / 3; i++) {
+		glm::vec3 const p = grid.Position(i);
+		bool const bBorder = p.x == 0.0f || p.y == 0.0f || p.x == 1.0f || p.y == 1.0f;
+
+		EXPECT_EQ(bBorder, simplifier.IsLocked(i));
+
+		if (bBorder) {
+			EXPECT_NE(result.end(), std::find(result.begin(), result.end(), i));
+		}
+	}
+}
+
+TEST(Simplifier, Seam_Is_Locked)
+{
+	Grid grid(8);
+
+	// Split the middle column: the right half uses copies of its vertices
+	unsigned int const column = 4;
+	unsigned int const firstCopy = static_cast<unsigned int>(grid.Positions.size() / 3);
+
+	for (unsigned int y = 0; y <= 8; y++) {
+		glm::vec3 const p = grid.Position(y * 9 + column);
+		grid.Positions.insert(grid.Positions.end(), { p.x, p.y, p.z });
+	}
+
+	for (size_t t = 0; t < grid.Indices.size() / 3; t++) {
+		float centerX = 0.0f;
+		for (size_t k = 0; k < 3; k++) {
+			centerX += grid.Position(grid.Indices[t * 3 + k]).x / 3.0f;
+		}
+		if (centerX < 0.5f) { continue ; }
+
+		for (size_t k = 0; k < 3; k++) {
+			unsigned int &index = grid.Indices[t * 3 + k];
+			if (index % 9 == column) {
+				index = firstCopy + index / 9;
+			}
+		}
+	}
+
+	MeshSimplifier simplifier(grid.Positions, grid.Indices);
+
+	for (unsigned int y = 0; y <= 8; y++) {
+		EXPECT_TRUE(simplifier.IsLocked(y * 9 + column));
+		EXPECT_TRUE(simplifier.IsLocked(firstCopy + y));
+	}
+	EXPECT_FALSE(simplifier.IsLocked(4 * 9 + 2));
+}
+
+TEST(Simplifier, Error_Bound_Is_Respected)
+{
+	Grid const grid(24, Bump);
+	MeshSimplifier simplifier(grid.Positions, grid.Indices);
+
+	float error = 1.0f;
+	auto const result = simplifier.Simplify(grid.Indices, 0, 0.001f, &error);
+
+	EXPECT_LT(result.size(), grid.Indices.size());
+	EXPECT_LE(error, 0.001f);
+}
+
+TEST(Simplifier, Lods_Get_Coarser)
+{
+	Grid const grid(32, Bump);
+	MeshSimplifier simplifier(grid.Positions, grid.Indices);
+
+	auto const lods = simplifier.GenerateLods(grid.Indices);
+
+	ASSERT_FALSE(lods.empty());
+	EXPECT_LE(lods.size(), MeshSimplifier::MaxLods);
+
+	size_t previous = grid.Indices.size();
+
+	for (auto const &lod : lods) {
+		EXPECT_LT(lod.size(), previous);
+		EXPECT_EQ(0u, lod.size() % 3);
+
+		for (size_t i = 0; i < lod.size(); i += 3) {
+			EXPECT_LT(lod[i], grid.Positions.size() / 3);
+			EXPECT_TRUE(lod[i] != lod[i + 1] && lod[i + 1] != lod[i + 2] && lod[i] != lod[i + 2]);
+		}
+		previous = lod.size();
+	}
+}
+
+TEST(Simplifier, Small_Meshes_Have_No_Lod)
+{
+	Grid const grid(2);
+	MeshSimplifier simplifier(grid.Positions, grid.Indices);
+
+	EXPECT_TRUE(simplifier.GenerateLods(grid.Indices).empty());
+}